@@ -942,40 +942,41 @@ LSTATUS WINAPI RegQueryMultipleValuesA( HKEY hkey, PVALENTA val_list, DWORD num_
 LSTATUS WINAPI RegQueryMultipleValuesW( HKEY hkey, PVALENTW val_list, DWORD num_vals,
                                      LPWSTR lpValueBuf, LPDWORD ldwTotsize )
 {
+    KEY_MULTIPLE_VALUE_INFORMATION *info;
+    UNICODE_STRING *names;
+    NTSTATUS status;
     unsigned int i;
-    DWORD maxBytes = *ldwTotsize;
-    HRESULT status;
-    LPSTR bufptr = (LPSTR)lpValueBuf;
-    *ldwTotsize = 0;
 
     TRACE("(%p,%p,%d,%p,%p=%d)\n", hkey, val_list, num_vals, lpValueBuf, ldwTotsize, *ldwTotsize);
 
-    for(i=0; i < num_vals; ++i)
+    if (!(hkey = get_special_root_hkey( hkey, 0 ))) return ERROR_INVALID_HANDLE;
+
+    if (!(info = HeapAlloc( GetProcessHeap(), 0, num_vals * (sizeof(*info) + sizeof(*names)) )))
+        return ERROR_OUTOFMEMORY;
+    names = (UNICODE_STRING *)(info + num_vals);
+    for (i = 0; i < num_vals; i++)
     {
-        val_list[i].ve_valuelen=0;
-        status = RegQueryValueExW(hkey, val_list[i].ve_valuename, NULL, NULL, NULL, &val_list[i].ve_valuelen);
-        if(status != ERROR_SUCCESS)
-        {
-            return status;
-        }
+        RtlInitUnicodeString( &names[i], val_list[i].ve_valuename );
+        info[i].ValueName = &names[i];
+    }
 
-        if(lpValueBuf != NULL && *ldwTotsize + val_list[i].ve_valuelen <= maxBytes)
+    /* all the values are retrieved in two server round trips */
+    status = NtQueryMultipleValueKey( hkey, info, num_vals, lpValueBuf,
+                                      lpValueBuf ? *ldwTotsize : 0, ldwTotsize );
+    if (!status || status == STATUS_BUFFER_OVERFLOW)
+    {
+        for (i = 0; i < num_vals; i++)
         {
-            status = RegQueryValueExW(hkey, val_list[i].ve_valuename, NULL, &val_list[i].ve_type,
-                                      (LPBYTE)bufptr, &val_list[i].ve_valuelen);
-            if(status != ERROR_SUCCESS)
-            {
-                return status;
-            }
-
-            val_list[i].ve_valueptr = (DWORD_PTR)bufptr;
-
-            bufptr += val_list[i].ve_valuelen;
+            val_list[i].ve_valuelen = info[i].DataLength;
+            val_list[i].ve_type     = info[i].Type;
+            if (!status) val_list[i].ve_valueptr = (DWORD_PTR)((char *)lpValueBuf + info[i].DataOffset);
         }
-
-        *ldwTotsize += val_list[i].ve_valuelen;
     }
-    return lpValueBuf != NULL && *ldwTotsize <= maxBytes ? ERROR_SUCCESS : ERROR_MORE_DATA;
+    else *ldwTotsize = 0;
+    HeapFree( GetProcessHeap(), 0, info );
+
+    if (!status && !lpValueBuf) return ERROR_MORE_DATA;
+    return RtlNtStatusToDosError( status );
 }
 
 /******************************************************************************
@@ -842,6 +842,60 @@ static void test_get_value(void)
     ok(!strcmp(expanded, buf), "expanded=\"%s\" buf=\"%s\"\n", expanded, buf);
 } 
 
+static void test_query_multiple_values(void)
+{
+    static const WCHAR tp1W[] = {'T','P','1','_','S','Z',0};
+    static const WCHAR dwordW[] = {'D','W','O','R','D',0};
+    static const WCHAR bin64W[] = {'B','I','N','6','4',0};
+    static const WCHAR zbW[] = {'T','P','1','_','Z','B','_','S','Z',0};
+    static const WCHAR missingW[] = {'M','i','s','s','i','n','g',0};
+    static const DWORD qw[2] = { 0x12345678, 0x87654321 };
+    WCHAR buffer[256], pathW[MAX_PATH];
+    VALENTW vals[4];
+    DWORD ret, size, expected;
+
+    MultiByteToWideChar( CP_ACP, 0, sTestpath1, -1, pathW, MAX_PATH );
+    expected = (lstrlenW(pathW) + 1) * sizeof(WCHAR) + 4 + 8;
+
+    memset( vals, 0, sizeof(vals) );
+    vals[0].ve_valuename = (WCHAR *)tp1W;
+    vals[1].ve_valuename = (WCHAR *)dwordW;
+    vals[2].ve_valuename = (WCHAR *)zbW;
+    vals[3].ve_valuename = (WCHAR *)bin64W;
+
+    size = 0;
+    ret = RegQueryMultipleValuesW( hkey_main, vals, 4, NULL, &size );
+    ok( ret == ERROR_MORE_DATA, "ret=%d\n", ret );
+    ok( size == expected, "size=%d, expected %d\n", size, expected );
+
+    size = expected - 1;
+    ret = RegQueryMultipleValuesW( hkey_main, vals, 4, buffer, &size );
+    ok( ret == ERROR_MORE_DATA, "ret=%d\n", ret );
+    ok( size == expected, "size=%d, expected %d\n", size, expected );
+
+    size = sizeof(buffer);
+    ret = RegQueryMultipleValuesW( hkey_main, vals, 4, buffer, &size );
+    ok( ret == ERROR_SUCCESS, "ret=%d\n", ret );
+    ok( size == expected, "size=%d, expected %d\n", size, expected );
+    ok( vals[0].ve_type == REG_SZ, "type=%d\n", vals[0].ve_type );
+    ok( vals[0].ve_valuelen == (lstrlenW(pathW) + 1) * sizeof(WCHAR), "len=%d\n", vals[0].ve_valuelen );
+    ok( !lstrcmpW( (WCHAR *)vals[0].ve_valueptr, pathW ), "wrong data %s\n",
+        wine_dbgstr_w( (WCHAR *)vals[0].ve_valueptr ));
+    ok( vals[1].ve_type == REG_DWORD, "type=%d\n", vals[1].ve_type );
+    ok( vals[1].ve_valuelen == 4, "len=%d\n", vals[1].ve_valuelen );
+    ok( *(DWORD *)vals[1].ve_valueptr == qw[0], "wrong data %x\n", *(DWORD *)vals[1].ve_valueptr );
+    ok( vals[2].ve_type == REG_SZ, "type=%d\n", vals[2].ve_type );
+    ok( vals[2].ve_valuelen == 0, "len=%d\n", vals[2].ve_valuelen );
+    ok( vals[3].ve_type == REG_BINARY, "type=%d\n", vals[3].ve_type );
+    ok( vals[3].ve_valuelen == 8, "len=%d\n", vals[3].ve_valuelen );
+    ok( !memcmp( (void *)vals[3].ve_valueptr, qw, 8 ), "wrong data\n" );
+
+    vals[2].ve_valuename = (WCHAR *)missingW;
+    size = sizeof(buffer);
+    ret = RegQueryMultipleValuesW( hkey_main, vals, 4, buffer, &size );
+    ok( ret == ERROR_FILE_NOT_FOUND, "ret=%d\n", ret );
+}
+
 static void test_reg_open_key(void)
 {
     DWORD ret = 0;
@@ -2716,6 +2770,157 @@ static void test_delete_value(void)
        "expect ERROR_FILE_NOT_FOUND, got %i\n", res);
 }
 
+static void test_flush_key(void)
+{
+    static const BYTE data[] = { 1, 2, 3, 4, 5, 6, 7 };
+    char buffer[32], class[16];
+    DWORD i, type, size, class_size, values;
+    HKEY hkey, subkey;
+    LONG res;
+
+    /* the server may write the flushed changes to its journal, use data that needs padding */
+    res = RegCreateKeyExA( hkey_main, "flush", 0, (char *)"cls", 0, KEY_ALL_ACCESS, NULL, &hkey, NULL );
+    ok( res == ERROR_SUCCESS, "RegCreateKeyExA failed: %d\n", res );
+    if (res) return;
+    for (i = 0; i <= sizeof(data); i++)
+    {
+        sprintf( buffer, "v%u", i );
+        res = RegSetValueExA( hkey, buffer, 0, REG_BINARY, data, i );
+        ok( res == ERROR_SUCCESS, "RegSetValueExA %s failed: %d\n", buffer, res );
+    }
+    res = RegCreateKeyA( hkey, "sub", &subkey );
+    ok( res == ERROR_SUCCESS, "RegCreateKeyA failed: %d\n", res );
+    RegCloseKey( subkey );
+    res = RegCreateKeyExA( hkey, "volatile", 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &subkey, NULL );
+    ok( res == ERROR_SUCCESS, "RegCreateKeyExA failed: %d\n", res );
+    RegCloseKey( subkey );
+
+    res = RegFlushKey( hkey );
+    ok( res == ERROR_SUCCESS, "RegFlushKey failed: %d\n", res );
+
+    /* modify the flushed key and delete a flushed subkey */
+    res = RegSetValueExA( hkey, "v3", 0, REG_SZ, (const BYTE *)"new", 4 );
+    ok( res == ERROR_SUCCESS, "RegSetValueExA failed: %d\n", res );
+    res = RegDeleteValueA( hkey, "v0" );
+    ok( res == ERROR_SUCCESS, "RegDeleteValueA failed: %d\n", res );
+    res = RegDeleteKeyA( hkey, "sub" );
+    ok( res == ERROR_SUCCESS, "RegDeleteKeyA failed: %d\n", res );
+    res = RegFlushKey( hkey );
+    ok( res == ERROR_SUCCESS, "RegFlushKey failed: %d\n", res );
+
+    class_size = sizeof(class);
+    res = RegQueryInfoKeyA( hkey, class, &class_size, NULL, NULL, NULL, NULL, &values, NULL, NULL, NULL, NULL );
+    ok( res == ERROR_SUCCESS, "RegQueryInfoKeyA failed: %d\n", res );
+    ok( !strcmp( class, "cls" ), "wrong class %s\n", class );
+    ok( values == sizeof(data), "expected %u values, got %u\n", (DWORD)sizeof(data), values );
+    for (i = 1; i <= sizeof(data); i++)
+    {
+        sprintf( buffer, "v%u", i );
+        size = sizeof(buffer);
+        res = RegQueryValueExA( hkey, buffer, NULL, &type, (BYTE *)buffer, &size );
+        ok( res == ERROR_SUCCESS, "RegQueryValueExA v%u failed: %d\n", i, res );
+        if (i == 3)
+        {
+            ok( type == REG_SZ && size == 4 && !strcmp( buffer, "new" ), "v3: wrong value %u %u\n", type, size );
+            continue;
+        }
+        ok( type == REG_BINARY && size == i && !memcmp( buffer, data, i ), "v%u: wrong value %u %u\n", i, type, size );
+    }
+    res = RegOpenKeyA( hkey, "sub", &subkey );
+    ok( res == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", res );
+    res = RegOpenKeyA( hkey, "volatile", &subkey );
+    ok( res == ERROR_SUCCESS, "RegOpenKeyA failed: %d\n", res );
+    RegCloseKey( subkey );
+
+    delete_key( hkey );
+    RegCloseKey( hkey );
+}
+
+static void test_large_key(void)
+{
+    unsigned int i, count = winetest_interactive ? 100000 : 5000;
+    char name[16], prev[16];
+    DWORD start, size, subkeys;
+    HKEY hkey, subkey;
+    LONG res;
+
+    res = RegCreateKeyA( hkey_main, "large", &hkey );
+    ok( res == ERROR_SUCCESS, "RegCreateKeyA failed: %d\n", res );
+    if (res) return;
+
+    /* the multiplier makes the names unique but not ordered */
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "%08x", i * 2654435761u );
+        res = RegCreateKeyA( hkey, name, &subkey );
+        if (res)
+        {
+            ok( 0, "RegCreateKeyA %s failed: %d\n", name, res );
+            break;
+        }
+        RegCloseKey( subkey );
+    }
+    if (winetest_debug > 1) trace( "created %u subkeys in %u ms\n", i, GetTickCount() - start );
+    count = i;
+
+    res = RegQueryInfoKeyA( hkey, NULL, NULL, NULL, &subkeys, NULL, NULL, NULL, NULL, NULL, NULL, NULL );
+    ok( res == ERROR_SUCCESS, "RegQueryInfoKeyA failed: %d\n", res );
+    ok( subkeys == count, "expected %u subkeys, got %u\n", count, subkeys );
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "%08X", i * 2654435761u );
+        res = RegOpenKeyA( hkey, name, &subkey );
+        if (res)
+        {
+            ok( 0, "RegOpenKeyA %s failed: %d\n", name, res );
+            break;
+        }
+        RegCloseKey( subkey );
+    }
+    if (winetest_debug > 1) trace( "opened %u subkeys in %u ms\n", i, GetTickCount() - start );
+
+    res = RegOpenKeyA( hkey, "not-here", &subkey );
+    ok( res == ERROR_FILE_NOT_FOUND, "expected ERROR_FILE_NOT_FOUND, got %d\n", res );
+
+    /* enumerate backwards, deleting the last subkey each time */
+    start = GetTickCount();
+    prev[0] = 0;
+    for (i = count; i > 0; i--)
+    {
+        size = sizeof(name);
+        res = RegEnumKeyExA( hkey, i - 1, name, &size, NULL, NULL, NULL, NULL );
+        if (res)
+        {
+            ok( 0, "RegEnumKeyExA %u failed: %d\n", i - 1, res );
+            break;
+        }
+        if (prev[0] && lstrcmpiA( name, prev ) >= 0)
+        {
+            ok( 0, "subkey %u %s is not sorted before %s\n", i - 1, name, prev );
+            break;
+        }
+        res = RegDeleteKeyA( hkey, name );
+        if (res)
+        {
+            ok( 0, "RegDeleteKeyA %s failed: %d\n", name, res );
+            break;
+        }
+        strcpy( prev, name );
+    }
+    if (winetest_debug > 1) trace( "deleted %u subkeys in %u ms\n", count - i, GetTickCount() - start );
+
+    res = RegQueryInfoKeyA( hkey, NULL, NULL, NULL, &subkeys, NULL, NULL, NULL, NULL, NULL, NULL, NULL );
+    ok( res == ERROR_SUCCESS, "RegQueryInfoKeyA failed: %d\n", res );
+    ok( !subkeys, "expected no subkeys, got %u\n", subkeys );
+
+    RegCloseKey( hkey );
+    res = RegDeleteKeyA( hkey_main, "large" );
+    ok( res == ERROR_SUCCESS, "RegDeleteKeyA failed: %d\n", res );
+}
+
 START_TEST(registry)
 {
     /* Load pointers for functions that are not available in all Windows versions */
@@ -2727,6 +2932,7 @@ START_TEST(registry)
     test_enum_value();
     test_query_value_ex();
     test_get_value();
+    test_query_multiple_values();
     test_reg_open_key();
     test_reg_create_key();
     test_reg_close_key();
@@ -2755,6 +2961,8 @@ START_TEST(registry)
     test_rw_order();
     test_deleted_key();
     test_delete_value();
+    test_flush_key();
+    test_large_key();
 
     /* cleanup */
     delete_key( hkey_main );
@@ -552,20 +552,48 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
-static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
-                         HRGN clip, BLENDFUNCTION blend )
+struct blend_rects_params
 {
+    dib_info       *dst;
+    const RECT     *dst_rect;
+    const dib_info *src;
+    const RECT     *src_rect;
+    BLENDFUNCTION   blend;
+};
+
+static void blend_rects( void *arg, int num, const RECT *rects )
+{
+    const struct blend_rects_params *params = arg;
     POINT origin;
-    struct clipped_rects clipped_rects;
     int i;
 
-    if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
-    for (i = 0; i < clipped_rects.count; i++)
+    for (i = 0; i < num; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        origin.x = params->src_rect->left + rects[i].left - params->dst_rect->left;
+        origin.y = params->src_rect->top  + rects[i].top  - params->dst_rect->top;
+        params->dst->funcs->blend_rect( params->dst, &rects[i], params->src, &origin, params->blend );
     }
+}
+
+static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                         HRGN clip, BLENDFUNCTION blend )
+{
+    struct blend_rects_params params;
+    struct clipped_rects clipped_rects;
+
+    if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+
+    params.dst      = dst;
+    params.dst_rect = dst_rect;
+    params.src      = src;
+    params.src_rect = src_rect;
+    params.blend    = blend;
+
+    /* bands could read rows written by another one if the source is the destination */
+    if (src->bits.ptr == dst->bits.ptr)
+        blend_rects( &params, clipped_rects.count, clipped_rects.rects );
+    else
+        process_rects_in_bands( clipped_rects.count, clipped_rects.rects, blend_rects, &params );
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
 }
@@ -1146,6 +1174,138 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_band
+{
+    POINT dst_start;
+    POINT src_start;
+    int   err;
+    int   length;
+};
+
+struct stretch_rows
+{
+    dib_info                    *dst_dib;
+    const dib_info              *src_dib;
+    void                       (*row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                                         const dib_info *src_dib, const POINT *src_start,
+                                         const struct stretch_params *params, int mode, BOOL keep_dst);
+    const struct stretch_params *h_params;
+    const struct stretch_params *v_params;
+    BOOL                         vstretch;
+    int                          mode;
+    int                          width;
+    struct stretch_band         *bands;
+};
+
+/* render length steps of a vertical stretch or shrink, starting on a new source
+ * row for stretches and on a new destination row for shrinks */
+static void stretch_rows( const struct stretch_rows *rows, POINT dst_start, POINT src_start,
+                          int err, int length )
+{
+    const struct stretch_params *v_params = rows->v_params;
+
+    if (rows->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = rows->width;
+
+        while (length--)
+        {
+            if (need_row)
+            {
+                rows->row_fn( rows->dst_dib, &dst_start, rows->src_dib, &src_start,
+                              rows->h_params, rows->mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - v_params->dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                offset_rect( &this_row, 0, v_params->dst_inc );
+                copy_rect( rows->dst_dib, &this_row, rows->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                need_row = TRUE;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (length--)
+        {
+            if (rows->mode != STRETCH_DELETESCANS || !merged_rows)
+                rows->row_fn( rows->dst_dib, &dst_start, rows->src_dib, &src_start,
+                              rows->h_params, rows->mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                merged_rows = 0;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+}
+
+/* split the steps of a stretch into bands that don't depend on each other's
+ * output, i.e. that start on a new source row or a new destination row */
+static unsigned int split_stretch_rows( struct stretch_rows *rows, POINT dst_start, POINT src_start,
+                                        unsigned int count )
+{
+    const struct stretch_params *v_params = rows->v_params;
+    int i, err = v_params->err_start;
+    BOOL can_split = TRUE;
+    unsigned int band = 0;
+
+    for (i = 0; i < v_params->length; i++)
+    {
+        if (can_split && band < count && i >= (LONGLONG)band * v_params->length / count)
+        {
+            if (band) rows->bands[band - 1].length = i - rows->bands[band - 1].length;
+            rows->bands[band].dst_start = dst_start;
+            rows->bands[band].src_start = src_start;
+            rows->bands[band].err       = err;
+            rows->bands[band].length    = i;  /* start step until the band is closed */
+            band++;
+        }
+
+        can_split = err > 0;
+        if (err > 0)
+        {
+            if (rows->vstretch) src_start.y += v_params->src_inc;
+            else dst_start.y += v_params->dst_inc;
+            err += v_params->err_add_1;
+        }
+        else err += v_params->err_add_2;
+        if (rows->vstretch) dst_start.y += v_params->dst_inc;
+        else src_start.y += v_params->src_inc;
+    }
+    if (band) rows->bands[band - 1].length = v_params->length - rows->bands[band - 1].length;
+    return band;
+}
+
+static void stretch_rows_band( void *arg, unsigned int index )
+{
+    const struct stretch_rows *rows = arg;
+    const struct stretch_band *band = &rows->bands[index];
+
+    stretch_rows( rows, band->dst_start, band->src_start, band->err, band->length );
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1155,11 +1315,9 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_rows rows;
+    unsigned int bands;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1193,63 +1351,26 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
+    rows.dst_dib  = &dst_dib;
+    rows.src_dib  = &src_dib;
+    rows.row_fn   = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    rows.h_params = &h_params;
+    rows.v_params = &v_params;
+    rows.vstretch = vstretch;
+    rows.mode     = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    rows.width    = dst->visrect.right - dst->visrect.left;
+
+    bands = get_band_count( rows.width, dst->visrect.bottom - dst->visrect.top );
+    if (bands <= 1 || src_bits == dst_bits ||
+        !(rows.bands = HeapAlloc( GetProcessHeap(), 0, bands * sizeof(*rows.bands) )))
     {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
+        stretch_rows( &rows, dst_start, src_start, v_params.err_start, v_params.length );
     }
     else
     {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
+        bands = split_stretch_rows( &rows, dst_start, src_start, bands );
+        run_parallel( bands, stretch_rows_band, &rows );
+        HeapFree( GetProcessHeap(), 0, rows.bands );
     }
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
@@ -203,10 +203,10 @@ typedef struct primitive_funcs
                                     const struct stretch_params *params, int mode, BOOL keep_dst);
 } primitive_funcs;
 
-extern const primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
+extern primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_32   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_24   DECLSPEC_HIDDEN;
-extern const primitive_funcs funcs_555  DECLSPEC_HIDDEN;
+extern primitive_funcs funcs_555  DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_16   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_8    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_4    DECLSPEC_HIDDEN;
@@ -252,6 +252,12 @@ extern void add_clipped_bounds( dibdrv_physdev *dev, const RECT *rect, HRGN clip
 extern int clip_line(const POINT *start, const POINT *end, const RECT *clip,
                      const bres_params *params, POINT *pt1, POINT *pt2) DECLSPEC_HIDDEN;
 extern void release_cached_font( struct cached_font *font ) DECLSPEC_HIDDEN;
+extern unsigned int get_band_count( int width, int height ) DECLSPEC_HIDDEN;
+extern void run_parallel( unsigned int count, void (*func)( void *arg, unsigned int index ),
+                          void *arg ) DECLSPEC_HIDDEN;
+extern void process_rects_in_bands( int num, const RECT *rects,
+                                    void (*func)( void *arg, int num, const RECT *rects ),
+                                    void *arg ) DECLSPEC_HIDDEN;
 
 static inline void init_clipped_rects( struct clipped_rects *clip_rects )
 {
@@ -1751,6 +1751,30 @@ COLORREF dibdrv_SetDCPenColor( PHYSDEV dev, COLORREF color )
     return color;
 }
 
+struct brush_rects_params
+{
+    const dib_info      *dib;
+    rop_mask             color;
+    POINT                origin;
+    const dib_info      *brush_dib;
+    const rop_mask_bits *masks;
+};
+
+static void solid_rects( void *arg, int num, const RECT *rects )
+{
+    const struct brush_rects_params *params = arg;
+
+    params->dib->funcs->solid_rects( params->dib, num, rects, params->color.and, params->color.xor );
+}
+
+static void pattern_rects( void *arg, int num, const RECT *rects )
+{
+    const struct brush_rects_params *params = arg;
+
+    params->dib->funcs->pattern_rects( params->dib, num, rects, &params->origin,
+                                       params->brush_dib, params->masks );
+}
+
 /**********************************************************************
  *             solid_brush
  *
@@ -1759,11 +1783,12 @@ COLORREF dibdrv_SetDCPenColor( PHYSDEV dev, COLORREF color )
 static BOOL solid_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
                         int num, const RECT *rects, INT rop)
 {
-    rop_mask brush_color;
+    struct brush_rects_params params;
     DWORD color = get_pixel_color( pdev->dev.hdc, &pdev->dib, brush->colorref, TRUE );
 
-    calc_rop_masks( rop, color, &brush_color );
-    dib->funcs->solid_rects( dib, num, rects, brush_color.and, brush_color.xor );
+    params.dib = dib;
+    calc_rop_masks( rop, color, &params.color );
+    process_rects_in_bands( num, rects, solid_rects, &params );
     return TRUE;
 }
 
@@ -1984,7 +2009,7 @@ static BOOL select_pattern_brush( dibdrv_physdev *pdev, dib_brush *brush, BOOL *
 static BOOL pattern_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
                           int num, const RECT *rects, INT rop)
 {
-    POINT origin;
+    struct brush_rects_params params;
     BOOL needs_reselect = FALSE;
 
     if (rop != brush->rop)
@@ -2021,9 +2046,12 @@ static BOOL pattern_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
         if (!rop_needs_and_mask( brush->rop )) brush->masks.and = NULL;  /* ignore the and mask */
     }
 
-    GetBrushOrgEx(pdev->dev.hdc, &origin);
+    params.dib       = dib;
+    params.brush_dib = &brush->dib;
+    params.masks     = &brush->masks;
+    GetBrushOrgEx(pdev->dev.hdc, &params.origin);
 
-    dib->funcs->pattern_rects( dib, num, rects, &origin, &brush->dib, &brush->masks );
+    process_rects_in_bands( num, rects, pattern_rects, &params );
 
     if (needs_reselect) free_pattern_brush( brush );
     return TRUE;
@@ -0,0 +1,252 @@
+/*
+ * DIB driver parallel execution of large operations
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Large fills, blends and stretches can be split into bands of rows that
+ * are rendered concurrently on the thread pool. Each band writes a disjoint
+ * set of destination rows with exactly the same primitives as the serial
+ * path, so the output doesn't depend on the number of bands.
+ *
+ * This is disabled by default; it is enabled by setting the "Threads" value
+ * of HKCU\Software\Wine\DIB Engine to the maximum number of bands to use.
+ */
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winreg.h"
+
+#include "gdi_private.h"
+#include "dibdrv.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+/* operations smaller than this stay on the calling thread */
+#define PARALLEL_MIN_PIXELS  (512 * 512)
+#define PARALLEL_MIN_ROWS    16
+#define PARALLEL_MAX_BANDS   64
+
+static unsigned int max_bands = 1;
+
+struct parallel_job
+{
+    void         (*func)( void *arg, unsigned int index );
+    void          *arg;
+    unsigned int   count;
+    LONG           next;      /* next band to render */
+    LONG           remaining; /* bands not rendered yet */
+    LONG           refcount;  /* the caller and the queued workers */
+    HANDLE         done;      /* signaled once all bands are rendered */
+};
+
+/***********************************************************************
+ *           init_dib_parallel
+ */
+void init_dib_parallel(void)
+{
+    char buffer[16];
+    DWORD type, size = sizeof(buffer);
+    HKEY hkey;
+    int val;
+
+    if (RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\DIB Engine", &hkey )) return;
+    if (!RegQueryValueExA( hkey, "Threads", NULL, &type, (BYTE *)buffer, &size ) && type == REG_SZ)
+    {
+        if ((val = atoi( buffer )) > 1) max_bands = min( val, PARALLEL_MAX_BANDS );
+        TRACE( "using up to %u bands\n", max_bands );
+    }
+    RegCloseKey( hkey );
+}
+
+/***********************************************************************
+ *           get_band_count
+ *
+ * Number of bands a width x height operation should be split into; 1 means serial.
+ */
+unsigned int get_band_count( int width, int height )
+{
+    if (max_bands <= 1 || width <= 0 || height < 2 * PARALLEL_MIN_ROWS) return 1;
+    if ((LONGLONG)width * height < PARALLEL_MIN_PIXELS) return 1;
+    return min( max_bands, height / PARALLEL_MIN_ROWS );
+}
+
+static void release_job( struct parallel_job *job )
+{
+    if (InterlockedDecrement( &job->refcount )) return;
+    CloseHandle( job->done );
+    HeapFree( GetProcessHeap(), 0, job );
+}
+
+static void run_job( struct parallel_job *job )
+{
+    LONG index;
+
+    while ((index = InterlockedIncrement( &job->next ) - 1) < job->count)
+    {
+        job->func( job->arg, index );
+        if (!InterlockedDecrement( &job->remaining )) SetEvent( job->done );
+    }
+}
+
+static DWORD CALLBACK parallel_worker( void *arg )
+{
+    struct parallel_job *job = arg;
+
+    run_job( job );
+    release_job( job );
+    return 0;
+}
+
+/***********************************************************************
+ *           run_parallel
+ *
+ * Call func for every index below count, concurrently when possible, and
+ * wait for all of them to finish.
+ *
+ * The caller renders all the bands that no worker has started yet, so it
+ * only ever waits for bands that are being rendered. Workers that couldn't
+ * start in time, because the pool is busy or the loader lock is held, find
+ * nothing left to do; the job is freed by whoever releases it last.
+ */
+void run_parallel( unsigned int count, void (*func)( void *arg, unsigned int index ), void *arg )
+{
+    struct parallel_job *job;
+    unsigned int i;
+
+    if (count <= 1 || !(job = HeapAlloc( GetProcessHeap(), 0, sizeof(*job) ))) goto serial;
+    if (!(job->done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        HeapFree( GetProcessHeap(), 0, job );
+        goto serial;
+    }
+    job->func      = func;
+    job->arg       = arg;
+    job->count     = count;
+    job->next      = 0;
+    job->remaining = count;
+    job->refcount  = 1;
+
+    for (i = 1; i < count; i++)
+    {
+        InterlockedIncrement( &job->refcount );
+        if (!QueueUserWorkItem( parallel_worker, job, WT_EXECUTEDEFAULT ))
+        {
+            InterlockedDecrement( &job->refcount );
+            break;
+        }
+    }
+
+    run_job( job );
+    if (job->remaining) WaitForSingleObject( job->done, INFINITE );
+    release_job( job );
+    return;
+
+serial:
+    for (i = 0; i < count; i++) func( arg, i );
+}
+
+#define MAX_STACK_BAND_RECTS 64
+
+struct rects_band_job
+{
+    const RECT    *rects;
+    int            num;
+    RECT          *band_rects; /* num rects per band, if they don't fit on the stack */
+    int            top;
+    int            band_height;
+    void         (*func)( void *arg, int num, const RECT *rects );
+    void          *arg;
+};
+
+static void rects_band( void *arg, unsigned int index )
+{
+    struct rects_band_job *job = arg;
+    RECT band_rects[MAX_STACK_BAND_RECTS], *rects = band_rects, band;
+    int i, count = 0;
+
+    band.left   = INT_MIN;
+    band.right  = INT_MAX;
+    band.top    = job->top + index * job->band_height;
+    band.bottom = band.top + job->band_height;
+
+    if (job->band_rects) rects = job->band_rects + (size_t)index * job->num;
+
+    for (i = 0; i < job->num; i++)
+        if (intersect_rect( &rects[count], &job->rects[i], &band )) count++;
+
+    if (count) job->func( job->arg, count, rects );
+}
+
+/***********************************************************************
+ *           process_rects_in_bands
+ *
+ * Call func on a set of non-overlapping rectangles, possibly in several
+ * bands of rows running concurrently.
+ */
+void process_rects_in_bands( int num, const RECT *rects,
+                             void (*func)( void *arg, int num, const RECT *rects ), void *arg )
+{
+    struct rects_band_job job;
+    RECT bounds;
+    LONGLONG area = 0;
+    unsigned int bands;
+    int i;
+
+    if (max_bands <= 1 || num <= 0)
+    {
+        func( arg, num, rects );
+        return;
+    }
+
+    bounds = rects[0];
+    for (i = 0; i < num; i++)
+    {
+        bounds.top    = min( bounds.top, rects[i].top );
+        bounds.bottom = max( bounds.bottom, rects[i].bottom );
+        area += (LONGLONG)(rects[i].right - rects[i].left) * (rects[i].bottom - rects[i].top);
+    }
+
+    if (area < PARALLEL_MIN_PIXELS ||
+        (bands = get_band_count( area / (bounds.bottom - bounds.top), bounds.bottom - bounds.top )) <= 1)
+    {
+        func( arg, num, rects );
+        return;
+    }
+
+    job.band_rects = NULL;
+    if (num > MAX_STACK_BAND_RECTS &&
+        !(job.band_rects = HeapAlloc( GetProcessHeap(), 0, (size_t)bands * num * sizeof(RECT) )))
+    {
+        func( arg, num, rects );
+        return;
+    }
+
+    job.rects       = rects;
+    job.num         = num;
+    job.top         = bounds.top;
+    job.band_height = (bounds.bottom - bounds.top + bands - 1) / bands;
+    job.func        = func;
+    job.arg         = arg;
+    run_parallel( bands, rects_band, &job );
+    HeapFree( GetProcessHeap(), 0, job.band_rects );
+}
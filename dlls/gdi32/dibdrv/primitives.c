@@ -20,6 +20,13 @@
 
 #include <assert.h>
 
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <emmintrin.h>
+#define USE_SSE2
+#define SSE2_TARGET __attribute__((target("sse2")))
+#endif
+
 #include "gdi_private.h"
 #include "dibdrv.h"
 
@@ -6225,7 +6232,223 @@ static void shrink_row_null(const dib_info *dst_dib, const POINT *dst_start,
     return;
 }
 
-const primitive_funcs funcs_8888 =
+#ifdef USE_SSE2
+
+/* The SSE2 versions below must give exactly the same results as the generic ones,
+ * they are only substituted at run time when the CPU supports them. */
+
+/* (x + 127) / 255 in each 16-bit lane, exact for x <= 255 * 255 */
+static inline __m128i SSE2_TARGET div255_round_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ) );
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( x, 8 ) ), 8 );
+}
+
+/* pack 16-bit channel values (at most 510) back into four pixels; like the generic
+ * code ORs the channels together, a carry out of a channel ends up in the next one */
+static inline __m128i SSE2_TARGET pack_channels_sse2( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i bytes = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ) );
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ) );
+    return _mm_or_si128( bytes, _mm_slli_epi32( carry, 8 ) );
+}
+
+static inline __m128i SSE2_TARGET broadcast_alpha_sse2( __m128i x )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, _MM_SHUFFLE(3,3,3,3) ), _MM_SHUFFLE(3,3,3,3) );
+}
+
+/* premultiplied source over destination, as in blend_argb() */
+static inline __m128i SSE2_TARGET blend_argb_sse2( __m128i dst, __m128i src_lo, __m128i src_hi )
+{
+    const __m128i zero = _mm_setzero_si128(), c255 = _mm_set1_epi16( 255 );
+    __m128i dst_lo = _mm_unpacklo_epi8( dst, zero ), dst_hi = _mm_unpackhi_epi8( dst, zero );
+
+    dst_lo = div255_round_sse2( _mm_mullo_epi16( dst_lo, _mm_sub_epi16( c255, broadcast_alpha_sse2( src_lo ))));
+    dst_hi = div255_round_sse2( _mm_mullo_epi16( dst_hi, _mm_sub_epi16( c255, broadcast_alpha_sse2( src_hi ))));
+    return pack_channels_sse2( _mm_add_epi16( src_lo, dst_lo ), _mm_add_epi16( src_hi, dst_hi ));
+}
+
+/* constant alpha blend of all four channels, as in blend_argb_constant_alpha() */
+static inline __m128i SSE2_TARGET blend_constant_alpha_sse2( __m128i dst, __m128i src, __m128i alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i inv = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    __m128i lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( src, zero ), alpha ),
+                                _mm_mullo_epi16( _mm_unpacklo_epi8( dst, zero ), inv ));
+    __m128i hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( src, zero ), alpha ),
+                                _mm_mullo_epi16( _mm_unpackhi_epi8( dst, zero ), inv ));
+    return _mm_packus_epi16( div255_round_sse2( lo ), div255_round_sse2( hi ));
+}
+
+static void SSE2_TARGET blend_rect_8888_sse2(const dib_info *dst, const RECT *rc,
+                                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
+{
+    DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
+    DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi16( blend.SourceConstantAlpha );
+    const __m128i alpha_mask = _mm_set1_epi32( 0xff000000 );
+    __m128i s, d, s_lo, s_hi;
+    int x, y, width = rc->right - rc->left;
+
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+    {
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+        {
+            if (blend.SourceConstantAlpha == 255)
+            {
+                for (x = 0; x + 4 <= width; x += 4)
+                {
+                    s = _mm_loadu_si128( (const __m128i *)(src_ptr + x) );
+                    /* fully transparent pixels leave the destination untouched,
+                     * and fully opaque ones replace it */
+                    if (_mm_movemask_epi8( _mm_cmpeq_epi32( s, zero )) == 0xffff) continue;
+                    if (_mm_movemask_epi8( _mm_cmpeq_epi32( _mm_and_si128( s, alpha_mask ), alpha_mask )) == 0xffff)
+                    {
+                        _mm_storeu_si128( (__m128i *)(dst_ptr + x), s );
+                        continue;
+                    }
+                    d = _mm_loadu_si128( (const __m128i *)(dst_ptr + x) );
+                    s_lo = _mm_unpacklo_epi8( s, zero );
+                    s_hi = _mm_unpackhi_epi8( s, zero );
+                    _mm_storeu_si128( (__m128i *)(dst_ptr + x), blend_argb_sse2( d, s_lo, s_hi ));
+                }
+                for (; x < width; x++)
+                    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+            }
+            else
+            {
+                for (x = 0; x + 4 <= width; x += 4)
+                {
+                    s = _mm_loadu_si128( (const __m128i *)(src_ptr + x) );
+                    d = _mm_loadu_si128( (const __m128i *)(dst_ptr + x) );
+                    s_lo = div255_round_sse2( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), alpha ));
+                    s_hi = div255_round_sse2( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), alpha ));
+                    _mm_storeu_si128( (__m128i *)(dst_ptr + x), blend_argb_sse2( d, s_lo, s_hi ));
+                }
+                for (; x < width; x++)
+                    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+            }
+        }
+        else if (src->compression == BI_RGB)
+        {
+            for (x = 0; x + 4 <= width; x += 4)
+            {
+                s = _mm_loadu_si128( (const __m128i *)(src_ptr + x) );
+                d = _mm_loadu_si128( (const __m128i *)(dst_ptr + x) );
+                _mm_storeu_si128( (__m128i *)(dst_ptr + x), blend_constant_alpha_sse2( d, s, alpha ));
+            }
+            for (; x < width; x++)
+                dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+        }
+        else
+        {
+            for (x = 0; x + 4 <= width; x += 4)
+            {
+                s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src_ptr + x) ), alpha_mask );
+                d = _mm_loadu_si128( (const __m128i *)(dst_ptr + x) );
+                _mm_storeu_si128( (__m128i *)(dst_ptr + x), blend_constant_alpha_sse2( d, s, alpha ));
+            }
+            for (; x < width; x++)
+                dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+        }
+    }
+}
+
+static void SSE2_TARGET convert_to_8888_sse2(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
+{
+    DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel;
+    WORD *src_start, *src_pixel;
+    int x, y, width = src_rect->right - src_rect->left, pad_size = (dst->width - width) * 4;
+    __m128i s, v;
+    DWORD src_val;
+
+    if (src->funcs != &funcs_555)
+    {
+        convert_to_8888( dst, src, src_rect, dither );
+        return;
+    }
+
+    src_start = get_pixel_ptr_16(src, src_rect->left, src_rect->top);
+    for(y = src_rect->top; y < src_rect->bottom; y++)
+    {
+        dst_pixel = dst_start;
+        src_pixel = src_start;
+        for(x = 0; x + 4 <= width; x += 4, src_pixel += 4, dst_pixel += 4)
+        {
+            v = _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i *)src_pixel ), _mm_setzero_si128() );
+            s =                _mm_and_si128( _mm_slli_epi32( v, 9 ), _mm_set1_epi32( 0xf80000 ));
+            s = _mm_or_si128( s, _mm_and_si128( _mm_slli_epi32( v, 4 ), _mm_set1_epi32( 0x070000 )));
+            s = _mm_or_si128( s, _mm_and_si128( _mm_slli_epi32( v, 6 ), _mm_set1_epi32( 0x00f800 )));
+            s = _mm_or_si128( s, _mm_and_si128( _mm_slli_epi32( v, 1 ), _mm_set1_epi32( 0x000700 )));
+            s = _mm_or_si128( s, _mm_and_si128( _mm_slli_epi32( v, 3 ), _mm_set1_epi32( 0x0000f8 )));
+            s = _mm_or_si128( s, _mm_and_si128( _mm_srli_epi32( v, 2 ), _mm_set1_epi32( 0x000007 )));
+            _mm_storeu_si128( (__m128i *)dst_pixel, s );
+        }
+        for(; x < width; x++)
+        {
+            src_val = *src_pixel++;
+            *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
+                           ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
+                           ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
+        }
+        if(pad_size) memset(dst_pixel, 0, pad_size);
+        dst_start += dst->stride / 4;
+        src_start += src->stride / 2;
+    }
+}
+
+static void SSE2_TARGET convert_to_555_sse2(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
+{
+    WORD *dst_start = get_pixel_ptr_16(dst, 0, 0), *dst_pixel;
+    DWORD *src_start, *src_pixel;
+    int x, y, width = src_rect->right - src_rect->left;
+    int pad_size = ((dst->width + 1) & ~1) * 2 - width * 2;
+    __m128i lo, hi;
+    DWORD src_val;
+
+    if (src->funcs != &funcs_8888)
+    {
+        convert_to_555( dst, src, src_rect, dither );
+        return;
+    }
+
+    src_start = get_pixel_ptr_32(src, src_rect->left, src_rect->top);
+    for(y = src_rect->top; y < src_rect->bottom; y++)
+    {
+        dst_pixel = dst_start;
+        src_pixel = src_start;
+        for(x = 0; x + 8 <= width; x += 8, src_pixel += 8, dst_pixel += 8)
+        {
+            lo = _mm_loadu_si128( (const __m128i *)src_pixel );
+            hi = _mm_loadu_si128( (const __m128i *)(src_pixel + 4) );
+            lo = _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_srli_epi32( lo, 9 ), _mm_set1_epi32( 0x7c00 )),
+                                             _mm_and_si128( _mm_srli_epi32( lo, 6 ), _mm_set1_epi32( 0x03e0 ))),
+                               _mm_and_si128( _mm_srli_epi32( lo, 3 ), _mm_set1_epi32( 0x001f )));
+            hi = _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_srli_epi32( hi, 9 ), _mm_set1_epi32( 0x7c00 )),
+                                             _mm_and_si128( _mm_srli_epi32( hi, 6 ), _mm_set1_epi32( 0x03e0 ))),
+                               _mm_and_si128( _mm_srli_epi32( hi, 3 ), _mm_set1_epi32( 0x001f )));
+            /* values fit in 15 bits, so the signed saturation is a no-op */
+            _mm_storeu_si128( (__m128i *)dst_pixel, _mm_packs_epi32( lo, hi ));
+        }
+        for(; x < width; x++)
+        {
+            src_val = *src_pixel++;
+            *dst_pixel++ = ((src_val >> 9) & 0x7c00) |
+                           ((src_val >> 6) & 0x03e0) |
+                           ((src_val >> 3) & 0x001f);
+        }
+        if(pad_size) memset(dst_pixel, 0, pad_size);
+        dst_start += dst->stride / 2;
+        src_start += src->stride / 4;
+    }
+}
+
+#endif  /* USE_SSE2 */
+
+primitive_funcs funcs_8888 =
 {
     solid_rects_32,
     solid_line_32,
@@ -6285,7 +6508,7 @@ const primitive_funcs funcs_24 =
     shrink_row_24
 };
 
-const primitive_funcs funcs_555 =
+primitive_funcs funcs_555 =
 {
     solid_rects_16,
     solid_line_16,
@@ -6404,3 +6627,21 @@ const primitive_funcs funcs_null =
     stretch_row_null,
     shrink_row_null
 };
+
+/***********************************************************************
+ *           init_dib_primitives
+ *
+ * Substitute optimized versions of the hottest primitives when the CPU supports them.
+ */
+void init_dib_primitives(void)
+{
+#ifdef USE_SSE2
+    if (IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE ))
+    {
+        TRACE( "using SSE2 primitives\n" );
+        funcs_8888.blend_rect = blend_rect_8888_sse2;
+        funcs_8888.convert_to = convert_to_8888_sse2;
+        funcs_555.convert_to  = convert_to_555_sse2;
+    }
+#endif
+}
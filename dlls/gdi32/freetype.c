@@ -269,6 +269,8 @@ typedef struct tagFace {
 
 typedef struct tagFamily {
     struct list entry;
+    struct list name_entry;     /* entry in the family name hash */
+    struct list english_entry;  /* entry in the English name hash */
     unsigned int refcount;
     WCHAR *FamilyName;
     WCHAR *EnglishName;
@@ -370,6 +372,11 @@ static struct list font_subst_list = LIST_INIT(font_subst_list);
 
 static struct list font_list = LIST_INIT(font_list);
 
+/* families indexed by name, CreateFont looks up a family by name every time */
+#define FAMILY_HASH_SIZE 1024
+static struct list family_name_hash[FAMILY_HASH_SIZE];
+static struct list family_english_hash[FAMILY_HASH_SIZE];
+
 struct freetype_physdev
 {
     struct gdi_physdev dev;
@@ -523,6 +530,7 @@ static BOOL get_outline_text_metrics(GdiFont *font);
 static BOOL get_bitmap_text_metrics(GdiFont *font);
 static BOOL get_text_metrics(GdiFont *font, LPTEXTMETRICW ptm);
 static void remove_face_from_cache( Face *face );
+static Family *find_family_from_name(const WCHAR *name);
 
 static const WCHAR system_link[] = {'S','o','f','t','w','a','r','e','\\','M','i','c','r','o','s','o','f','t','\\',
                                     'W','i','n','d','o','w','s',' ','N','T','\\',
@@ -927,42 +935,84 @@ static const struct list *get_face_list_from_family(const Family *family)
         return family->replacement;
 }
 
+static Face *find_face_in_family(const Family *family, const WCHAR *file_name)
+{
+    const struct list *face_list = get_face_list_from_family(family);
+    Face *face;
+    const WCHAR *file;
+
+    LIST_FOR_EACH_ENTRY(face, face_list, Face, entry)
+    {
+        if (!face->file)
+            continue;
+        file = strrchrW(face->file, '/');
+        if(!file)
+            file = face->file;
+        else
+            file++;
+        if(strcmpiW(file, file_name)) continue;
+        face->refcount++;
+        return face;
+    }
+    return NULL;
+}
+
 static Face *find_face_from_filename(const WCHAR *file_name, const WCHAR *face_name)
 {
     Family *family;
     Face *face;
-    const WCHAR *file;
 
     TRACE("looking for file %s name %s\n", debugstr_w(file_name), debugstr_w(face_name));
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    if (face_name)
     {
-        const struct list *face_list;
-        if(face_name && strcmpiW(face_name, family->FamilyName))
-            continue;
-        face_list = get_face_list_from_family(family);
-        LIST_FOR_EACH_ENTRY(face, face_list, Face, entry)
-        {
-            if (!face->file)
-                continue;
-            file = strrchrW(face->file, '/');
-            if(!file)
-                file = face->file;
-            else
-                file++;
-            if(strcmpiW(file, file_name)) continue;
-            face->refcount++;
-            return face;
-	}
+        if ((family = find_family_from_name(face_name))) return find_face_in_family(family, file_name);
+        return NULL;
     }
+
+    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+        if ((face = find_face_in_family(family, file_name))) return face;
     return NULL;
 }
 
+static struct list *get_family_hash_bucket(struct list *table, const WCHAR *name)
+{
+    unsigned int hash = 0;
+
+    if (!table[0].next)
+    {
+        unsigned int i;
+        for (i = 0; i < FAMILY_HASH_SIZE; i++) list_init( &table[i] );
+    }
+    while (*name) hash = hash * 31 + tolowerW( *name++ );
+    return &table[hash % FAMILY_HASH_SIZE];
+}
+
+/* check whether family comes before other in the font list */
+static BOOL family_precedes(const Family *family, const Family *other)
+{
+    const struct list *ptr = &family->entry;
+
+    while ((ptr = list_next(&font_list, ptr)))
+        if (ptr == &other->entry) return TRUE;
+    return FALSE;
+}
+
+static void add_family_to_hash(Family *family)
+{
+    list_add_tail( get_family_hash_bucket( family_name_hash, family->FamilyName ), &family->name_entry );
+    if (family->EnglishName)
+        list_add_tail( get_family_hash_bucket( family_english_hash, family->EnglishName ),
+                       &family->english_entry );
+    else
+        list_init( &family->english_entry );
+}
+
 static Family *find_family_from_name(const WCHAR *name)
 {
     Family *family;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    LIST_FOR_EACH_ENTRY(family, get_family_hash_bucket( family_name_hash, name ), Family, name_entry)
     {
         if(!strcmpiW(family->FamilyName, name))
             return family;
@@ -971,19 +1021,18 @@ static Family *find_family_from_name(const WCHAR *name)
     return NULL;
 }
 
+/* returns the first family in font list order that matches either name */
 static Family *find_family_from_any_name(const WCHAR *name)
 {
-    Family *family;
+    Family *family, *ret = find_family_from_name(name);
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    LIST_FOR_EACH_ENTRY(family, get_family_hash_bucket( family_english_hash, name ), Family, english_entry)
     {
-        if(!strcmpiW(family->FamilyName, name))
-            return family;
-        if(family->EnglishName && !strcmpiW(family->EnglishName, name))
-            return family;
+        if(strcmpiW(family->EnglishName, name)) continue;
+        if(!ret || family_precedes(family, ret)) ret = family;
     }
 
-    return NULL;
+    return ret;
 }
 
 static void DumpSubstList(void)
@@ -1394,6 +1443,8 @@ static void release_family( Family *family )
     if (--family->refcount) return;
     assert( list_empty( &family->faces ));
     list_remove( &family->entry );
+    list_remove( &family->name_entry );
+    list_remove( &family->english_entry );
     HeapFree( GetProcessHeap(), 0, family->FamilyName );
     HeapFree( GetProcessHeap(), 0, family->EnglishName );
     HeapFree( GetProcessHeap(), 0, family );
@@ -1499,6 +1550,7 @@ static Family *create_family( WCHAR *name, WCHAR *english_name )
     list_init( &family->faces );
     family->replacement = &family->faces;
     list_add_tail( &font_list, &family->entry );
+    add_family_to_hash( family );
 
     return family;
 }
@@ -1521,6 +1573,78 @@ static inline LONG reg_save_dword(HKEY hkey, const WCHAR *value, DWORD data)
     return RegSetValueExW(hkey, value, 0, REG_DWORD, (BYTE*)&data, sizeof(DWORD));
 }
 
+/* The font cache key is also saved to a binary file in the config dir, which
+ * processes map instead of enumerating the key. The file is tagged with the
+ * serial of the key, which changes every time a face is added or removed. */
+
+#define FONT_CACHE_FILE_MAGIC   0x46435746  /* "FWCF" */
+#define FONT_CACHE_FILE_VERSION 1
+
+static const WCHAR font_cache_serial_value[] = {'S','e','r','i','a','l',0};
+
+struct font_cache_serial
+{
+    DWORD    pid;
+    DWORD    count;
+    FILETIME time;
+};
+
+struct font_cache_file_header
+{
+    DWORD                    magic;
+    DWORD                    version;
+    DWORD                    size;      /* total file size */
+    DWORD                    families;
+    struct font_cache_serial serial;
+};
+
+/* followed by the family name and English name, then the faces */
+struct font_cache_file_family
+{
+    DWORD name_len;      /* string lengths are in WCHARs, including the null */
+    DWORD english_len;   /* 0 if there is no English name */
+    DWORD faces;
+};
+
+/* followed by the file name, style name and full name */
+struct font_cache_file_face
+{
+    DWORD         file_len;
+    DWORD         style_len;
+    DWORD         full_name_len;
+    DWORD         face_index;
+    DWORD         ntm_flags;
+    DWORD         font_version;
+    DWORD         flags;
+    DWORD         scalable;
+    FONTSIGNATURE fs;
+    INT           height;
+    INT           width;
+    INT           size;
+    INT           x_ppem;
+    INT           y_ppem;
+    INT           internal_leading;
+};
+
+static void update_font_cache_serial(void)
+{
+    static LONG count;
+    struct font_cache_serial serial;
+
+    serial.pid = GetCurrentProcessId();
+    serial.count = InterlockedIncrement(&count);
+    GetSystemTimeAsFileTime(&serial.time);
+    RegSetValueExW(hkey_font_cache, font_cache_serial_value, 0, REG_BINARY, (BYTE *)&serial, sizeof(serial));
+}
+
+static BOOL get_font_cache_serial(struct font_cache_serial *serial)
+{
+    DWORD type, size = sizeof(*serial);
+
+    return !RegQueryValueExW(hkey_font_cache, font_cache_serial_value, NULL, &type, (BYTE *)serial, &size) &&
+           type == REG_BINARY && size == sizeof(*serial);
+}
+
 static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *buffer, DWORD buffer_size)
 {
     DWORD needed, strike_index = 0;
@@ -1630,12 +1754,26 @@ static void reorder_vertical_fonts(void)
     list_move_tail( &font_list, &vertical_families );
 }
 
+static void add_english_subst(const Family *family)
+{
+    FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
+    subst->from.name = strdupW(family->EnglishName);
+    subst->from.charset = -1;
+    subst->to.name = strdupW(family->FamilyName);
+    subst->to.charset = -1;
+    add_font_subst(&font_subst_list, subst, 0);
+}
+
+static void save_font_list_to_file(const struct font_cache_serial *serial);
+
 static void load_font_list_from_cache(HKEY hkey_font_cache)
 {
     DWORD size, family_index = 0;
     Family *family;
     HKEY hkey_family;
     WCHAR buffer[4096];
+    struct font_cache_serial serial;
+    BOOL have_serial = get_font_cache_serial(&serial);
 
     size = sizeof(buffer);
     while (!RegEnumKeyExW(hkey_font_cache, family_index++, buffer, &size, NULL, NULL, NULL, NULL))
@@ -1653,14 +1791,7 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
         family = create_family(family_name, english_family);
 
         if(english_family)
-        {
-            FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
-            subst->from.name = strdupW(english_family);
-            subst->from.charset = -1;
-            subst->to.name = strdupW(family_name);
-            subst->to.charset = -1;
-            add_font_subst(&font_subst_list, subst, 0);
-        }
+            add_english_subst(family);
 
         size = sizeof(buffer);
         while (!RegEnumKeyExW(hkey_family, face_index++, buffer, &size, NULL, NULL, NULL, NULL))
@@ -1682,6 +1813,10 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
     }
 
     reorder_vertical_fonts();
+
+    /* the serial was read before enumerating the key, so a concurrent
+       change invalidates the snapshot instead of getting lost */
+    if (have_serial) save_font_list_to_file(&serial);
 }
 
 static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
@@ -1752,6 +1887,7 @@ static void add_face_to_cache(Face *face)
     }
     RegCloseKey(hkey_face);
     RegCloseKey(hkey_family);
+    update_font_cache_serial();
 }
 
 static void remove_face_from_cache( Face *face )
@@ -1773,6 +1909,253 @@ static void remove_face_from_cache( Face *face )
         HeapFree(GetProcessHeap(), 0, face_key_name);
     }
     RegCloseKey(hkey_family);
+    update_font_cache_serial();
+}
+
+static char *get_font_cache_file_name(void)
+{
+    static const char nameA[] = "/fontcache";
+    const char *config_dir = wine_get_config_dir();
+    char *name;
+
+    if (!config_dir) return NULL;
+    if ((name = HeapAlloc(GetProcessHeap(), 0, strlen(config_dir) + sizeof(nameA))))
+    {
+        strcpy(name, config_dir);
+        strcat(name, nameA);
+    }
+    return name;
+}
+
+static inline DWORD font_cache_string_len(const WCHAR *str)
+{
+    return str ? strlenW(str) + 1 : 0;
+}
+
+/* copy data to the file buffer, or only compute the size if buffer is NULL */
+static void put_font_cache_data(BYTE *buffer, DWORD *pos, const void *data, DWORD size)
+{
+    if (buffer && size) memcpy(buffer + *pos, data, size);
+    *pos += (size + 3) & ~3;
+}
+
+static DWORD put_font_list(BYTE *buffer, DWORD *count)
+{
+    struct font_cache_file_family family_data;
+    struct font_cache_file_face face_data;
+    DWORD pos = sizeof(struct font_cache_file_header);
+    Family *family;
+    Face *face;
+
+    *count = 0;
+    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    {
+        family_data.faces = 0;
+        LIST_FOR_EACH_ENTRY(face, &family->faces, Face, entry)
+            if (face->flags & ADDFONT_ADD_TO_CACHE) family_data.faces++;
+        if (!family_data.faces) continue;
+
+        family_data.name_len = font_cache_string_len(family->FamilyName);
+        family_data.english_len = font_cache_string_len(family->EnglishName);
+        put_font_cache_data(buffer, &pos, &family_data, sizeof(family_data));
+        put_font_cache_data(buffer, &pos, family->FamilyName, family_data.name_len * sizeof(WCHAR));
+        put_font_cache_data(buffer, &pos, family->EnglishName, family_data.english_len * sizeof(WCHAR));
+
+        LIST_FOR_EACH_ENTRY(face, &family->faces, Face, entry)
+        {
+            if (!(face->flags & ADDFONT_ADD_TO_CACHE)) continue;
+            face_data.file_len = font_cache_string_len(face->file);
+            face_data.style_len = font_cache_string_len(face->StyleName);
+            face_data.full_name_len = font_cache_string_len(face->FullName);
+            face_data.face_index = face->face_index;
+            face_data.ntm_flags = face->ntmFlags;
+            face_data.font_version = face->font_version;
+            face_data.flags = face->flags;
+            face_data.scalable = face->scalable;
+            face_data.fs = face->fs;
+            face_data.height = face->size.height;
+            face_data.width = face->size.width;
+            face_data.size = face->size.size;
+            face_data.x_ppem = face->size.x_ppem;
+            face_data.y_ppem = face->size.y_ppem;
+            face_data.internal_leading = face->size.internal_leading;
+            put_font_cache_data(buffer, &pos, &face_data, sizeof(face_data));
+            put_font_cache_data(buffer, &pos, face->file, face_data.file_len * sizeof(WCHAR));
+            put_font_cache_data(buffer, &pos, face->StyleName, face_data.style_len * sizeof(WCHAR));
+            put_font_cache_data(buffer, &pos, face->FullName, face_data.full_name_len * sizeof(WCHAR));
+        }
+        (*count)++;
+    }
+    return pos;
+}
+
+static void save_font_list_to_file(const struct font_cache_serial *serial)
+{
+    struct font_cache_file_header *header;
+    char *name, *tmp_name;
+    DWORD size, count;
+    BYTE *buffer;
+    BOOL ret = FALSE;
+    int fd;
+
+    size = put_font_list(NULL, &count);
+    if (!(buffer = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size))) return;
+    put_font_list(buffer, &count);
+
+    header = (struct font_cache_file_header *)buffer;
+    header->magic = FONT_CACHE_FILE_MAGIC;
+    header->version = FONT_CACHE_FILE_VERSION;
+    header->size = size;
+    header->families = count;
+    header->serial = *serial;
+
+    if (!(name = get_font_cache_file_name())) goto done;
+    if (!(tmp_name = HeapAlloc(GetProcessHeap(), 0, strlen(name) + sizeof(".tmp"))))
+    {
+        HeapFree(GetProcessHeap(), 0, name);
+        goto done;
+    }
+    strcpy(tmp_name, name);
+    strcat(tmp_name, ".tmp");
+
+    /* write a new file and rename it, processes may still be mapping the old one */
+    if ((fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0666)) != -1)
+    {
+        ret = write(fd, buffer, size) == size;
+        close(fd);
+        if (ret) ret = !rename(tmp_name, name);
+        if (!ret) unlink(tmp_name);
+    }
+    if (!ret) WARN("failed to save font cache to %s\n", debugstr_a(name));
+    else TRACE("saved %u families to %s\n", count, debugstr_a(name));
+
+    HeapFree(GetProcessHeap(), 0, tmp_name);
+    HeapFree(GetProcessHeap(), 0, name);
+done:
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
+static const void *get_font_cache_data(const BYTE **ptr, const BYTE *end, DWORD size)
+{
+    const void *ret = *ptr;
+
+    size = (size + 3) & ~3;
+    if (size > end - *ptr) return NULL;
+    *ptr += size;
+    return ret;
+}
+
+static BOOL get_font_cache_string(const BYTE **ptr, const BYTE *end, DWORD len, const WCHAR **str)
+{
+    *str = NULL;
+    if (!len) return TRUE;
+    if (len > (end - *ptr) / sizeof(WCHAR)) return FALSE;
+    if (!(*str = get_font_cache_data(ptr, end, len * sizeof(WCHAR)))) return FALSE;
+    return !(*str)[len - 1];
+}
+
+/* walk the file data, only validating it unless create is set */
+static BOOL load_font_cache_data(const BYTE *ptr, const BYTE *end, DWORD count, BOOL create)
+{
+    const struct font_cache_file_family *family_data;
+    const struct font_cache_file_face *face_data;
+    const WCHAR *name, *english, *file, *style, *full_name;
+    Family *family = NULL;
+    Face *face;
+    DWORD i, j;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(family_data = get_font_cache_data(&ptr, end, sizeof(*family_data)))) return FALSE;
+        if (!get_font_cache_string(&ptr, end, family_data->name_len, &name) || !name) return FALSE;
+        if (!get_font_cache_string(&ptr, end, family_data->english_len, &english)) return FALSE;
+
+        if (create)
+        {
+            family = create_family(strdupW(name), english ? strdupW(english) : NULL);
+            if (english) add_english_subst(family);
+        }
+
+        for (j = 0; j < family_data->faces; j++)
+        {
+            if (!(face_data = get_font_cache_data(&ptr, end, sizeof(*face_data)))) return FALSE;
+            if (!get_font_cache_string(&ptr, end, face_data->file_len, &file) || !file) return FALSE;
+            if (!get_font_cache_string(&ptr, end, face_data->style_len, &style) || !style) return FALSE;
+            if (!get_font_cache_string(&ptr, end, face_data->full_name_len, &full_name)) return FALSE;
+            if (!create) continue;
+
+            face = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*face));
+            face->refcount = 1;
+            face->file = strdupW(file);
+            face->StyleName = strdupW(style);
+            face->FullName = full_name ? strdupW(full_name) : NULL;
+            face->face_index = face_data->face_index;
+            face->ntmFlags = face_data->ntm_flags;
+            face->font_version = face_data->font_version;
+            face->flags = face_data->flags;
+            face->fs = face_data->fs;
+            face->scalable = face_data->scalable;
+            if (!face->scalable)
+            {
+                face->size.height = face_data->height;
+                face->size.width = face_data->width;
+                face->size.size = face_data->size;
+                face->size.x_ppem = face_data->x_ppem;
+                face->size.y_ppem = face_data->y_ppem;
+                face->size.internal_leading = face_data->internal_leading;
+            }
+
+            if (insert_face_in_family_list(face, family))
+                TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+
+            release_face(face);
+        }
+        if (create) release_family(family);
+    }
+    return ptr == end;
+}
+
+static BOOL load_font_list_from_file(void)
+{
+    const struct font_cache_file_header *header;
+    struct font_cache_serial serial;
+    struct stat st;
+    char *name;
+    void *data;
+    BOOL ret = FALSE;
+    int fd;
+
+    if (!get_font_cache_serial(&serial)) return FALSE;
+    if (!(name = get_font_cache_file_name())) return FALSE;
+    fd = open(name, O_RDONLY);
+    HeapFree(GetProcessHeap(), 0, name);
+    if (fd == -1) return FALSE;
+
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(*header) || st.st_size > 0x7fffffff ||
+        (data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        return FALSE;
+    }
+    close(fd);
+
+    header = data;
+    if (header->magic == FONT_CACHE_FILE_MAGIC && header->version == FONT_CACHE_FILE_VERSION &&
+        header->size == st.st_size && !memcmp(&header->serial, &serial, sizeof(serial)))
+    {
+        const BYTE *ptr = (const BYTE *)(header + 1), *end = (const BYTE *)data + st.st_size;
+
+        if ((ret = load_font_cache_data(ptr, end, header->families, FALSE)))
+        {
+            load_font_cache_data(ptr, end, header->families, TRUE);
+            TRACE("loaded %u families from the font cache file\n", header->families);
+        }
+        else WARN("invalid font cache file\n");
+    }
+    else TRACE("font cache file is out of date\n");
+
+    munmap(data, st.st_size);
+    return ret;
 }
 
 static WCHAR *prepend_at(WCHAR *family)
@@ -2262,16 +2645,9 @@ static void LoadReplaceList(void)
                 Family * const family = find_family_from_any_name(data);
                 if (family != NULL)
                 {
-                    Family * const new_family = HeapAlloc(GetProcessHeap(), 0, sizeof(*new_family));
-                    if (new_family != NULL)
-                    {
-                        TRACE("mapping %s to %s\n", debugstr_w(data), debugstr_w(value));
-                        new_family->FamilyName = strdupW(value);
-                        new_family->EnglishName = NULL;
-                        list_init(&new_family->faces);
-                        new_family->replacement = &family->faces;
-                        list_add_tail(&font_list, &new_family->entry);
-                    }
+                    Family * const new_family = create_family(strdupW(value), NULL);
+                    TRACE("mapping %s to %s\n", debugstr_w(data), debugstr_w(value));
+                    new_family->replacement = &family->faces;
                 }
                 else
                 {
@@ -4075,17 +4451,12 @@ static void init_font_list(void)
 
 static BOOL move_to_front(const WCHAR *name)
 {
-    Family *family, *cursor2;
-    LIST_FOR_EACH_ENTRY_SAFE(family, cursor2, &font_list, Family, entry)
-    {
-        if(!strcmpiW(family->FamilyName, name))
-        {
-            list_remove(&family->entry);
-            list_add_head(&font_list, &family->entry);
-            return TRUE;
-        }
-    }
-    return FALSE;
+    Family *family = find_family_from_name(name);
+
+    if (!family) return FALSE;
+    list_remove(&family->entry);
+    list_add_head(&font_list, &family->entry);
+    return TRUE;
 }
 
 static BOOL set_default(const WCHAR **name_list)
@@ -4136,7 +4507,7 @@ BOOL WineEngInit(void)
 
     if(disposition == REG_CREATED_NEW_KEY)
         init_font_list();
-    else
+    else if (!load_font_list_from_file())
         load_font_list_from_cache(hkey_font_cache);
 
     reorder_font_list();
@@ -4370,6 +4741,118 @@ static GdiFont *alloc_font(void)
     return ret;
 }
 
+/* Rendered glyph bitmaps, shared by all the fonts of the process and
+ * bounded by total size. Text drawing asks for the same few hundred glyphs
+ * over and over, so this saves the FreeType rasterization on a hit. */
+struct glyph_bitmap
+{
+    struct list   entry;      /* entry in the LRU list */
+    struct list   hash_entry; /* entry in the hash bucket */
+    GdiFont      *font;
+    UINT          glyph;
+    UINT          format;
+    MAT2          mat;
+    GLYPHMETRICS  gm;
+    DWORD         size;
+    BYTE          bits[1];
+};
+
+#define GLYPH_CACHE_HASH_SIZE 256
+#define GLYPH_CACHE_MAX_SIZE  (4 * 1024 * 1024)
+
+static struct list glyph_cache_lru = LIST_INIT(glyph_cache_lru);
+static struct list glyph_cache_hash[GLYPH_CACHE_HASH_SIZE];
+static SIZE_T glyph_cache_size;
+static unsigned int glyph_cache_hits, glyph_cache_misses;
+
+static BOOL is_cacheable_glyph_format( UINT format )
+{
+    switch (format & ~(GGO_GLYPH_INDEX | GGO_UNHINTED))
+    {
+    case GGO_BITMAP:
+    case GGO_GRAY2_BITMAP:
+    case GGO_GRAY4_BITMAP:
+    case GGO_GRAY8_BITMAP:
+    case WINE_GGO_GRAY16_BITMAP:
+    case WINE_GGO_HRGB_BITMAP:
+    case WINE_GGO_HBGR_BITMAP:
+    case WINE_GGO_VRGB_BITMAP:
+    case WINE_GGO_VBGR_BITMAP:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static struct list *get_glyph_cache_bucket( const GdiFont *font, UINT glyph, UINT format )
+{
+    UINT_PTR hash = (UINT_PTR)font / sizeof(void *) + glyph * 31 + format;
+
+    if (!glyph_cache_hash[0].next)
+    {
+        unsigned int i;
+        for (i = 0; i < GLYPH_CACHE_HASH_SIZE; i++) list_init( &glyph_cache_hash[i] );
+    }
+    return &glyph_cache_hash[hash % GLYPH_CACHE_HASH_SIZE];
+}
+
+static void free_glyph_bitmap( struct glyph_bitmap *bitmap )
+{
+    list_remove( &bitmap->entry );
+    list_remove( &bitmap->hash_entry );
+    glyph_cache_size -= bitmap->size;
+    HeapFree( GetProcessHeap(), 0, bitmap );
+}
+
+static struct glyph_bitmap *find_glyph_bitmap( const GdiFont *font, UINT glyph, UINT format, const MAT2 *mat )
+{
+    struct list *bucket = get_glyph_cache_bucket( font, glyph, format );
+    struct glyph_bitmap *bitmap;
+
+    LIST_FOR_EACH_ENTRY( bitmap, bucket, struct glyph_bitmap, hash_entry )
+    {
+        if (bitmap->font != font || bitmap->glyph != glyph || bitmap->format != format) continue;
+        if (memcmp( &bitmap->mat, mat, sizeof(*mat) )) continue;
+        list_remove( &bitmap->entry );
+        list_add_head( &glyph_cache_lru, &bitmap->entry );
+        return bitmap;
+    }
+    return NULL;
+}
+
+static void add_glyph_bitmap( GdiFont *font, UINT glyph, UINT format, const MAT2 *mat,
+                              const GLYPHMETRICS *gm, DWORD size, const void *bits )
+{
+    struct glyph_bitmap *bitmap;
+
+    if (size > GLYPH_CACHE_MAX_SIZE / 16) return;
+    if (!(bitmap = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct glyph_bitmap, bits[size] ))))
+        return;
+
+    bitmap->font   = font;
+    bitmap->glyph  = glyph;
+    bitmap->format = format;
+    bitmap->mat    = *mat;
+    bitmap->gm     = *gm;
+    bitmap->size   = size;
+    memcpy( bitmap->bits, bits, size );
+
+    glyph_cache_size += size;
+    while (glyph_cache_size > GLYPH_CACHE_MAX_SIZE)
+        free_glyph_bitmap( LIST_ENTRY( list_tail( &glyph_cache_lru ), struct glyph_bitmap, entry ));
+
+    list_add_head( &glyph_cache_lru, &bitmap->entry );
+    list_add_head( get_glyph_cache_bucket( font, glyph, format ), &bitmap->hash_entry );
+}
+
+static void purge_glyph_bitmaps( const GdiFont *font )
+{
+    struct glyph_bitmap *bitmap, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( bitmap, next, &glyph_cache_lru, struct glyph_bitmap, entry )
+        if (bitmap->font == font) free_glyph_bitmap( bitmap );
+}
+
 static void free_font(GdiFont *font)
 {
     CHILD_FONT *child, *child_next;
@@ -4384,6 +4867,7 @@ static void free_font(GdiFont *font)
         HeapFree(GetProcessHeap(), 0, child);
     }
 
+    purge_glyph_bitmaps( font );
     if (font->ft_face) pFT_Done_Face(font->ft_face);
     if (font->mapping) unmap_font_file( font->mapping );
     HeapFree(GetProcessHeap(), 0, font->kern_pairs);
@@ -5034,9 +5518,9 @@ static HFONT freetype_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_flags )
     struct freetype_physdev *physdev = get_freetype_dev( dev );
     GdiFont *ret;
     Face *face, *best, *best_bitmap;
-    Family *family, *last_resort_family;
+    Family *family, *last_resort_family, *name_families[2];
     const struct list *face_list;
-    INT height, width = 0;
+    INT height, width = 0, i;
     unsigned int score = 0, new_score;
     signed int diff = 0, newdiff;
     BOOL bd, it, can_use_bitmap, want_vertical;
@@ -5152,23 +5636,28 @@ static HFONT freetype_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_flags )
 	   where we'll either use the charset of the current ansi codepage
 	   or if that's unavailable the first charset that the font supports.
 	*/
-        LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry ) {
-            if (!strcmpiW(family->FamilyName, FaceName) ||
-                (psub && !strcmpiW(family->FamilyName, psub->to.name)))
-            {
-                font_link = find_font_link(family->FamilyName);
-                face_list = get_face_list_from_family(family);
-                LIST_FOR_EACH_ENTRY( face, face_list, Face, entry ) {
-                    if (!(face->scalable || can_use_bitmap))
-                        continue;
-                    if (csi.fs.fsCsb[0] & face->fs.fsCsb[0])
-                        goto found;
-                    if (font_link != NULL &&
-                        csi.fs.fsCsb[0] & font_link->fs.fsCsb[0])
-                        goto found;
-                    if (!csi.fs.fsCsb[0])
-                        goto found;
-                }
+        name_families[0] = find_family_from_name(FaceName);
+        name_families[1] = psub ? find_family_from_name(psub->to.name) : NULL;
+        if (name_families[0] && name_families[1] && family_precedes(name_families[1], name_families[0]))
+        {
+            family = name_families[0];
+            name_families[0] = name_families[1];
+            name_families[1] = family;
+        }
+        for (i = 0; i < 2; i++) {
+            if (!(family = name_families[i])) continue;
+            font_link = find_font_link(family->FamilyName);
+            face_list = get_face_list_from_family(family);
+            LIST_FOR_EACH_ENTRY( face, face_list, Face, entry ) {
+                if (!(face->scalable || can_use_bitmap))
+                    continue;
+                if (csi.fs.fsCsb[0] & face->fs.fsCsb[0])
+                    goto found;
+                if (font_link != NULL &&
+                    csi.fs.fsCsb[0] & font_link->fs.fsCsb[0])
+                    goto found;
+                if (!csi.fs.fsCsb[0])
+                    goto found;
             }
 	}
 
@@ -5245,18 +5734,16 @@ static HFONT freetype_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_flags )
         strcpyW(lf.lfFaceName, defSans);
     else
         strcpyW(lf.lfFaceName, defSans);
-    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry ) {
-        if(!strcmpiW(family->FamilyName, lf.lfFaceName)) {
-            font_link = find_font_link(family->FamilyName);
-            face_list = get_face_list_from_family(family);
-            LIST_FOR_EACH_ENTRY( face, face_list, Face, entry ) {
-                if (!(face->scalable || can_use_bitmap))
-                    continue;
-                if (csi.fs.fsCsb[0] & face->fs.fsCsb[0])
-                    goto found;
-                if (font_link != NULL && csi.fs.fsCsb[0] & font_link->fs.fsCsb[0])
-                    goto found;
-            }
+    if ((family = find_family_from_name(lf.lfFaceName))) {
+        font_link = find_font_link(family->FamilyName);
+        face_list = get_face_list_from_family(family);
+        LIST_FOR_EACH_ENTRY( face, face_list, Face, entry ) {
+            if (!(face->scalable || can_use_bitmap))
+                continue;
+            if (csi.fs.fsCsb[0] & face->fs.fsCsb[0])
+                goto found;
+            if (font_link != NULL && csi.fs.fsCsb[0] & font_link->fs.fsCsb[0])
+                goto found;
         }
     }
 
@@ -7558,6 +8045,49 @@ end:
     return ret;
 }
 
+/*************************************************************
+ * get_cached_glyph_outline
+ *
+ * get_glyph_outline for the bitmap formats, going through the glyph cache.
+ */
+static DWORD get_cached_glyph_outline( GdiFont *font, UINT glyph, UINT format, LPGLYPHMETRICS lpgm,
+                                       DWORD buflen, LPVOID buf, const MAT2 *lpmat )
+{
+    struct glyph_bitmap *bitmap;
+    DWORD ret;
+    ABC abc;
+
+    if ((bitmap = find_glyph_bitmap( font, glyph, format, lpmat )))
+    {
+        if (!buf)
+        {
+            glyph_cache_hits++;
+            *lpgm = bitmap->gm;
+            return bitmap->size;
+        }
+        if (buflen >= bitmap->size)
+        {
+            glyph_cache_hits++;
+            *lpgm = bitmap->gm;
+            memcpy( buf, bitmap->bits, bitmap->size );
+            return bitmap->size;
+        }
+        /* let get_glyph_outline deal with short buffers */
+        return get_glyph_outline( font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
+    }
+
+    if (!(++glyph_cache_misses % 4096))
+        TRACE( "%u hits, %u misses, %lu bytes cached\n",
+               glyph_cache_hits, glyph_cache_misses, glyph_cache_size );
+
+    /* a size query doesn't rasterize the glyph, the bits are cached once they are
+     * rendered for the request that follows it */
+    ret = get_glyph_outline( font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
+    if (buf && ret != GDI_ERROR && ret && ret <= buflen)
+        add_glyph_bitmap( font, glyph, format, lpmat, lpgm, ret, buf );
+    return ret;
+}
+
 /*************************************************************
  * freetype_GetGlyphOutline
  */
@@ -7576,7 +8106,10 @@ static DWORD freetype_GetGlyphOutline( PHYSDEV dev, UINT glyph, UINT format,
 
     GDI_CheckNotLock();
     EnterCriticalSection( &freetype_cs );
-    ret = get_glyph_outline( physdev->font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
+    if (lpmat && is_cacheable_glyph_format( format ))
+        ret = get_cached_glyph_outline( physdev->font, glyph, format, lpgm, buflen, buf, lpmat );
+    else
+        ret = get_glyph_outline( physdev->font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
     LeaveCriticalSection( &freetype_cs );
     return ret;
 }
@@ -656,6 +656,8 @@ BOOL WINAPI DllMain( HINSTANCE inst, DWORD reason, LPVOID reserved )
     gdi32_module = inst;
     DisableThreadLibraryCalls( inst );
     WineEngInit();
+    init_dib_primitives();
+    init_dib_parallel();
 
     /* create stock objects */
     stock_objects[WHITE_BRUSH]  = CreateBrushIndirect( &WhiteBrush );
@@ -26,6 +26,7 @@
 #include "winbase.h"
 #include "wingdi.h"
 #include "winuser.h"
+#include "winreg.h"
 #include "wincrypt.h"
 #include "mmsystem.h" /* DIBINDEX */
 
@@ -3330,16 +3331,274 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+static HBITMAP create_timing_dib( HDC hdc, int size, int bpp, void **bits )
+{
+    BITMAPINFO bmi;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth       = size;
+    bmi.bmiHeader.biHeight      = -size;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = bpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    return CreateDIBSection( hdc, &bmi, DIB_RGB_COLORS, bits, NULL, 0 );
+}
+
+/* not a conformance test, this traces the cost of the most used primitives
+ * to make it easier to compare implementations */
+static void test_primitive_timings(void)
+{
+    static const int sizes[] = { 64, 256, 1024 };
+    static const BLENDFUNCTION blends[] =
+    {
+        { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA },
+        { AC_SRC_OVER, 0, 128, AC_SRC_ALPHA },
+        { AC_SRC_OVER, 0, 128, 0 },
+    };
+    HDC src_dc, dst_dc;
+    HBITMAP src_bmp, dst_bmp, old_src, old_dst;
+    DWORD *src_bits, *dst_bits, start, count;
+    WORD *bits_555;
+    BITMAPINFO bmi;
+    int i, j, k, size;
+
+    if (!winetest_interactive)
+    {
+        skip( "primitive timings (set WINETEST_INTERACTIVE=1)\n" );
+        return;
+    }
+    if (!pGdiAlphaBlend)
+    {
+        win_skip( "GdiAlphaBlend not supported\n" );
+        return;
+    }
+
+    src_dc = CreateCompatibleDC( 0 );
+    dst_dc = CreateCompatibleDC( 0 );
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        size = sizes[i];
+        count = (1 << 22) / (size * size) + 1;
+        src_bmp = create_timing_dib( src_dc, size, 32, (void **)&src_bits );
+        dst_bmp = create_timing_dib( dst_dc, size, 32, (void **)&dst_bits );
+        ok( src_bmp && dst_bmp, "failed to create dibs\n" );
+        if (!src_bmp || !dst_bmp) break;
+
+        for (j = 0; j < size * size; j++)
+        {
+            BYTE alpha = j * 7;
+            src_bits[j] = (alpha << 24) | ((j * 3 % (alpha + 1)) << 16) | ((j % (alpha + 1)) << 8) | alpha;
+            dst_bits[j] = j * 0x01030507;
+        }
+        old_src = SelectObject( src_dc, src_bmp );
+        old_dst = SelectObject( dst_dc, dst_bmp );
+
+        for (j = 0; j < sizeof(blends) / sizeof(blends[0]); j++)
+        {
+            start = GetTickCount();
+            for (k = 0; k < count; k++)
+                pGdiAlphaBlend( dst_dc, 0, 0, size, size, src_dc, 0, 0, size, size, blends[j] );
+            trace( "%4dx%-4d AlphaBlend alpha %3u format %u: %u ms for %u calls\n", size, size,
+                   blends[j].SourceConstantAlpha, blends[j].AlphaFormat, GetTickCount() - start, count );
+        }
+
+        SelectObject( src_dc, old_src );
+        SelectObject( dst_dc, old_dst );
+        bits_555 = HeapAlloc( GetProcessHeap(), 0, size * size * sizeof(WORD) );
+
+        memset( &bmi, 0, sizeof(bmi) );
+        bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth       = size;
+        bmi.bmiHeader.biHeight      = -size;
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 16;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        start = GetTickCount();
+        for (k = 0; k < count; k++)
+            GetDIBits( dst_dc, dst_bmp, 0, size, bits_555, &bmi, DIB_RGB_COLORS );
+        trace( "%4dx%-4d 8888 to 555: %u ms for %u calls\n", size, size, GetTickCount() - start, count );
+
+        start = GetTickCount();
+        for (k = 0; k < count; k++)
+            SetDIBits( dst_dc, dst_bmp, 0, size, bits_555, &bmi, DIB_RGB_COLORS );
+        trace( "%4dx%-4d 555 to 8888: %u ms for %u calls\n", size, size, GetTickCount() - start, count );
+
+        HeapFree( GetProcessHeap(), 0, bits_555 );
+        DeleteObject( src_bmp );
+        DeleteObject( dst_bmp );
+    }
+
+    DeleteDC( src_dc );
+    DeleteDC( dst_dc );
+}
+
+#define SCENE_SIZE 1024
+
+/* large primitives, which the DIB engine may split across threads */
+static DWORD *render_scene(void)
+{
+    static const BLENDFUNCTION blend = { AC_SRC_OVER, 0, 192, AC_SRC_ALPHA };
+    BITMAPINFO bmi;
+    HDC dc, src_dc;
+    HBITMAP bmp, src_bmp, old, old_src;
+    HBRUSH brush, old_brush;
+    HRGN rgn, tmp;
+    DWORD *bits, *src_bits, *ret;
+    int i;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth       = SCENE_SIZE;
+    bmi.bmiHeader.biHeight      = -SCENE_SIZE;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    dc = CreateCompatibleDC( 0 );
+    bmp = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    old = SelectObject( dc, bmp );
+
+    brush = CreateHatchBrush( HS_DIAGCROSS, RGB( 0x20, 0x80, 0xc0 ) );
+    old_brush = SelectObject( dc, brush );
+    SetBkColor( dc, RGB( 0xf0, 0xe0, 0x10 ) );
+    PatBlt( dc, 0, 0, SCENE_SIZE, SCENE_SIZE, PATCOPY );
+    SelectObject( dc, old_brush );
+    DeleteObject( brush );
+
+    rgn = CreateRectRgn( 0, 0, 0, 0 );
+    for (i = 0; i < 8; i++)
+    {
+        tmp = CreateRectRgn( 30 + i * 50, 17 + i * 90, SCENE_SIZE - 20 - i * 30, 97 + i * 120 );
+        CombineRgn( rgn, rgn, tmp, RGN_OR );
+        DeleteObject( tmp );
+    }
+    brush = CreateSolidBrush( RGB( 0x55, 0x33, 0xaa ) );
+    FillRgn( dc, rgn, brush );
+    DeleteObject( brush );
+    DeleteObject( rgn );
+
+    bmi.bmiHeader.biWidth  = 256;
+    bmi.bmiHeader.biHeight = -200;
+    src_dc = CreateCompatibleDC( 0 );
+    src_bmp = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    old_src = SelectObject( src_dc, src_bmp );
+    for (i = 0; i < 256 * 200; i++)
+    {
+        BYTE alpha = i % 256;
+        src_bits[i] = (alpha << 24) | (((i / 256) * alpha / 200) << 16) | (((i * 7) & 0xff) * alpha / 255 << 8) | (alpha / 2);
+    }
+
+    if (pGdiAlphaBlend) pGdiAlphaBlend( dc, 10, 20, 1000, 990, src_dc, 0, 0, 256, 200, blend );
+    SetStretchBltMode( dc, COLORONCOLOR );
+    StretchBlt( dc, 0, 300, SCENE_SIZE, 700, src_dc, 3, 5, 250, 190, SRCINVERT );
+
+    ret = HeapAlloc( GetProcessHeap(), 0, SCENE_SIZE * SCENE_SIZE * sizeof(DWORD) );
+    memcpy( ret, bits, SCENE_SIZE * SCENE_SIZE * sizeof(DWORD) );
+
+    SelectObject( src_dc, old_src );
+    DeleteObject( src_bmp );
+    DeleteDC( src_dc );
+    SelectObject( dc, old );
+    DeleteObject( bmp );
+    DeleteDC( dc );
+    return ret;
+}
+
+static void test_parallel_rendering( const char *argv0 )
+{
+    static const char threads[] = "4";
+    char temp_path[MAX_PATH], filename[MAX_PATH], cmdline[2 * MAX_PATH], old_value[16];
+    DWORD *serial, *parallel, size, disposition, type, old_size = sizeof(old_value);
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    HANDLE file;
+    HKEY key;
+    LONG res;
+    BOOL ret, restore;
+    int i;
+
+    /* the setting is read at startup, so the parallel scene is rendered by a child process */
+    res = RegCreateKeyExA( HKEY_CURRENT_USER, "Software\\Wine\\DIB Engine", 0, NULL, 0,
+                           KEY_ALL_ACCESS, NULL, &key, &disposition );
+    if (res)
+    {
+        skip( "can't create the DIB Engine key, error %d\n", res );
+        return;
+    }
+    restore = !RegQueryValueExA( key, "Threads", NULL, &type, (BYTE *)old_value, &old_size );
+    RegSetValueExA( key, "Threads", 0, REG_SZ, (const BYTE *)threads, sizeof(threads) );
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "dib", 0, filename );
+    sprintf( cmdline, "\"%s\" dib parallel \"%s\"", argv0, filename );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    ok( ret, "CreateProcess failed, error %u\n", GetLastError() );
+    winetest_wait_child_process( pi.hProcess );
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+
+    if (restore) RegSetValueExA( key, "Threads", 0, type, (const BYTE *)old_value, old_size );
+    else RegDeleteValueA( key, "Threads" );
+    RegCloseKey( key );
+    if (disposition == REG_CREATED_NEW_KEY) RegDeleteKeyA( HKEY_CURRENT_USER, "Software\\Wine\\DIB Engine" );
+
+    serial = render_scene();
+    parallel = HeapAlloc( GetProcessHeap(), 0, SCENE_SIZE * SCENE_SIZE * sizeof(DWORD) );
+    file = CreateFileA( filename, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError() );
+    size = 0;
+    ret = ReadFile( file, parallel, SCENE_SIZE * SCENE_SIZE * sizeof(DWORD), &size, NULL );
+    ok( ret && size == SCENE_SIZE * SCENE_SIZE * sizeof(DWORD), "read %u bytes\n", size );
+    CloseHandle( file );
+    DeleteFileA( filename );
+
+    if (size == SCENE_SIZE * SCENE_SIZE * sizeof(DWORD))
+    {
+        for (i = 0; i < SCENE_SIZE * SCENE_SIZE; i++) if (serial[i] != parallel[i]) break;
+        ok( i == SCENE_SIZE * SCENE_SIZE, "pixel %d,%d differs: %08x / %08x\n",
+            i % SCENE_SIZE, i / SCENE_SIZE, serial[i], parallel[i] );
+    }
+    HeapFree( GetProcessHeap(), 0, serial );
+    HeapFree( GetProcessHeap(), 0, parallel );
+}
+
+static void save_scene( const char *filename )
+{
+    DWORD *bits = render_scene(), size;
+    HANDLE file;
+
+    file = CreateFileA( filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError() );
+    WriteFile( file, bits, SCENE_SIZE * SCENE_SIZE * sizeof(DWORD), &size, NULL );
+    CloseHandle( file );
+    HeapFree( GetProcessHeap(), 0, bits );
+}
+
 START_TEST(dib)
 {
     HMODULE mod = GetModuleHandleA("gdi32.dll");
+    char **argv;
+    int argc;
+
     pSetLayout = (void *)GetProcAddress( mod, "SetLayout" );
     pGdiAlphaBlend = (void *)GetProcAddress( mod, "GdiAlphaBlend" );
     pGdiGradientFill = (void *)GetProcAddress( mod, "GdiGradientFill" );
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 4 && !strcmp( argv[2], "parallel" ))
+    {
+        save_scene( argv[3] );
+        return;
+    }
+
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
     test_simple_graphics();
+    test_parallel_rendering( argv[0] );
+    test_primitive_timings();
 
     CryptReleaseContext(crypt_prov, 0);
 }
@@ -5057,6 +5057,67 @@ static void test_GetGlyphOutline_empty_contour(void)
     ReleaseDC(NULL, hdc);
 }
 
+static void test_GetGlyphOutline_repeated(void)
+{
+    static const MAT2 mat2 = { {0,2}, {0,0}, {0,0}, {0,2} };
+    static const UINT formats[] = { GGO_BITMAP, GGO_GRAY2_BITMAP, GGO_GRAY4_BITMAP, GGO_GRAY8_BITMAP };
+    HDC hdc;
+    LOGFONTA lf;
+    HFONT hfont, hfont_prev;
+    GLYPHMETRICS gm, gm2;
+    BYTE *buf, *buf2;
+    DWORD ret, size, size2;
+    UINT i;
+
+    /* a size not used by the other tests, so that the first rendering isn't cached yet */
+    memset(&lf, 0, sizeof(lf));
+    lf.lfHeight = -37;
+    lstrcpyA(lf.lfFaceName, "Arial");
+
+    hfont = CreateFontIndirectA(&lf);
+    ok(hfont != 0, "CreateFontIndirectA error %u\n", GetLastError());
+
+    hdc = GetDC(NULL);
+    hfont_prev = SelectObject(hdc, hfont);
+    ok(hfont_prev != NULL, "SelectObject failed\n");
+
+    for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+    {
+        size = GetGlyphOutlineA(hdc, 'W', formats[i], &gm, 0, NULL, &mat);
+        if (size == GDI_ERROR || !size)
+        {
+            skip("GetGlyphOutline format %u not supported\n", formats[i]);
+            continue;
+        }
+        buf = HeapAlloc(GetProcessHeap(), 0, size);
+        buf2 = HeapAlloc(GetProcessHeap(), 0, size);
+
+        ret = GetGlyphOutlineA(hdc, 'W', formats[i], &gm, size, buf, &mat);
+        ok(ret == size, "%u: GetGlyphOutline returned %u, expected %u\n", formats[i], ret, size);
+
+        /* a different transform must not return the same bits */
+        size2 = GetGlyphOutlineA(hdc, 'W', formats[i], &gm2, 0, NULL, &mat2);
+        ok(size2 > size, "%u: got size %u for the scaled glyph, expected more than %u\n", formats[i], size2, size);
+        ok(gm2.gmBlackBoxX > gm.gmBlackBoxX, "%u: got width %u for the scaled glyph, expected more than %u\n",
+           formats[i], gm2.gmBlackBoxX, gm.gmBlackBoxX);
+
+        /* served from the cache on Wine, it has to match the first rendering */
+        memset(&gm2, 0xcc, sizeof(gm2));
+        memset(buf2, 0xcc, size);
+        ret = GetGlyphOutlineA(hdc, 'W', formats[i], &gm2, size, buf2, &mat);
+        ok(ret == size, "%u: GetGlyphOutline returned %u, expected %u\n", formats[i], ret, size);
+        ok(!memcmp(&gm, &gm2, sizeof(gm)), "%u: glyph metrics differ\n", formats[i]);
+        ok(!memcmp(buf, buf2, size), "%u: glyph bits differ\n", formats[i]);
+
+        HeapFree(GetProcessHeap(), 0, buf);
+        HeapFree(GetProcessHeap(), 0, buf2);
+    }
+
+    SelectObject(hdc, hfont_prev);
+    DeleteObject(hfont);
+    ReleaseDC(NULL, hdc);
+}
+
 static void test_GetGlyphOutline_metric_clipping(void)
 {
     HDC hdc;
@@ -5729,6 +5790,52 @@ static void test_vertical_order(void)
     DeleteDC( hdc );
 }
 
+static void test_family_name_lookup(void)
+{
+    struct enum_font_data efd;
+    char name[LF_FACESIZE], face_name[LF_FACESIZE];
+    LOGFONTA lf;
+    HFONT hfont;
+    HDC hdc;
+    int i, ret;
+
+    hdc = CreateCompatibleDC(0);
+    ok(hdc != NULL, "CreateCompatibleDC failed\n");
+
+    memset(&lf, 0, sizeof(lf));
+    lf.lfCharSet = DEFAULT_CHARSET;
+    efd.total = 0;
+    EnumFontFamiliesExA(hdc, &lf, enum_font_data_proc, (LPARAM)&efd, 0);
+    if (!efd.total)
+    {
+        skip("no TrueType fonts installed\n");
+        DeleteDC(hdc);
+        return;
+    }
+
+    /* every enumerated family must be found again by name, whatever its case */
+    for (i = 0; i < efd.total; i++)
+    {
+        strcpy(name, efd.lf[i].lfFaceName);
+        if (i % 2) CharUpperA(name);
+        else CharLowerA(name);
+
+        memset(&lf, 0, sizeof(lf));
+        strcpy(lf.lfFaceName, name);
+        lf.lfCharSet = efd.lf[i].lfCharSet;
+        lf.lfHeight = 16;
+        hfont = CreateFontIndirectA(&lf);
+        ok(hfont != NULL, "CreateFontIndirect failed\n");
+        hfont = SelectObject(hdc, hfont);
+        memset(face_name, 0, sizeof(face_name));
+        ret = GetTextFaceA(hdc, sizeof(face_name), face_name);
+        ok(ret && !lstrcmpiA(face_name, efd.lf[i].lfFaceName),
+           "%s: expected face %s, got %s\n", name, efd.lf[i].lfFaceName, face_name);
+        DeleteObject(SelectObject(hdc, hfont));
+    }
+    DeleteDC(hdc);
+}
+
 static void test_GetCharWidth32(void)
 {
     BOOL ret;
@@ -6069,6 +6176,7 @@ START_TEST(font)
     test_GdiRealizationInfo();
     test_GetTextFace();
     test_GetGlyphOutline();
+    test_GetGlyphOutline_repeated();
     test_GetTextMetrics2("Tahoma", -11);
     test_GetTextMetrics2("Tahoma", -55);
     test_GetTextMetrics2("Tahoma", -110);
@@ -6083,6 +6191,7 @@ START_TEST(font)
     test_east_asian_font_selection();
     test_max_height();
     test_vertical_order();
+    test_family_name_lookup();
     test_GetCharWidth32();
     test_fake_bold_font();
     test_bitmap_font_glyph_index();
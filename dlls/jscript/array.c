@@ -27,10 +27,20 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(jscript);
 
+/*
+ * Elements 0..elems_cnt-1 are stored in the elems vector and exposed through the
+ * index property hooks. As soon as a hole would be created, all the elements are
+ * moved to regular properties and the array stays sparse.
+ */
 typedef struct {
     jsdisp_t dispex;
 
     DWORD length;
+
+    jsval_t *elems;
+    DWORD elems_cnt;
+    DWORD elems_size;
+    BOOL sparse;
 } ArrayInstance;
 
 static const WCHAR lengthW[] = {'l','e','n','g','t','h',0};
@@ -59,6 +69,63 @@ static inline ArrayInstance *array_this(vdisp_t *jsthis)
     return is_vclass(jsthis, JSCLASS_ARRAY) ? array_from_vdisp(jsthis) : NULL;
 }
 
+static inline ArrayInstance *dense_array(jsdisp_t *jsdisp)
+{
+    return is_class(jsdisp, JSCLASS_ARRAY) && !((ArrayInstance*)jsdisp)->sparse ? (ArrayInstance*)jsdisp : NULL;
+}
+
+static BOOL grow_elems(ArrayInstance *array, DWORD cnt)
+{
+    jsval_t *new_elems;
+    DWORD new_size;
+
+    if(cnt <= array->elems_size)
+        return TRUE;
+
+    new_size = max(cnt, max(array->elems_size*2, 4));
+    if(array->elems)
+        new_elems = heap_realloc(array->elems, new_size*sizeof(*new_elems));
+    else
+        new_elems = heap_alloc(new_size*sizeof(*new_elems));
+    if(!new_elems)
+        return FALSE;
+
+    array->elems = new_elems;
+    array->elems_size = new_size;
+    return TRUE;
+}
+
+static void truncate_elems(ArrayInstance *array, DWORD cnt)
+{
+    while(array->elems_cnt > cnt)
+        jsval_release(array->elems[--array->elems_cnt]);
+}
+
+/* move all the elements to regular properties */
+static HRESULT make_sparse(ArrayInstance *array)
+{
+    DWORD i, cnt = array->elems_cnt, length = array->length;
+    jsval_t *elems = array->elems;
+    HRESULT hres = S_OK;
+
+    TRACE("%p %u\n", array, cnt);
+
+    array->sparse = TRUE;
+    array->elems = NULL;
+    array->elems_cnt = array->elems_size = 0;
+
+    for(i=0; i < cnt; i++) {
+        if(SUCCEEDED(hres))
+            hres = jsdisp_propput_idx(&array->dispex, i, elems[i]);
+        jsval_release(elems[i]);
+    }
+    heap_free(elems);
+
+    /* an element may have been added without being set yet */
+    array->length = length;
+    return hres;
+}
+
 static HRESULT get_length(script_ctx_t *ctx, vdisp_t *vdisp, jsdisp_t **jsthis, DWORD *ret)
 {
     ArrayInstance *array;
@@ -137,10 +204,14 @@ static HRESULT Array_length(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, unsi
         if(len!=(DWORD)len)
             return throw_range_error(ctx, JS_E_INVALID_LENGTH, NULL);
 
-        for(i=len; i<This->length; i++) {
-            hres = jsdisp_delete_idx(&This->dispex, i);
-            if(FAILED(hres))
-                return hres;
+        if(!This->sparse) {
+            truncate_elems(This, len);
+        }else {
+            for(i=len; i<This->length; i++) {
+                hres = jsdisp_delete_idx(&This->dispex, i);
+                if(FAILED(hres))
+                    return hres;
+            }
         }
 
         This->length = len;
@@ -357,6 +428,7 @@ static HRESULT Array_join(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigne
 static HRESULT Array_pop(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *jsthis;
     jsval_t val;
     DWORD length;
@@ -378,6 +450,17 @@ static HRESULT Array_pop(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned
         return S_OK;
     }
 
+    array = dense_array(jsthis);
+    if(array && array->elems_cnt == length) {
+        val = array->elems[--array->elems_cnt];
+        array->length--;
+        if(r)
+            *r = val;
+        else
+            jsval_release(val);
+        return S_OK;
+    }
+
     length--;
     hres = jsdisp_get_idx(jsthis, length, &val);
     if(SUCCEEDED(hres))
@@ -406,6 +489,7 @@ static HRESULT Array_pop(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned
 static HRESULT Array_push(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *jsthis;
     DWORD length = 0;
     unsigned i;
@@ -417,6 +501,25 @@ static HRESULT Array_push(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigne
     if(FAILED(hres))
         return hres;
 
+    array = dense_array(jsthis);
+    if(array && array->elems_cnt == length && length+argc >= length) {
+        if(!grow_elems(array, length+argc))
+            return E_OUTOFMEMORY;
+
+        for(i=0; i < argc; i++) {
+            hres = jsval_copy(argv[i], array->elems+length+i);
+            if(FAILED(hres))
+                break;
+        }
+        array->elems_cnt = array->length = length+i;
+        if(FAILED(hres))
+            return hres;
+
+        if(r)
+            *r = jsval_number(length+argc);
+        return S_OK;
+    }
+
     for(i=0; i < argc; i++) {
         hres = jsdisp_propput_idx(jsthis, length+i, argv[i]);
         if(FAILED(hres))
@@ -546,6 +649,7 @@ static HRESULT Array_shift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsign
 /* ECMA-262 3rd Edition    15.4.4.10 */
 static HRESULT Array_slice(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *arr, *jsthis;
     DOUBLE range;
     DWORD length, start, end, idx;
@@ -587,7 +691,33 @@ static HRESULT Array_slice(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsign
     if(FAILED(hres))
         return hres;
 
-    for(idx=start; idx<end; idx++) {
+    array = dense_array(jsthis);
+    if(array && start < end && start < array->elems_cnt) {
+        ArrayInstance *ret = (ArrayInstance*)arr;
+        DWORD cnt = min(end, array->elems_cnt) - start;
+
+        if(!grow_elems(ret, cnt)) {
+            jsdisp_release(arr);
+            return E_OUTOFMEMORY;
+        }
+
+        for(idx=0; idx < cnt; idx++) {
+            hres = jsval_copy(array->elems[start+idx], ret->elems+idx);
+            if(FAILED(hres))
+                break;
+            ret->elems_cnt++;
+        }
+        if(FAILED(hres)) {
+            jsdisp_release(arr);
+            return hres;
+        }
+
+        idx = start+cnt;
+    }else {
+        idx = start;
+    }
+
+    for(; idx<end; idx++) {
         jsval_t v;
 
         hres = jsdisp_get_idx(jsthis, idx, &v);
@@ -1021,6 +1151,10 @@ static HRESULT Array_value(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, unsig
 
 static void Array_destructor(jsdisp_t *dispex)
 {
+    ArrayInstance *array = (ArrayInstance*)dispex;
+
+    truncate_elems(array, 0);
+    heap_free(array->elems);
     heap_free(dispex);
 }
 
@@ -1041,10 +1175,108 @@ static void Array_on_put(jsdisp_t *dispex, const WCHAR *name)
     if(*ptr)
         return;
 
+    /* an element was stored as a regular property, so the others have to be too */
+    if(!array->sparse)
+        make_sparse(array);
+
     if(id >= array->length)
         array->length = id+1;
 }
 
+static unsigned Array_idx_length(jsdisp_t *dispex)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+
+    return array->elems_cnt;
+}
+
+static HRESULT Array_idx_get(jsdisp_t *dispex, unsigned idx, jsval_t *r)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+
+    TRACE("%p[%u]\n", array, idx);
+
+    if(idx >= array->elems_cnt) {
+        *r = jsval_undefined();
+        return S_OK;
+    }
+
+    return jsval_copy(array->elems[idx], r);
+}
+
+static HRESULT Array_idx_add(jsdisp_t *dispex, unsigned idx)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+    HRESULT hres;
+
+    if(array->sparse)
+        return S_FALSE;
+    if(idx < array->elems_cnt)
+        return S_OK;
+
+    if(idx > array->elems_cnt) {
+        hres = make_sparse(array);
+        return FAILED(hres) ? hres : S_FALSE;
+    }
+
+    if(!grow_elems(array, idx+1))
+        return E_OUTOFMEMORY;
+
+    /* the length is only updated when the element is set */
+    array->elems[array->elems_cnt++] = jsval_undefined();
+    return S_OK;
+}
+
+static HRESULT Array_idx_put(jsdisp_t *dispex, unsigned idx, jsval_t val)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+    jsval_t copy;
+    HRESULT hres;
+
+    TRACE("%p[%u] = %s\n", array, idx, debugstr_jsval(val));
+
+    if(idx >= array->elems_cnt) {
+        /* the element was removed after its property was looked up */
+        hres = Array_idx_add(dispex, idx);
+        if(FAILED(hres))
+            return hres;
+        if(hres == S_FALSE)
+            return jsdisp_propput_idx(dispex, idx, val);
+    }
+
+    hres = jsval_copy(val, &copy);
+    if(FAILED(hres))
+        return hres;
+
+    jsval_release(array->elems[idx]);
+    array->elems[idx] = copy;
+    if(idx >= array->length)
+        array->length = idx+1;
+    return S_OK;
+}
+
+static HRESULT Array_idx_delete(jsdisp_t *dispex, unsigned idx)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+    HRESULT hres;
+
+    TRACE("%p[%u]\n", array, idx);
+
+    if(idx >= array->elems_cnt)
+        return S_OK;
+
+    if(idx == array->elems_cnt-1) {
+        truncate_elems(array, idx);
+        return S_OK;
+    }
+
+    hres = make_sparse(array);
+    if(FAILED(hres))
+        return hres;
+
+    return jsdisp_delete_idx(dispex, idx);
+}
+
 static const builtin_prop_t Array_props[] = {
     {concatW,                Array_concat,               PROPF_METHOD|1},
     {joinW,                  Array_join,                 PROPF_METHOD|1},
@@ -1067,7 +1299,12 @@ static const builtin_info_t Array_info = {
     sizeof(Array_props)/sizeof(*Array_props),
     Array_props,
     Array_destructor,
-    Array_on_put
+    Array_on_put,
+    Array_idx_length,
+    Array_idx_get,
+    Array_idx_put,
+    Array_idx_add,
+    Array_idx_delete
 };
 
 static const builtin_prop_t ArrayInst_props[] = {
@@ -1080,7 +1317,12 @@ static const builtin_info_t ArrayInst_info = {
     sizeof(ArrayInst_props)/sizeof(*ArrayInst_props),
     ArrayInst_props,
     Array_destructor,
-    Array_on_put
+    Array_on_put,
+    Array_idx_length,
+    Array_idx_get,
+    Array_idx_put,
+    Array_idx_add,
+    Array_idx_delete
 };
 
 static HRESULT ArrayConstr_value(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
@@ -40,11 +40,25 @@ typedef struct _statement_ctx_t {
     struct _statement_ctx_t *next;
 } statement_ctx_t;
 
+/* variables visible in a function, used to resolve identifiers at compile time */
+typedef struct _function_scope_t {
+    function_code_t *func;
+    function_expression_t *funcs;
+
+    BOOL is_global;  /* variables are properties of the global object */
+    BOOL is_eval;    /* code is executed in the scope of the caller */
+    BOOL is_dynamic; /* eval may add variables */
+    BOOL in_scope;   /* function is created in a with or catch block */
+
+    struct _function_scope_t *parent;
+} function_scope_t;
+
 typedef struct {
     parser_ctx_t *parser;
     bytecode_t *code;
 
     BOOL from_eval;
+    BOOL is_procedure;
 
     unsigned code_off;
     unsigned code_size;
@@ -61,8 +75,16 @@ typedef struct {
 
     function_expression_t *func_head;
     function_expression_t *func_tail;
+
+    function_scope_t *scope;
+    unsigned *ident_instrs;
+    unsigned ident_instrs_size;
+    unsigned ident_instrs_cnt;
 } compiler_ctx_t;
 
+static const WCHAR argumentsW[] = {'a','r','g','u','m','e','n','t','s',0};
+static const WCHAR evalW[] = {'e','v','a','l',0};
+
 static const struct {
     const char *op_str;
     instr_arg_type_t arg1_type;
@@ -287,6 +309,54 @@ static HRESULT push_instr_bstr_uint(compiler_ctx_t *ctx, jsop_t op, const WCHAR
     return S_OK;
 }
 
+static BOOL is_scope_used(compiler_ctx_t *ctx)
+{
+    statement_ctx_t *iter;
+
+    for(iter = ctx->stat_ctx; iter; iter = iter->next) {
+        if(iter->using_scope)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* identifier instructions are resolved when all the variables of the function are known */
+static HRESULT push_instr_ident(compiler_ctx_t *ctx, jsop_t op, const WCHAR *identifier, unsigned flags)
+{
+    HRESULT hres;
+
+    if(!strcmpW(identifier, evalW))
+        ctx->scope->is_dynamic = TRUE;
+
+    hres = push_instr_bstr_uint(ctx, op, identifier, flags);
+    if(FAILED(hres))
+        return hres;
+
+    /* var statements always set the variable, even in with blocks */
+    if(op != OP_var_set && is_scope_used(ctx))
+        return S_OK;
+
+    if(!ctx->ident_instrs_size) {
+        ctx->ident_instrs = heap_alloc(16 * sizeof(*ctx->ident_instrs));
+        if(!ctx->ident_instrs)
+            return E_OUTOFMEMORY;
+        ctx->ident_instrs_size = 16;
+    }else if(ctx->ident_instrs_size == ctx->ident_instrs_cnt) {
+        unsigned *new_instrs;
+
+        new_instrs = heap_realloc(ctx->ident_instrs, ctx->ident_instrs_size*2*sizeof(*ctx->ident_instrs));
+        if(!new_instrs)
+            return E_OUTOFMEMORY;
+
+        ctx->ident_instrs = new_instrs;
+        ctx->ident_instrs_size *= 2;
+    }
+
+    ctx->ident_instrs[ctx->ident_instrs_cnt++] = ctx->code_off-1;
+    return S_OK;
+}
+
 static HRESULT push_instr_uint_str(compiler_ctx_t *ctx, jsop_t op, unsigned arg1, const WCHAR *arg2)
 {
     unsigned instr;
@@ -369,6 +439,10 @@ static HRESULT compile_member_expression(compiler_ctx_t *ctx, member_expression_
     if(FAILED(hres))
         return hres;
 
+    /* eval called as a method still uses the scope of the caller */
+    if(!strcmpW(expr->identifier, evalW))
+        ctx->scope->is_dynamic = TRUE;
+
     return push_instr_bstr(ctx, OP_member, expr->identifier);
 }
 
@@ -414,7 +488,7 @@ static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *ex
     case EXPR_IDENT: {
         identifier_expression_t *ident_expr = (identifier_expression_t*)expr;
 
-        hres = push_instr_bstr_uint(ctx, OP_identid, ident_expr->identifier, flags);
+        hres = push_instr_ident(ctx, OP_identid, ident_expr->identifier, flags);
         break;
     }
     case EXPR_ARRAY: {
@@ -438,12 +512,10 @@ static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *ex
         if(FAILED(hres))
             return hres;
 
-        /* FIXME: Potential optimization */
-        hres = push_instr_str(ctx, OP_str, member_expr->identifier);
-        if(FAILED(hres))
-            return hres;
+        if(!strcmpW(member_expr->identifier, evalW))
+            ctx->scope->is_dynamic = TRUE;
 
-        hres = push_instr_uint(ctx, OP_memberid, flags);
+        hres = push_instr_bstr_uint(ctx, OP_memberid_name, member_expr->identifier, flags);
         break;
     }
     DEFAULT_UNREACHABLE;
@@ -678,6 +750,26 @@ static HRESULT compile_assign_expression(compiler_ctx_t *ctx, binary_expression_
         }else {
             use_throw_path = TRUE;
         }
+    }else if(expr->expression1->type == EXPR_ARRAY && op == OP_LAST) {
+        binary_expression_t *array_expr = (binary_expression_t*)expr->expression1;
+
+        /* elements are stored by index, without looking up their DISPID first */
+        hres = compile_expression(ctx, array_expr->expression1, TRUE);
+        if(FAILED(hres))
+            return hres;
+
+        hres = compile_expression(ctx, array_expr->expression2, TRUE);
+        if(FAILED(hres))
+            return hres;
+
+        if(!push_instr(ctx, OP_memberkey))
+            return E_OUTOFMEMORY;
+
+        hres = compile_expression(ctx, expr->expression2, TRUE);
+        if(FAILED(hres))
+            return hres;
+
+        return push_instr(ctx, OP_assign_member) ? S_OK : E_OUTOFMEMORY;
     }else if(is_memberid_expr(expr->expression1->type)) {
         hres = compile_memberid_expression(ctx, expr->expression1, fdexNameEnsure);
         if(FAILED(hres))
@@ -860,10 +952,13 @@ static HRESULT compile_function_expression(compiler_ctx_t *ctx, function_express
 {
     ctx->func_tail = ctx->func_tail ? (ctx->func_tail->next = expr) : (ctx->func_head = expr);
 
+    /* anonymous functions are created when the expression is evaluated, in its scope */
+    expr->in_scope = !expr->identifier && is_scope_used(ctx);
+
     /* FIXME: not exactly right */
     if(expr->identifier) {
         ctx->func->func_cnt++;
-        return push_instr_bstr(ctx, OP_ident, expr->identifier);
+        return push_instr_ident(ctx, OP_ident, expr->identifier, 0);
     }
 
     return push_instr_uint(ctx, OP_func, ctx->func->func_cnt++);
@@ -960,7 +1055,7 @@ static HRESULT compile_expression(compiler_ctx_t *ctx, expression_t *expr, BOOL
         hres = compile_binary_expression(ctx, (binary_expression_t*)expr, OP_gteq);
         break;
     case EXPR_IDENT:
-        hres = push_instr_bstr(ctx, OP_ident, ((identifier_expression_t*)expr)->identifier);
+        hres = push_instr_ident(ctx, OP_ident, ((identifier_expression_t*)expr)->identifier, 0);
         break;
     case EXPR_IN:
         hres = compile_binary_expression(ctx, (binary_expression_t*)expr, OP_in);
@@ -1101,7 +1196,7 @@ static HRESULT compile_variable_list(compiler_ctx_t *ctx, variable_declaration_t
         if(FAILED(hres))
             return hres;
 
-        hres = push_instr_bstr(ctx, OP_var_set, iter->identifier);
+        hres = push_instr_ident(ctx, OP_var_set, iter->identifier, 0);
         if(FAILED(hres))
             return hres;
     }
@@ -1299,7 +1394,7 @@ static HRESULT compile_forin_statement(compiler_ctx_t *ctx, forin_statement_t *s
         return hres;
 
     if(stat->variable) {
-        hres = push_instr_bstr_uint(ctx, OP_identid, stat->variable->identifier, fdexNameEnsure);
+        hres = push_instr_ident(ctx, OP_identid, stat->variable->identifier, fdexNameEnsure);
         if(FAILED(hres))
             return hres;
     }else if(is_memberid_expr(stat->expr->type)) {
@@ -1804,6 +1899,7 @@ void release_bytecode(bytecode_t *code)
     heap_pool_free(&code->heap);
     heap_free(code->bstr_pool);
     heap_free(code->str_pool);
+    heap_free(code->caches);
     heap_free(code->instrs);
     heap_free(code);
 }
@@ -1834,9 +1930,100 @@ static HRESULT init_code(compiler_ctx_t *compiler, const WCHAR *source)
     return S_OK;
 }
 
+static BOOL is_local_name(function_scope_t *scope, const WCHAR *name)
+{
+    function_expression_t *iter;
+    unsigned i;
+
+    if(!strcmpW(name, argumentsW))
+        return TRUE;
+
+    for(i=0; i < scope->func->param_cnt; i++) {
+        if(!strcmpW(scope->func->params[i], name))
+            return TRUE;
+    }
+
+    for(i=0; i < scope->func->var_cnt; i++) {
+        if(!strcmpW(scope->func->variables[i], name))
+            return TRUE;
+    }
+
+    for(iter = scope->funcs; iter; iter = iter->next) {
+        if(iter->identifier && !strcmpW(iter->identifier, name))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* check that no scope object between the function and the global object may contain the name */
+static BOOL is_global_name(function_scope_t *scope, const WCHAR *name)
+{
+    for(; scope; scope = scope->parent) {
+        if(scope->is_global)
+            return TRUE;
+        if(scope->is_eval || scope->is_dynamic || scope->in_scope || is_local_name(scope, name))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* ECMA-262 3rd Edition    10.1.4 */
+static HRESULT resolve_identifiers(compiler_ctx_t *ctx)
+{
+    function_scope_t *scope = ctx->scope;
+    function_code_t *func = scope->func;
+    BOOL has_locals;
+    instr_t *instr;
+    unsigned i, j;
+    BSTR name;
+
+    if(!ctx->ident_instrs_cnt)
+        return S_OK;
+
+    has_locals = !scope->is_global && !scope->is_eval;
+    if(has_locals) {
+        func->locals = compiler_alloc(ctx->code, ctx->ident_instrs_cnt * sizeof(*func->locals));
+        if(!func->locals)
+            return E_OUTOFMEMORY;
+    }
+
+    for(i=0; i < ctx->ident_instrs_cnt; i++) {
+        instr = instr_ptr(ctx, ctx->ident_instrs[i]);
+        name = instr->u.arg[0].bstr;
+
+        if(has_locals && is_local_name(scope, name)) {
+            for(j=0; j < func->local_cnt && strcmpW(func->locals[j], name); j++);
+            if(j == func->local_cnt)
+                func->locals[func->local_cnt++] = name;
+
+            switch(instr->op) {
+            case OP_ident:
+                instr->op = OP_local;
+                break;
+            case OP_identid:
+                instr->op = OP_localid;
+                break;
+            case OP_var_set:
+                instr->op = OP_local_set;
+                break;
+            DEFAULT_UNREACHABLE;
+            }
+            instr->u.arg[0].uint = j;
+        }else if(instr->op != OP_var_set && is_global_name(scope, name)) {
+            instr->op = instr->op == OP_ident ? OP_global : OP_globalid;
+        }
+    }
+
+    ctx->ident_instrs_cnt = 0;
+    return S_OK;
+}
+
 static HRESULT compile_function(compiler_ctx_t *ctx, source_elements_t *source, function_expression_t *func_expr,
         BOOL from_eval, function_code_t *func)
 {
+    function_scope_t scope = {func};
     variable_declaration_t *var_iter;
     function_expression_t *iter;
     unsigned off, i;
@@ -1848,6 +2035,13 @@ static HRESULT compile_function(compiler_ctx_t *ctx, source_elements_t *source,
     ctx->func_head = ctx->func_tail = NULL;
     ctx->from_eval = from_eval;
 
+    scope.is_global = !func_expr && !from_eval && !ctx->is_procedure;
+    scope.is_eval = from_eval;
+    scope.in_scope = func_expr && func_expr->in_scope;
+    scope.parent = ctx->scope;
+    ctx->scope = &scope;
+    ctx->ident_instrs_cnt = 0;
+
     off = ctx->code_off;
     ctx->func = func;
     hres = compile_block_statement(ctx, source->statement);
@@ -1859,9 +2053,6 @@ static HRESULT compile_function(compiler_ctx_t *ctx, source_elements_t *source,
     if(!push_instr(ctx, OP_ret))
         return E_OUTOFMEMORY;
 
-    if(TRACE_ON(jscript_disas))
-        dump_code(ctx, off);
-
     func->instr_off = off;
 
     if(func_expr && func_expr->identifier) {
@@ -1902,6 +2093,16 @@ static HRESULT compile_function(compiler_ctx_t *ctx, source_elements_t *source,
 
     assert(i == func->var_cnt);
 
+    scope.funcs = ctx->func_head;
+    hres = resolve_identifiers(ctx);
+    if(FAILED(hres))
+        return hres;
+
+    func->has_eval = scope.is_dynamic;
+
+    if(TRACE_ON(jscript_disas))
+        dump_code(ctx, off);
+
     func->funcs = compiler_alloc(ctx->code, func->func_cnt * sizeof(*func->funcs));
     if(!func->funcs)
         return E_OUTOFMEMORY;
@@ -1915,6 +2116,7 @@ static HRESULT compile_function(compiler_ctx_t *ctx, source_elements_t *source,
 
     assert(i == func->func_cnt);
 
+    ctx->scope = scope.parent;
     return S_OK;
 }
 
@@ -1989,11 +2191,13 @@ static HRESULT compile_arguments(compiler_ctx_t *ctx, const WCHAR *args)
 }
 
 HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, const WCHAR *args, const WCHAR *delimiter,
-        BOOL from_eval, BOOL use_decode, bytecode_t **ret)
+        BOOL from_eval, BOOL is_procedure, BOOL use_decode, bytecode_t **ret)
 {
     compiler_ctx_t compiler = {0};
     HRESULT hres;
 
+    compiler.is_procedure = is_procedure;
+
     hres = init_code(&compiler, code);
     if(FAILED(hres))
         return hres;
@@ -2020,11 +2224,18 @@ HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, const WCHAR *args,
 
     hres = compile_function(&compiler, compiler.parser->source, NULL, from_eval, &compiler.code->global_code);
     parser_release(compiler.parser);
+    heap_free(compiler.ident_instrs);
     if(FAILED(hres)) {
         release_bytecode(compiler.code);
         return hres;
     }
 
+    compiler.code->caches = heap_alloc_zero(compiler.code_off * sizeof(*compiler.code->caches));
+    if(!compiler.code->caches) {
+        release_bytecode(compiler.code);
+        return E_OUTOFMEMORY;
+    }
+
     *ret = compiler.code;
     return S_OK;
 }
@@ -60,14 +60,74 @@ struct _dispex_prop_t {
     int bucket_next;
 };
 
+static const WCHAR idx_formatW[] = {'%','u',0};
+
+static LONG last_serial;
+
 static inline DISPID prop_to_id(jsdisp_t *This, dispex_prop_t *prop)
 {
     return prop - This->props;
 }
 
+/* ECMA-262 3rd Edition    15.4 */
+static BOOL is_idx_name(const WCHAR *name, unsigned *ret)
+{
+    const WCHAR *ptr;
+    unsigned idx = 0;
+
+    if(!isdigitW(*name) || (*name == '0' && name[1]))
+        return FALSE;
+
+    for(ptr = name; isdigitW(*ptr); ptr++) {
+        if(idx > (0xfffffffe - (*ptr-'0')) / 10)
+            return FALSE;
+        idx = idx*10 + (*ptr-'0');
+    }
+
+    if(*ptr)
+        return FALSE;
+
+    *ret = idx;
+    return TRUE;
+}
+
+static inline DWORD get_idx_flags(jsdisp_t *This)
+{
+    /* elements of objects that may grow are enumerable, like regular properties */
+    if(This->builtin_info->idx_add)
+        return PROPF_ENUM;
+    return This->builtin_info->idx_put ? 0 : PROPF_CONST;
+}
+
+/*
+ * Index properties are only created when they are looked up by name, and the object
+ * may remove or add back elements after that, so check that they are still valid.
+ */
+static void update_idx_prop(jsdisp_t *This, dispex_prop_t *prop)
+{
+    unsigned idx;
+
+    if(!This->builtin_info->idx_length)
+        return;
+
+    if(prop->type == PROP_IDX) {
+        if(prop->u.idx >= This->builtin_info->idx_length(This))
+            prop->type = PROP_DELETED;
+    }else if((prop->type == PROP_DELETED || prop->type == PROP_PROTREF) && prop->name
+            && is_idx_name(prop->name, &idx) && idx < This->builtin_info->idx_length(This)) {
+        prop->type = PROP_IDX;
+        prop->flags = get_idx_flags(This);
+        prop->u.idx = idx;
+    }
+}
+
 static inline dispex_prop_t *get_prop(jsdisp_t *This, DISPID id)
 {
-    if(id < 0 || id >= This->prop_cnt || This->props[id].type == PROP_DELETED)
+    if(id < 0 || id >= This->prop_cnt)
+        return NULL;
+
+    update_idx_prop(This, This->props+id);
+    if(This->props[id].type == PROP_DELETED)
         return NULL;
 
     return This->props+id;
@@ -202,6 +262,7 @@ static HRESULT find_prop_name(jsdisp_t *This, unsigned hash, const WCHAR *name,
                 This->props[bucket].bucket_head = pos;
             }
 
+            update_idx_prop(This, This->props+pos);
             *ret = &This->props[pos];
             return S_OK;
         }
@@ -222,13 +283,10 @@ static HRESULT find_prop_name(jsdisp_t *This, unsigned hash, const WCHAR *name,
     }
 
     if(This->builtin_info->idx_length) {
-        const WCHAR *ptr;
-        unsigned idx = 0;
+        unsigned idx;
 
-        for(ptr = name; isdigitW(*ptr) && idx < 0x10000; ptr++)
-            idx = idx*10 + (*ptr-'0');
-        if(!*ptr && idx < This->builtin_info->idx_length(This)) {
-            prop = alloc_prop(This, name, PROP_IDX, This->builtin_info->idx_put ? 0 : PROPF_CONST);
+        if(is_idx_name(name, &idx) && idx < This->builtin_info->idx_length(This)) {
+            prop = alloc_prop(This, name, PROP_IDX, get_idx_flags(This));
             if(!prop)
                 return E_OUTOFMEMORY;
 
@@ -291,6 +349,16 @@ static HRESULT ensure_prop_name(jsdisp_t *This, const WCHAR *name, BOOL search_p
         hres = find_prop_name_prot(This, string_hash(name), name, &prop);
     else
         hres = find_prop_name(This, string_hash(name), name, &prop);
+    if(SUCCEEDED(hres) && (!prop || prop->type == PROP_DELETED) && This->builtin_info->idx_add) {
+        unsigned idx;
+
+        /* give the object a chance to store the new element itself, this may reallocate props */
+        if(is_idx_name(name, &idx)) {
+            hres = This->builtin_info->idx_add(This, idx);
+            if(SUCCEEDED(hres))
+                hres = find_prop_name(This, string_hash(name), name, &prop);
+        }
+    }
     if(SUCCEEDED(hres) && (!prop || prop->type == PROP_DELETED)) {
         TRACE("creating prop %s flags %x\n", debugstr_w(name), create_flags);
 
@@ -542,6 +610,28 @@ static HRESULT fill_protrefs(jsdisp_t *This)
     return S_OK;
 }
 
+/* make sure that all the elements are listed when enumerating the properties */
+static HRESULT fill_idx_props(jsdisp_t *This)
+{
+    dispex_prop_t *prop;
+    unsigned i, length;
+    WCHAR name[12];
+    HRESULT hres;
+
+    if(!This->builtin_info->idx_add)
+        return S_OK;
+
+    length = This->builtin_info->idx_length(This);
+    for(i = 0; i < length; i++) {
+        sprintfW(name, idx_formatW, i);
+        hres = find_prop_name(This, string_hash(name), name, &prop);
+        if(FAILED(hres))
+            return hres;
+    }
+
+    return S_OK;
+}
+
 static inline jsdisp_t *impl_from_IDispatchEx(IDispatchEx *iface)
 {
     return CONTAINING_RECORD(iface, jsdisp_t, IDispatchEx_iface);
@@ -740,7 +830,7 @@ static HRESULT WINAPI DispatchEx_InvokeEx(IDispatchEx *iface, DISPID id, LCID lc
     return hres;
 }
 
-static HRESULT delete_prop(dispex_prop_t *prop, BOOL *ret)
+static HRESULT delete_prop(jsdisp_t *This, dispex_prop_t *prop, BOOL *ret)
 {
     if(prop->flags & PROPF_DONTDELETE) {
         *ret = FALSE;
@@ -752,6 +842,8 @@ static HRESULT delete_prop(dispex_prop_t *prop, BOOL *ret)
     if(prop->type == PROP_JSVAL) {
         jsval_release(prop->u.val);
         prop->type = PROP_DELETED;
+    }else if(prop->type == PROP_IDX && This->builtin_info->idx_delete) {
+        return This->builtin_info->idx_delete(This, prop->u.idx);
     }
     return S_OK;
 }
@@ -776,7 +868,7 @@ static HRESULT WINAPI DispatchEx_DeleteMemberByName(IDispatchEx *iface, BSTR bst
         return S_OK;
     }
 
-    return delete_prop(prop, &b);
+    return delete_prop(This, prop, &b);
 }
 
 static HRESULT WINAPI DispatchEx_DeleteMemberByDispID(IDispatchEx *iface, DISPID id)
@@ -793,7 +885,7 @@ static HRESULT WINAPI DispatchEx_DeleteMemberByDispID(IDispatchEx *iface, DISPID
         return DISP_E_MEMBERNOTFOUND;
     }
 
-    return delete_prop(prop, &b);
+    return delete_prop(This, prop, &b);
 }
 
 static HRESULT WINAPI DispatchEx_GetMemberProperties(IDispatchEx *iface, DISPID id, DWORD grfdexFetch, DWORD *pgrfdex)
@@ -830,6 +922,10 @@ static HRESULT WINAPI DispatchEx_GetNextDispID(IDispatchEx *iface, DWORD grfdex,
     TRACE("(%p)->(%x %x %p)\n", This, grfdex, id, pid);
 
     if(id == DISPID_STARTENUM) {
+        hres = fill_idx_props(This);
+        if(FAILED(hres))
+            return hres;
+
         hres = fill_protrefs(This);
         if(FAILED(hres))
             return hres;
@@ -843,6 +939,7 @@ static HRESULT WINAPI DispatchEx_GetNextDispID(IDispatchEx *iface, DWORD grfdex,
     }
 
     while(iter < This->props + This->prop_cnt) {
+        update_idx_prop(This, iter);
         if(iter->name && (get_flags(This, iter) & PROPF_ENUM) && iter->type!=PROP_DELETED) {
             *pid = prop_to_id(This, iter);
             return S_OK;
@@ -906,6 +1003,11 @@ HRESULT init_dispex(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *b
     if(prototype)
         jsdisp_addref(prototype);
 
+    /* zero is never used, so that empty caches never match */
+    do {
+        dispex->serial = InterlockedIncrement(&last_serial);
+    } while(!dispex->serial);
+
     dispex->prop_cnt = 1;
     if(builtin_info->value_prop.invoke) {
         dispex->props[0].type = PROP_BUILTIN;
@@ -1053,6 +1155,36 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+HRESULT jsdisp_get_idx_id(jsdisp_t *jsdisp, DWORD idx, DWORD flags, DISPID *id)
+{
+    WCHAR name[12];
+
+    sprintfW(name, idx_formatW, idx);
+    return jsdisp_get_id(jsdisp, name, flags, id);
+}
+
+/*
+ * Properties are never removed from the props array, so a DISPID found for a name stays
+ * valid for the same object until the property is deleted. The serial identifies the
+ * object, the address could be reused by a new one.
+ */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    HRESULT hres;
+
+    if(cache->serial == jsdisp->serial && get_prop(jsdisp, cache->id)) {
+        *id = cache->id;
+        return S_OK;
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres)) {
+        cache->serial = jsdisp->serial;
+        cache->id = *id;
+    }
+    return hres;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
@@ -1321,10 +1453,22 @@ HRESULT jsdisp_propput_dontenum(jsdisp_t *obj, const WCHAR *name, jsval_t val)
 HRESULT jsdisp_propput_idx(jsdisp_t *obj, DWORD idx, jsval_t val)
 {
     WCHAR buf[12];
+    HRESULT hres;
 
-    static const WCHAR formatW[] = {'%','d',0};
+    if(obj->builtin_info->idx_put) {
+        if(idx < obj->builtin_info->idx_length(obj))
+            return obj->builtin_info->idx_put(obj, idx, val);
+
+        if(obj->builtin_info->idx_add) {
+            hres = obj->builtin_info->idx_add(obj, idx);
+            if(hres == S_OK)
+                return obj->builtin_info->idx_put(obj, idx, val);
+            if(FAILED(hres))
+                return hres;
+        }
+    }
 
-    sprintfW(buf, formatW, idx);
+    sprintfW(buf, idx_formatW, idx);
     return jsdisp_propput_name(obj, buf, val);
 }
 
@@ -1398,9 +1542,10 @@ HRESULT jsdisp_get_idx(jsdisp_t *obj, DWORD idx, jsval_t *r)
     dispex_prop_t *prop;
     HRESULT hres;
 
-    static const WCHAR formatW[] = {'%','d',0};
+    if(obj->builtin_info->idx_length && idx < obj->builtin_info->idx_length(obj))
+        return obj->builtin_info->idx_get(obj, idx, r);
 
-    sprintfW(name, formatW, idx);
+    sprintfW(name, idx_formatW, idx);
 
     hres = find_prop_name_prot(obj, string_hash(name), name, &prop);
     if(FAILED(hres))
@@ -1464,19 +1609,18 @@ HRESULT disp_propget(script_ctx_t *ctx, IDispatch *disp, DISPID id, jsval_t *val
 
 HRESULT jsdisp_delete_idx(jsdisp_t *obj, DWORD idx)
 {
-    static const WCHAR formatW[] = {'%','d',0};
     WCHAR buf[12];
     dispex_prop_t *prop;
     BOOL b;
     HRESULT hres;
 
-    sprintfW(buf, formatW, idx);
+    sprintfW(buf, idx_formatW, idx);
 
     hres = find_prop_name(obj, string_hash(buf), buf, &prop);
     if(FAILED(hres) || !prop)
         return hres;
 
-    return delete_prop(prop, &b);
+    return delete_prop(obj, prop, &b);
 }
 
 HRESULT disp_delete(IDispatch *disp, DISPID id, BOOL *ret)
@@ -1491,7 +1635,7 @@ HRESULT disp_delete(IDispatch *disp, DISPID id, BOOL *ret)
 
         prop = get_prop(jsdisp, id);
         if(prop)
-            hres = delete_prop(prop, ret);
+            hres = delete_prop(jsdisp, prop, ret);
         else
             hres = DISP_E_MEMBERNOTFOUND;
 
@@ -1534,7 +1678,7 @@ HRESULT disp_delete_name(script_ctx_t *ctx, IDispatch *disp, jsstr_t *name, BOOL
 
         hres = find_prop_name(jsdisp, string_hash(ptr), ptr, &prop);
         if(prop) {
-            hres = delete_prop(prop, ret);
+            hres = delete_prop(jsdisp, prop, ret);
         }else {
             *ret = TRUE;
             hres = S_OK;
@@ -1582,7 +1726,7 @@ HRESULT jsdisp_is_own_prop(jsdisp_t *obj, const WCHAR *name, BOOL *ret)
     if(FAILED(hres))
         return hres;
 
-    *ret = prop && (prop->type == PROP_JSVAL || prop->type == PROP_BUILTIN);
+    *ret = prop && (prop->type == PROP_JSVAL || prop->type == PROP_BUILTIN || prop->type == PROP_IDX);
     return S_OK;
 }
 
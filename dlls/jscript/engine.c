@@ -342,6 +342,7 @@ void exec_release(exec_ctx_t *ctx)
     if(ctx->script)
         script_release(ctx->script);
     jsval_release(ctx->ret);
+    heap_free(ctx->locals);
     heap_free(ctx->stack);
     heap_free(ctx);
 }
@@ -491,33 +492,12 @@ static BOOL lookup_global_members(script_ctx_t *ctx, BSTR identifier, exprval_t
     return FALSE;
 }
 
-/* ECMA-262 3rd Edition    10.1.4 */
-static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+/* look up an identifier that was not found in the global object */
+static HRESULT lookup_named_items(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
 {
-    scope_chain_t *scope;
     named_item_t *item;
-    DISPID id = 0;
     HRESULT hres;
 
-    TRACE("%s\n", debugstr_w(identifier));
-
-    for(scope = ctx->exec_ctx->scope_chain; scope; scope = scope->next) {
-        if(scope->jsobj)
-            hres = jsdisp_get_id(scope->jsobj, identifier, fdexNameImplicit, &id);
-        else
-            hres = disp_get_id(ctx, scope->obj, identifier, identifier, fdexNameImplicit, &id);
-        if(SUCCEEDED(hres)) {
-            exprval_set_idref(ret, scope->obj, id);
-            return S_OK;
-        }
-    }
-
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
-    if(SUCCEEDED(hres)) {
-        exprval_set_idref(ret, to_disp(ctx->global), id);
-        return S_OK;
-    }
-
     for(item = ctx->named_items; item; item = item->next) {
         if((item->flags & SCRIPTITEM_ISVISIBLE) && !strcmpW(item->name, identifier)) {
             if(!item->disp) {
@@ -555,6 +535,35 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
     return S_OK;
 }
 
+/* ECMA-262 3rd Edition    10.1.4 */
+static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+{
+    scope_chain_t *scope;
+    DISPID id = 0;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(identifier));
+
+    for(scope = ctx->exec_ctx->scope_chain; scope; scope = scope->next) {
+        if(scope->jsobj)
+            hres = jsdisp_get_id(scope->jsobj, identifier, fdexNameImplicit, &id);
+        else
+            hres = disp_get_id(ctx, scope->obj, identifier, identifier, fdexNameImplicit, &id);
+        if(SUCCEEDED(hres)) {
+            exprval_set_idref(ret, scope->obj, id);
+            return S_OK;
+        }
+    }
+
+    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    if(SUCCEEDED(hres)) {
+        exprval_set_idref(ret, to_disp(ctx->global), id);
+        return S_OK;
+    }
+
+    return lookup_named_items(ctx, identifier, ret);
+}
+
 static inline BSTR get_op_bstr(exec_ctx_t *ctx, int i){
     return ctx->code->instrs[ctx->ip].u.arg[i].bstr;
 }
@@ -575,6 +584,10 @@ static inline double get_op_double(exec_ctx_t *ctx){
     return ctx->code->instrs[ctx->ip].u.dbl;
 }
 
+static inline prop_cache_t *get_op_cache(exec_ctx_t *ctx){
+    return ctx->code->caches+ctx->ip;
+}
+
 /* ECMA-262 3rd Edition    12.2 */
 static HRESULT interp_var_set(exec_ctx_t *ctx)
 {
@@ -590,6 +603,25 @@ static HRESULT interp_var_set(exec_ctx_t *ctx)
     return hres;
 }
 
+/* ECMA-262 3rd Edition    12.2 */
+static HRESULT interp_local_set(exec_ctx_t *ctx)
+{
+    const unsigned arg = get_op_uint(ctx, 0);
+    const BSTR name = ctx->func_code->locals[arg];
+    jsval_t val;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(name));
+
+    val = stack_pop(ctx);
+    hres = jsdisp_get_id_cached(ctx->var_disp, name, fdexNameEnsure, ctx->locals+arg, &id);
+    if(SUCCEEDED(hres))
+        hres = disp_propput(ctx->script, to_disp(ctx->var_disp), id, val);
+    jsval_release(val);
+    return hres;
+}
+
 /* ECMA-262 3rd Edition    12.6.4 */
 static HRESULT interp_forin(exec_ctx_t *ctx)
 {
@@ -826,14 +858,32 @@ static HRESULT interp_func(exec_ctx_t *ctx)
     return stack_push(ctx, jsval_obj(dispex));
 }
 
+/* check if a number is an array index, so that its string form doesn't need to be built */
+static inline BOOL is_idx_number(jsval_t v, DWORD *idx)
+{
+    double n;
+
+    if(!is_number(v))
+        return FALSE;
+
+    n = get_number(v);
+    if(n < 0 || n >= 0xffffffff || n != (DWORD)n)
+        return FALSE;
+
+    *idx = n;
+    return TRUE;
+}
+
 /* ECMA-262 3rd Edition    11.2.1 */
 static HRESULT interp_array(exec_ctx_t *ctx)
 {
     jsstr_t *name_str;
     const WCHAR *name;
     jsval_t v, namev;
+    jsdisp_t *jsdisp;
     IDispatch *obj;
     DISPID id;
+    DWORD idx;
     HRESULT hres;
 
     TRACE("\n");
@@ -846,6 +896,17 @@ static HRESULT interp_array(exec_ctx_t *ctx)
         return hres;
     }
 
+    if(is_idx_number(namev, &idx) && (jsdisp = to_jsdisp(obj))) {
+        hres = jsdisp_get_idx(jsdisp, idx, &v);
+        IDispatch_Release(obj);
+        if(hres == DISP_E_UNKNOWNNAME)
+            hres = S_OK;
+        if(FAILED(hres))
+            return hres;
+
+        return stack_push(ctx, v);
+    }
+
     hres = to_flat_string(ctx->script, namev, &name_str, &name);
     jsval_release(namev);
     if(FAILED(hres)) {
@@ -872,6 +933,7 @@ static HRESULT interp_array(exec_ctx_t *ctx)
 static HRESULT interp_member(exec_ctx_t *ctx)
 {
     const BSTR arg = get_op_bstr(ctx, 0);
+    jsdisp_t *jsdisp;
     IDispatch *obj;
     jsval_t v;
     DISPID id;
@@ -883,9 +945,13 @@ static HRESULT interp_member(exec_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx->script, obj, arg, arg, 0, &id);
+    jsdisp = to_jsdisp(obj);
+    if(jsdisp)
+        hres = jsdisp_get_id_cached(jsdisp, arg, 0, get_op_cache(ctx), &id);
+    else
+        hres = disp_get_id(ctx->script, obj, arg, arg, 0, &id);
     if(SUCCEEDED(hres)) {
-        hres = disp_propget(ctx->script, obj, id, &v);
+        hres = jsdisp ? jsdisp_propget(jsdisp, id, &v) : disp_propget(ctx->script, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
         v = jsval_undefined();
         hres = S_OK;
@@ -904,8 +970,10 @@ static HRESULT interp_memberid(exec_ctx_t *ctx)
     jsval_t objv, namev;
     const WCHAR *name;
     jsstr_t *name_str;
+    jsdisp_t *jsdisp;
     IDispatch *obj;
     DISPID id;
+    DWORD idx;
     HRESULT hres;
 
     TRACE("%x\n", arg);
@@ -915,6 +983,21 @@ static HRESULT interp_memberid(exec_ctx_t *ctx)
 
     hres = to_object(ctx->script, objv, &obj);
     jsval_release(objv);
+    if(SUCCEEDED(hres) && is_idx_number(namev, &idx) && (jsdisp = to_jsdisp(obj))) {
+        hres = jsdisp_get_idx_id(jsdisp, idx, arg, &id);
+        if(FAILED(hres)) {
+            IDispatch_Release(obj);
+            if(hres == DISP_E_UNKNOWNNAME && !(arg & fdexNameEnsure)) {
+                obj = NULL;
+                id = JS_E_INVALID_PROPERTY;
+            }else {
+                ERR("failed %08x\n", hres);
+                return hres;
+            }
+        }
+
+        return stack_push_objid(ctx, obj, id);
+    }
     if(SUCCEEDED(hres)) {
         hres = to_flat_string(ctx->script, namev, &name_str, &name);
         if(FAILED(hres))
@@ -940,6 +1023,88 @@ static HRESULT interp_memberid(exec_ctx_t *ctx)
     return stack_push_objid(ctx, obj, id);
 }
 
+/*
+ * ECMA-262 3rd Edition    11.2.1
+ * Used instead of memberid for plain assignments to obj[expr]. Elements of objects that store
+ * them by index are kept as a number, so that assign_member doesn't have to look them up by name.
+ */
+static HRESULT interp_memberkey(exec_ctx_t *ctx)
+{
+    jsval_t objv, namev;
+    const WCHAR *name;
+    jsstr_t *name_str;
+    jsdisp_t *jsdisp;
+    IDispatch *obj;
+    HRESULT hres;
+    DWORD idx;
+
+    TRACE("\n");
+
+    namev = stack_pop(ctx);
+    objv = stack_pop(ctx);
+
+    hres = to_object(ctx->script, objv, &obj);
+    jsval_release(objv);
+    if(FAILED(hres)) {
+        jsval_release(namev);
+        return hres;
+    }
+
+    hres = stack_push(ctx, jsval_disp(obj));
+    if(FAILED(hres)) {
+        jsval_release(namev);
+        return hres;
+    }
+
+    if(is_idx_number(namev, &idx) && (jsdisp = to_jsdisp(obj)) && jsdisp->builtin_info->idx_put)
+        return stack_push(ctx, namev);
+
+    hres = to_flat_string(ctx->script, namev, &name_str, &name);
+    jsval_release(namev);
+    if(FAILED(hres))
+        return hres;
+
+    return stack_push(ctx, jsval_string(name_str));
+}
+
+/* ECMA-262 3rd Edition    11.2.1 */
+static HRESULT interp_memberid_name(exec_ctx_t *ctx)
+{
+    const BSTR arg = get_op_bstr(ctx, 0);
+    const unsigned flags = get_op_uint(ctx, 1);
+    jsdisp_t *jsdisp;
+    IDispatch *obj;
+    jsval_t objv;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s %x\n", debugstr_w(arg), flags);
+
+    objv = stack_pop(ctx);
+    hres = to_object(ctx->script, objv, &obj);
+    jsval_release(objv);
+    if(FAILED(hres))
+        return hres;
+
+    jsdisp = to_jsdisp(obj);
+    if(jsdisp)
+        hres = jsdisp_get_id_cached(jsdisp, arg, flags, get_op_cache(ctx), &id);
+    else
+        hres = disp_get_id(ctx->script, obj, arg, arg, flags, &id);
+    if(FAILED(hres)) {
+        IDispatch_Release(obj);
+        if(hres == DISP_E_UNKNOWNNAME && !(flags & fdexNameEnsure)) {
+            obj = NULL;
+            id = JS_E_INVALID_PROPERTY;
+        }else {
+            ERR("failed %08x\n", hres);
+            return hres;
+        }
+    }
+
+    return stack_push_objid(ctx, obj, id);
+}
+
 /* ECMA-262 3rd Edition    11.2.1 */
 static HRESULT interp_refval(exec_ctx_t *ctx)
 {
@@ -1046,12 +1211,50 @@ static HRESULT interp_this(exec_ctx_t *ctx)
     return stack_push(ctx, jsval_disp(ctx->this_obj));
 }
 
+static HRESULT push_ident_value(exec_ctx_t *ctx, BSTR identifier, exprval_t *exprval)
+{
+    jsval_t v;
+    HRESULT hres;
+
+    if(exprval->type == EXPRVAL_INVALID)
+        return throw_type_error(ctx->script, JS_E_UNDEFINED_VARIABLE, identifier);
+
+    hres = exprval_to_value(ctx->script, exprval, &v);
+    exprval_release(exprval);
+    if(FAILED(hres))
+        return hres;
+
+    return stack_push(ctx, v);
+}
+
+static HRESULT push_ident_ref(exec_ctx_t *ctx, BSTR identifier, unsigned flags, exprval_t *exprval)
+{
+    HRESULT hres;
+
+    if(exprval->type == EXPRVAL_INVALID && (flags & fdexNameEnsure)) {
+        DISPID id;
+
+        hres = jsdisp_get_id(ctx->script->global, identifier, fdexNameEnsure, &id);
+        if(FAILED(hres))
+            return hres;
+
+        exprval_set_idref(exprval, to_disp(ctx->script->global), id);
+    }
+
+    if(exprval->type != EXPRVAL_IDREF) {
+        WARN("invalid ref\n");
+        exprval_release(exprval);
+        return stack_push_objid(ctx, NULL, JS_E_OBJECT_EXPECTED);
+    }
+
+    return stack_push_objid(ctx, exprval->u.idref.disp, exprval->u.idref.id);
+}
+
 /* ECMA-262 3rd Edition    10.1.4 */
 static HRESULT interp_ident(exec_ctx_t *ctx)
 {
     const BSTR arg = get_op_bstr(ctx, 0);
     exprval_t exprval;
-    jsval_t v;
     HRESULT hres;
 
     TRACE("%s\n", debugstr_w(arg));
@@ -1060,15 +1263,7 @@ static HRESULT interp_ident(exec_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    if(exprval.type == EXPRVAL_INVALID)
-        return throw_type_error(ctx->script, JS_E_UNDEFINED_VARIABLE, arg);
-
-    hres = exprval_to_value(ctx->script, &exprval, &v);
-    exprval_release(&exprval);
-    if(FAILED(hres))
-        return hres;
-
-    return stack_push(ctx, v);
+    return push_ident_value(ctx, arg, &exprval);
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
@@ -1085,23 +1280,136 @@ static HRESULT interp_identid(exec_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    if(exprval.type == EXPRVAL_INVALID && (flags & fdexNameEnsure)) {
-        DISPID id;
+    return push_ident_ref(ctx, arg, flags, &exprval);
+}
 
-        hres = jsdisp_get_id(ctx->script->global, arg, fdexNameEnsure, &id);
+/* identifier that the compiler found in the variables of the function */
+static HRESULT interp_local(exec_ctx_t *ctx)
+{
+    const unsigned arg = get_op_uint(ctx, 0);
+    const BSTR name = ctx->func_code->locals[arg];
+    exprval_t exprval;
+    jsval_t v;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(name));
+
+    hres = jsdisp_get_id_cached(ctx->var_disp, name, 0, ctx->locals+arg, &id);
+    if(SUCCEEDED(hres)) {
+        hres = jsdisp_propget(ctx->var_disp, id, &v);
         if(FAILED(hres))
             return hres;
 
-        exprval_set_idref(&exprval, to_disp(ctx->script->global), id);
+        return stack_push(ctx, v);
     }
+    if(hres != DISP_E_UNKNOWNNAME)
+        return hres;
 
-    if(exprval.type != EXPRVAL_IDREF) {
-        WARN("invalid ref\n");
-        exprval_release(&exprval);
-        return stack_push_objid(ctx, NULL, JS_E_OBJECT_EXPECTED);
+    /* the variable was deleted */
+    hres = identifier_eval(ctx->script, name, &exprval);
+    if(FAILED(hres))
+        return hres;
+
+    return push_ident_value(ctx, name, &exprval);
+}
+
+static HRESULT interp_localid(exec_ctx_t *ctx)
+{
+    const unsigned arg = get_op_uint(ctx, 0);
+    const unsigned flags = get_op_uint(ctx, 1);
+    const BSTR name = ctx->func_code->locals[arg];
+    exprval_t exprval;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s %x\n", debugstr_w(name), flags);
+
+    hres = jsdisp_get_id_cached(ctx->var_disp, name, 0, ctx->locals+arg, &id);
+    if(SUCCEEDED(hres)) {
+        jsdisp_addref(ctx->var_disp);
+        return stack_push_objid(ctx, to_disp(ctx->var_disp), id);
+    }
+    if(hres != DISP_E_UNKNOWNNAME)
+        return hres;
+
+    hres = identifier_eval(ctx->script, name, &exprval);
+    if(FAILED(hres))
+        return hres;
+
+    return push_ident_ref(ctx, name, flags, &exprval);
+}
+
+/* identifier that can't be found in the scope chain, so the global object is searched first */
+static HRESULT interp_global(exec_ctx_t *ctx)
+{
+    const BSTR arg = get_op_bstr(ctx, 0);
+    jsdisp_t *global = ctx->script->global;
+    exprval_t exprval;
+    jsval_t v;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(arg));
+
+    if(ctx->script->dynamic_scopes) {
+        hres = identifier_eval(ctx->script, arg, &exprval);
+        if(FAILED(hres))
+            return hres;
+
+        return push_ident_value(ctx, arg, &exprval);
+    }
+
+    hres = jsdisp_get_id_cached(global, arg, 0, get_op_cache(ctx), &id);
+    if(SUCCEEDED(hres)) {
+        hres = jsdisp_propget(global, id, &v);
+        if(FAILED(hres))
+            return hres;
+
+        return stack_push(ctx, v);
+    }
+    if(hres != DISP_E_UNKNOWNNAME)
+        return hres;
+
+    hres = lookup_named_items(ctx->script, arg, &exprval);
+    if(FAILED(hres))
+        return hres;
+
+    return push_ident_value(ctx, arg, &exprval);
+}
+
+static HRESULT interp_globalid(exec_ctx_t *ctx)
+{
+    const BSTR arg = get_op_bstr(ctx, 0);
+    const unsigned flags = get_op_uint(ctx, 1);
+    jsdisp_t *global = ctx->script->global;
+    exprval_t exprval;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s %x\n", debugstr_w(arg), flags);
+
+    if(ctx->script->dynamic_scopes) {
+        hres = identifier_eval(ctx->script, arg, &exprval);
+        if(FAILED(hres))
+            return hres;
+
+        return push_ident_ref(ctx, arg, flags, &exprval);
+    }
+
+    hres = jsdisp_get_id_cached(global, arg, 0, get_op_cache(ctx), &id);
+    if(SUCCEEDED(hres)) {
+        jsdisp_addref(global);
+        return stack_push_objid(ctx, to_disp(global), id);
     }
+    if(hres != DISP_E_UNKNOWNNAME)
+        return hres;
+
+    hres = lookup_named_items(ctx->script, arg, &exprval);
+    if(FAILED(hres))
+        return hres;
 
-    return stack_push_objid(ctx, exprval.u.idref.disp, exprval.u.idref.id);
+    return push_ident_ref(ctx, arg, flags, &exprval);
 }
 
 /* ECMA-262 3rd Edition    7.8.1 */
@@ -2277,6 +2585,41 @@ static HRESULT interp_assign(exec_ctx_t *ctx)
     return stack_push(ctx, v);
 }
 
+/* ECMA-262 3rd Edition    11.13.1 */
+static HRESULT interp_assign_member(exec_ctx_t *ctx)
+{
+    IDispatch *disp;
+    jsval_t v, keyv;
+    jsstr_t *name_str;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("\n");
+
+    v = stack_pop(ctx);
+    keyv = stack_pop(ctx);
+    disp = get_object(stack_pop(ctx));
+
+    if(is_number(keyv)) {
+        hres = jsdisp_propput_idx(to_jsdisp(disp), get_number(keyv), v);
+    }else {
+        name_str = get_string(keyv);
+        hres = disp_get_id(ctx->script, disp, jsstr_flatten(name_str), NULL, fdexNameEnsure, &id);
+        if(SUCCEEDED(hres))
+            hres = disp_propput(ctx->script, disp, id, v);
+        else
+            ERR("failed %08x\n", hres);
+        jsstr_release(name_str);
+    }
+    IDispatch_Release(disp);
+    if(FAILED(hres)) {
+        jsval_release(v);
+        return hres;
+    }
+
+    return stack_push(ctx, v);
+}
+
 /* JScript extension */
 static HRESULT interp_assign_call(exec_ctx_t *ctx)
 {
@@ -2527,6 +2870,12 @@ HRESULT exec_source(exec_ctx_t *ctx, bytecode_t *code, function_code_t *func, BO
         }
     }
 
+    if(func->local_cnt) {
+        ctx->locals = heap_alloc_zero(func->local_cnt * sizeof(*ctx->locals));
+        if(!ctx->locals)
+            return E_OUTOFMEMORY;
+    }
+
     prev_ctx = ctx->script->exec_ctx;
     ctx->script->exec_ctx = ctx;
 
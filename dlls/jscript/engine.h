@@ -42,6 +42,7 @@ typedef struct {
     X(array,      1, 0,0)                  \
     X(assign,     1, 0,0)                  \
     X(assign_call,1, ARG_UINT,   0)       \
+    X(assign_member,1, 0,0)                \
     X(bool,       1, ARG_INT,    0)        \
     X(bneg,       1, 0,0)                  \
     X(call,       1, ARG_UINT,   ARG_UINT) \
@@ -59,6 +60,8 @@ typedef struct {
     X(eq2,        1, 0,0)                  \
     X(forin,      0, ARG_ADDR,   0)        \
     X(func,       1, ARG_UINT,   0)        \
+    X(global,     1, ARG_BSTR,   0)        \
+    X(globalid,   1, ARG_BSTR,   ARG_UINT) \
     X(gt,         1, 0,0)                  \
     X(gteq,       1, 0,0)                  \
     X(ident,      1, ARG_BSTR,   0)        \
@@ -68,11 +71,16 @@ typedef struct {
     X(int,        1, ARG_INT,    0)        \
     X(jmp,        0, ARG_ADDR,   0)        \
     X(jmp_z,      0, ARG_ADDR,   0)        \
+    X(local,      1, ARG_UINT,   0)        \
+    X(localid,    1, ARG_UINT,   ARG_UINT) \
+    X(local_set,  1, ARG_UINT,   0)        \
     X(lshift,     1, 0,0)                  \
     X(lt,         1, 0,0)                  \
     X(lteq,       1, 0,0)                  \
     X(member,     1, ARG_BSTR,   0)        \
     X(memberid,   1, ARG_UINT,   0)        \
+    X(memberid_name,1,ARG_BSTR,  ARG_UINT) \
+    X(memberkey,  1, 0,0)                  \
     X(minus,      1, 0,0)                  \
     X(mod,        1, 0,0)                  \
     X(mul,        1, 0,0)                  \
@@ -160,6 +168,12 @@ typedef struct _function_code_t {
 
     unsigned param_cnt;
     BSTR *params;
+
+    /* variables accessed by the function's own code, resolved at compile time */
+    unsigned local_cnt;
+    BSTR *locals;
+
+    BOOL has_eval;  /* eval is called directly, identifiers are not resolved past the function */
 } function_code_t;
 
 typedef struct _bytecode_t {
@@ -180,10 +194,12 @@ typedef struct _bytecode_t {
     unsigned str_pool_size;
     unsigned str_cnt;
 
+    prop_cache_t *caches; /* one for each instruction */
+
     struct _bytecode_t *next;
 } bytecode_t;
 
-HRESULT compile_script(script_ctx_t*,const WCHAR*,const WCHAR*,const WCHAR*,BOOL,BOOL,bytecode_t**) DECLSPEC_HIDDEN;
+HRESULT compile_script(script_ctx_t*,const WCHAR*,const WCHAR*,const WCHAR*,BOOL,BOOL,BOOL,bytecode_t**) DECLSPEC_HIDDEN;
 void release_bytecode(bytecode_t*) DECLSPEC_HIDDEN;
 
 static inline void bytecode_addref(bytecode_t *code)
@@ -234,6 +250,7 @@ struct _exec_ctx_t {
     IDispatch *this_obj;
     function_code_t *func_code;
     BOOL is_global;
+    prop_cache_t *locals;
 
     jsval_t *stack;
     unsigned stack_size;
@@ -498,6 +515,7 @@ typedef struct _function_expression_t {
     DWORD src_len;
 
     struct _function_expression_t *next; /* for compiler */
+    BOOL in_scope; /* for compiler */
 } function_expression_t;
 
 typedef struct {
@@ -811,7 +811,7 @@ static HRESULT construct_function(script_ctx_t *ctx, unsigned argc, jsval_t *arg
     if(FAILED(hres))
         return hres;
 
-    hres = compile_script(ctx, str, NULL, NULL, FALSE, FALSE, &code);
+    hres = compile_script(ctx, str, NULL, NULL, FALSE, FALSE, FALSE, &code);
     heap_free(str);
     if(FAILED(hres))
         return hres;
@@ -368,12 +368,17 @@ static HRESULT JSGlobal_eval(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, uns
         return E_OUTOFMEMORY;
 
     TRACE("parsing %s\n", debugstr_jsval(argv[0]));
-    hres = compile_script(ctx, src, NULL, NULL, TRUE, FALSE, &code);
+    hres = compile_script(ctx, src, NULL, NULL, TRUE, FALSE, FALSE, &code);
     if(FAILED(hres)) {
         WARN("parse (%s) failed: %08x\n", debugstr_jsval(argv[0]), hres);
         return throw_syntax_error(ctx, hres, NULL);
     }
 
+    /* an aliased eval adds the variables to a function that the compiler assumed to be static */
+    if((code->global_code.var_cnt || code->global_code.func_cnt) && ctx->exec_ctx->var_disp != ctx->global
+       && !ctx->exec_ctx->func_code->has_eval)
+        ctx->dynamic_scopes = TRUE;
+
     hres = exec_source(ctx->exec_ctx, code, &code->global_code, TRUE, r);
     release_bytecode(code);
     return hres;
@@ -1058,6 +1058,72 @@ ok(tmp === "test", "obj.shift() = " + tmp);
 ok(obj.length == 2, "obj.length = " + obj.length);
 ok(obj[1] === 3, "obj[1] = " + obj[1]);
 
+arr = [];
+for(i=0; i<1000; i++)
+    arr.push(i);
+ok(arr.length === 1000, "arr.length = " + arr.length);
+for(i=0; i<1000; i++)
+    arr[i] = arr[i]*2;
+ok(arr[999] === 1998, "arr[999] = " + arr[999]);
+tmp = arr.slice(995);
+ok(tmp.toString() === "1990,1992,1994,1996,1998", "arr.slice(995) = " + tmp);
+tmp = arr.pop();
+ok(tmp === 1998, "arr.pop() = " + tmp);
+ok(arr.length === 999, "arr.length = " + arr.length);
+ok(!(999 in arr), "999 in arr");
+ok(998 in arr, "998 not in arr");
+ok(arr.hasOwnProperty("0"), "arr.hasOwnProperty('0') is false");
+ok(!arr.hasOwnProperty("999"), "arr.hasOwnProperty('999') is true");
+arr.length = 3;
+ok(arr.toString() === "0,2,4", "arr = " + arr.toString());
+ok(!(3 in arr), "3 in arr");
+arr[3] = 6;
+ok(arr.length === 4, "arr.length = " + arr.length);
+delete arr[1];
+ok(arr.toString() === "0,,4,6", "arr = " + arr.toString());
+ok(!(1 in arr), "1 in arr");
+arr[1] = 2;
+ok(arr.toString() === "0,2,4,6", "arr = " + arr.toString());
+tmp = [];
+for(i in arr)
+    tmp.push(i);
+tmp.sort();
+ok(tmp.toString() === "0,1,2,3", "for in arr = " + tmp);
+
+arr = [1,2];
+arr["5"] = 5;
+ok(arr.length === 6, "arr.length = " + arr.length);
+ok(arr.toString() === "1,2,,,,5", "arr = " + arr.toString());
+tmp = arr.pop();
+ok(tmp === 5, "arr.pop() = " + tmp);
+ok(arr.length === 5, "arr.length = " + arr.length);
+
+arr = [1,2,3];
+arr["01"] = 4;
+ok(arr[1] === 2, "arr[1] = " + arr[1]);
+ok(arr["01"] === 4, "arr['01'] = " + arr["01"]);
+
+arr = [];
+for(i=0; i<10; i++)
+    tmp = arr[arr.length] = i*i;
+ok(tmp === 81, "arr[arr.length] = i*i returned " + tmp);
+ok(arr.length === 10, "arr.length = " + arr.length);
+ok(arr.toString() === "0,1,4,9,16,25,36,49,64,81", "arr = " + arr.toString());
+arr[2.5] = 1;
+ok(arr.length === 10, "arr.length = " + arr.length);
+ok(arr["2.5"] === 1, "arr['2.5'] = " + arr["2.5"]);
+arr[12] = 12;
+ok(arr.length === 13, "arr.length = " + arr.length);
+ok(!(11 in arr), "11 in arr");
+tmp = {};
+tmp[3] = 3;
+ok(tmp["3"] === 3, "tmp['3'] = " + tmp["3"]);
+tmp = [];
+arr = "";
+(function() { arr += "o"; return tmp; })()[(function() { arr += "i"; return 0; })()] = (function() { arr += "v"; return 1; })();
+ok(arr === "oiv", "evaluation order " + arr);
+ok(tmp[0] === 1, "tmp[0] = " + tmp[0]);
+
 var num = new Number(6);
 arr = [0,1,2];
 tmp = arr.concat(3, [4,5], num);
@@ -1450,6 +1450,60 @@ function returnTest() {
 
 ok(returnTest() === undefined, "returnTest = " + returnTest());
 
+function cacheTest() {
+    var i, o, r = 0, objs = [{x: 1}, {y: 5, x: 2}, {}, {x: 3}];
+
+    for(i = 0; i < objs.length; i++) {
+        o = objs[i];
+        r += o.x ? o.x : 10;
+    }
+    ok(r === 16, "r = " + r);
+
+    o = {x: 1};
+    for(i = 0; i < 3; i++) {
+        if(i == 1)
+            delete o.x;
+        if(i == 2)
+            o.x = 3;
+        r = o.x;
+    }
+    ok(r === 3, "r = " + r);
+
+    r = 0;
+    for(i = 0; i < 3; i++) {
+        with({i: 10})
+            r += i;
+    }
+    ok(r === 30, "r = " + r);
+
+    r = (function() { return typeof cacheTest; })();
+    ok(r === "function", "typeof cacheTest = " + r);
+
+    r = (function() {
+        var f = function() { return cacheTestVar; };
+        eval("var cacheTestVar = 2;");
+        return f();
+    })();
+    ok(r === 2, "eval var = " + r);
+
+    with({cacheTestVar: 3})
+        r = (function() { return cacheTestVar; })();
+    ok(r === 3, "with var = " + r);
+
+    /* eval called through an alias */
+    r = (function() {
+        var e = eval;
+        var f = function() { return typeof aliasedEvalVar; };
+        e("var aliasedEvalVar = 4;");
+        return f() + " " + typeof aliasedEvalVar;
+    })();
+    ok(r === "number number", "aliased eval var = " + r);
+    ok(cacheTestVar === 1, "cacheTestVar = " + cacheTestVar);
+}
+
+var cacheTestVar = 1;
+cacheTest();
+
 /* Keep this test in the end of file */
 undefined = 6;
 ok(undefined === 6, "undefined = " + undefined);
@@ -327,62 +327,88 @@ static BOOL build_initial_environment(void)
 }
 
 
+#define NB_BATCHED_VALUES 16
+
 /***********************************************************************
  *           set_registry_variables
  *
  * Set environment variables by enumerating the values of a key;
  * helper for set_registry_environment().
+ * The values are fetched in batches to save server round trips.
  * Note that Windows happily truncates the value if it's too big.
  */
 static void set_registry_variables( HANDLE hkey, ULONG type )
 {
     static const WCHAR pathW[] = {'P','A','T','H'};
     static const WCHAR sep[] = {';',0};
+    static const DWORD value_size = 1024 * sizeof(WCHAR);
+    struct __server_request_info reqs[NB_BATCHED_VALUES];
+    void *req_ptrs[NB_BATCHED_VALUES];
     UNICODE_STRING env_name, env_value;
-    NTSTATUS status;
-    DWORD size;
-    int index;
-    char buffer[1024*sizeof(WCHAR) + sizeof(KEY_VALUE_FULL_INFORMATION)];
+    NTSTATUS status = STATUS_SUCCESS;
+    DWORD namelen, size;
+    int index, i;
+    char *buffer, *ptr;
     WCHAR tmpbuf[1024];
     UNICODE_STRING tmp;
-    KEY_VALUE_FULL_INFORMATION *info = (KEY_VALUE_FULL_INFORMATION *)buffer;
+
+    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, NB_BATCHED_VALUES * value_size ))) return;
 
     tmp.Buffer = tmpbuf;
     tmp.MaximumLength = sizeof(tmpbuf);
 
-    for (index = 0; ; index++)
+    for (index = 0; !status; index += NB_BATCHED_VALUES)
     {
-        status = NtEnumerateValueKey( hkey, index, KeyValueFullInformation,
-                                      buffer, sizeof(buffer), &size );
-        if (status != STATUS_SUCCESS && status != STATUS_BUFFER_OVERFLOW)
-            break;
-        if (info->Type != type)
-            continue;
-        env_name.Buffer = info->Name;
-        env_name.Length = env_name.MaximumLength = info->NameLength;
-        env_value.Buffer = (WCHAR *)(buffer + info->DataOffset);
-        env_value.Length = info->DataLength;
-        env_value.MaximumLength = sizeof(buffer) - info->DataOffset;
-        if (env_value.Length && !env_value.Buffer[env_value.Length/sizeof(WCHAR)-1])
-            env_value.Length -= sizeof(WCHAR);  /* don't count terminating null if any */
-        if (!env_value.Length) continue;
-        if (info->Type == REG_EXPAND_SZ)
+        for (i = 0; i < NB_BATCHED_VALUES; i++)
         {
-            status = RtlExpandEnvironmentStrings_U( NULL, &env_value, &tmp, NULL );
-            if (status != STATUS_SUCCESS && status != STATUS_BUFFER_OVERFLOW) continue;
-            RtlCopyUnicodeString( &env_value, &tmp );
+            memset( &reqs[i].u.req, 0, sizeof(reqs[i].u.req) );
+            reqs[i].u.req.request_header.req = REQ_enum_key_value;
+            reqs[i].u.req.enum_key_value_request.hkey = wine_server_obj_handle( hkey );
+            reqs[i].u.req.enum_key_value_request.index = index + i;
+            reqs[i].u.req.enum_key_value_request.info_class = KeyValueFullInformation;
+            reqs[i].data_count = 0;
+            wine_server_set_reply( &reqs[i], buffer + i * value_size, value_size );
+            req_ptrs[i] = &reqs[i];
         }
-        /* PATH is magic */
-        if (env_name.Length == sizeof(pathW) &&
-            !memicmpW( env_name.Buffer, pathW, sizeof(pathW)/sizeof(WCHAR) ) &&
-            !RtlQueryEnvironmentVariable_U( NULL, &env_name, &tmp ))
+        if ((status = wine_server_call_batch( req_ptrs, NB_BATCHED_VALUES ))) break;
+
+        for (i = 0; i < NB_BATCHED_VALUES; i++)
         {
-            RtlAppendUnicodeToString( &tmp, sep );
-            if (RtlAppendUnicodeStringToString( &tmp, &env_value )) continue;
-            RtlCopyUnicodeString( &env_value, &tmp );
+            const struct enum_key_value_reply *reply = &reqs[i].u.reply.enum_key_value_reply;
+
+            if ((status = reply->__header.error)) break;
+            if (reply->type != type)
+                continue;
+            ptr = buffer + i * value_size;
+            namelen = min( reply->namelen, reply->__header.reply_size );
+            size = reply->__header.reply_size - namelen;
+            env_name.Buffer = (WCHAR *)ptr;
+            env_name.Length = env_name.MaximumLength = namelen;
+            env_value.Buffer = (WCHAR *)(ptr + namelen);
+            env_value.Length = size & ~1;
+            env_value.MaximumLength = value_size - namelen;
+            if (env_value.Length && !env_value.Buffer[env_value.Length/sizeof(WCHAR)-1])
+                env_value.Length -= sizeof(WCHAR);  /* don't count terminating null if any */
+            if (!env_value.Length) continue;
+            if (reply->type == REG_EXPAND_SZ)
+            {
+                NTSTATUS ret = RtlExpandEnvironmentStrings_U( NULL, &env_value, &tmp, NULL );
+                if (ret != STATUS_SUCCESS && ret != STATUS_BUFFER_OVERFLOW) continue;
+                RtlCopyUnicodeString( &env_value, &tmp );
+            }
+            /* PATH is magic */
+            if (env_name.Length == sizeof(pathW) &&
+                !memicmpW( env_name.Buffer, pathW, sizeof(pathW)/sizeof(WCHAR) ) &&
+                !RtlQueryEnvironmentVariable_U( NULL, &env_name, &tmp ))
+            {
+                RtlAppendUnicodeToString( &tmp, sep );
+                if (RtlAppendUnicodeStringToString( &tmp, &env_value )) continue;
+                RtlCopyUnicodeString( &env_value, &tmp );
+            }
+            RtlSetEnvironmentVariable( NULL, &env_name, &env_value );
         }
-        RtlSetEnvironmentVariable( NULL, &env_name, &env_value );
     }
+    HeapFree( GetProcessHeap(), 0, buffer );
 }
 
 
@@ -603,6 +603,137 @@ static void test_threadcp(void)
     SetThreadLocale(last);
 }
 
+/* besides checking ASCII round trips, this traces the conversion throughput
+ * of a few code pages to make it easier to compare implementations */
+static void test_ascii_conversion(void)
+{
+    static const UINT codepages[] = { CP_UTF8, 1252, 437, 1251, 20127 };
+    static const int size = 65536;
+    WCHAR *wstr, *wbuf;
+    char *str, *buf;
+    int i, j, len, pos, ret, mb_len;
+
+    str  = HeapAlloc( GetProcessHeap(), 0, size * 3 );
+    buf  = HeapAlloc( GetProcessHeap(), 0, size * 3 );
+    wstr = HeapAlloc( GetProcessHeap(), 0, size * sizeof(WCHAR) );
+    wbuf = HeapAlloc( GetProcessHeap(), 0, size * sizeof(WCHAR) );
+
+    for (i = 0; i < sizeof(codepages) / sizeof(codepages[0]); i++)
+    {
+        for (j = 0; j < size; j++) str[j] = wstr[j] = ' ' + j % 95;
+
+        ret = MultiByteToWideChar( codepages[i], MB_ERR_INVALID_CHARS, str, size, wbuf, size );
+        ok( ret == size, "%u: MultiByteToWideChar returned %d\n", codepages[i], ret );
+        ok( !memcmp( wbuf, wstr, size * sizeof(WCHAR) ), "%u: wrong conversion\n", codepages[i] );
+        ret = WideCharToMultiByte( codepages[i], 0, wstr, size, buf, size * 3, NULL, NULL );
+        ok( ret == size, "%u: WideCharToMultiByte returned %d\n", codepages[i], ret );
+        ok( !memcmp( buf, str, size ), "%u: wrong conversion\n", codepages[i] );
+
+        /* 0xe9 is not in these code pages */
+        if (codepages[i] == 1251 || codepages[i] == 20127) continue;
+
+        /* a non-ASCII char at every position around the block boundaries */
+        for (len = 1; len <= 40; len++)
+        {
+            for (pos = -1; pos < len; pos++)
+            {
+                for (j = 0; j < len; j++) wstr[j] = 'a' + j % 26;
+                if (pos >= 0) wstr[pos] = 0xe9;
+
+                mb_len = WideCharToMultiByte( codepages[i], 0, wstr, len, NULL, 0, NULL, NULL );
+                ret = WideCharToMultiByte( codepages[i], 0, wstr, len, str, size * 3, NULL, NULL );
+                ok( ret == mb_len && ret == len + (codepages[i] == CP_UTF8 && pos >= 0),
+                    "%u: len %d pos %d: WideCharToMultiByte returned %d/%d\n",
+                    codepages[i], len, pos, ret, mb_len );
+
+                ret = MultiByteToWideChar( codepages[i], MB_ERR_INVALID_CHARS, str, mb_len, NULL, 0 );
+                ok( ret == len, "%u: len %d pos %d: MultiByteToWideChar returned %d\n",
+                    codepages[i], len, pos, ret );
+                ret = MultiByteToWideChar( codepages[i], MB_ERR_INVALID_CHARS, str, mb_len, wbuf, size );
+                ok( ret == len && !memcmp( wbuf, wstr, len * sizeof(WCHAR) ),
+                    "%u: len %d pos %d: wrong conversion\n", codepages[i], len, pos );
+            }
+        }
+    }
+
+    HeapFree( GetProcessHeap(), 0, str );
+    HeapFree( GetProcessHeap(), 0, buf );
+    HeapFree( GetProcessHeap(), 0, wstr );
+    HeapFree( GetProcessHeap(), 0, wbuf );
+}
+
+static void test_conversion_timings(void)
+{
+    static const UINT codepages[] = { CP_UTF8, 1252, 437, 1251, 20127 };
+    static const int size = 65536;
+    WCHAR *wstr, *wbuf;
+    char *str, *buf;
+    DWORD start, time;
+    int i, j, count, len;
+
+    if (!winetest_interactive)
+    {
+        skip( "conversion timings (set WINETEST_INTERACTIVE=1)\n" );
+        return;
+    }
+
+    str  = HeapAlloc( GetProcessHeap(), 0, size * 3 );
+    buf  = HeapAlloc( GetProcessHeap(), 0, size * 3 );
+    wstr = HeapAlloc( GetProcessHeap(), 0, size * sizeof(WCHAR) );
+    wbuf = HeapAlloc( GetProcessHeap(), 0, size * sizeof(WCHAR) );
+
+    for (i = 0; i < sizeof(codepages) / sizeof(codepages[0]); i++)
+    {
+        for (j = 0; j < size; j++) str[j] = wstr[j] = ' ' + j % 95;
+
+        count = 0;
+        start = GetTickCount();
+        do
+        {
+            MultiByteToWideChar( codepages[i], 0, str, size, wbuf, size );
+            count++;
+        } while ((time = GetTickCount() - start) < 100);
+        trace( "%u: ASCII MultiByteToWideChar %u KB/ms\n", codepages[i], count * (size / 1024) / time );
+
+        count = 0;
+        start = GetTickCount();
+        do
+        {
+            WideCharToMultiByte( codepages[i], 0, wstr, size, buf, size * 3, NULL, NULL );
+            count++;
+        } while ((time = GetTickCount() - start) < 100);
+        trace( "%u: ASCII WideCharToMultiByte %u KB/ms\n", codepages[i], count * (size / 1024) / time );
+
+        /* mostly ASCII with an accented letter every few words */
+        for (j = 0; j < size; j += 37) wstr[j] = 0xe9;
+        len = WideCharToMultiByte( codepages[i], 0, wstr, size, str, size * 3, NULL, NULL );
+
+        count = 0;
+        start = GetTickCount();
+        do
+        {
+            MultiByteToWideChar( codepages[i], 0, str, len, wbuf, size );
+            count++;
+        } while ((time = GetTickCount() - start) < 100);
+        trace( "%u: mixed MultiByteToWideChar %u KB/ms\n", codepages[i], count * (size / 1024) / time );
+
+        count = 0;
+        start = GetTickCount();
+        do
+        {
+            WideCharToMultiByte( codepages[i], codepages[i] == CP_UTF8 ? 0 : WC_NO_BEST_FIT_CHARS,
+                                 wstr, size, buf, size * 3, NULL, NULL );
+            count++;
+        } while ((time = GetTickCount() - start) < 100);
+        trace( "%u: mixed WideCharToMultiByte %u KB/ms\n", codepages[i], count * (size / 1024) / time );
+    }
+
+    HeapFree( GetProcessHeap(), 0, str );
+    HeapFree( GetProcessHeap(), 0, buf );
+    HeapFree( GetProcessHeap(), 0, wstr );
+    HeapFree( GetProcessHeap(), 0, wbuf );
+}
+
 START_TEST(codepage)
 {
     BOOL bUsedDefaultChar;
@@ -620,4 +751,6 @@ START_TEST(codepage)
 
     test_undefined_byte_char();
     test_threadcp();
+    test_ascii_conversion();
+    test_conversion_timings();
 }
@@ -3191,6 +3191,157 @@ static void test_overlapped(void)
     ok( r == TRUE, "close handle failed\n");
 }
 
+#define QUEUE_BLOCK_SIZE  4096
+#define QUEUE_BLOCK_COUNT 1024
+#define QUEUE_MAX_DEPTH   128
+
+static void test_overlapped_queue_depth(void)
+{
+    static const DWORD depths[] = { 1, 4, 16, 64, QUEUE_MAX_DEPTH };
+    char temp_path[MAX_PATH], name[MAX_PATH];
+    OVERLAPPED *ovs, *ov, ev_ov;
+    DWORD i, j, *block, count, started, done, start, ticks;
+    HANDLE file, port;
+    ULONG_PTR key;
+    char *buffers;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "qd", 0, name );
+
+    file = CreateFileA( name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile error %u\n", GetLastError() );
+    block = HeapAlloc( GetProcessHeap(), 0, QUEUE_BLOCK_SIZE );
+    for (i = 0; i < QUEUE_BLOCK_COUNT; i++)
+    {
+        for (j = 0; j < QUEUE_BLOCK_SIZE / sizeof(DWORD); j++) block[j] = i * 1000 + j;
+        ret = WriteFile( file, block, QUEUE_BLOCK_SIZE, &count, NULL );
+        ok( ret && count == QUEUE_BLOCK_SIZE, "WriteFile error %u\n", GetLastError() );
+    }
+    HeapFree( GetProcessHeap(), 0, block );
+    CloseHandle( file );
+
+    file = CreateFileA( name, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile error %u\n", GetLastError() );
+
+    /* with an event */
+    buffers = HeapAlloc( GetProcessHeap(), 0, QUEUE_MAX_DEPTH * QUEUE_BLOCK_SIZE );
+    memset( &ev_ov, 0, sizeof(ev_ov) );
+    ev_ov.hEvent = CreateEventA( NULL, TRUE, TRUE, NULL );
+    ev_ov.Offset = 5 * QUEUE_BLOCK_SIZE;
+    ret = ReadFile( file, buffers, QUEUE_BLOCK_SIZE, NULL, &ev_ov );
+    ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile error %u\n", GetLastError() );
+    ret = GetOverlappedResult( file, &ev_ov, &count, TRUE );
+    ok( ret, "GetOverlappedResult error %u\n", GetLastError() );
+    ok( count == QUEUE_BLOCK_SIZE, "got %u bytes\n", count );
+    ok( ((DWORD *)buffers)[7] == 5007, "got %u\n", ((DWORD *)buffers)[7] );
+
+    /* at the end of the file */
+    ev_ov.Offset = QUEUE_BLOCK_COUNT * QUEUE_BLOCK_SIZE;
+    ret = ReadFile( file, buffers, QUEUE_BLOCK_SIZE, NULL, &ev_ov );
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+        ret = GetOverlappedResult( file, &ev_ov, &count, TRUE );
+    ok( !ret && GetLastError() == ERROR_HANDLE_EOF, "got %d error %u\n", ret, GetLastError() );
+    CloseHandle( ev_ov.hEvent );
+
+    /* through a completion port, with several requests in flight */
+    port = CreateIoCompletionPort( file, NULL, 0xdead, 0 );
+    ok( port != NULL, "CreateIoCompletionPort error %u\n", GetLastError() );
+    ovs = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, QUEUE_MAX_DEPTH * sizeof(*ovs) );
+    srand( 42 );
+
+    for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+    {
+        start = GetTickCount();
+        started = done = 0;
+        for (j = 0; j < depths[i]; j++)
+        {
+            ovs[j].Offset = (rand() % QUEUE_BLOCK_COUNT) * QUEUE_BLOCK_SIZE;
+            ret = ReadFile( file, buffers + j * QUEUE_BLOCK_SIZE, QUEUE_BLOCK_SIZE, NULL, &ovs[j] );
+            ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile error %u\n", GetLastError() );
+            started++;
+        }
+        while (done < started)
+        {
+            ov = NULL;
+            ret = GetQueuedCompletionStatus( port, &count, &key, &ov, 10000 );
+            ok( ret, "GetQueuedCompletionStatus error %u\n", GetLastError() );
+            if (!ov) break;
+            ok( key == 0xdead, "got key %x\n", (DWORD)key );
+            ok( count == QUEUE_BLOCK_SIZE, "got %u bytes\n", count );
+            j = ov - ovs;
+            block = (DWORD *)(buffers + j * QUEUE_BLOCK_SIZE);
+            ok( block[1] == ov->Offset / QUEUE_BLOCK_SIZE * 1000 + 1,
+                "got %u for offset %x\n", block[1], ov->Offset );
+            done++;
+
+            if (started < QUEUE_BLOCK_COUNT)
+            {
+                ov->Offset = (rand() % QUEUE_BLOCK_COUNT) * QUEUE_BLOCK_SIZE;
+                ret = ReadFile( file, block, QUEUE_BLOCK_SIZE, NULL, ov );
+                ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile error %u\n", GetLastError() );
+                started++;
+            }
+        }
+        ok( done == QUEUE_BLOCK_COUNT, "depth %u: %u requests completed\n", depths[i], done );
+        ticks = GetTickCount() - start;
+        if (winetest_debug > 1)
+            trace( "depth %u: %u random reads in %u ms (%u IOPS)\n", depths[i], done, ticks,
+                   ticks ? done * 1000 / ticks : 0 );
+    }
+
+    /* without an event, waiting on the file handle of a port-bound file */
+    memset( ovs, 0, sizeof(*ovs) );
+    ovs[0].Offset = 3 * QUEUE_BLOCK_SIZE;
+    ret = ReadFile( file, buffers, QUEUE_BLOCK_SIZE, NULL, &ovs[0] );
+    ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile error %u\n", GetLastError() );
+    count = 0;
+    ret = GetOverlappedResult( file, &ovs[0], &count, TRUE );
+    ok( ret, "GetOverlappedResult error %u\n", GetLastError() );
+    ok( count == QUEUE_BLOCK_SIZE, "got %u bytes\n", count );
+    ok( ((DWORD *)buffers)[7] == 3007, "got %u\n", ((DWORD *)buffers)[7] );
+    ov = NULL;
+    ret = GetQueuedCompletionStatus( port, &count, &key, &ov, 1000 );
+    ok( ret, "GetQueuedCompletionStatus error %u\n", GetLastError() );
+    ok( ov == &ovs[0], "got overlapped %p\n", ov );
+
+    /* cancelling requests in flight */
+    for (j = 0; j < QUEUE_MAX_DEPTH; j++)
+    {
+        memset( &ovs[j], 0, sizeof(ovs[j]) );
+        ovs[j].hEvent = CreateEventA( NULL, TRUE, FALSE, NULL );
+        ovs[j].Offset = (rand() % QUEUE_BLOCK_COUNT) * QUEUE_BLOCK_SIZE;
+        ret = ReadFile( file, buffers + j * QUEUE_BLOCK_SIZE, QUEUE_BLOCK_SIZE, NULL, &ovs[j] );
+        ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile error %u\n", GetLastError() );
+    }
+    ret = CancelIo( file );
+    ok( ret, "CancelIo error %u\n", GetLastError() );
+    for (j = 0; j < QUEUE_MAX_DEPTH; j++)
+    {
+        ok( WaitForSingleObject( ovs[j].hEvent, 10000 ) == WAIT_OBJECT_0, "request %u not completed\n", j );
+        SetLastError( 0xdeadbeef );
+        ret = GetOverlappedResult( file, &ovs[j], &count, TRUE );
+        ok( ret || GetLastError() == ERROR_OPERATION_ABORTED,
+            "request %u: got %d error %u\n", j, ret, GetLastError() );
+        if (ret) ok( count == QUEUE_BLOCK_SIZE, "request %u: got %u bytes\n", j, count );
+        CloseHandle( ovs[j].hEvent );
+    }
+    for (j = 0; j < QUEUE_MAX_DEPTH; j++)
+    {
+        ov = NULL;
+        ret = GetQueuedCompletionStatus( port, &count, &key, &ov, 1000 );
+        ok( ret || (ov && GetLastError() == ERROR_OPERATION_ABORTED),
+            "GetQueuedCompletionStatus got %d error %u\n", ret, GetLastError() );
+        if (!ov) break;
+    }
+
+    HeapFree( GetProcessHeap(), 0, ovs );
+    HeapFree( GetProcessHeap(), 0, buffers );
+    CloseHandle( port );
+    CloseHandle( file );
+    DeleteFileA( name );
+}
+
 static void test_RemoveDirectory(void)
 {
     int rc;
@@ -4126,6 +4277,7 @@ START_TEST(file)
     test_read_write();
     test_OpenFile();
     test_overlapped();
+    test_overlapped_queue_depth();
     test_RemoveDirectory();
     test_ReplaceFileA();
     test_ReplaceFileW();
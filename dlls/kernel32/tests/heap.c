@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
 struct heap_layout
@@ -853,6 +854,162 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+#define LFH_THREAD_BLOCKS  64
+#define LFH_THREAD_LOOPS   20000
+
+/* returns the number of errors, the loop itself doesn't call ok() to avoid skewing the timings */
+static DWORD WINAPI lfh_thread( void *arg )
+{
+    HANDLE heap = arg;
+    BYTE *blocks[LFH_THREAD_BLOCKS];
+    SIZE_T size;
+    DWORD i, j, errors = 0, seed = GetCurrentThreadId();
+
+    memset( blocks, 0, sizeof(blocks) );
+    for (i = 0; i < LFH_THREAD_LOOPS; i++)
+    {
+        j = i % LFH_THREAD_BLOCKS;
+        if (blocks[j])
+        {
+            size = HeapSize( heap, 0, blocks[j] );
+            if (blocks[j][0] != (BYTE)size || blocks[j][size - 1] != (BYTE)size) errors++;
+            if (!HeapFree( heap, 0, blocks[j] )) errors++;
+        }
+        seed = seed * 1103515245 + 12345;
+        size = 1 + (seed >> 16) % 512;
+        if (!(blocks[j] = HeapAlloc( heap, 0, size )))
+        {
+            errors++;
+            break;
+        }
+        if (HeapSize( heap, 0, blocks[j] ) != size) errors++;
+        blocks[j][0] = blocks[j][size - 1] = (BYTE)size;
+    }
+    for (j = 0; j < LFH_THREAD_BLOCKS; j++) HeapFree( heap, 0, blocks[j] );
+    return errors;
+}
+
+static void test_lfh_threads( HANDLE heap, const char *name )
+{
+    HANDLE threads[8];
+    DWORD i, count, start, id, errors;
+
+    for (count = 1; count <= sizeof(threads) / sizeof(threads[0]); count *= 2)
+    {
+        start = GetTickCount();
+        for (i = 0; i < count; i++) threads[i] = CreateThread( NULL, 0, lfh_thread, heap, 0, &id );
+        WaitForMultipleObjects( count, threads, TRUE, INFINITE );
+        if (winetest_debug > 1)
+            trace( "%s heap: %u threads, %u allocations each in %u ms\n",
+                   name, count, LFH_THREAD_LOOPS, GetTickCount() - start );
+        for (i = 0; i < count; i++)
+        {
+            errors = ~0u;
+            GetExitCodeThread( threads[i], &errors );
+            ok( !errors, "%s heap: thread %u of %u got %u errors\n", name, i, count, errors );
+            CloseHandle( threads[i] );
+        }
+    }
+    ok( HeapValidate( heap, 0, NULL ), "%s heap is corrupted\n", name );
+}
+
+static void test_HeapSetInformation(void)
+{
+    HANDLE heap, heap2;
+    ULONG info, i;
+    BYTE *p, *p2;
+    BOOL ret;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+
+    /* the standard heap is used as reference for the timings */
+    test_lfh_threads( heap, "standard" );
+
+    info = 2;
+    SetLastError( 0xdeadbeef );
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) - 1 );
+    ok( !ret, "HeapSetInformation should fail\n" );
+
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    if (!ret)
+    {
+        /* LFH is disabled when running under a debugger or with heap checking */
+        skip( "could not enable LFH, error %u\n", GetLastError() );
+        HeapDestroy( heap );
+        return;
+    }
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    info = 0;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "LFH should not be disabled\n" );
+
+    /* blocks must keep behaving as usual */
+    p = HeapAlloc( heap, HEAP_ZERO_MEMORY, 30 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+    ok( !p[0] && !p[29], "block not zeroed\n" );
+    ok( HeapSize( heap, 0, p ) == 30, "wrong size %lu\n", HeapSize( heap, 0, p ) );
+    p2 = HeapReAlloc( heap, 0, p, 300 );
+    ok( p2 != NULL, "HeapReAlloc failed\n" );
+    ok( HeapSize( heap, 0, p2 ) == 300, "wrong size %lu\n", HeapSize( heap, 0, p2 ) );
+    ret = HeapFree( heap, 0, p2 );
+    ok( ret, "HeapFree failed %u\n", GetLastError() );
+    p = HeapAlloc( heap, 0, 30 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+    ok( HeapValidate( heap, 0, p ), "block %p is not valid\n", p );
+    ret = HeapFree( heap, 0, p );
+    ok( ret, "HeapFree failed %u\n", GetLastError() );
+
+    /* a block of another heap must not end up in the front end */
+    heap2 = HeapCreate( 0, 0, 0 );
+    ok( heap2 != NULL, "HeapCreate failed\n" );
+    p2 = HeapAlloc( heap2, 0, 30 );
+    ok( p2 != NULL, "HeapAlloc failed\n" );
+    SetLastError( 0xdeadbeef );
+    ret = HeapFree( heap, 0, p2 );
+    ok( !ret, "HeapFree succeeded\n" );
+    ok( HeapSize( heap2, 0, p2 ) == 30, "wrong size %lu\n", HeapSize( heap2, 0, p2 ) );
+    for (i = 0; i < 64; i++)
+    {
+        p = HeapAlloc( heap, 0, 30 );
+        ok( p != p2, "got block %p of the other heap\n", p );
+        HeapFree( heap, 0, p );
+    }
+    ret = HeapFree( heap2, 0, p2 );
+    ok( ret, "HeapFree failed %u\n", GetLastError() );
+    HeapDestroy( heap2 );
+
+    test_lfh_threads( heap, "LFH" );
+
+    /* classes that are not implemented are ignored */
+    ret = pHeapSetInformation( heap, HeapEnableTerminationOnCorruption, NULL, 0 );
+    ok( ret, "HeapSetInformation failed %u\n", GetLastError() );
+    HeapDestroy( heap );
+
+    /* serialization is required for LFH */
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation should fail\n" );
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 0, "expected 0, got %u\n", info );
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1173,6 +1330,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), (2 << 20));
     test_sized_HeapReAlloc((1 << 20), 1);
     test_HeapQueryInformation();
+    test_HeapSetInformation();
 
     if (pRtlGetNtGlobalFlags)
     {
@@ -1475,6 +1475,48 @@ static void test_CompareStringA(void)
         "ret %d, error %d, expected value %d\n", ret, GetLastError(), CSTR_EQUAL);
 }
 
+struct comparestringw_entry {
+    DWORD flags;
+    WCHAR first[8];
+    WCHAR second[8];
+    int ret;
+};
+
+static const struct comparestringw_entry comparestringw_data[] = {
+    /* a hyphen or apostrophe on one side only, with a case or unicode weight difference */
+    { 0, {'c','o','-','o','P',0}, {'c','o','o','p',0}, CSTR_GREATER_THAN },
+    { 0, {'c','o','o','-','P',0}, {'c','o','o','p',0}, CSTR_GREATER_THAN },
+    { 0, {'C','o','-','o','p',0}, {'c','o','o','p',0}, CSTR_GREATER_THAN },
+    { 0, {'c','o','o','p',0}, {'C','o','-','o','p',0}, CSTR_LESS_THAN },
+    { 0, {'C','o','\'','o','p',0}, {'c','o','o','p',0}, CSTR_GREATER_THAN },
+    { 0, {'C','o','-','o','p',0}, {'c','o','O','q',0}, CSTR_LESS_THAN },
+    { SORT_STRINGSORT, {'C','o','-','o','p',0}, {'c','o','o','p',0}, CSTR_LESS_THAN },
+    /* symbols ignored on either side in string sort */
+    { NORM_IGNORESYMBOLS | SORT_STRINGSORT, {'a','.','b',0}, {'A','b',0}, CSTR_LESS_THAN },
+    { NORM_IGNORESYMBOLS | SORT_STRINGSORT, {'A','.','b',0}, {'a','-','b',0}, CSTR_GREATER_THAN },
+    { NORM_IGNORESYMBOLS | SORT_STRINGSORT, {'a',',','b',0}, {'a','.','B',0}, CSTR_LESS_THAN },
+    { NORM_IGNORESYMBOLS | SORT_STRINGSORT, {'a','.','b',0}, {'a',',','c',0}, CSTR_LESS_THAN },
+    { NORM_IGNORESYMBOLS | SORT_STRINGSORT, {'a','.','-','b',0}, {'a','b',0}, CSTR_EQUAL },
+    { NORM_IGNORESYMBOLS | SORT_STRINGSORT | NORM_IGNORECASE, {'a','.','b',0}, {'A',',','B',0}, CSTR_EQUAL },
+};
+
+static void test_CompareStringW(void)
+{
+    int ret, i;
+
+    for (i = 0; i < sizeof(comparestringw_data)/sizeof(comparestringw_data[0]); i++)
+    {
+        const struct comparestringw_entry *entry = &comparestringw_data[i];
+
+        ret = CompareStringW(LOCALE_SYSTEM_DEFAULT, entry->flags, entry->first, -1, entry->second, -1);
+        ok(ret == entry->ret, "%d: %s vs %s: got %d, expected %d\n", i,
+           wine_dbgstr_w(entry->first), wine_dbgstr_w(entry->second), ret, entry->ret);
+        ret = CompareStringW(LOCALE_SYSTEM_DEFAULT, entry->flags, entry->second, -1, entry->first, -1);
+        ok(ret == CSTR_LESS_THAN + CSTR_GREATER_THAN - entry->ret, "%d: %s vs %s: got %d\n", i,
+           wine_dbgstr_w(entry->second), wine_dbgstr_w(entry->first), ret);
+    }
+}
+
 struct comparestringex_test {
     const char *locale;
     DWORD flags;
@@ -3841,6 +3883,7 @@ START_TEST(locale)
   test_GetCurrencyFormatA(); /* Also tests the W version */
   test_GetNumberFormatA();   /* Also tests the W version */
   test_CompareStringA();
+  test_CompareStringW();
   test_CompareStringEx();
   test_LCMapStringA();
   test_LCMapStringW();
@@ -56,6 +56,9 @@ static VOID   (WINAPI *pReleaseSRWLockShared)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockExclusive)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockShared)(PSRWLOCK);
 
+static BOOL   (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE,OVERLAPPED_ENTRY*,ULONG,ULONG*,DWORD,BOOL);
+static BOOL   (WINAPI *pSetFileCompletionNotificationModes)(HANDLE,UCHAR);
+
 static void test_signalandwait(void)
 {
     DWORD (WINAPI *pSignalObjectAndWait)(HANDLE, HANDLE, DWORD, BOOL);
@@ -489,6 +492,202 @@ static void test_semaphore(void)
     CloseHandle( handle );
 }
 
+#define NB_PING_PONGS 10000
+
+static HANDLE ping_event, pong_event;
+
+static DWORD WINAPI ping_pong_thread(void *arg)
+{
+    DWORD i, ret;
+
+    for (i = 0; i < NB_PING_PONGS; i++)
+    {
+        ret = WaitForSingleObject(ping_event, 5000);
+        if (ret != WAIT_OBJECT_0) return ret;
+        SetEvent(pong_event);
+    }
+    return 0;
+}
+
+static DWORD WINAPI abandon_thread(void *arg)
+{
+    return WaitForSingleObject(arg, 0);
+}
+
+static DWORD WINAPI wait_all_thread(void *arg)
+{
+    return WaitForMultipleObjects(2, arg, TRUE, 5000);
+}
+
+static DWORD WINAPI wait_event_thread(void *arg)
+{
+    return WaitForSingleObject(arg, 5000);
+}
+
+static void close_remote_handle(DWORD pid, HANDLE handle)
+{
+    HANDLE process;
+    BOOL ret;
+
+    process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid);
+    ok(process != NULL, "OpenProcess failed with error %u\n", GetLastError());
+    ret = DuplicateHandle(process, handle, NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+    ok(ret, "DuplicateHandle failed with error %u\n", GetLastError());
+    CloseHandle(process);
+}
+
+static void test_pulse_event(BOOL manual_reset)
+{
+    HANDLE event, threads[2];
+    DWORD i, ret;
+
+    event = CreateEventA(NULL, manual_reset, FALSE, NULL);
+    for (i = 0; i < 2; i++) threads[i] = CreateThread(NULL, 0, wait_event_thread, event, 0, NULL);
+    Sleep(100);  /* let the threads block in the wait */
+    PulseEvent(event);
+    ret = WaitForMultipleObjects(2, threads, manual_reset, 1000);
+    ok(ret == WAIT_OBJECT_0 || (!manual_reset && ret == WAIT_OBJECT_0 + 1),
+       "pulse didn't release the waiters, ret %u\n", ret);
+    ret = WaitForSingleObject(event, 0);
+    ok(ret == WAIT_TIMEOUT, "event is signaled after the pulse, ret %u\n", ret);
+    if (!manual_reset)
+    {
+        /* a single thread is released by an auto-reset event */
+        ret = WaitForMultipleObjects(2, threads, TRUE, 100);
+        ok(ret == WAIT_TIMEOUT, "both threads were released, ret %u\n", ret);
+        SetEvent(event);
+        ret = WaitForMultipleObjects(2, threads, TRUE, 1000);
+        ok(ret == WAIT_OBJECT_0, "WaitForMultipleObjects returned %u\n", ret);
+    }
+    for (i = 0; i < 2; i++)
+    {
+        GetExitCodeThread(threads[i], &ret);
+        ok(ret == WAIT_OBJECT_0, "thread %u returned %u\n", i, ret);
+        CloseHandle(threads[i]);
+    }
+    CloseHandle(event);
+}
+
+static void test_remote_close(const char *argv0)
+{
+    char cmdline[MAX_PATH + 64];
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    HANDLE event, event2, keep;
+    DWORD ret;
+
+    event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    DuplicateHandle(GetCurrentProcess(), event, GetCurrentProcess(), &keep, 0, FALSE, DUPLICATE_SAME_ACCESS);
+    ret = WaitForSingleObject(event, 0);
+    ok(ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret);
+
+    sprintf(cmdline, "\"%s\" sync close %x %p", argv0, GetCurrentProcessId(), event);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess failed with error %u\n", GetLastError());
+    winetest_wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+
+    /* the handle value is likely reused, it must not refer to the closed object */
+    event2 = CreateEventA(NULL, TRUE, FALSE, NULL);
+    ok(event2 != NULL, "CreateEvent failed with error %u\n", GetLastError());
+    SetEvent(event2);
+    ret = WaitForSingleObject(keep, 0);
+    ok(ret == WAIT_TIMEOUT, "closed event was signaled, ret %u\n", ret);
+    ret = WaitForSingleObject(event2, 0);
+    ok(ret == WAIT_OBJECT_0, "new event wasn't signaled, ret %u\n", ret);
+    CloseHandle(event2);
+    CloseHandle(keep);
+}
+
+static void test_sync_fast_path(const char *argv0)
+{
+    HANDLE thread, mutex, sem, handles[2];
+    DWORD i, ret, start, prev;
+
+    /* uncontended operations */
+    sem = CreateSemaphoreA(NULL, 0, NB_PING_PONGS, NULL);
+    ok(sem != NULL, "CreateSemaphore failed with error %u\n", GetLastError());
+    start = GetTickCount();
+    for (i = 0; i < NB_PING_PONGS; i++)
+    {
+        ret = ReleaseSemaphore(sem, 1, NULL);
+        ok(ret, "ReleaseSemaphore failed with error %u\n", GetLastError());
+        ret = WaitForSingleObject(sem, 0);
+        ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    }
+    if (winetest_debug > 1) trace("%u semaphore release/wait in %u ms\n", NB_PING_PONGS, GetTickCount() - start);
+    ret = WaitForSingleObject(sem, 0);
+    ok(ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret);
+    ret = ReleaseSemaphore(sem, NB_PING_PONGS + 1, NULL);
+    ok(!ret && GetLastError() == ERROR_TOO_MANY_POSTS, "wrong error %u\n", GetLastError());
+
+    /* blocking waits between two threads */
+    ping_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    pong_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    thread = CreateThread(NULL, 0, ping_pong_thread, NULL, 0, NULL);
+    start = GetTickCount();
+    for (i = 0; i < NB_PING_PONGS; i++)
+    {
+        SetEvent(ping_event);
+        ret = WaitForSingleObject(pong_event, 5000);
+        if (ret != WAIT_OBJECT_0) break;
+    }
+    if (winetest_debug > 1) trace("%u ping-pongs in %u ms\n", i, GetTickCount() - start);
+    ok(i == NB_PING_PONGS, "stopped after %u ping-pongs, ret %u\n", i, ret);
+    ret = WaitForSingleObject(thread, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    GetExitCodeThread(thread, &ret);
+    ok(!ret, "thread returned %u\n", ret);
+    CloseHandle(thread);
+
+    /* a wait-all in the server must be woken by a state change in the client */
+    handles[0] = ping_event;
+    handles[1] = sem;
+    thread = CreateThread(NULL, 0, wait_all_thread, handles, 0, NULL);
+    SetEvent(ping_event);
+    ret = WaitForSingleObject(thread, 100);
+    ok(ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret);
+    ReleaseSemaphore(sem, 1, NULL);
+    ret = WaitForSingleObject(thread, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    GetExitCodeThread(thread, &ret);
+    ok(ret == WAIT_OBJECT_0, "thread returned %u\n", ret);
+    CloseHandle(thread);
+    ret = WaitForSingleObject(ping_event, 0);
+    ok(ret == WAIT_TIMEOUT, "event not reset, ret %u\n", ret);
+    ret = ReleaseSemaphore(sem, 1, (LONG *)&prev);
+    ok(ret && !prev, "semaphore count %u\n", prev);
+    CloseHandle(ping_event);
+    CloseHandle(pong_event);
+    CloseHandle(sem);
+
+    /* mutexes owned by a dead thread are abandoned */
+    mutex = CreateMutexA(NULL, FALSE, NULL);
+    thread = CreateThread(NULL, 0, abandon_thread, mutex, 0, NULL);
+    ret = WaitForSingleObject(thread, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    GetExitCodeThread(thread, &ret);
+    ok(ret == WAIT_OBJECT_0, "thread returned %u\n", ret);
+    CloseHandle(thread);
+    ret = WaitForSingleObject(mutex, 0);
+    ok(ret == WAIT_ABANDONED, "WaitForSingleObject returned %u\n", ret);
+    ret = WaitForSingleObject(mutex, 0);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    ret = ReleaseMutex(mutex);
+    ok(ret, "ReleaseMutex failed with error %u\n", GetLastError());
+    ret = ReleaseMutex(mutex);
+    ok(ret, "ReleaseMutex failed with error %u\n", GetLastError());
+    SetLastError(0xdeadbeef);
+    ret = ReleaseMutex(mutex);
+    ok(!ret && GetLastError() == ERROR_NOT_OWNER, "wrong error %u\n", GetLastError());
+    CloseHandle(mutex);
+
+    test_pulse_event(TRUE);
+    test_pulse_event(FALSE);
+    test_remote_close(argv0);
+}
+
 static void test_waitable_timer(void)
 {
     HANDLE handle, handle2;
@@ -736,6 +935,112 @@ static void CALLBACK timer_queue_cb6(PVOID p, BOOLEAN timedOut)
     }
 }
 
+static void test_completion_status_ex(void)
+{
+    static const char pipename[] = "\\\\.\\pipe\\wine_sync_test";
+    char temp_path[MAX_PATH], filename[MAX_PATH], buffer[4];
+    OVERLAPPED_ENTRY entries[16];
+    HANDLE port, file, server, client;
+    OVERLAPPED ov;
+    ULONG count, i;
+    DWORD size;
+    BOOL ret;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip("GetQueuedCompletionStatusEx not available\n");
+        return;
+    }
+
+    port = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+    ok( port != NULL, "CreateIoCompletionPort error %u\n", GetLastError() );
+
+    for (i = 0; i < 10; i++)
+    {
+        ret = PostQueuedCompletionStatus( port, i, 0x100 + i, (OVERLAPPED *)(ULONG_PTR)(0x200 + i) );
+        ok( ret, "PostQueuedCompletionStatus error %u\n", GetLastError() );
+    }
+
+    count = 0xdeadbeef;
+    ret = pGetQueuedCompletionStatusEx( port, entries, 4, &count, 0, FALSE );
+    ok( ret, "GetQueuedCompletionStatusEx error %u\n", GetLastError() );
+    ok( count == 4, "wrong count %u\n", count );
+    for (i = 0; i < count; i++)
+    {
+        ok( entries[i].lpCompletionKey == 0x100 + i, "%u: wrong key %lx\n", i, entries[i].lpCompletionKey );
+        ok( entries[i].lpOverlapped == (OVERLAPPED *)(ULONG_PTR)(0x200 + i),
+            "%u: wrong overlapped %p\n", i, entries[i].lpOverlapped );
+        ok( entries[i].dwNumberOfBytesTransferred == i, "%u: wrong size %u\n", i,
+            entries[i].dwNumberOfBytesTransferred );
+    }
+
+    count = 0xdeadbeef;
+    ret = pGetQueuedCompletionStatusEx( port, entries, 16, &count, 0, FALSE );
+    ok( ret, "GetQueuedCompletionStatusEx error %u\n", GetLastError() );
+    ok( count == 6, "wrong count %u\n", count );
+    ok( entries[0].lpCompletionKey == 0x104, "wrong key %lx\n", entries[0].lpCompletionKey );
+    ok( entries[5].lpCompletionKey == 0x109, "wrong key %lx\n", entries[5].lpCompletionKey );
+
+    SetLastError( 0xdeadbeef );
+    ret = pGetQueuedCompletionStatusEx( port, entries, 16, &count, 0, FALSE );
+    ok( !ret, "GetQueuedCompletionStatusEx succeeded\n" );
+    ok( GetLastError() == WAIT_TIMEOUT, "wrong error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    ret = pGetQueuedCompletionStatusEx( port, entries, 16, &count, 10, FALSE );
+    ok( !ret, "GetQueuedCompletionStatusEx succeeded\n" );
+    ok( GetLastError() == WAIT_TIMEOUT, "wrong error %u\n", GetLastError() );
+
+    CloseHandle( port );
+
+    if (!pSetFileCompletionNotificationModes)
+    {
+        win_skip("SetFileCompletionNotificationModes not available\n");
+        return;
+    }
+
+    GetTempPathA( sizeof(temp_path), temp_path );
+    GetTempFileNameA( temp_path, "WQE", 0, filename );
+    file = CreateFileA( filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_FLAG_OVERLAPPED | FILE_FLAG_DELETE_ON_CLOSE, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile error %u\n", GetLastError() );
+
+    ret = pSetFileCompletionNotificationModes( file, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS );
+    ok( ret, "SetFileCompletionNotificationModes error %u\n", GetLastError() );
+    ret = pSetFileCompletionNotificationModes( file, FILE_SKIP_SET_EVENT_ON_HANDLE );
+    ok( ret, "SetFileCompletionNotificationModes error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    ret = pSetFileCompletionNotificationModes( file, 0x80 );
+    ok( !ret, "SetFileCompletionNotificationModes succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    CloseHandle( file );
+
+    /* the handle is not signaled when a request without an event completes */
+    server = CreateNamedPipeA( pipename, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED,
+                               PIPE_TYPE_BYTE | PIPE_WAIT, 1, 1024, 1024, 0, NULL );
+    ok( server != INVALID_HANDLE_VALUE, "CreateNamedPipe error %u\n", GetLastError() );
+    client = CreateFileA( pipename, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL );
+    ok( client != INVALID_HANDLE_VALUE, "CreateFile error %u\n", GetLastError() );
+    ret = pSetFileCompletionNotificationModes( server, FILE_SKIP_SET_EVENT_ON_HANDLE );
+    ok( ret, "SetFileCompletionNotificationModes error %u\n", GetLastError() );
+
+    memset( &ov, 0, sizeof(ov) );
+    ret = ReadFile( server, buffer, 4, NULL, &ov );
+    ok( !ret && GetLastError() == ERROR_IO_PENDING, "ReadFile got %d error %u\n", ret, GetLastError() );
+    ret = WriteFile( client, "test", 4, &size, NULL );
+    ok( ret, "WriteFile error %u\n", GetLastError() );
+    for (i = 0; i < 100 && !HasOverlappedIoCompleted( &ov ); i++) SleepEx( 10, TRUE );
+    ok( HasOverlappedIoCompleted( &ov ), "read not completed\n" );
+    ret = GetOverlappedResult( server, &ov, &size, FALSE );
+    ok( ret && size == 4, "GetOverlappedResult got %d size %u error %u\n", ret, size, GetLastError() );
+    ok( WaitForSingleObject( server, 0 ) == WAIT_TIMEOUT, "pipe handle is signaled\n" );
+
+    CloseHandle( client );
+    CloseHandle( server );
+}
+
 static void test_timer_queue(void)
 {
     HANDLE q, t0, t1, t2, t3, t4, t5;
@@ -2286,6 +2591,8 @@ static void test_srwlock_example(void)
 
 START_TEST(sync)
 {
+    char **argv;
+    int argc;
     HMODULE hdll = GetModuleHandleA("kernel32.dll");
     pChangeTimerQueueTimer = (void*)GetProcAddress(hdll, "ChangeTimerQueueTimer");
     pCreateTimerQueue = (void*)GetProcAddress(hdll, "CreateTimerQueue");
@@ -2312,14 +2619,30 @@ START_TEST(sync)
     pReleaseSRWLockShared = (void *)GetProcAddress(hdll, "ReleaseSRWLockShared");
     pTryAcquireSRWLockExclusive = (void *)GetProcAddress(hdll, "TryAcquireSRWLockExclusive");
     pTryAcquireSRWLockShared = (void *)GetProcAddress(hdll, "TryAcquireSRWLockShared");
+    pGetQueuedCompletionStatusEx = (void *)GetProcAddress(hdll, "GetQueuedCompletionStatusEx");
+    pSetFileCompletionNotificationModes = (void *)GetProcAddress(hdll, "SetFileCompletionNotificationModes");
+
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 5 && !strcmp(argv[2], "close"))
+    {
+        DWORD pid;
+        HANDLE handle;
+
+        sscanf(argv[3], "%x", &pid);
+        sscanf(argv[4], "%p", &handle);
+        close_remote_handle(pid, handle);
+        return;
+    }
 
     test_signalandwait();
     test_mutex();
     test_slist();
     test_event();
     test_semaphore();
+    test_sync_fast_path(argv[0]);
     test_waitable_timer();
     test_iocp_callback();
+    test_completion_status_ex();
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
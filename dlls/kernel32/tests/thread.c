@@ -90,6 +90,21 @@ static PTP_WORK (WINAPI *pCreateThreadpoolWork)(PTP_WORK_CALLBACK,PVOID,PTP_CALL
 static void (WINAPI *pSubmitThreadpoolWork)(PTP_WORK);
 static void (WINAPI *pWaitForThreadpoolWorkCallbacks)(PTP_WORK,BOOL);
 static void (WINAPI *pCloseThreadpoolWork)(PTP_WORK);
+static void (WINAPI *pCloseThreadpool)(PTP_POOL);
+static BOOL (WINAPI *pSetThreadpoolThreadMinimum)(PTP_POOL,DWORD);
+static void (WINAPI *pSetThreadpoolThreadMaximum)(PTP_POOL,DWORD);
+static BOOL (WINAPI *pTrySubmitThreadpoolCallback)(PTP_SIMPLE_CALLBACK,PVOID,PTP_CALLBACK_ENVIRON);
+static BOOL (WINAPI *pCallbackMayRunLong)(PTP_CALLBACK_INSTANCE);
+static void (WINAPI *pSetEventWhenCallbackReturns)(PTP_CALLBACK_INSTANCE,HANDLE);
+static PTP_TIMER (WINAPI *pCreateThreadpoolTimer)(PTP_TIMER_CALLBACK,PVOID,PTP_CALLBACK_ENVIRON);
+static void (WINAPI *pSetThreadpoolTimer)(PTP_TIMER,FILETIME *,DWORD,DWORD);
+static BOOL (WINAPI *pIsThreadpoolTimerSet)(PTP_TIMER);
+static void (WINAPI *pWaitForThreadpoolTimerCallbacks)(PTP_TIMER,BOOL);
+static void (WINAPI *pCloseThreadpoolTimer)(PTP_TIMER);
+static PTP_WAIT (WINAPI *pCreateThreadpoolWait)(PTP_WAIT_CALLBACK,PVOID,PTP_CALLBACK_ENVIRON);
+static void (WINAPI *pSetThreadpoolWait)(PTP_WAIT,HANDLE,FILETIME *);
+static void (WINAPI *pWaitForThreadpoolWaitCallbacks)(PTP_WAIT,BOOL);
+static void (WINAPI *pCloseThreadpoolWait)(PTP_WAIT);
 
 static HANDLE create_target_process(const char *arg)
 {
@@ -1614,12 +1629,68 @@ static void WINAPI threadpool_workcallback(PTP_CALLBACK_INSTANCE instance, void
     (*foo)++;
 }
 
+#define NB_WORK_POSTS 1000
+#define NB_WAITS      100
+
+static LONG work_count;
+static PTP_WORK child_work;
+
+static void WINAPI threadpool_countcallback(PTP_CALLBACK_INSTANCE instance, void *context, PTP_WORK work)
+{
+    InterlockedIncrement(&work_count);
+}
+
+static void WINAPI threadpool_spawncallback(PTP_CALLBACK_INSTANCE instance, void *context, PTP_WORK work)
+{
+    int i;
+
+    /* posted from a worker, the work items are queued locally and stolen by the other workers */
+    for (i = 0; i < NB_WORK_POSTS; i++) pSubmitThreadpoolWork(child_work);
+}
+
+static void WINAPI threadpool_longcallback(PTP_CALLBACK_INSTANCE instance, void *context)
+{
+    BOOL *ret = context;
+
+    *ret = pCallbackMayRunLong(instance);
+}
+
+static void WINAPI threadpool_simplecallback(PTP_CALLBACK_INSTANCE instance, void *context)
+{
+    pSetEventWhenCallbackReturns(instance, context);
+}
+
+static LONG timer_count;
+
+static void WINAPI threadpool_timercallback(PTP_CALLBACK_INSTANCE instance, void *context, PTP_TIMER timer)
+{
+    if (InterlockedIncrement(&timer_count) == 3) pSetEventWhenCallbackReturns(instance, context);
+}
+
+static LONG wait_count;
+static TP_WAIT_RESULT wait_result;
+
+static void WINAPI threadpool_waitcallback(PTP_CALLBACK_INSTANCE instance, void *context, PTP_WAIT wait,
+                                           TP_WAIT_RESULT result)
+{
+    wait_result = result;
+    if (InterlockedIncrement(&wait_count) == NB_WAITS) pSetEventWhenCallbackReturns(instance, context);
+}
 
 static void test_threadpool(void)
 {
+    TP_CALLBACK_ENVIRON environment;
     PTP_POOL pool;
-    PTP_WORK work;
+    PTP_WORK work, spawn;
+    PTP_TIMER timer;
+    PTP_WAIT waits[NB_WAITS];
+    HANDLE events[NB_WAITS];
+    HANDLE done;
+    FILETIME due;
+    DWORD start, ret;
+    BOOL may_run_long;
     int workcalled = 0;
+    int i;
 
     if (!pCreateThreadpool) {
         todo_wine win_skip("thread pool apis not supported.\n");
@@ -1635,7 +1706,122 @@ static void test_threadpool(void)
     ok (workcalled == 1, "expected work to be called once, got %d\n", workcalled);
 
     pool = pCreateThreadpool(NULL);
-    todo_wine ok (pool != NULL, "CreateThreadpool failed\n");
+    ok (pool != NULL, "CreateThreadpool failed\n");
+    if (!pool) return;
+
+    pSetThreadpoolThreadMaximum(pool, 4);
+    ret = pSetThreadpoolThreadMinimum(pool, 2);
+    ok (ret, "SetThreadpoolThreadMinimum failed %u\n", GetLastError());
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+
+    /* many posts of the same work object */
+    work_count = 0;
+    work = pCreateThreadpoolWork(threadpool_countcallback, NULL, &environment);
+    ok (work != NULL, "Error %d in CreateThreadpoolWork\n", GetLastError());
+    start = GetTickCount();
+    for (i = 0; i < NB_WORK_POSTS; i++) pSubmitThreadpoolWork(work);
+    pWaitForThreadpoolWorkCallbacks(work, FALSE);
+    if (winetest_debug > 1) trace("%u work items in %u ms\n", NB_WORK_POSTS, GetTickCount() - start);
+    ok (work_count == NB_WORK_POSTS, "expected %u callbacks, got %d\n", NB_WORK_POSTS, work_count);
+
+    /* posts from within a callback */
+    work_count = 0;
+    child_work = work;
+    spawn = pCreateThreadpoolWork(threadpool_spawncallback, NULL, &environment);
+    ok (spawn != NULL, "Error %d in CreateThreadpoolWork\n", GetLastError());
+    start = GetTickCount();
+    pSubmitThreadpoolWork(spawn);
+    pWaitForThreadpoolWorkCallbacks(spawn, FALSE);
+    pWaitForThreadpoolWorkCallbacks(work, FALSE);
+    if (winetest_debug > 1) trace("%u nested work items in %u ms\n", NB_WORK_POSTS, GetTickCount() - start);
+    ok (work_count == NB_WORK_POSTS, "expected %u callbacks, got %d\n", NB_WORK_POSTS, work_count);
+    pCloseThreadpoolWork(spawn);
+    pCloseThreadpoolWork(work);
+
+    done = CreateEventA(NULL, FALSE, FALSE, NULL);
+
+    ret = pTrySubmitThreadpoolCallback(threadpool_simplecallback, done, &environment);
+    ok (ret, "TrySubmitThreadpoolCallback failed %u\n", GetLastError());
+    ret = WaitForSingleObject(done, 1000);
+    ok (ret == WAIT_OBJECT_0, "simple callback not called\n");
+
+    may_run_long = FALSE;
+    ret = pTrySubmitThreadpoolCallback(threadpool_longcallback, &may_run_long, &environment);
+    ok (ret, "TrySubmitThreadpoolCallback failed %u\n", GetLastError());
+    ret = pTrySubmitThreadpoolCallback(threadpool_simplecallback, done, &environment);
+    ok (ret, "TrySubmitThreadpoolCallback failed %u\n", GetLastError());
+    ret = WaitForSingleObject(done, 1000);
+    ok (ret == WAIT_OBJECT_0, "simple callback not called\n");
+    ok (may_run_long, "CallbackMayRunLong failed\n");
+
+    /* periodic timer, first expiration after 50ms */
+    timer_count = 0;
+    timer = pCreateThreadpoolTimer(threadpool_timercallback, done, &environment);
+    ok (timer != NULL, "Error %d in CreateThreadpoolTimer\n", GetLastError());
+    ok (!pIsThreadpoolTimerSet(timer), "timer should not be set\n");
+    due.dwLowDateTime = (DWORD)-500000;
+    due.dwHighDateTime = (DWORD)-1;
+    pSetThreadpoolTimer(timer, &due, 20, 0);
+    ok (pIsThreadpoolTimerSet(timer), "timer should be set\n");
+    ret = WaitForSingleObject(done, 1000);
+    ok (ret == WAIT_OBJECT_0, "timer callback not called\n");
+    pSetThreadpoolTimer(timer, NULL, 0, 0);
+    ok (!pIsThreadpoolTimerSet(timer), "timer should not be set\n");
+    pWaitForThreadpoolTimerCallbacks(timer, TRUE);
+    ok (timer_count >= 3, "expected at least 3 timer callbacks, got %d\n", timer_count);
+    pCloseThreadpoolTimer(timer);
+
+    /* more waits than fit in a single wait call */
+    wait_count = 0;
+    wait_result = 0xdeadbeef;
+    for (i = 0; i < NB_WAITS; i++)
+    {
+        events[i] = CreateEventA(NULL, FALSE, FALSE, NULL);
+        waits[i] = pCreateThreadpoolWait(threadpool_waitcallback, done, &environment);
+        ok (waits[i] != NULL, "Error %d in CreateThreadpoolWait\n", GetLastError());
+        pSetThreadpoolWait(waits[i], events[i], NULL);
+    }
+    start = GetTickCount();
+    for (i = 0; i < NB_WAITS; i++) SetEvent(events[i]);
+    ret = WaitForSingleObject(done, 5000);
+    if (winetest_debug > 1) trace("%u waits in %u ms\n", NB_WAITS, GetTickCount() - start);
+    ok (ret == WAIT_OBJECT_0, "wait callbacks not called\n");
+    ok (wait_count == NB_WAITS, "expected %u callbacks, got %d\n", NB_WAITS, wait_count);
+    ok (wait_result == WAIT_OBJECT_0, "wrong result %u\n", wait_result);
+
+    /* a single signaled object must be enough to fire its wait */
+    wait_count = NB_WAITS - 1;
+    wait_result = 0xdeadbeef;
+    for (i = 1; i < 4; i++) pSetThreadpoolWait(waits[i], events[i], NULL);
+    SetEvent(events[2]);
+    ret = WaitForSingleObject(done, 1000);
+    ok (ret == WAIT_OBJECT_0, "wait callback not called\n");
+    ok (wait_result == WAIT_OBJECT_0, "wrong result %u\n", wait_result);
+    ok (wait_count == NB_WAITS, "expected %u callbacks, got %d\n", NB_WAITS, wait_count);
+    for (i = 1; i < 4; i++) pSetThreadpoolWait(waits[i], NULL, NULL);
+
+    /* waits are one-shot, and time out when requested */
+    wait_count = NB_WAITS - 1;
+    due.dwLowDateTime = (DWORD)-500000;
+    due.dwHighDateTime = (DWORD)-1;
+    pSetThreadpoolWait(waits[0], events[0], &due);
+    ret = WaitForSingleObject(done, 1000);
+    ok (ret == WAIT_OBJECT_0, "wait callback not called\n");
+    ok (wait_result == WAIT_TIMEOUT, "wrong result %u\n", wait_result);
+    ok (wait_count == NB_WAITS, "expected %u callbacks, got %d\n", NB_WAITS, wait_count);
+
+    for (i = 0; i < NB_WAITS; i++)
+    {
+        pWaitForThreadpoolWaitCallbacks(waits[i], FALSE);
+        pCloseThreadpoolWait(waits[i]);
+        CloseHandle(events[i]);
+    }
+
+    CloseHandle(done);
+    pCloseThreadpool(pool);
 }
 
 static void test_reserved_tls(void)
@@ -1704,6 +1890,21 @@ static void init_funcs(void)
     X(SubmitThreadpoolWork);
     X(WaitForThreadpoolWorkCallbacks);
     X(CloseThreadpoolWork);
+    X(CloseThreadpool);
+    X(SetThreadpoolThreadMinimum);
+    X(SetThreadpoolThreadMaximum);
+    X(TrySubmitThreadpoolCallback);
+    X(CallbackMayRunLong);
+    X(SetEventWhenCallbackReturns);
+    X(CreateThreadpoolTimer);
+    X(SetThreadpoolTimer);
+    X(IsThreadpoolTimerSet);
+    X(WaitForThreadpoolTimerCallbacks);
+    X(CloseThreadpoolTimer);
+    X(CreateThreadpoolWait);
+    X(SetThreadpoolWait);
+    X(WaitForThreadpoolWaitCallbacks);
+    X(CloseThreadpoolWait);
 #undef X
 }
 
@@ -2511,6 +2511,18 @@ static int read_utf8(int fd, MSVCRT_wchar_t *buf, unsigned int count)
     return num_read*2;
 }
 
+/* INTERNAL: Length of the leading run of bytes that need no text mode
+ * translation, i.e. that contain neither \r nor ^Z */
+static DWORD text_run_length(const char *buf, DWORD len)
+{
+    const char *cr = memchr(buf, '\r', len);
+    const char *eof;
+
+    if (cr) len = cr - buf;
+    if ((eof = memchr(buf, 0x1a, len))) len = eof - buf;
+    return len;
+}
+
 /*********************************************************************
  * (internal) read_i
  *
@@ -2594,6 +2606,20 @@ static int read_i(int fd, void *buf, unsigned int count)
 
             for (i=0, j=0; i<num_read; i+=1+utf16)
             {
+                /* copy plain runs at once, leaving \r and ^Z to the code below */
+                if (!utf16)
+                {
+                    DWORD len = text_run_length(bufstart+i, num_read-i);
+
+                    if (len)
+                    {
+                        if (i != j) memmove(bufstart+j, bufstart+i, len);
+                        i += len;
+                        j += len;
+                        if (i == num_read) break;
+                    }
+                }
+
                 /* in text mode, a ctrl-z signals EOF */
                 if (bufstart[i]==0x1a && (!utf16 || bufstart[i+1]==0))
                 {
@@ -3214,21 +3240,26 @@ int CDECL MSVCRT__write(int fd, const void* buf, unsigned int count)
 
         if (!(info->exflag & (EF_UTF8|EF_UTF16)))
         {
+            const char *lf, *end = s + count;
+
             /* find number of \n */
-            for (nr_lf=0, i=0; i<count; i++)
-                if (s[i] == '\n')
-                    nr_lf++;
+            for (nr_lf=0, lf=s; (lf = memchr(lf, '\n', end-lf)); lf++)
+                nr_lf++;
             if (nr_lf)
             {
                 size = count+nr_lf;
                 if ((q = p = MSVCRT_malloc(size)))
                 {
-                    for (s = buf, i = 0, j = 0; i < count; i++)
+                    /* copy the text between line feeds in chunks */
+                    for (s = buf, j = 0; (lf = memchr(s, '\n', end-s)); s = lf+1)
                     {
-                        if (s[i] == '\n')
-                            p[j++] = '\r';
-                        p[j++] = s[i];
+                        memcpy(p+j, s, lf-s);
+                        j += lf-s;
+                        p[j++] = '\r';
+                        p[j++] = '\n';
                     }
+                    memcpy(p+j, s, end-s);
+                    s = buf;
                 }
                 else
                 {
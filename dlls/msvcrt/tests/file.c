@@ -2182,6 +2182,128 @@ static void test_mktemp(void)
     ok(_mktemp(buf) != NULL, "_mktemp(\"**XXXXXX\") == NULL\n");
 }
 
+static void test_text_read(void)
+{
+    static const struct
+    {
+        const char *data;
+        unsigned int count;    /* size of each _read */
+        const char *expect;    /* data returned by the reads, separated by '|' */
+    } tests[] =
+    {
+        { "abc\r\ndef", 16, "abc\ndef" },
+        { "abc\r\ndef", 4, "abc|\ndef" },   /* \r at the end of the buffer */
+        { "\r\nab", 1, "\n|a|b" },
+        { "ab\rcd", 16, "ab\rcd" },          /* lone \r */
+        { "ab\rcd", 3, "ab\r|cd" },
+        { "ab\r", 16, "ab\r" },
+        { "a\r\r\nb", 16, "a\r\nb" },
+        { "a\r\r\nb", 3, "a\r|\nb" },
+        { "abc\x1a" "def", 16, "abc" },       /* ^Z ends the file */
+        { "abc\x1a" "def", 2, "ab|c" },
+        { "a\r\nb\x1a\r\n", 16, "a\nb" },
+    };
+    char *tempf, buf[16], out[64];
+    int i, fd, ret, pos;
+
+    tempf = _tempnam(".", "wne");
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        fd = _open(tempf, _O_CREAT|_O_TRUNC|_O_BINARY|_O_WRONLY, _S_IREAD|_S_IWRITE);
+        ok(fd != -1, "%d: can't create %s: %d\n", i, tempf, errno);
+        if (fd == -1) break;
+        _write(fd, tests[i].data, strlen(tests[i].data));
+        _close(fd);
+
+        fd = _open(tempf, _O_RDONLY|_O_TEXT);
+        ok(fd != -1, "%d: can't open %s: %d\n", i, tempf, errno);
+        if (fd == -1) break;
+        for (pos = 0; (ret = _read(fd, buf, tests[i].count)) > 0; pos += ret)
+        {
+            if (pos) out[pos++] = '|';
+            memcpy(out + pos, buf, ret);
+        }
+        out[pos] = 0;
+        ok(!ret, "%d: _read returned %d\n", i, ret);
+        ok(!strcmp(out, tests[i].expect), "%d: wrong data read (%d bytes)\n", i, pos);
+        _close(fd);
+    }
+    unlink(tempf);
+    free(tempf);
+}
+
+static void test_text_timings(void)
+{
+    static const char line[] = "The quick brown fox jumps over the lazy dog, 0123456789.\n";
+    static const char *modes[] = { "b", "t" };
+    const int lines = 20000, len = sizeof(line) - 1;
+    char *tempf, *data, buf[128], mode[4];
+    DWORD start, write_time, read_time, gets_time;
+    int i, m, count, size;
+    FILE *f;
+
+    if (!winetest_interactive)
+    {
+        skip("text mode timings (set WINETEST_INTERACTIVE=1)\n");
+        return;
+    }
+
+    tempf = _tempnam(".", "wne");
+    data = malloc(lines * len);
+    ok(data != NULL, "malloc failed\n");
+    if (!data) return;
+
+    for (m = 0; m < 2; m++)
+    {
+        sprintf(mode, "w%s", modes[m]);
+        f = fopen(tempf, mode);
+        ok(f != NULL, "fopen(%s) failed\n", mode);
+        if (!f) break;
+        start = GetTickCount();
+        for (i = 0; i < lines; i++) fputs(line, f);
+        write_time = GetTickCount() - start;
+        fclose(f);
+
+        f = fopen(tempf, "rb");
+        ok(f != NULL, "fopen(rb) failed\n");
+        if (!f) break;
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fclose(f);
+        ok(size == lines * (len + m), "%s: got size %d\n", mode, size);
+
+        sprintf(mode, "r%s", modes[m]);
+        f = fopen(tempf, mode);
+        ok(f != NULL, "fopen(%s) failed\n", mode);
+        if (!f) break;
+        start = GetTickCount();
+        count = fread(data, 1, lines * len, f);
+        read_time = GetTickCount() - start;
+        ok(count == lines * len, "%s: fread returned %d\n", mode, count);
+        ok(!memcmp(data, line, len) && !memcmp(data + count - len, line, len),
+           "%s: wrong data read\n", mode);
+        ok(fread(buf, 1, 1, f) == 0, "%s: expected EOF\n", mode);
+        fclose(f);
+
+        f = fopen(tempf, mode);
+        ok(f != NULL, "fopen(%s) failed\n", mode);
+        if (!f) break;
+        start = GetTickCount();
+        for (count = 0; fgets(buf, sizeof(buf), f); count++)
+            if (strcmp(buf, line)) break;
+        gets_time = GetTickCount() - start;
+        ok(count == lines, "%s: read %d lines\n", mode, count);
+        fclose(f);
+
+        trace("%s mode, %d bytes: fputs %u ms, fread %u ms, fgets %u ms\n",
+              m ? "text" : "binary", size, write_time, read_time, gets_time);
+    }
+
+    free(data);
+    unlink(tempf);
+    free(tempf);
+}
+
 static void test__open_osfhandle(void)
 {
     ioinfo *info;
@@ -2284,6 +2406,8 @@ START_TEST(file)
     test_stdin();
     test_mktemp();
     test__open_osfhandle();
+    test_text_read();
+    test_text_timings();
 
     /* Wait for the (_P_NOWAIT) spawned processes to finish to make sure the report
      * file contains lines in the correct order
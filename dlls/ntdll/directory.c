@@ -2205,6 +2205,277 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
 }
 
 
+/* cache of the names found in a directory, used for case-insensitive lookups */
+struct dir_cache_name
+{
+    unsigned int next;          /* next name with the same long name hash (index + 1) */
+    unsigned int next_short;    /* next name with the same short name hash (index + 1) */
+    unsigned int unix_name;     /* offset of the Unix name in unix_names */
+    unsigned int long_name;     /* offset of the lower-case long name in long_names */
+    unsigned short long_len;
+    unsigned short short_len;   /* zero if the long name is a valid DOS name */
+    WCHAR short_name[12];       /* lower-case hashed short name */
+};
+
+struct dir_cache
+{
+    struct list            entry;         /* entry in dir_cache_list, most recently used first */
+    dev_t                  dev;           /* identity of the directory */
+    ino_t                  ino;
+    time_t                 mtime;         /* modification times when the names were read */
+    time_t                 ctime;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM) && defined(HAVE_STRUCT_STAT_ST_CTIM)
+    long                   mtime_nsec;
+    long                   ctime_nsec;
+#endif
+    unsigned int           count;         /* number of names */
+    unsigned int           hash_size;     /* size of the hash tables, a power of two */
+    unsigned int          *hash;          /* first name for each long name hash (index + 1) */
+    unsigned int          *hash_short;    /* first name for each short name hash (index + 1) */
+    struct dir_cache_name *names;
+    char                  *unix_names;
+    WCHAR                 *long_names;
+};
+
+#define MAX_DIR_CACHE 64  /* max number of cached directories */
+
+static struct list dir_cache_list = LIST_INIT( dir_cache_list );
+static unsigned int dir_cache_count;
+
+static unsigned int hash_dir_cache_name( const WCHAR *name, int len )
+{
+    unsigned int hash = 0;
+    while (len--) hash = hash * 65599 + *name++;
+    return hash;
+}
+
+static void free_dir_cache( struct dir_cache *cache )
+{
+    list_remove( &cache->entry );
+    dir_cache_count--;
+    RtlFreeHeap( GetProcessHeap(), 0, cache->hash );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->unix_names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->long_names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+static BOOL is_dir_cache_valid( const struct dir_cache *cache, const struct stat *st )
+{
+    if (cache->mtime != st->st_mtime || cache->ctime != st->st_ctime) return FALSE;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM) && defined(HAVE_STRUCT_STAT_ST_CTIM)
+    if (cache->mtime_nsec != st->st_mtim.tv_nsec || cache->ctime_nsec != st->st_ctim.tv_nsec) return FALSE;
+#endif
+    return TRUE;
+}
+
+/* check that the directory can no longer change without changing its times, that is
+ * that they are older than the current tick of the coarse clock the kernel sets them from */
+static BOOL is_dir_time_settled( const struct stat *st )
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_REALTIME_COARSE) && defined(HAVE_STRUCT_STAT_ST_CTIM)
+    struct timespec now;
+
+    /* file systems that only store seconds have no sub-second part */
+    if (st->st_ctim.tv_nsec && !clock_gettime( CLOCK_REALTIME_COARSE, &now ))
+        return st->st_ctim.tv_sec < now.tv_sec ||
+               (st->st_ctim.tv_sec == now.tv_sec && st->st_ctim.tv_nsec < now.tv_nsec);
+#endif
+    return st->st_ctime < time( NULL );
+}
+
+/***********************************************************************
+ *           read_dir_cache
+ *
+ * Read all the names of a directory into a new cache entry.
+ * dir_section must be held by caller.
+ */
+static struct dir_cache *read_dir_cache( const char *dir, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    unsigned int i, names_size = 64, unix_size = 1024, long_size = 1024, unix_pos = 0, long_pos = 0;
+    struct dir_cache *cache;
+    struct dir_cache_name *name;
+    UNICODE_STRING str;
+    BOOLEAN spaces;
+    struct dirent *de;
+    DIR *dirp;
+    void *ptr;
+    int ret, len;
+
+    if (!(dirp = opendir( dir ))) return NULL;
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) goto failed;
+    list_init( &cache->entry );
+    dir_cache_count++;
+    cache->dev = st->st_dev;
+    cache->ino = st->st_ino;
+    cache->mtime = st->st_mtime;
+    cache->ctime = st->st_ctime;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM) && defined(HAVE_STRUCT_STAT_ST_CTIM)
+    cache->mtime_nsec = st->st_mtim.tv_nsec;
+    cache->ctime_nsec = st->st_ctim.tv_nsec;
+#endif
+    cache->names = RtlAllocateHeap( GetProcessHeap(), 0, names_size * sizeof(*cache->names) );
+    cache->unix_names = RtlAllocateHeap( GetProcessHeap(), 0, unix_size );
+    cache->long_names = RtlAllocateHeap( GetProcessHeap(), 0, long_size * sizeof(WCHAR) );
+    if (!cache->names || !cache->unix_names || !cache->long_names) goto failed;
+
+    str.Buffer = buffer;
+    str.MaximumLength = sizeof(buffer);
+    while ((de = readdir( dirp )))
+    {
+        /* names that don't convert to Unicode can't be found by a case-insensitive search */
+        len = strlen( de->d_name );
+        if ((ret = ntdll_umbstowcs( 0, de->d_name, len, buffer, MAX_DIR_ENTRY_LEN )) <= 0) continue;
+
+        if (cache->count == names_size)
+        {
+            names_size *= 2;
+            if (!(ptr = RtlReAllocateHeap( GetProcessHeap(), 0, cache->names,
+                                           names_size * sizeof(*cache->names) ))) goto failed;
+            cache->names = ptr;
+        }
+        while (unix_pos + len + 1 > unix_size)
+        {
+            unix_size *= 2;
+            if (!(ptr = RtlReAllocateHeap( GetProcessHeap(), 0, cache->unix_names, unix_size ))) goto failed;
+            cache->unix_names = ptr;
+        }
+        while (long_pos + ret > long_size)
+        {
+            long_size *= 2;
+            if (!(ptr = RtlReAllocateHeap( GetProcessHeap(), 0, cache->long_names,
+                                           long_size * sizeof(WCHAR) ))) goto failed;
+            cache->long_names = ptr;
+        }
+
+        name = &cache->names[cache->count++];
+        name->unix_name = unix_pos;
+        memcpy( cache->unix_names + unix_pos, de->d_name, len + 1 );
+        unix_pos += len + 1;
+        name->long_name = long_pos;
+        name->long_len = ret;
+        for (i = 0; i < ret; i++) cache->long_names[long_pos++] = tolowerW( buffer[i] );
+
+        str.Length = ret * sizeof(WCHAR);
+        name->short_len = 0;
+        if (!RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) || spaces)
+        {
+            name->short_len = hash_short_file_name( &str, name->short_name );
+            for (i = 0; i < name->short_len; i++) name->short_name[i] = tolowerW( name->short_name[i] );
+        }
+    }
+    closedir( dirp );
+    dirp = NULL;
+
+    for (cache->hash_size = 16; cache->hash_size < cache->count; cache->hash_size *= 2) ;
+    if (!(cache->hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                         2 * cache->hash_size * sizeof(*cache->hash) ))) goto failed;
+    cache->hash_short = cache->hash + cache->hash_size;
+
+    /* insert in reverse order so that the chains keep the directory order */
+    for (i = cache->count; i > 0; i--)
+    {
+        unsigned int hash;
+
+        name = &cache->names[i - 1];
+        hash = hash_dir_cache_name( cache->long_names + name->long_name, name->long_len ) & (cache->hash_size - 1);
+        name->next = cache->hash[hash];
+        cache->hash[hash] = i;
+        if (!name->short_len) continue;
+        hash = hash_dir_cache_name( name->short_name, name->short_len ) & (cache->hash_size - 1);
+        name->next_short = cache->hash_short[hash];
+        cache->hash_short[hash] = i;
+    }
+
+    TRACE( "%s: %u names\n", debugstr_a(dir), cache->count );
+    return cache;
+
+failed:
+    if (dirp) closedir( dirp );
+    if (cache) free_dir_cache( cache );
+    return NULL;
+}
+
+/***********************************************************************
+ *           find_file_in_dir_cache
+ *
+ * Case-insensitive search of a name through the directory cache.
+ * Return 1 and copy the Unix name to 'dest' if found, 0 if not found, and
+ * -1 if the directory can't be cached and has to be searched the hard way.
+ */
+static int find_file_in_dir_cache( const char *dir, const WCHAR *name, int length,
+                                   BOOLEAN check_short, char *dest )
+{
+    WCHAR lower[MAX_DIR_ENTRY_LEN];
+    struct dir_cache *cache = NULL, *iter;
+    struct dir_cache_name *entry;
+    unsigned int i, pos, hash, found = 0;
+    struct stat st;
+
+    if (length > MAX_DIR_ENTRY_LEN) return 0;
+    if (stat( dir, &st ) == -1) return -1;
+
+    RtlEnterCriticalSection( &dir_section );
+
+    LIST_FOR_EACH_ENTRY( iter, &dir_cache_list, struct dir_cache, entry )
+    {
+        if (iter->dev != st.st_dev || iter->ino != st.st_ino) continue;
+        if (is_dir_cache_valid( iter, &st )) cache = iter;
+        else free_dir_cache( iter );
+        break;
+    }
+
+    if (!cache)
+    {
+        /* the directory may be modified again without changing its times if
+         * they are too recent, wait until they are in the past to cache it */
+        if (!is_dir_time_settled( &st ) || !(cache = read_dir_cache( dir, &st )))
+        {
+            RtlLeaveCriticalSection( &dir_section );
+            return -1;
+        }
+        if (dir_cache_count > MAX_DIR_CACHE)
+            free_dir_cache( LIST_ENTRY( list_tail( &dir_cache_list ), struct dir_cache, entry ));
+    }
+    else list_remove( &cache->entry );
+    list_add_head( &dir_cache_list, &cache->entry );
+
+    for (i = 0; i < length; i++) lower[i] = tolowerW( name[i] );
+    hash = hash_dir_cache_name( lower, length ) & (cache->hash_size - 1);
+
+    for (pos = cache->hash[hash]; pos; pos = entry->next)
+    {
+        entry = &cache->names[pos - 1];
+        if (entry->long_len == length &&
+            !memcmp( cache->long_names + entry->long_name, lower, length * sizeof(WCHAR) ))
+        {
+            found = pos;
+            break;
+        }
+    }
+
+    /* a short name match earlier in the directory takes precedence */
+    if (check_short)
+    {
+        for (pos = cache->hash_short[hash]; pos && (!found || pos < found); pos = entry->next_short)
+        {
+            entry = &cache->names[pos - 1];
+            if (entry->short_len == length && !memcmp( entry->short_name, lower, length * sizeof(WCHAR) ))
+            {
+                found = pos;
+                break;
+            }
+        }
+    }
+
+    if (found) strcpy( dest, cache->unix_names + cache->names[found - 1].unix_name );
+    RtlLeaveCriticalSection( &dir_section );
+    return found != 0;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2312,6 +2583,15 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (find_file_in_dir_cache( unix_name, name, length, is_name_8_dot_3, unix_name + pos ))
+    {
+    case 1:
+        unix_name[pos - 1] = '/';
+        goto success;
+    case 0:
+        goto not_found;
+    }
+
     if (!(dir = opendir( unix_name )))
     {
         if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
@@ -83,6 +83,7 @@
 #include "wine/unicode.h"
 #include "wine/debug.h"
 #include "wine/server.h"
+#include "wine/list.h"
 #include "ntdll_misc.h"
 
 #include "winternl.h"
@@ -559,6 +560,213 @@ static NTSTATUS get_io_avail_mode( HANDLE handle, enum server_fd_type type, BOOL
 }
 
 
+/* overlapped I/O on a regular file, performed by the disk I/O thread pool */
+struct async_disk_io
+{
+    struct list      entry;     /* entry in the list of requests not started yet */
+    HANDLE           caller;    /* file handle used by the caller, to match cancel requests */
+    DWORD            tid;       /* id of the thread that started the request */
+    BOOL             cancelled;
+    int              fd;        /* private copy of the file descriptor */
+    BOOL             write;
+    void            *buffer;
+    ULONG            length;
+    off_t            offset;
+    HANDLE           handle;    /* copy of the file handle to post the completion or signal the file, or 0 */
+    HANDLE           event;     /* copy of the event handle, or 0 */
+    IO_STATUS_BLOCK *iosb;
+    ULONG_PTR        cvalue;
+};
+
+#define MAX_DISK_IO_THREADS 64  /* max number of concurrent disk requests */
+
+static RTL_RUN_ONCE disk_io_once = RTL_RUN_ONCE_INIT;
+static TP_CALLBACK_ENVIRON disk_io_environment;
+static struct list disk_io_queue = LIST_INIT( disk_io_queue );
+
+static RTL_CRITICAL_SECTION disk_io_section;
+static RTL_CRITICAL_SECTION_DEBUG disk_io_critsect_debug =
+{
+    0, 0, &disk_io_section,
+    { &disk_io_critsect_debug.ProcessLocksList, &disk_io_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": disk_io_section") }
+};
+static RTL_CRITICAL_SECTION disk_io_section = { &disk_io_critsect_debug, -1, 0, 0, 0, 0 };
+
+static DWORD WINAPI init_disk_io_pool( RTL_RUN_ONCE *once, void *param, void **context )
+{
+    TP_POOL *pool;
+
+    if (TpAllocPool( &pool, NULL )) return FALSE;
+    TpSetPoolMaxThreads( pool, MAX_DISK_IO_THREADS );
+    disk_io_environment.Version = 1;
+    disk_io_environment.Pool = pool;
+    return TRUE;
+}
+
+/* keep the file unsignaled while a request without an event is in progress */
+static NTSTATUS set_fd_pending_io( HANDLE handle, BOOL pending )
+{
+    NTSTATUS status;
+
+    SERVER_START_REQ( set_fd_pending_io )
+    {
+        req->handle  = wine_server_obj_handle( handle );
+        req->pending = pending;
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    return status;
+}
+
+static void free_disk_io( struct async_disk_io *io )
+{
+    if (io->fd != -1) close( io->fd );
+    if (io->handle) NtClose( io->handle );
+    if (io->event) NtClose( io->event );
+    RtlFreeHeap( GetProcessHeap(), 0, io );
+}
+
+static void CALLBACK disk_io_callback( TP_CALLBACK_INSTANCE *instance, void *arg )
+{
+    struct async_disk_io *io = arg;
+    NTSTATUS status = STATUS_SUCCESS;
+    ssize_t result = 0;
+    BOOL cancelled;
+
+    /* once started, the request can no longer be cancelled */
+    RtlEnterCriticalSection( &disk_io_section );
+    list_remove( &io->entry );
+    cancelled = io->cancelled;
+    RtlLeaveCriticalSection( &disk_io_section );
+
+    if (cancelled) status = STATUS_CANCELLED;
+    else for (;;)
+    {
+        if (io->write) result = pwrite( io->fd, io->buffer, io->length, io->offset );
+        else result = pread( io->fd, io->buffer, io->length, io->offset );
+        if (result != -1 || errno != EINTR) break;
+    }
+
+    if (result == -1)
+    {
+        if (errno == EFAULT) status = io->write ? STATUS_INVALID_USER_BUFFER : STATUS_ACCESS_VIOLATION;
+        else status = FILE_GetNtStatus();
+        result = 0;
+    }
+    else if (!cancelled && !io->write && !result && io->length) status = STATUS_END_OF_FILE;
+
+    TRACE( "%s %p %u bytes at %s = %x (%u)\n", io->write ? "write" : "read", io->buffer, io->length,
+           wine_dbgstr_longlong( io->offset ), status, (ULONG)result );
+
+    io->iosb->Information = result;
+    io->iosb->u.Status = status;
+    if (io->event) NtSetEvent( io->event, NULL );
+    else set_fd_pending_io( io->handle, FALSE );
+    if (io->cvalue) NTDLL_AddCompletion( io->handle, io->cvalue, status, result, TRUE );
+    free_disk_io( io );
+}
+
+/***********************************************************************
+ *           queue_disk_io
+ *
+ * Start an overlapped read or write at a given offset of a regular file.
+ * The caller keeps ownership of the fd and the handles, copies are made for
+ * the duration of the request. Returns STATUS_PENDING on success.
+ */
+static NTSTATUS queue_disk_io( HANDLE handle, int fd, HANDLE event, IO_STATUS_BLOCK *iosb,
+                               ULONG_PTR cvalue, BOOL write, void *buffer, ULONG length, off_t offset )
+{
+    struct async_disk_io *io;
+    NTSTATUS status;
+
+    if ((status = RtlRunOnceExecuteOnce( &disk_io_once, init_disk_io_pool, NULL, NULL )))
+        return status;
+
+    if (!(io = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*io) ))) return STATUS_NO_MEMORY;
+    io->caller = handle;
+    io->tid    = GetCurrentThreadId();
+    io->write  = write;
+    io->buffer = buffer;
+    io->length = length;
+    io->offset = offset;
+    io->iosb   = iosb;
+    io->cvalue = cvalue;
+
+    if ((io->fd = dup( fd )) == -1)
+    {
+        status = FILE_GetNtStatus();
+        goto error;
+    }
+    /* the caller may close its handles as soon as the request has completed */
+    if (event && (status = NtDuplicateObject( NtCurrentProcess(), event, NtCurrentProcess(),
+                                              &io->event, 0, 0, DUPLICATE_SAME_ACCESS )))
+        goto error;
+    if ((cvalue || !event) &&
+        (status = NtDuplicateObject( NtCurrentProcess(), handle, NtCurrentProcess(),
+                                     &io->handle, 0, 0, DUPLICATE_SAME_ACCESS )))
+        goto error;
+
+    if (event) NtResetEvent( event, NULL );
+    else if ((status = set_fd_pending_io( handle, TRUE ))) goto error;
+    iosb->u.Status = STATUS_PENDING;
+    iosb->Information = 0;
+    RtlEnterCriticalSection( &disk_io_section );
+    list_add_tail( &disk_io_queue, &io->entry );
+    if (!(status = TpSimpleTryPost( disk_io_callback, io, &disk_io_environment )))
+    {
+        RtlLeaveCriticalSection( &disk_io_section );
+        return STATUS_PENDING;
+    }
+    list_remove( &io->entry );
+    RtlLeaveCriticalSection( &disk_io_section );
+    if (!event) set_fd_pending_io( handle, FALSE );
+
+error:
+    free_disk_io( io );
+    return status;
+}
+
+/***********************************************************************
+ *           cancel_disk_io
+ *
+ * Cancel the pool requests of a file that have not been started yet,
+ * optionally only those of the current thread or of a given iosb. They
+ * are still completed by the pool, with STATUS_CANCELLED.
+ */
+static BOOL cancel_disk_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread )
+{
+    struct async_disk_io *io;
+    BOOL found = FALSE;
+
+    RtlEnterCriticalSection( &disk_io_section );
+    LIST_FOR_EACH_ENTRY( io, &disk_io_queue, struct async_disk_io, entry )
+    {
+        if (io->caller != handle || io->cancelled) continue;
+        if (only_thread && io->tid != GetCurrentThreadId()) continue;
+        if (iosb && io->iosb != iosb) continue;
+        io->cancelled = TRUE;
+        found = TRUE;
+    }
+    RtlLeaveCriticalSection( &disk_io_section );
+    return found;
+}
+
+/* check if a synchronously completed request should not be queued to the completion port */
+static inline BOOL skip_completion( HANDLE handle, NTSTATUS status )
+{
+    return status == STATUS_SUCCESS &&
+           (server_get_fd_comp_flags( handle ) & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS);
+}
+
+/* check if an overlapped request can be handled by the disk I/O thread pool */
+static inline BOOL use_disk_io_pool( PIO_APC_ROUTINE apc )
+{
+    /* APCs have to be queued to the calling thread */
+    return !apc;
+}
+
+
 /******************************************************************************
  *  NtReadFile					[NTDLL.@]
  *  ZwReadFile					[NTDLL.@]
@@ -622,7 +830,12 @@ NTSTATUS WINAPI NtReadFile(HANDLE hFile, HANDLE hEvent,
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
-            /* async I/O doesn't make sense on regular files */
+            if (async_read && use_disk_io_pool( apc ) &&
+                (status = queue_disk_io( hFile, unix_handle, hEvent, io_status, cvalue, FALSE,
+                                         buffer, length, offset->QuadPart )) == STATUS_PENDING)
+                goto err;
+
+            /* otherwise complete the read synchronously */
             while ((result = pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
                 if (errno != EINTR)
@@ -780,7 +993,8 @@ err:
         if (status != STATUS_PENDING && hEvent) NtResetEvent( hEvent, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total );
+    if (send_completion && !skip_completion( hFile, status ))
+        NTDLL_AddCompletion( hFile, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -867,7 +1081,8 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         if (status != STATUS_PENDING && event) NtResetEvent( event, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total );
+    if (send_completion && !skip_completion( file, status ))
+        NTDLL_AddCompletion( file, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -1034,7 +1249,14 @@ NTSTATUS WINAPI NtWriteFile(HANDLE hFile, HANDLE hEvent,
                 goto done;
             }
 
-            /* async I/O doesn't make sense on regular files */
+            /* appends are not queued, the end of file could move before they run */
+            if (async_write && offset->QuadPart != FILE_WRITE_TO_END_OF_FILE &&
+                use_disk_io_pool( apc ) &&
+                (status = queue_disk_io( hFile, unix_handle, hEvent, io_status, cvalue, TRUE,
+                                         (void *)buffer, length, off )) == STATUS_PENDING)
+                goto err;
+
+            /* otherwise complete the write synchronously */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
                 if (errno != EINTR)
@@ -1182,7 +1404,8 @@ err:
         if (status != STATUS_PENDING && hEvent) NtResetEvent( hEvent, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total );
+    if (send_completion && !skip_completion( hFile, status ))
+        NTDLL_AddCompletion( hFile, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -1274,7 +1497,8 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         if (status != STATUS_PENDING && event) NtResetEvent( event, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total );
+    if (send_completion && !skip_completion( file, status ))
+        NTDLL_AddCompletion( file, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -1999,7 +2223,7 @@ NTSTATUS WINAPI NtQueryInformationFile( HANDLE hFile, PIO_STATUS_BLOCK io,
         0,                                             /* FileIdFullDirectoryInformation */
         0,                                             /* FileValidDataLengthInformation */
         0,                                             /* FileShortNameInformation */
-        0,
+        0,                                             /* FileIoCompletionNotificationInformation */
         0,
         0,
         0,                                             /* FileSfioReserveInformation */
@@ -2349,6 +2573,28 @@ NTSTATUS WINAPI NtSetInformationFile(HANDLE handle, PIO_STATUS_BLOCK io,
             io->u.Status = STATUS_INVALID_PARAMETER_3;
         break;
 
+    case FileIoCompletionNotificationInformation:
+        if (len >= sizeof(FILE_IO_COMPLETION_NOTIFICATION_INFORMATION))
+        {
+            FILE_IO_COMPLETION_NOTIFICATION_INFORMATION *info = ptr;
+
+            if (info->Flags & ~(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE))
+            {
+                io->u.Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+            SERVER_START_REQ( set_fd_completion_mode )
+            {
+                req->handle   = wine_server_obj_handle( handle );
+                req->flags    = info->Flags;
+                io->u.Status  = wine_server_call( req );
+            }
+            SERVER_END_REQ;
+            if (!io->u.Status) server_set_fd_comp_flags( handle, info->Flags );
+        } else
+            io->u.Status = STATUS_INFO_LENGTH_MISMATCH;
+        break;
+
     case FileAllInformation:
         io->u.Status = STATUS_INVALID_INFO_CLASS;
         break;
@@ -3076,6 +3322,8 @@ NTSTATUS WINAPI NtCancelIoFileEx( HANDLE hFile, PIO_STATUS_BLOCK iosb, PIO_STATU
         io_status->u.Status = wine_server_call( req );
     }
     SERVER_END_REQ;
+    if (cancel_disk_io( hFile, iosb, FALSE ) && io_status->u.Status == STATUS_NOT_FOUND)
+        io_status->u.Status = STATUS_SUCCESS;
     if (io_status->u.Status)
         return io_status->u.Status;
 
@@ -3108,6 +3356,7 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE hFile, PIO_STATUS_BLOCK io_status )
         io_status->u.Status = wine_server_call( req );
     }
     SERVER_END_REQ;
+    cancel_disk_io( hFile, NULL, TRUE );
     if (io_status->u.Status)
         return io_status->u.Status;
 
@@ -84,6 +84,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_CACHED_MAGIC     0x484c46
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -159,6 +160,7 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    struct lfh_slot *lfh;           /* Low-fragmentation front end slots, if enabled */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -167,6 +169,47 @@ typedef struct tagHEAP
 #define COMMIT_MASK          0xffff  /* bitmask for commit/decommit granularity */
 #define MAX_FREE_PENDING     1024    /* max number of free requests to delay */
 
+/* Low-fragmentation front end: small blocks are recycled through per-size class
+ * magazines without taking the heap critical section. Each thread is mapped to
+ * one of several slots of magazines based on its id, so that threads don't
+ * compete for the same slot. */
+#define LFH_MAX_SIZE         0x400   /* max size of blocks handled by the front end */
+#define LFH_NB_CLASSES       (LFH_MAX_SIZE / ALIGNMENT)
+#define LFH_NB_SLOTS         16      /* number of per-thread slots */
+#define LFH_DEPTH            16      /* max number of blocks in a magazine */
+#define LFH_BATCH            (LFH_DEPTH / 2)  /* number of blocks to refill or flush at once */
+#define LFH_NB_RANGES        64      /* max number of subheaps indexed for lock-free lookups */
+
+struct lfh_magazine
+{
+    ULONG                 count;                /* number of blocks in the magazine */
+    ARENA_INUSE          *blocks[LFH_DEPTH];    /* cached blocks */
+};
+
+struct lfh_slot
+{
+    int                   lock;                 /* owner flag, the slot is never waited upon */
+    struct lfh_magazine   classes[LFH_NB_CLASSES];
+};
+
+/* Subheap ranges, stored after the slots, so that freed blocks can be checked
+ * without taking the heap lock. The ranges are only modified with the lock held;
+ * readers give up if they see a modification in progress. */
+struct lfh_ranges
+{
+    LONG                  seq;                  /* odd while the ranges are being modified */
+    ULONG                 count;                /* number of ranges, > LFH_NB_RANGES on overflow */
+    struct
+    {
+        const char       *start;                /* first byte after the subheap header */
+        const char       *end;                  /* end of the subheap */
+    } ranges[LFH_NB_RANGES];
+};
+
+/* heap flags that prevent the front end from being used */
+#define HEAP_LFH_INCOMPATIBLE (HEAP_NO_SERIALIZE | HEAP_TAIL_CHECKING_ENABLED | \
+                               HEAP_FREE_CHECKING_ENABLED | HEAP_VALIDATE)
+
 /* some undocumented flags (names are made up) */
 #define HEAP_PAGE_ALLOCS      0x01000000
 #define HEAP_VALIDATE         0x10000000
@@ -290,7 +333,8 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_CACHED_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -484,6 +528,79 @@ static inline void HEAP_InsertFreeBlock( HEAP *heap, ARENA_FREE *pArena, BOOL la
 }
 
 
+static inline struct lfh_ranges *lfh_get_ranges( const HEAP *heap )
+{
+    return (struct lfh_ranges *)(heap->lfh + LFH_NB_SLOTS);
+}
+
+/***********************************************************************
+ *           lfh_add_range
+ *
+ * Add a subheap to the front end ranges. The heap lock must be held.
+ */
+static void lfh_add_range( HEAP *heap, const SUBHEAP *subheap )
+{
+    struct lfh_ranges *index;
+
+    if (!heap->lfh) return;
+    index = lfh_get_ranges( heap );
+    interlocked_xchg_add( &index->seq, 1 );
+    if (index->count < LFH_NB_RANGES)
+    {
+        index->ranges[index->count].start = (const char *)subheap->base + subheap->headerSize;
+        index->ranges[index->count].end = (const char *)subheap->base + subheap->size;
+    }
+    index->count++;
+    interlocked_xchg_add( &index->seq, 1 );
+}
+
+/***********************************************************************
+ *           lfh_remove_range
+ *
+ * Remove a subheap from the front end ranges. The heap lock must be held.
+ */
+static void lfh_remove_range( HEAP *heap, const SUBHEAP *subheap )
+{
+    const char *start = (const char *)subheap->base + subheap->headerSize;
+    struct lfh_ranges *index;
+    ULONG i;
+
+    if (!heap->lfh) return;
+    index = lfh_get_ranges( heap );
+    if (index->count > LFH_NB_RANGES) return;  /* overflowed, lookups always fall back */
+    for (i = 0; i < index->count; i++) if (index->ranges[i].start == start) break;
+    if (i == index->count) return;
+    interlocked_xchg_add( &index->seq, 1 );
+    index->ranges[i] = index->ranges[--index->count];
+    interlocked_xchg_add( &index->seq, 1 );
+}
+
+/***********************************************************************
+ *           lfh_find_range
+ *
+ * Check without locking whether a block is inside one of the subheaps.
+ * Returns FALSE if unsure; callers then fall back to the locked path.
+ */
+static BOOL lfh_find_range( const HEAP *heap, const ARENA_INUSE *arena )
+{
+    struct lfh_ranges *index = lfh_get_ranges( heap );
+    const char *ptr = (const char *)arena;
+    ULONG i, count;
+    BOOL ret = FALSE;
+    LONG seq;
+
+    if ((seq = interlocked_cmpxchg( &index->seq, 0, 0 )) & 1) return FALSE;
+    count = index->count;
+    if (count > LFH_NB_RANGES) count = LFH_NB_RANGES;
+    for (i = 0; i < count; i++)
+    {
+        if (ptr < index->ranges[i].start || ptr >= index->ranges[i].end - sizeof(*arena)) continue;
+        ret = TRUE;
+        break;
+    }
+    return ret && interlocked_cmpxchg( &index->seq, 0, 0 ) == seq;
+}
+
 /***********************************************************************
  *           HEAP_FindSubHeap
  * Find the sub-heap containing a given address.
@@ -670,6 +787,7 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
         list_remove( &pFree->entry );
         /* Remove the subheap from the list */
         list_remove( &subheap->entry );
+        lfh_remove_range( subheap->heap, subheap );
         /* Free the memory */
         subheap->magic = 0;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -906,6 +1024,7 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         subheap->magic      = SUBHEAP_MAGIC;
         subheap->headerSize = ROUND_SIZE( sizeof(SUBHEAP) );
         list_add_head( &heap->subheap_list, &subheap->entry );
+        lfh_add_range( heap, subheap );
     }
     else
     {
@@ -1204,7 +1323,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_CACHED_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1419,7 +1539,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_CACHED_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1437,6 +1557,164 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
 }
 
 
+/***********************************************************************
+ *           allocate_block
+ *
+ * Find a free block of the given size and turn it into an in-use block.
+ * Must be called with the heap locked.
+ */
+static ARENA_INUSE *allocate_block( HEAP *heap, SIZE_T rounded_size )
+{
+    ARENA_FREE *pArena;
+    ARENA_INUSE *pInUse;
+    SUBHEAP *subheap;
+
+    if (!(pArena = HEAP_FindFreeBlock( heap, rounded_size, &subheap ))) return NULL;
+
+    /* Remove the arena from the free list */
+
+    list_remove( &pArena->entry );
+
+    /* Build the in-use arena */
+
+    pInUse = (ARENA_INUSE *)pArena;
+
+    /* in-use arena is smaller than free arena,
+     * so we have to add the difference to the size */
+    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
+    pInUse->magic = ARENA_INUSE_MAGIC;
+
+    /* Shrink the block */
+
+    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
+    return pInUse;
+}
+
+
+/* size class of a block; blocks of a class are at least as large as the class size */
+static inline unsigned int lfh_get_class( SIZE_T size )
+{
+    return (size - ARENA_OFFSET) / ALIGNMENT;
+}
+
+/***********************************************************************
+ *           lfh_lock_slot
+ *
+ * Grab the front end slot of the current thread, or any other available one.
+ * Returns NULL rather than waiting if all the slots are busy.
+ */
+static struct lfh_slot *lfh_lock_slot( HEAP *heap )
+{
+    unsigned int i, start = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread ) / 4;
+
+    for (i = 0; i < LFH_NB_SLOTS; i++)
+    {
+        struct lfh_slot *slot = &heap->lfh[(start + i) % LFH_NB_SLOTS];
+        if (!slot->lock && !interlocked_cmpxchg( &slot->lock, 1, 0 )) return slot;
+    }
+    return NULL;
+}
+
+static inline void lfh_unlock_slot( struct lfh_slot *slot )
+{
+    interlocked_xchg( &slot->lock, 0 );
+}
+
+/***********************************************************************
+ *           lfh_alloc
+ *
+ * Allocate a small block from the front end magazines, refilling them
+ * from the heap as needed.
+ */
+static ARENA_INUSE *lfh_alloc( HEAP *heap, DWORD flags, SIZE_T size, SIZE_T rounded_size )
+{
+    struct lfh_magazine *magazine;
+    struct lfh_slot *slot;
+    ARENA_INUSE *arena;
+
+    if (rounded_size >= LFH_MAX_SIZE || (flags & HEAP_LFH_INCOMPATIBLE)) return NULL;
+    if (!(slot = lfh_lock_slot( heap ))) return NULL;
+
+    magazine = &slot->classes[lfh_get_class( rounded_size )];
+    if (!magazine->count)
+    {
+        RtlEnterCriticalSection( &heap->critSection );
+        while (magazine->count < LFH_BATCH)
+        {
+            if (!(arena = allocate_block( heap, rounded_size ))) break;
+            arena->magic = ARENA_CACHED_MAGIC;
+            magazine->blocks[magazine->count++] = arena;
+        }
+        RtlLeaveCriticalSection( &heap->critSection );
+        if (!magazine->count)
+        {
+            lfh_unlock_slot( slot );
+            return NULL;
+        }
+    }
+    arena = magazine->blocks[--magazine->count];
+    lfh_unlock_slot( slot );
+
+    arena->magic = ARENA_INUSE_MAGIC;
+    arena->unused_bytes = (arena->size & ARENA_SIZE_MASK) - size;
+    notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( arena + 1, size, arena->unused_bytes, flags );
+    return arena;
+}
+
+/***********************************************************************
+ *           lfh_free
+ *
+ * Return a small block to the front end magazines, flushing them back
+ * to the heap when they are full. The block must belong to one of the
+ * subheaps of the heap; anything else, including large blocks, is left
+ * to RtlFreeHeap for the usual error handling.
+ */
+static BOOL lfh_free( HEAP *heap, void *ptr )
+{
+    ARENA_INUSE *arena = (ARENA_INUSE *)ptr - 1;
+    struct lfh_magazine *magazine;
+    struct lfh_slot *slot;
+    SUBHEAP *subheap;
+    unsigned int i;
+
+    if (heap->flags & HEAP_LFH_INCOMPATIBLE) return FALSE;
+    if (!(slot = lfh_lock_slot( heap ))) return FALSE;
+
+    /* the range lookup must be done before looking at the arena */
+    if (!lfh_find_range( heap, arena ) ||
+        (ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET ||
+        arena->magic != ARENA_INUSE_MAGIC ||
+        (arena->size & ARENA_FLAG_FREE) ||
+        (arena->size & ARENA_SIZE_MASK) >= LFH_MAX_SIZE)
+    {
+        lfh_unlock_slot( slot );
+        return FALSE;
+    }
+
+    magazine = &slot->classes[lfh_get_class( arena->size & ARENA_SIZE_MASK )];
+    if (magazine->count == LFH_DEPTH)
+    {
+        RtlEnterCriticalSection( &heap->critSection );
+        for (i = 0; i < LFH_BATCH; i++)
+        {
+            ARENA_INUSE *block = magazine->blocks[i];
+            block->magic = ARENA_INUSE_MAGIC;
+            if ((subheap = HEAP_FindSubHeap( heap, block ))) HEAP_MakeInUseBlockFree( subheap, block );
+            else ERR( "Heap %p: cached block %p is not inside heap\n", heap, block + 1 );
+        }
+        magazine->count -= LFH_BATCH;
+        memmove( magazine->blocks, magazine->blocks + LFH_BATCH, magazine->count * sizeof(*magazine->blocks) );
+        RtlLeaveCriticalSection( &heap->critSection );
+    }
+    notify_free( ptr );
+    arena->magic = ARENA_CACHED_MAGIC;
+    magazine->blocks[magazine->count++] = arena;
+    lfh_unlock_slot( slot );
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           heap_set_debug_flags
  */
@@ -1628,6 +1906,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lfh)
+    {
+        size = 0;
+        addr = heapPtr->lfh;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1654,9 +1938,7 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
  */
 PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 {
-    ARENA_FREE *pArena;
     ARENA_INUSE *pInUse;
-    SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
     SIZE_T rounded_size;
 
@@ -1673,6 +1955,12 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh && (pInUse = lfh_alloc( heapPtr, flags, size, rounded_size )))
+    {
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
+        return pInUse + 1;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1686,7 +1974,7 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 
     /* Locate a suitable free block */
 
-    if (!(pArena = HEAP_FindFreeBlock( heapPtr, rounded_size, &subheap )))
+    if (!(pInUse = allocate_block( heapPtr, rounded_size )))
     {
         TRACE("(%p,%08x,%08lx): returning NULL\n",
                   heap, flags, size  );
@@ -1695,22 +1983,6 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
         return NULL;
     }
 
-    /* Remove the arena from the free list */
-
-    list_remove( &pArena->entry );
-
-    /* Build the in-use arena */
-
-    pInUse = (ARENA_INUSE *)pArena;
-
-    /* in-use arena is smaller than free arena,
-     * so we have to add the difference to the size */
-    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
-    pInUse->magic = ARENA_INUSE_MAGIC;
-
-    /* Shrink the block */
-
-    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
     pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
@@ -1754,6 +2026,12 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
         return FALSE;
     }
 
+    if (heapPtr->lfh && lfh_free( heapPtr, ptr ))
+    {
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
@@ -2123,7 +2401,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_CACHED_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2171,7 +2450,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
-        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
+        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC || pArena->magic == ARENA_CACHED_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
         and PROCESS_HEAP_ENTRY_DDESHARE yet */
@@ -2236,6 +2515,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2244,7 +2525,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        heapPtr = HEAP_GetPtr( heap );
+        *(ULONG *)info = (heapPtr && heapPtr->lfh) ? 2 /* LFH */ : 0 /* standard heap */;
         return STATUS_SUCCESS;
 
     default:
@@ -2252,3 +2534,70 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         return STATUS_INVALID_INFO_CLASS;
     }
 }
+
+/***********************************************************************
+ *           RtlSetHeapInformation    (NTDLL.@)
+ */
+NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
+                                       PVOID info, SIZE_T size )
+{
+    HEAP *heapPtr;
+    void *ptr = NULL;
+    SIZE_T lfh_size = LFH_NB_SLOTS * sizeof(struct lfh_slot) + sizeof(struct lfh_ranges);
+    SUBHEAP *subheap;
+    NTSTATUS status;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case 0:  /* standard heap, LFH cannot be turned off again */
+            return heapPtr->lfh ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2:  /* low-fragmentation heap */
+            if (heapPtr->lfh) return STATUS_SUCCESS;
+            if ((heapPtr->flags & HEAP_LFH_INCOMPATIBLE) || RUNNING_ON_VALGRIND) return STATUS_UNSUCCESSFUL;
+            if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 4, &lfh_size,
+                                                   MEM_COMMIT, PAGE_READWRITE )))
+                return status;
+            RtlEnterCriticalSection( &heapPtr->critSection );
+            if (!heapPtr->lfh)
+            {
+                struct lfh_ranges *index = (struct lfh_ranges *)((struct lfh_slot *)ptr + LFH_NB_SLOTS);
+
+                LIST_FOR_EACH_ENTRY( subheap, &heapPtr->subheap_list, SUBHEAP, entry )
+                {
+                    if (index->count < LFH_NB_RANGES)
+                    {
+                        index->ranges[index->count].start = (const char *)subheap->base + subheap->headerSize;
+                        index->ranges[index->count].end = (const char *)subheap->base + subheap->size;
+                    }
+                    index->count++;
+                }
+                interlocked_xchg_ptr( (void **)&heapPtr->lfh, ptr );
+                ptr = NULL;
+            }
+            RtlLeaveCriticalSection( &heapPtr->critSection );
+            if (ptr)
+            {
+                lfh_size = 0;
+                NtFreeVirtualMemory( NtCurrentProcess(), &ptr, &lfh_size, MEM_RELEASE );
+            }
+            TRACE( "enabled LFH for heap %p\n", heap );
+            return STATUS_SUCCESS;
+        default:  /* look-aside lists are no longer supported */
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    case HeapEnableTerminationOnCorruption:
+        FIXME("HeapEnableTerminationOnCorruption not supported\n");
+        return STATUS_SUCCESS;
+
+    default:
+        FIXME("Unknown heap information class %u\n", info_class);
+        return STATUS_SUCCESS;
+    }
+}
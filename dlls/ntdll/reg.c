@@ -678,6 +678,9 @@ NTSTATUS WINAPI NtNotifyChangeKey(
 /******************************************************************************
  * NtQueryMultipleValueKey [NTDLL]
  * ZwQueryMultipleValueKey
+ *
+ * The values are retrieved with batched server calls, one to get their
+ * sizes and one to fetch the data directly into the caller's buffer.
  */
 
 NTSTATUS WINAPI NtQueryMultipleValueKey(
@@ -688,10 +691,82 @@ NTSTATUS WINAPI NtQueryMultipleValueKey(
 	ULONG Length,
 	PULONG  ReturnLength)
 {
-	FIXME("(%p,%p,0x%08x,%p,0x%08x,%p) stub!\n",
-	KeyHandle, ListOfValuesToQuery, NumberOfItems, MultipleValueInformation,
-	Length,ReturnLength);
-	return STATUS_SUCCESS;
+    struct __server_request_info *reqs;
+    void **req_ptrs;
+    NTSTATUS ret;
+    ULONG i, total;
+    BOOL changed;
+
+    TRACE( "(%p,%p,0x%08x,%p,0x%08x,%p)\n", KeyHandle, ListOfValuesToQuery, NumberOfItems,
+           MultipleValueInformation, Length, ReturnLength );
+
+    for (i = 0; i < NumberOfItems; i++)
+        if (ListOfValuesToQuery[i].ValueName->Length > MAX_VALUE_LENGTH)
+            return STATUS_OBJECT_NAME_NOT_FOUND;
+
+    if (!(reqs = RtlAllocateHeap( GetProcessHeap(), 0,
+                                  NumberOfItems * (sizeof(*reqs) + sizeof(*req_ptrs)) )))
+        return STATUS_NO_MEMORY;
+    req_ptrs = (void **)(reqs + NumberOfItems);
+
+    do
+    {
+        /* first get the size of all the values */
+        for (i = 0; i < NumberOfItems; i++)
+        {
+            memset( &reqs[i].u.req, 0, sizeof(reqs[i].u.req) );
+            reqs[i].u.req.request_header.req = REQ_get_key_value;
+            reqs[i].u.req.get_key_value_request.hkey = wine_server_obj_handle( KeyHandle );
+            reqs[i].data_count = 0;
+            wine_server_add_data( &reqs[i], ListOfValuesToQuery[i].ValueName->Buffer,
+                                  ListOfValuesToQuery[i].ValueName->Length );
+            wine_server_set_reply( &reqs[i], NULL, 0 );
+            req_ptrs[i] = &reqs[i];
+        }
+        if ((ret = wine_server_call_batch( req_ptrs, NumberOfItems ))) break;
+
+        for (i = total = 0; i < NumberOfItems; i++)
+        {
+            if ((ret = reqs[i].u.reply.reply_header.error)) break;
+            ListOfValuesToQuery[i].Type       = reqs[i].u.reply.get_key_value_reply.type;
+            ListOfValuesToQuery[i].DataLength = reqs[i].u.reply.get_key_value_reply.total;
+            ListOfValuesToQuery[i].DataOffset = total;
+            total += ListOfValuesToQuery[i].DataLength;
+        }
+        if (ret) break;
+        if (ReturnLength) *ReturnLength = total;
+        if (total > Length)
+        {
+            ret = STATUS_BUFFER_OVERFLOW;
+            break;
+        }
+
+        /* then fetch the data in place, unless a value has changed in the meantime */
+        for (i = 0; i < NumberOfItems; i++)
+        {
+            memset( &reqs[i].u.req, 0, sizeof(reqs[i].u.req) );
+            reqs[i].u.req.request_header.req = REQ_get_key_value;
+            reqs[i].u.req.get_key_value_request.hkey = wine_server_obj_handle( KeyHandle );
+            reqs[i].data_count = 0;
+            wine_server_add_data( &reqs[i], ListOfValuesToQuery[i].ValueName->Buffer,
+                                  ListOfValuesToQuery[i].ValueName->Length );
+            wine_server_set_reply( &reqs[i], (char *)MultipleValueInformation +
+                                   ListOfValuesToQuery[i].DataOffset,
+                                   ListOfValuesToQuery[i].DataLength );
+        }
+        if ((ret = wine_server_call_batch( req_ptrs, NumberOfItems ))) break;
+
+        for (i = 0, changed = FALSE; i < NumberOfItems; i++)
+        {
+            if ((ret = reqs[i].u.reply.reply_header.error)) break;
+            if (reqs[i].u.reply.get_key_value_reply.total != ListOfValuesToQuery[i].DataLength)
+                changed = TRUE;
+            ListOfValuesToQuery[i].Type = reqs[i].u.reply.get_key_value_reply.type;
+        }
+    } while (!ret && changed);
+
+    RtlFreeHeap( GetProcessHeap(), 0, reqs );
+    return ret;
 }
 
 /******************************************************************************
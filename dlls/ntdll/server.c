@@ -298,6 +298,81 @@ unsigned int wine_server_call( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           wine_server_call_batch (NTDLL.@)
+ *
+ * Perform several independent server calls in a single round trip.
+ *
+ * PARAMS
+ *     req_ptrs [I/O] Array of requests, prepared like for wine_server_call
+ *     count    [I]   Number of requests
+ *
+ * RETURNS
+ *     The status of the batch itself. The status of each request is
+ *     stored in its reply header, requests that couldn't be executed
+ *     get the status of the batch, or STATUS_INTERNAL_ERROR.
+ */
+unsigned int wine_server_call_batch( void **req_ptrs, unsigned int count )
+{
+    struct __server_request_info *req;
+    data_size_t req_size = 0, reply_size = 0, size, pos;
+    unsigned int i, j, done = 0, ret;
+    char *buffer, *ptr;
+
+    for (i = 0; i < count; i++)
+    {
+        req = req_ptrs[i];
+        req_size += sizeof(req->u.req) + ((req->u.req.request_header.request_size + 7) & ~7);
+        reply_size += sizeof(req->u.reply) + ((req->u.req.request_header.reply_size + 7) & ~7);
+    }
+    if (!(buffer = RtlAllocateHeap( GetProcessHeap(), 0, max( req_size, reply_size ))))
+        return STATUS_NO_MEMORY;
+
+    for (i = 0, ptr = buffer; i < count; i++)
+    {
+        req = req_ptrs[i];
+        memcpy( ptr, &req->u.req, sizeof(req->u.req) );
+        ptr += sizeof(req->u.req);
+        for (j = 0, size = 0; j < req->data_count; j++)
+        {
+            memcpy( ptr + size, req->data[j].ptr, req->data[j].size );
+            size += req->data[j].size;
+        }
+        memset( ptr + size, 0, -size & 7 );
+        ptr += (size + 7) & ~7;
+    }
+
+    SERVER_START_REQ( batch )
+    {
+        wine_server_add_data( req, buffer, req_size );
+        wine_server_set_reply( req, buffer, reply_size );
+        ret = wine_server_call( req );
+        done = reply->count;
+    }
+    SERVER_END_REQ;
+
+    for (i = 0, pos = 0; i < count; i++)
+    {
+        req = req_ptrs[i];
+        if (i < done)
+        {
+            memcpy( &req->u.reply, buffer + pos, sizeof(req->u.reply) );
+            pos += sizeof(req->u.reply);
+            size = req->u.reply.reply_header.reply_size;
+            if (size) memcpy( req->reply_data, buffer + pos, size );
+            pos += (size + 7) & ~7;
+        }
+        else
+        {
+            memset( &req->u.reply, 0, sizeof(req->u.reply) );
+            req->u.reply.reply_header.error = ret ? ret : STATUS_INTERNAL_ERROR;
+        }
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, buffer );
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -793,6 +868,7 @@ struct fd_cache_entry
     enum server_fd_type type : 5;
     unsigned int        access : 3;
     unsigned int        options : 24;
+    unsigned int        comp_flags : 2;
 };
 
 #define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(struct fd_cache_entry))
@@ -815,7 +891,7 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
  * Caller must hold fd_cache_section.
  */
 static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
-                            unsigned int access, unsigned int options )
+                            unsigned int access, unsigned int options, unsigned int comp_flags )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
     int prev_fd;
@@ -842,6 +918,7 @@ static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
     fd_cache[entry][idx].type = type;
     fd_cache[entry][idx].access = access;
     fd_cache[entry][idx].options = options;
+    fd_cache[entry][idx].comp_flags = comp_flags;
     if (prev_fd != -1) close( prev_fd );
     return TRUE;
 }
@@ -884,6 +961,38 @@ int server_remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************
+ *           server_get_fd_comp_flags
+ *
+ * Return the FILE_SKIP_* completion notification flags of a cached fd.
+ */
+unsigned int server_get_fd_comp_flags( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && fd_cache[entry] && fd_cache[entry][idx].fd)
+        return fd_cache[entry][idx].comp_flags;
+    return 0;
+}
+
+
+/***********************************************************************
+ *           server_set_fd_comp_flags
+ *
+ * Record the completion notification flags set on the file of a cached fd.
+ */
+void server_set_fd_comp_flags( HANDLE handle, unsigned int flags )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    if (entry < FD_CACHE_ENTRIES && fd_cache[entry] && fd_cache[entry][idx].fd)
+        fd_cache[entry][idx].comp_flags |= flags;
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -918,8 +1027,8 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
             {
                 assert( wine_server_ptr_handle(fd_handle) == handle );
                 *needs_close = (!reply->cacheable ||
-                                !add_fd_to_cache( handle, fd, reply->type,
-                                                  reply->access, reply->options ));
+                                !add_fd_to_cache( handle, fd, reply->type, reply->access,
+                                                  reply->options, reply->comp_flags ));
             }
             else ret = STATUS_TOO_MANY_OPENED_FILES;
         }
@@ -1016,6 +1125,26 @@ void CDECL wine_server_release_fd( HANDLE handle, int unix_fd )
 }
 
 
+/***********************************************************************
+ *           wine_server_uncache_fd   (NTDLL.@)
+ *
+ * Drop the Unix file descriptor cached for a handle, for objects whose
+ * file descriptor was replaced by the server.
+ *
+ * PARAMS
+ *     handle  [I] Wine file handle.
+ *
+ * RETURNS
+ *     nothing
+ */
+void CDECL wine_server_uncache_fd( HANDLE handle )
+{
+    int fd = server_remove_fd_from_cache( handle );
+
+    if (fd != -1) close( fd );
+}
+
+
 /***********************************************************************
  *           server_pipe
  *
@@ -26,10 +26,19 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
+#include <sys/stat.h>
 #ifdef HAVE_POLL_H
 #include <poll.h>
 #endif
@@ -56,6 +65,7 @@
 #include "windef.h"
 #include "winternl.h"
 #include "wine/server.h"
+#include "wine/library.h"
 #include "wine/debug.h"
 #include "ntdll_misc.h"
 
@@ -144,6 +154,349 @@ void NTDLL_free_struct_sd(struct security_descriptor *server_sd)
     RtlFreeHeap(GetProcessHeap(), 0, server_sd);
 }
 
+/*
+ *	Shared memory synchronization
+ *
+ * When the server runs with WINESHMSYNC set, the state of events, mutexes and
+ * semaphores lives in a region shared with the server, so that they can be
+ * signaled and waited upon without a server call when there is no contention.
+ */
+
+#define TICKSPERSEC 10000000
+
+#ifdef __linux__
+
+static int shm_sync_enabled = -1;
+
+static inline int shared_futex_wait( int *addr, int val, struct timespec *timeout )
+{
+    return syscall( __NR_futex, addr, 0 /* FUTEX_WAIT */, val, timeout, 0, 0 );
+}
+
+static inline int shared_futex_wake( int *addr, int val )
+{
+    return syscall( __NR_futex, addr, 1 /* FUTEX_WAKE */, val, NULL, 0, 0 );
+}
+
+#else
+
+static int shm_sync_enabled = 0;
+
+static inline int shared_futex_wait( int *addr, int val, struct timespec *timeout )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+static inline int shared_futex_wake( int *addr, int val )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+struct shm_sync_cache_entry
+{
+    unsigned int index;       /* index in the shared region, 0 if not cached yet */
+    unsigned int access;      /* access rights of the handle */
+    unsigned int generation;  /* generation of the object slot */
+    unsigned int epoch;       /* generation of the reserved slot when the entry was cached */
+};
+
+#define SHM_SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(struct shm_sync_cache_entry))
+#define SHM_SYNC_CACHE_ENTRIES     256
+#define SHM_SYNC_NO_OBJECT         ~0u  /* index cached for handles to other objects */
+
+static struct shm_sync_object *shm_sync_region;  /* followed by the read-only object information */
+static unsigned int shm_sync_size;
+static struct shm_sync_cache_entry *shm_sync_cache[SHM_SYNC_CACHE_ENTRIES];
+
+static inline unsigned int shm_sync_handle_to_index( obj_handle_t handle, unsigned int *entry )
+{
+    unsigned int idx = (handle >> 2) - 1;
+    *entry = idx / SHM_SYNC_CACHE_BLOCK_SIZE;
+    return idx % SHM_SYNC_CACHE_BLOCK_SIZE;
+}
+
+/* map the region created by the server in the server directory */
+static BOOL map_shm_sync_region(void)
+{
+    static const char name[] = "/sync";
+    const char *dir = wine_get_server_dir();
+    struct stat st;
+    unsigned int size;
+    char *path;
+    void *ptr;
+    int fd;
+
+    if (!dir) return FALSE;
+    if (!(path = RtlAllocateHeap( GetProcessHeap(), 0, strlen(dir) + sizeof(name) ))) return FALSE;
+    strcpy( path, dir );
+    strcat( path, name );
+    fd = open( path, O_RDWR );
+    RtlFreeHeap( GetProcessHeap(), 0, path );
+    if (fd == -1) return FALSE;
+
+    if (fstat( fd, &st ) == -1 ||
+        (ptr = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return FALSE;
+    }
+    close( fd );
+
+    /* the information is only written by the server */
+    size = st.st_size / (sizeof(struct shm_sync_object) + sizeof(struct shm_sync_info));
+    if (mprotect( (struct shm_sync_object *)ptr + size, size * sizeof(struct shm_sync_info), PROT_READ ) == -1)
+    {
+        munmap( ptr, st.st_size );
+        return FALSE;
+    }
+    shm_sync_size = size;
+    if (interlocked_cmpxchg_ptr( (void **)&shm_sync_region, ptr, NULL ))
+        munmap( ptr, st.st_size );  /* another thread mapped it first */
+    return TRUE;
+}
+
+static inline const struct shm_sync_info *get_shm_sync_info( unsigned int index )
+{
+    return (const struct shm_sync_info *)(shm_sync_region + shm_sync_size) + index;
+}
+
+/* check if a cache entry still refers to the object of the handle */
+static inline BOOL shm_sync_cache_valid( const struct shm_sync_cache_entry *cache )
+{
+    if (cache->index == SHM_SYNC_NO_OBJECT || cache->index >= shm_sync_size) return TRUE;
+    /* the slot has been freed, or a handle has been closed from another process */
+    return get_shm_sync_info( cache->index )->generation == cache->generation &&
+           get_shm_sync_info( 0 )->generation == cache->epoch;
+}
+
+/***********************************************************************
+ *           get_shm_sync
+ *
+ * Return the shared state of a synchronization object of the given type
+ * (SHM_SYNC_NONE for any type), or NULL if the operation has to go through
+ * the server. The slot generation is returned in the optional last parameter.
+ * Mutexes also need a slot for the list of mutexes owned by the thread.
+ */
+static struct shm_sync_object *get_shm_sync( HANDLE handle, unsigned int type, ACCESS_MASK access,
+                                             unsigned int *generation )
+{
+    obj_handle_t obj_handle = wine_server_obj_handle( handle );
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    struct shm_sync_cache_entry *block;
+    const struct shm_sync_info *info;
+    unsigned int entry, idx, index, epoch, granted = 0, gen = 0, owner = 0;
+    NTSTATUS ret;
+
+    /* pseudo-handles and console handles can't be shared objects */
+    if (!shm_sync_enabled || !obj_handle || (obj_handle & 3)) return NULL;
+
+    idx = shm_sync_handle_to_index( obj_handle, &entry );
+    if (entry >= SHM_SYNC_CACHE_ENTRIES) return NULL;
+
+    if (!(block = shm_sync_cache[entry]))  /* do we need to allocate a new block of entries? */
+    {
+        block = wine_anon_mmap( NULL, SHM_SYNC_CACHE_BLOCK_SIZE * sizeof(*block), PROT_READ | PROT_WRITE, 0 );
+        if (block == MAP_FAILED) return NULL;
+        if (interlocked_cmpxchg_ptr( (void **)&shm_sync_cache[entry], block, NULL ))
+        {
+            munmap( block, SHM_SYNC_CACHE_BLOCK_SIZE * sizeof(*block) );
+            block = shm_sync_cache[entry];
+        }
+    }
+
+    if (!(index = block[idx].index) || !shm_sync_cache_valid( &block[idx] ) ||
+        (index < shm_sync_size && get_shm_sync_info( index )->type == SHM_SYNC_MUTEX &&
+         !thread_data->shm_sync_slot))
+    {
+        epoch = shm_sync_region ? get_shm_sync_info( 0 )->generation : 0;
+        SERVER_START_REQ( get_shm_sync )
+        {
+            req->handle = obj_handle;
+            ret = wine_server_call( req );
+            index = reply->index;
+            granted = reply->access;
+            gen = reply->generation;
+            owner = reply->owner;
+        }
+        SERVER_END_REQ;
+
+        if (ret == STATUS_NOT_SUPPORTED)
+        {
+            shm_sync_enabled = 0;
+            return NULL;
+        }
+        if (ret == STATUS_OBJECT_TYPE_MISMATCH) index = SHM_SYNC_NO_OBJECT;
+        else if (ret) return NULL;
+        else if (!shm_sync_region)
+        {
+            if (!map_shm_sync_region())
+            {
+                WARN( "cannot map the shared synchronization region\n" );
+                shm_sync_enabled = 0;
+                return NULL;
+            }
+            /* a handle may have been closed after the request, look it up again next time */
+            epoch = get_shm_sync_info( 0 )->generation - 1;
+        }
+        if (owner) thread_data->shm_sync_slot = owner;
+        block[idx].access = granted;
+        block[idx].generation = gen;
+        block[idx].epoch = epoch;
+        block[idx].index = index;
+    }
+
+    if (index == SHM_SYNC_NO_OBJECT || index >= shm_sync_size) return NULL;
+    info = get_shm_sync_info( index );
+    /* let the server report the errors */
+    if ((type && info->type != type) || (block[idx].access & access) != access) return NULL;
+    if (info->type == SHM_SYNC_MUTEX && !thread_data->shm_sync_slot) return NULL;
+    if (generation) *generation = block[idx].generation;
+    return &shm_sync_region[index];
+}
+
+/***********************************************************************
+ *           shm_sync_remove_from_cache
+ */
+void shm_sync_remove_from_cache( HANDLE handle )
+{
+    obj_handle_t obj_handle = wine_server_obj_handle( handle );
+    unsigned int entry, idx;
+
+    if (!obj_handle || (obj_handle & 3)) return;
+    idx = shm_sync_handle_to_index( obj_handle, &entry );
+    if (entry < SHM_SYNC_CACHE_ENTRIES && shm_sync_cache[entry])
+        shm_sync_cache[entry][idx].index = 0;
+}
+
+/* add a mutex acquired by the current thread to its owned list */
+static void shm_sync_link_owned( struct shm_sync_object *sync )
+{
+    unsigned int head = ntdll_get_thread_data()->shm_sync_slot;
+    unsigned int next = shm_sync_region[head].owned_next;
+
+    sync->owned_prev = head;
+    sync->owned_next = next;
+    shm_sync_region[next].owned_prev = sync - shm_sync_region;
+    shm_sync_region[head].owned_next = sync - shm_sync_region;
+}
+
+/* remove a mutex released by the current thread from its owned list */
+static void shm_sync_unlink_owned( struct shm_sync_object *sync )
+{
+    if (!sync->owned_next) return;  /* acquired by the server without a list */
+    shm_sync_region[sync->owned_prev].owned_next = sync->owned_next;
+    shm_sync_region[sync->owned_next].owned_prev = sync->owned_prev;
+    sync->owned_prev = sync->owned_next = 0;
+}
+
+/* wake up the threads waiting for an object after changing its state */
+static void shm_sync_wake( HANDLE handle, struct shm_sync_object *sync )
+{
+    interlocked_xchg_add( &sync->seq, 1 );
+    if (sync->client_waiters) shared_futex_wake( &sync->seq, INT_MAX );
+    if (get_shm_sync_info( sync - shm_sync_region )->server_waiters)
+    {
+        SERVER_START_REQ( wake_shm_sync )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            wine_server_call( req );
+        }
+        SERVER_END_REQ;
+    }
+}
+
+/* try to acquire an object, return STATUS_TIMEOUT if it's not signaled */
+static NTSTATUS shm_sync_try_acquire( struct shm_sync_object *sync )
+{
+    const struct shm_sync_info *info = get_shm_sync_info( sync - shm_sync_region );
+    int tid = GetCurrentThreadId();
+
+    switch (info->type)
+    {
+    case SHM_SYNC_EVENT:
+        if (info->manual_reset ? sync->state : interlocked_cmpxchg( &sync->state, 0, 1 ) == 1)
+            return STATUS_WAIT_0;
+        break;
+    case SHM_SYNC_SEMAPHORE:
+        if (interlocked_dec_if_nonzero( &sync->state )) return STATUS_WAIT_0;
+        break;
+    case SHM_SYNC_MUTEX:
+        if (sync->state == tid)
+        {
+            if (sync->count >= MAXLONG) return STATUS_MUTANT_LIMIT_EXCEEDED;
+            sync->count++;
+            return STATUS_WAIT_0;
+        }
+        if (!sync->state && !interlocked_cmpxchg( &sync->state, tid, 0 ))
+        {
+            sync->count = 1;
+            shm_sync_link_owned( sync );
+            return interlocked_xchg( &sync->abandoned, 0 ) ? STATUS_ABANDONED_WAIT_0 : STATUS_WAIT_0;
+        }
+        break;
+    }
+    return STATUS_TIMEOUT;
+}
+
+/* check if an event has been pulsed since the wait started, and claim the pulse if it's auto-reset */
+static BOOL shm_sync_pulsed( struct shm_sync_object *sync, unsigned int *pulse )
+{
+    const struct shm_sync_info *info = get_shm_sync_info( sync - shm_sync_region );
+    unsigned int current = info->pulse, claimed;
+
+    if (info->type != SHM_SYNC_EVENT || current == *pulse) return FALSE;
+    if (info->manual_reset) return TRUE;
+    /* the count of an auto-reset event is the last pulse that released a thread */
+    *pulse = current;
+    claimed = sync->count;
+    return claimed != current && interlocked_cmpxchg( (int *)&sync->count, current, claimed ) == claimed;
+}
+
+/* wait for a single object without going through the server */
+/* returns STATUS_RETRY if the object has been destroyed in the meantime */
+static NTSTATUS shm_sync_wait( struct shm_sync_object *sync, unsigned int generation,
+                               const LARGE_INTEGER *timeout )
+{
+    const struct shm_sync_info *info = get_shm_sync_info( sync - shm_sync_region );
+    LARGE_INTEGER now, end;
+    struct timespec timespec, *ts = NULL;
+    unsigned int pulse = info->pulse;
+    NTSTATUS ret;
+    int seq;
+
+    if (timeout && timeout->QuadPart != TIMEOUT_INFINITE)
+    {
+        NtQuerySystemTime( &now );
+        end.QuadPart = timeout->QuadPart < 0 ? now.QuadPart - timeout->QuadPart : timeout->QuadPart;
+        ts = &timespec;
+    }
+
+    for (;;)
+    {
+        /* read the futex word before the state, a change after this will wake us up */
+        seq = interlocked_xchg_add( &sync->seq, 0 );
+        if (info->generation != generation) return STATUS_RETRY;
+        if ((ret = shm_sync_try_acquire( sync )) != STATUS_TIMEOUT) return ret;
+        if (shm_sync_pulsed( sync, &pulse )) return STATUS_WAIT_0;
+        if (ts)
+        {
+            NtQuerySystemTime( &now );
+            if (now.QuadPart >= end.QuadPart) return STATUS_TIMEOUT;
+            timespec.tv_sec  = (end.QuadPart - now.QuadPart) / TICKSPERSEC;
+            timespec.tv_nsec = (end.QuadPart - now.QuadPart) % TICKSPERSEC * 100;
+        }
+        /* signals for suspension and system APCs interrupt the futex wait */
+        interlocked_xchg_add( &sync->client_waiters, 1 );
+        /* the server wakes the waiters after bumping the generation of a destroyed object */
+        if (info->generation == generation) shared_futex_wait( &sync->seq, seq, ts );
+        interlocked_xchg_add( &sync->client_waiters, -1 );
+    }
+}
+
 /*
  *	Semaphores
  */
@@ -256,7 +609,25 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
  */
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, PULONG previous )
 {
+    struct shm_sync_object *sync;
     NTSTATUS ret;
+
+    if ((sync = get_shm_sync( handle, SHM_SYNC_SEMAPHORE, SEMAPHORE_MODIFY_STATE, NULL )))
+    {
+        unsigned int current;
+
+        do
+        {
+            current = sync->state;
+            if (current + count < current || current + count > get_shm_sync_info( sync - shm_sync_region )->max)
+                return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+        } while (interlocked_cmpxchg( &sync->state, current + count, current ) != current);
+
+        if (previous) *previous = current;
+        if (!current) shm_sync_wake( handle, sync );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -350,10 +721,17 @@ NTSTATUS WINAPI NtOpenEvent(
  */
 NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 {
+    struct shm_sync_object *sync;
     NTSTATUS ret;
 
     /* FIXME: set NumberOfThreadsReleased */
 
+    if ((sync = get_shm_sync( handle, SHM_SYNC_EVENT, EVENT_MODIFY_STATE, NULL )))
+    {
+        if (!interlocked_xchg( &sync->state, 1 )) shm_sync_wake( handle, sync );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -369,11 +747,18 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
  */
 NTSTATUS WINAPI NtResetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 {
+    struct shm_sync_object *sync;
     NTSTATUS ret;
 
     /* resetting an event can't release any thread... */
     if (NumberOfThreadsReleased) *NumberOfThreadsReleased = 0;
 
+    if ((sync = get_shm_sync( handle, SHM_SYNC_EVENT, EVENT_MODIFY_STATE, NULL )))
+    {
+        interlocked_xchg( &sync->state, 0 );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -530,8 +915,22 @@ NTSTATUS WINAPI NtOpenMutant(OUT HANDLE* MutantHandle,
  */
 NTSTATUS WINAPI NtReleaseMutant( IN HANDLE handle, OUT PLONG prev_count OPTIONAL)
 {
+    struct shm_sync_object *sync;
     NTSTATUS    status;
 
+    if ((sync = get_shm_sync( handle, SHM_SYNC_MUTEX, 0, NULL )))
+    {
+        if (!sync->count || sync->state != GetCurrentThreadId()) return STATUS_MUTANT_NOT_OWNED;
+        if (prev_count) *prev_count = sync->count;
+        if (!--sync->count)
+        {
+            shm_sync_unlink_owned( sync );
+            interlocked_xchg( &sync->state, 0 );
+            shm_sync_wake( handle, sync );
+        }
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( release_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -852,11 +1251,20 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles,
                                           BOOLEAN wait_all, BOOLEAN alertable,
                                           const LARGE_INTEGER *timeout )
 {
+    struct shm_sync_object *sync;
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    unsigned int generation;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    /* alertable waits need the server to deliver user APCs */
+    if (count == 1 && !alertable &&
+        (sync = get_shm_sync( handles[0], SHM_SYNC_NONE, SYNCHRONIZE, &generation )) &&
+        (ret = shm_sync_wait( sync, generation, timeout )) != STATUS_RETRY)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_all ? SELECT_WAIT_ALL : SELECT_WAIT;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1164,6 +1572,83 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve up to count completion messages from completion object's queue
+ *
+ * PARAMS
+ *      port      [I] HANDLE to I/O completion object
+ *      info      [O] array receiving the completion messages
+ *      count     [I] size of the info array
+ *      written   [O] number of messages actually retrieved
+ *      timeout   [I] optional wait time in NTDLL format
+ *      alertable [I] whether the wait is alertable
+ *
+ * NOTES
+ *  Packets are dequeued in chunks, so a single server round trip can drain
+ *  many completions at once.
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE port, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                        ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    completion_msg_t msgs[32];
+    LARGE_INTEGER deadline;
+    NTSTATUS status;
+    ULONG i = 0, j, n;
+
+    TRACE( "(%p %p %u %p %p %u)\n", port, info, count, written, timeout, alertable );
+
+    /* another thread may take the packet we were woken up for, so make sure
+     * that waiting again doesn't extend a relative timeout */
+    if (timeout && timeout->QuadPart < 0)
+    {
+        NtQuerySystemTime( &deadline );
+        deadline.QuadPart -= timeout->QuadPart;
+        timeout = &deadline;
+    }
+
+    for (;;)
+    {
+        while (i < count)
+        {
+            n = min( count - i, sizeof(msgs) / sizeof(msgs[0]) );
+            SERVER_START_REQ( remove_completions )
+            {
+                req->handle = wine_server_obj_handle( port );
+                wine_server_set_reply( req, msgs, n * sizeof(msgs[0]) );
+                if (!(status = wine_server_call( req )))
+                    n = wine_server_reply_size( reply ) / sizeof(msgs[0]);
+            }
+            SERVER_END_REQ;
+            if (status) break;
+
+            for (j = 0; j < n; j++, i++)
+            {
+                info[i].CompletionKey             = msgs[j].ckey;
+                info[i].CompletionValue           = msgs[j].cvalue;
+                info[i].IoStatusBlock.Information = msgs[j].information;
+                info[i].IoStatusBlock.u.Status    = msgs[j].status;
+            }
+            if (n < sizeof(msgs) / sizeof(msgs[0])) break;  /* queue drained */
+        }
+
+        if (i)
+        {
+            status = STATUS_SUCCESS;
+            break;
+        }
+        if (status != STATUS_PENDING) break;
+
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != STATUS_WAIT_0) break;
+    }
+
+    *written = i ? i : 1;
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
@@ -1251,7 +1736,7 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE CompletionPort, IO_COMPLETION_INFORM
 }
 
 NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                              NTSTATUS CompletionStatus, ULONG Information )
+                              NTSTATUS CompletionStatus, ULONG Information, BOOL async )
 {
     NTSTATUS status;
 
@@ -1261,6 +1746,7 @@ NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         status = wine_server_call( req );
     }
     SERVER_END_REQ;
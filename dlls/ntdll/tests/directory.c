@@ -324,6 +324,82 @@ static void test_redirection(void)
     pRtlWow64EnableFsRedirectionEx( old, &cur );
 }
 
+static void test_case_insensitive_lookup(void)
+{
+    static const int count = 200;
+    char tmpdir[MAX_PATH], testdir[MAX_PATH + 16], path[MAX_PATH + 48], oldpath[MAX_PATH + 48];
+    DWORD attrs, start;
+    HANDLE file;
+    BOOL ret;
+    int i;
+
+    GetTempPathA(MAX_PATH, tmpdir);
+    sprintf(testdir, "%sCaseLookupTest", tmpdir);
+    ret = CreateDirectoryA(testdir, NULL);
+    ok(ret, "couldn't create dir '%s', error %d\n", testdir, GetLastError());
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf(path, "%s\\file%u.txt", testdir, i);
+        file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0);
+        ok(file != INVALID_HANDLE_VALUE, "failed to create %s, error %u\n", path, GetLastError());
+        CloseHandle(file);
+    }
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        sprintf(path, "%s\\FILE%u.TXT", testdir, i);
+        attrs = GetFileAttributesA(path);
+        ok(attrs != INVALID_FILE_ATTRIBUTES, "%s not found, error %u\n", path, GetLastError());
+        sprintf(path, "%s\\File%u.Bak", testdir, i);
+        attrs = GetFileAttributesA(path);
+        ok(attrs == INVALID_FILE_ATTRIBUTES, "%s found\n", path);
+    }
+    if (winetest_debug > 1)
+        trace("%u case-insensitive lookups in a directory of %u files: %u ms\n",
+              2 * count, count, GetTickCount() - start);
+
+    /* changes to the directory must be seen right away */
+    sprintf(path, "%s\\newfile.txt", testdir);
+    file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0);
+    ok(file != INVALID_HANDLE_VALUE, "failed to create %s, error %u\n", path, GetLastError());
+    CloseHandle(file);
+    sprintf(path, "%s\\NEWFILE.TXT", testdir);
+    attrs = GetFileAttributesA(path);
+    ok(attrs != INVALID_FILE_ATTRIBUTES, "%s not found, error %u\n", path, GetLastError());
+
+    sprintf(path, "%s\\file0.txt", testdir);
+    ret = DeleteFileA(path);
+    ok(ret, "failed to delete %s, error %u\n", path, GetLastError());
+    sprintf(path, "%s\\FILE0.TXT", testdir);
+    attrs = GetFileAttributesA(path);
+    ok(attrs == INVALID_FILE_ATTRIBUTES, "%s found\n", path);
+
+    sprintf(oldpath, "%s\\file1.txt", testdir);
+    sprintf(path, "%s\\renamed.txt", testdir);
+    ret = MoveFileA(oldpath, path);
+    ok(ret, "failed to rename %s, error %u\n", oldpath, GetLastError());
+    sprintf(path, "%s\\RENAMED.TXT", testdir);
+    attrs = GetFileAttributesA(path);
+    ok(attrs != INVALID_FILE_ATTRIBUTES, "%s not found, error %u\n", path, GetLastError());
+    sprintf(path, "%s\\FILE1.TXT", testdir);
+    attrs = GetFileAttributesA(path);
+    ok(attrs == INVALID_FILE_ATTRIBUTES, "%s found\n", path);
+
+    sprintf(path, "%s\\renamed.txt", testdir);
+    DeleteFileA(path);
+    sprintf(path, "%s\\newfile.txt", testdir);
+    DeleteFileA(path);
+    for (i = 2; i < count; i++)
+    {
+        sprintf(path, "%s\\file%u.txt", testdir, i);
+        DeleteFileA(path);
+    }
+    ret = RemoveDirectoryA(testdir);
+    ok(ret, "couldn't remove dir '%s', error %d\n", testdir, GetLastError());
+}
+
 START_TEST(directory)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -346,4 +422,5 @@ START_TEST(directory)
 
     test_NtQueryDirectoryFile();
     test_redirection();
+    test_case_insensitive_lookup();
 }
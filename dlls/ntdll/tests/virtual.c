@@ -0,0 +1,282 @@
+/*
+ * Unit test suite for ntdll virtual memory functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntdll_test.h"
+
+static NTSTATUS (WINAPI *pNtAllocateVirtualMemory)(HANDLE, PVOID *, ULONG, SIZE_T *, ULONG, ULONG);
+static NTSTATUS (WINAPI *pNtFreeVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG);
+static NTSTATUS (WINAPI *pNtQueryVirtualMemory)(HANDLE, LPCVOID, MEMORY_INFORMATION_CLASS,
+                                                PVOID, SIZE_T, SIZE_T *);
+
+#define NB_VIEWS   1024
+#define VIEW_SIZE  0x10000
+
+static void check_region( char *addr, char *alloc_base, SIZE_T size, DWORD state, ULONG index )
+{
+    MEMORY_BASIC_INFORMATION info;
+    NTSTATUS status;
+    SIZE_T len;
+
+    memset( &info, 0xcc, sizeof(info) );
+    status = pNtQueryVirtualMemory( NtCurrentProcess(), addr, MemoryBasicInformation,
+                                    &info, sizeof(info), &len );
+    ok( !status, "%u: NtQueryVirtualMemory failed %x\n", index, status );
+    ok( info.BaseAddress == addr, "%u: wrong base %p/%p\n", index, info.BaseAddress, addr );
+    ok( info.RegionSize == size, "%u: wrong size %lx/%lx\n", index, info.RegionSize, size );
+    ok( info.State == state, "%u: wrong state %x/%x\n", index, info.State, state );
+    if (state != MEM_FREE)
+        ok( info.AllocationBase == alloc_base, "%u: wrong allocation base %p/%p\n",
+            index, info.AllocationBase, alloc_base );
+}
+
+static void test_many_views(void)
+{
+    SYSTEM_INFO si;
+    NTSTATUS status;
+    char *base, *addr;
+    SIZE_T size;
+    ULONG i, count;
+
+    GetSystemInfo( &si );
+
+    /* find a free range, then release it to allocate separate views inside it */
+    base = NULL;
+    size = NB_VIEWS * VIEW_SIZE;
+    status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&base, 0, &size,
+                                       MEM_RESERVE, PAGE_NOACCESS );
+    if (status)
+    {
+        skip( "could not reserve %u views\n", NB_VIEWS );
+        return;
+    }
+    size = 0;
+    status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&base, &size, MEM_RELEASE );
+    ok( !status, "NtFreeVirtualMemory failed %x\n", status );
+
+    for (count = 0; count < NB_VIEWS; count++)
+    {
+        addr = base + count * VIEW_SIZE;
+        size = VIEW_SIZE;
+        status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&addr, 0, &size,
+                                           MEM_RESERVE, PAGE_READWRITE );
+        if (status) break;
+        if (count % 2) continue;
+        size = si.dwPageSize;
+        status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&addr, 0, &size,
+                                           MEM_COMMIT, PAGE_READWRITE );
+        ok( !status, "%u: NtAllocateVirtualMemory failed %x\n", count, status );
+        addr[0] = 1;
+    }
+    if (count < NB_VIEWS) skip( "could only allocate %u views\n", count );
+
+    for (i = 0; i < count; i++)
+    {
+        addr = base + i * VIEW_SIZE;
+        if (i % 2)
+        {
+            check_region( addr, addr, VIEW_SIZE, MEM_RESERVE, i );
+        }
+        else
+        {
+            check_region( addr, addr, si.dwPageSize, MEM_COMMIT, i );
+            check_region( addr + VIEW_SIZE / 2, addr, VIEW_SIZE / 2, MEM_RESERVE, i );
+        }
+    }
+
+    /* release every other view, the holes must not be merged with their neighbors */
+    for (i = 1; i < count; i += 2)
+    {
+        addr = base + i * VIEW_SIZE;
+        size = 0;
+        status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&addr, &size, MEM_RELEASE );
+        ok( !status, "%u: NtFreeVirtualMemory failed %x\n", i, status );
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        addr = base + i * VIEW_SIZE;
+        if (!(i % 2)) check_region( addr + si.dwPageSize, addr, VIEW_SIZE - si.dwPageSize, MEM_RESERVE, i );
+        else if (i < count - 1) check_region( addr, NULL, VIEW_SIZE, MEM_FREE, i );
+    }
+
+    for (i = 0; i < count; i += 2)
+    {
+        addr = base + i * VIEW_SIZE;
+        size = 0;
+        status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&addr, &size, MEM_RELEASE );
+        ok( !status, "%u: NtFreeVirtualMemory failed %x\n", i, status );
+    }
+}
+
+#define NB_UNITS  256
+
+/* allocations in a fragmented area must only use the holes that are large enough */
+static void test_fragmented_free_area(void)
+{
+    char used[NB_UNITS], *base, *addr, *extra[32];
+    ULONG i, j, k, len, count = 0, nb_extra = 0;
+    NTSTATUS status;
+    SIZE_T size;
+
+    base = NULL;
+    size = NB_UNITS * VIEW_SIZE;
+    status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&base, 0, &size,
+                                       MEM_RESERVE, PAGE_NOACCESS );
+    if (status)
+    {
+        skip( "could not reserve %u units\n", NB_UNITS );
+        return;
+    }
+    size = 0;
+    status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&base, &size, MEM_RELEASE );
+    ok( !status, "NtFreeVirtualMemory failed %x\n", status );
+
+    /* views of 1 to 3 units separated by holes of 1 to 7 units */
+    memset( used, 0, sizeof(used) );
+    for (i = 0, j = 0; ; j++)
+    {
+        len = 1 + j % 3;
+        if (i + len > NB_UNITS) break;
+        addr = base + i * VIEW_SIZE;
+        size = len * VIEW_SIZE;
+        status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&addr, 0, &size,
+                                           MEM_RESERVE, PAGE_READWRITE );
+        if (status)
+        {
+            skip( "could not allocate view at %p\n", base + i * VIEW_SIZE );
+            break;
+        }
+        memset( used + i, 1, len );
+        count++;
+        i += len + 1 + j % 7;
+    }
+
+    /* allocate blocks of increasing size, bottom up and top down */
+    for (k = 1; k <= 8 && nb_extra < sizeof(extra) / sizeof(extra[0]); k++)
+    {
+        for (j = 0; j < 4 && nb_extra < sizeof(extra) / sizeof(extra[0]); j++)
+        {
+            addr = NULL;
+            size = k * VIEW_SIZE;
+            status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&addr, 0, &size,
+                                               MEM_RESERVE | ((j & 1) ? MEM_TOP_DOWN : 0), PAGE_READWRITE );
+            ok( !status, "%u: NtAllocateVirtualMemory failed %x\n", k, status );
+            if (status) continue;
+            extra[nb_extra++] = addr;
+            ok( !((ULONG_PTR)addr % VIEW_SIZE), "%u: unaligned address %p\n", k, addr );
+            ok( size == k * VIEW_SIZE, "%u: wrong size %lx\n", k, size );
+            check_region( addr, addr, size, MEM_RESERVE, k );
+
+            for (i = 0; i < NB_UNITS; i++)
+            {
+                if (base + (i + 1) * VIEW_SIZE <= addr || base + i * VIEW_SIZE >= addr + size) continue;
+                ok( !used[i], "%u: %p-%p overlaps unit %u\n", k, addr, addr + size, i );
+                used[i] = 1;
+            }
+        }
+    }
+
+    /* the views must be intact */
+    for (i = 0, j = 0; j < count; j++)
+    {
+        len = 1 + j % 3;
+        check_region( base + i * VIEW_SIZE, base + i * VIEW_SIZE, len * VIEW_SIZE, MEM_RESERVE, j );
+        addr = base + i * VIEW_SIZE;
+        size = 0;
+        status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&addr, &size, MEM_RELEASE );
+        ok( !status, "%u: NtFreeVirtualMemory failed %x\n", j, status );
+        i += len + 1 + j % 7;
+    }
+
+    for (i = 0; i < nb_extra; i++)
+    {
+        size = 0;
+        status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&extra[i], &size, MEM_RELEASE );
+        ok( !status, "%u: NtFreeVirtualMemory failed %x\n", i, status );
+    }
+}
+
+/* allocate, query and free views of growing counts, the time per view should stay flat */
+static void test_view_timings(void)
+{
+    static const ULONG counts[] = { 1024, 4096, 16384 };
+    MEMORY_BASIC_INFORMATION info;
+    DWORD start, alloc_time, query_time, free_time;
+    NTSTATUS status;
+    char **views;
+    SIZE_T size, len;
+    ULONG i, j, count;
+
+    if (!winetest_interactive)
+    {
+        skip( "view timings (set WINETEST_INTERACTIVE=1)\n" );
+        return;
+    }
+
+    views = HeapAlloc( GetProcessHeap(), 0, counts[sizeof(counts)/sizeof(counts[0]) - 1] * sizeof(*views) );
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    {
+        start = GetTickCount();
+        for (count = 0; count < counts[i]; count++)
+        {
+            views[count] = NULL;
+            size = VIEW_SIZE;
+            status = pNtAllocateVirtualMemory( NtCurrentProcess(), (void **)&views[count], 0, &size,
+                                               MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+            if (status) break;
+        }
+        alloc_time = GetTickCount() - start;
+        if (count < counts[i]) skip( "could only allocate %u views\n", count );
+
+        start = GetTickCount();
+        for (j = 0; j < count; j++)
+        {
+            status = pNtQueryVirtualMemory( NtCurrentProcess(), views[j] + VIEW_SIZE / 2, MemoryBasicInformation,
+                                            &info, sizeof(info), &len );
+            ok( !status && info.AllocationBase == views[j], "%u: NtQueryVirtualMemory failed %x\n", j, status );
+        }
+        query_time = GetTickCount() - start;
+
+        start = GetTickCount();
+        for (j = 0; j < count; j++)
+        {
+            size = 0;
+            status = pNtFreeVirtualMemory( NtCurrentProcess(), (void **)&views[j], &size, MEM_RELEASE );
+            ok( !status, "%u: NtFreeVirtualMemory failed %x\n", j, status );
+        }
+        free_time = GetTickCount() - start;
+
+        trace( "%u views: allocated in %u ms, queried in %u ms, freed in %u ms\n",
+               count, alloc_time, query_time, free_time );
+        if (count < counts[i]) break;
+    }
+    HeapFree( GetProcessHeap(), 0, views );
+}
+
+START_TEST(virtual)
+{
+    HMODULE hntdll = GetModuleHandleA( "ntdll.dll" );
+
+    pNtAllocateVirtualMemory = (void *)GetProcAddress( hntdll, "NtAllocateVirtualMemory" );
+    pNtFreeVirtualMemory     = (void *)GetProcAddress( hntdll, "NtFreeVirtualMemory" );
+    pNtQueryVirtualMemory    = (void *)GetProcAddress( hntdll, "NtQueryVirtualMemory" );
+
+    test_many_views();
+    test_fragmented_free_area();
+    test_view_timings();
+}
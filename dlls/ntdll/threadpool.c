@@ -1024,3 +1024,1318 @@ NTSTATUS WINAPI RtlDeleteTimer(HANDLE TimerQueue, HANDLE Timer,
 
     return status;
 }
+
+
+/************************** Vista thread pool **************************/
+
+/* Each worker thread owns a queue of objects with pending callbacks. Callbacks
+ * posted from a worker go to its own queue and are executed in LIFO order for
+ * locality, callbacks posted from other threads go to the shared pool queue,
+ * and idle workers steal from the head of the other workers' queues. */
+
+struct threadpool_queue
+{
+    RTL_CRITICAL_SECTION    cs;
+    struct list             objects;        /* objects with pending callbacks */
+};
+
+struct threadpool
+{
+    LONG                    refcount;
+    BOOL                    shutdown;       /* released by the application; once set, never unset */
+    RTL_CRITICAL_SECTION    cs;             /* protects the worker list and counts */
+    struct threadpool_queue queue;          /* callbacks posted from outside the pool */
+    struct list             workers;
+    RTL_CONDITION_VARIABLE  update_event;   /* idle workers sleep on this */
+    int                     max_workers;
+    int                     min_workers;
+    int                     num_workers;
+    int                     num_idle_workers;
+};
+
+struct threadpool_worker
+{
+    struct list             entry;          /* entry in the pool worker list */
+    struct threadpool      *pool;
+    struct threadpool_queue queue;          /* the owner works at the tail, thieves at the head */
+};
+
+enum threadpool_objtype
+{
+    TP_OBJECT_TYPE_SIMPLE,
+    TP_OBJECT_TYPE_WORK,
+    TP_OBJECT_TYPE_TIMER,
+    TP_OBJECT_TYPE_WAIT
+};
+
+struct waitqueue_bucket;
+
+struct threadpool_object
+{
+    LONG                    refcount;
+    BOOL                    shutdown;       /* released by the application; once set, never unset */
+    enum threadpool_objtype type;
+    struct threadpool      *pool;
+    PVOID                   userdata;
+    BOOL                    may_run_long;
+    /* protected by the lock of the queue the object is currently in */
+    struct threadpool_queue *volatile queue;
+    struct list             queue_entry;
+    LONG                    num_pending_callbacks;
+    /* completion of the callbacks is signaled under the pool lock */
+    LONG                    num_running_callbacks;
+    RTL_CONDITION_VARIABLE  finished_event;
+    union
+    {
+        struct
+        {
+            PTP_SIMPLE_CALLBACK callback;
+        } simple;
+        struct
+        {
+            PTP_WORK_CALLBACK callback;
+        } work;
+        struct
+        {
+            PTP_TIMER_CALLBACK callback;
+            /* protected by the timer queue lock */
+            BOOL        set;
+            ULONG       heap_index;             /* position in the timer heap */
+            ULONGLONG   timeout;                /* absolute due time */
+            LONG        period;
+            LONG        window;
+        } timer;
+        struct
+        {
+            PTP_WAIT_CALLBACK callback;
+            /* protected by the wait queue lock */
+            struct waitqueue_bucket *bucket;
+            struct list wait_entry;             /* entry in the bucket wait list */
+            BOOL        set;
+            HANDLE      handle;
+            ULONGLONG   timeout;                /* absolute due time, or TIMEOUT_INFINITE */
+            TP_WAIT_RESULT result;              /* result passed to the next callback */
+        } wait;
+    } u;
+};
+
+struct threadpool_instance
+{
+    struct threadpool_object *object;
+    DWORD                   threadid;
+    BOOL                    may_run_long;
+    struct
+    {
+        RTL_CRITICAL_SECTION *critical_section;
+        HANDLE              mutex;
+        HANDLE              semaphore;
+        LONG                semaphore_count;
+        HANDLE              event;
+    } cleanup;
+};
+
+static struct threadpool *default_threadpool;
+
+static RTL_CRITICAL_SECTION_DEBUG timerqueue_debug;
+static RTL_CRITICAL_SECTION_DEBUG waitqueue_debug;
+
+/* all the timers are kept in a single binary heap ordered by due time */
+static struct
+{
+    RTL_CRITICAL_SECTION        cs;
+    RTL_CONDITION_VARIABLE      update_event;
+    struct threadpool_object  **heap;
+    ULONG                       count;
+    ULONG                       size;
+    BOOL                        thread_running;
+} timerqueue = { { &timerqueue_debug, -1, 0, 0, 0, 0 }, RTL_CONDITION_VARIABLE_INIT };
+
+static RTL_CRITICAL_SECTION_DEBUG timerqueue_debug =
+{
+    0, 0, &timerqueue.cs,
+    { &timerqueue_debug.ProcessLocksList, &timerqueue_debug.ProcessLocksList },
+    0, 0, { (DWORD_PTR)(__FILE__ ": timerqueue.cs") }
+};
+
+/* waits are multiplexed over waiter threads, each handling up to
+ * MAXIMUM_WAIT_OBJECTS - 1 objects plus its update event */
+#define WAITQUEUE_BUCKET_SIZE  (MAXIMUM_WAIT_OBJECTS - 1)
+
+struct waitqueue_bucket
+{
+    struct list             bucket_entry;
+    LONG                    num_waits;      /* waits assigned to this bucket, set or not */
+    struct list             waiting;        /* waits currently set */
+    HANDLE                  update_event;
+};
+
+static struct
+{
+    RTL_CRITICAL_SECTION    cs;
+    struct list             buckets;
+} waitqueue = { { &waitqueue_debug, -1, 0, 0, 0, 0 }, LIST_INIT( waitqueue.buckets ) };
+
+static RTL_CRITICAL_SECTION_DEBUG waitqueue_debug =
+{
+    0, 0, &waitqueue.cs,
+    { &waitqueue_debug.ProcessLocksList, &waitqueue_debug.ProcessLocksList },
+    0, 0, { (DWORD_PTR)(__FILE__ ": waitqueue.cs") }
+};
+
+static inline struct threadpool *impl_from_TP_POOL( TP_POOL *pool )
+{
+    return (struct threadpool *)pool;
+}
+
+static inline struct threadpool_object *impl_from_TP_WORK( TP_WORK *work )
+{
+    struct threadpool_object *object = (struct threadpool_object *)work;
+    assert( object->type == TP_OBJECT_TYPE_WORK );
+    return object;
+}
+
+static inline struct threadpool_object *impl_from_TP_TIMER( TP_TIMER *timer )
+{
+    struct threadpool_object *object = (struct threadpool_object *)timer;
+    assert( object->type == TP_OBJECT_TYPE_TIMER );
+    return object;
+}
+
+static inline struct threadpool_object *impl_from_TP_WAIT( TP_WAIT *wait )
+{
+    struct threadpool_object *object = (struct threadpool_object *)wait;
+    assert( object->type == TP_OBJECT_TYPE_WAIT );
+    return object;
+}
+
+static inline struct threadpool_instance *impl_from_TP_CALLBACK_INSTANCE( TP_CALLBACK_INSTANCE *instance )
+{
+    return (struct threadpool_instance *)instance;
+}
+
+static inline ULONGLONG tp_current_time(void)
+{
+    LARGE_INTEGER now;
+    NtQuerySystemTime( &now );
+    return now.QuadPart;
+}
+
+/* convert an NT timeout to an absolute time */
+static ULONGLONG tp_absolute_time( const LARGE_INTEGER *timeout )
+{
+    if (!timeout) return TIMEOUT_INFINITE;
+    if (timeout->QuadPart <= 0) return tp_current_time() - timeout->QuadPart;
+    return timeout->QuadPart;
+}
+
+static void tp_queue_init( struct threadpool_queue *queue )
+{
+    RtlInitializeCriticalSection( &queue->cs );
+    queue->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool_queue.cs");
+    list_init( &queue->objects );
+}
+
+static void tp_queue_destroy( struct threadpool_queue *queue )
+{
+    queue->cs.DebugInfo->Spare[0] = 0;
+    RtlDeleteCriticalSection( &queue->cs );
+}
+
+/***********************************************************************
+ *           tp_threadpool_alloc
+ */
+static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
+{
+    struct threadpool *pool;
+
+    if (!(pool = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*pool) )))
+        return STATUS_NO_MEMORY;
+
+    pool->refcount          = 1;
+    pool->shutdown          = FALSE;
+    pool->max_workers       = 500;
+    pool->min_workers       = 0;
+    pool->num_workers       = 0;
+    pool->num_idle_workers  = 0;
+    RtlInitializeCriticalSection( &pool->cs );
+    pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
+    tp_queue_init( &pool->queue );
+    list_init( &pool->workers );
+    RtlInitializeConditionVariable( &pool->update_event );
+
+    TRACE( "allocated pool %p\n", pool );
+    *out = pool;
+    return STATUS_SUCCESS;
+}
+
+static void tp_threadpool_release( struct threadpool *pool )
+{
+    if (interlocked_dec( &pool->refcount )) return;
+
+    TRACE( "destroying pool %p\n", pool );
+    assert( pool->shutdown && !pool->num_workers );
+    tp_queue_destroy( &pool->queue );
+    pool->cs.DebugInfo->Spare[0] = 0;
+    RtlDeleteCriticalSection( &pool->cs );
+    RtlFreeHeap( GetProcessHeap(), 0, pool );
+}
+
+/* get the pool to use for a callback environment, grabbing a reference to it */
+static NTSTATUS tp_threadpool_lock( struct threadpool **out, TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool *pool = NULL;
+    NTSTATUS status;
+
+    if (environment) pool = (struct threadpool *)environment->Pool;
+
+    if (!pool)
+    {
+        if (!(pool = default_threadpool))
+        {
+            if ((status = tp_threadpool_alloc( &pool ))) return status;
+            if (interlocked_cmpxchg_ptr( (void **)&default_threadpool, pool, NULL ))
+            {
+                pool->shutdown = TRUE;
+                tp_threadpool_release( pool );
+            }
+            pool = default_threadpool;
+        }
+    }
+    interlocked_inc( &pool->refcount );
+    *out = pool;
+    return STATUS_SUCCESS;
+}
+
+static void CALLBACK threadpool_worker_proc( void *param );
+
+/***********************************************************************
+ *           tp_new_worker_thread
+ *
+ * Start a new worker thread. Must be called with the pool lock held.
+ */
+static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
+{
+    struct threadpool_worker *worker;
+    HANDLE thread;
+    NTSTATUS status;
+
+    if (!(worker = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*worker) )))
+        return STATUS_NO_MEMORY;
+
+    worker->pool = pool;
+    tp_queue_init( &worker->queue );
+
+    status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                  threadpool_worker_proc, worker, &thread, NULL );
+    if (status)
+    {
+        tp_queue_destroy( &worker->queue );
+        RtlFreeHeap( GetProcessHeap(), 0, worker );
+        return status;
+    }
+    interlocked_inc( &pool->refcount );
+    list_add_tail( &pool->workers, &worker->entry );
+    pool->num_workers++;
+    NtClose( thread );
+    return STATUS_SUCCESS;
+}
+
+/* make sure that a worker is available to process newly posted callbacks */
+static void tp_threadpool_signal( struct threadpool *pool )
+{
+    if (!pool->num_idle_workers && pool->num_workers >= pool->max_workers) return;
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (pool->num_idle_workers)
+        RtlWakeConditionVariable( &pool->update_event );
+    else if (pool->num_workers < pool->max_workers)
+        tp_new_worker_thread( pool );
+    RtlLeaveCriticalSection( &pool->cs );
+}
+
+static void tp_object_release( struct threadpool_object *object )
+{
+    if (interlocked_dec( &object->refcount )) return;
+
+    TRACE( "destroying object %p of type %u\n", object, object->type );
+    assert( object->shutdown && !object->queue );
+    tp_threadpool_release( object->pool );
+    RtlFreeHeap( GetProcessHeap(), 0, object );
+}
+
+static NTSTATUS tp_object_alloc( struct threadpool_object **out, enum threadpool_objtype type,
+                                 PVOID userdata, TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    if (!(object = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*object) )))
+        return STATUS_NO_MEMORY;
+
+    if ((status = tp_threadpool_lock( &object->pool, environment )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, object );
+        return status;
+    }
+
+    object->refcount = 1;
+    object->type     = type;
+    object->userdata = userdata;
+    RtlInitializeConditionVariable( &object->finished_event );
+
+    if (environment)
+    {
+        if (environment->Version != 1)
+            FIXME( "unsupported environment version %u\n", environment->Version );
+        if (environment->CleanupGroup || environment->FinalizationCallback)
+            FIXME( "cleanup groups and finalization callbacks are not supported\n" );
+        object->may_run_long = environment->u.s.LongFunction != 0;
+    }
+
+    TRACE( "allocated object %p of type %u\n", object, type );
+    *out = object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           tp_object_submit
+ *
+ * Queue a callback for an object. An object is in at most one queue at a
+ * time and the number of pending callbacks is stored along with it.
+ */
+static void tp_object_submit( struct threadpool_object *object )
+{
+    struct threadpool_worker *worker = ntdll_get_thread_data()->threadpool_worker;
+    struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue;
+
+    for (;;)
+    {
+        if ((queue = object->queue))
+        {
+            RtlEnterCriticalSection( &queue->cs );
+            if (object->queue == queue)
+            {
+                object->num_pending_callbacks++;
+                RtlLeaveCriticalSection( &queue->cs );
+                break;
+            }
+        }
+        else
+        {
+            queue = (worker && worker->pool == pool) ? &worker->queue : &pool->queue;
+            RtlEnterCriticalSection( &queue->cs );
+            if (!interlocked_cmpxchg_ptr( (void **)&object->queue, queue, NULL ))
+            {
+                /* the queue holds a reference until the last pending callback is started */
+                interlocked_inc( &object->refcount );
+                object->num_pending_callbacks = 1;
+                list_add_tail( &queue->objects, &object->queue_entry );
+                RtlLeaveCriticalSection( &queue->cs );
+                break;
+            }
+        }
+        RtlLeaveCriticalSection( &queue->cs );
+    }
+
+    tp_threadpool_signal( pool );
+}
+
+/* drop all the pending callbacks of an object */
+static void tp_object_cancel( struct threadpool_object *object )
+{
+    struct threadpool_queue *queue;
+
+    while ((queue = object->queue))
+    {
+        RtlEnterCriticalSection( &queue->cs );
+        if (object->queue == queue)
+        {
+            list_remove( &object->queue_entry );
+            object->num_pending_callbacks = 0;
+            object->queue = NULL;
+            RtlLeaveCriticalSection( &queue->cs );
+            tp_object_release( object );
+            break;
+        }
+        RtlLeaveCriticalSection( &queue->cs );
+    }
+}
+
+/* wait until all the pending and running callbacks of an object have completed */
+static void tp_object_wait( struct threadpool_object *object )
+{
+    struct threadpool *pool = object->pool;
+
+    RtlEnterCriticalSection( &pool->cs );
+    while (object->num_pending_callbacks || object->num_running_callbacks)
+        RtlSleepConditionVariableCS( &object->finished_event, &pool->cs, NULL );
+    RtlLeaveCriticalSection( &pool->cs );
+}
+
+/* take the next callback from a queue, from the tail when it's our own queue */
+static struct threadpool_object *tp_queue_pop( struct threadpool_queue *queue, BOOL tail )
+{
+    struct threadpool_object *object = NULL;
+    struct list *ptr;
+
+    if (list_empty( &queue->objects )) return NULL;
+
+    RtlEnterCriticalSection( &queue->cs );
+    if ((ptr = tail ? list_tail( &queue->objects ) : list_head( &queue->objects )))
+    {
+        object = LIST_ENTRY( ptr, struct threadpool_object, queue_entry );
+        interlocked_inc( &object->num_running_callbacks );
+        if (!--object->num_pending_callbacks)
+        {
+            /* the queue reference is transferred to the running callback */
+            list_remove( &object->queue_entry );
+            object->queue = NULL;
+        }
+        else interlocked_inc( &object->refcount );
+    }
+    RtlLeaveCriticalSection( &queue->cs );
+    return object;
+}
+
+/* find the next callback to run; stealing requires the pool lock */
+static struct threadpool_object *tp_worker_next_object( struct threadpool_worker *worker, BOOL steal )
+{
+    struct threadpool *pool = worker->pool;
+    struct threadpool_worker *victim;
+    struct threadpool_object *object;
+
+    if ((object = tp_queue_pop( &worker->queue, TRUE ))) return object;
+    if ((object = tp_queue_pop( &pool->queue, FALSE ))) return object;
+    if (!steal) return NULL;
+
+    LIST_FOR_EACH_ENTRY( victim, &pool->workers, struct threadpool_worker, entry )
+    {
+        if (victim == worker) continue;
+        if ((object = tp_queue_pop( &victim->queue, FALSE ))) return object;
+    }
+    return NULL;
+}
+
+/***********************************************************************
+ *           tp_object_execute
+ *
+ * Run a callback that was taken from a queue, then release it.
+ */
+static void tp_object_execute( struct threadpool_object *object )
+{
+    struct threadpool *pool = object->pool;
+    struct threadpool_instance instance;
+    TP_CALLBACK_INSTANCE *callback_instance = (TP_CALLBACK_INSTANCE *)&instance;
+
+    memset( &instance, 0, sizeof(instance) );
+    instance.object       = object;
+    instance.threadid     = GetCurrentThreadId();
+    instance.may_run_long = object->may_run_long;
+
+    switch (object->type)
+    {
+    case TP_OBJECT_TYPE_SIMPLE:
+        TRACE( "executing simple callback %p(%p, %p)\n",
+               object->u.simple.callback, callback_instance, object->userdata );
+        object->u.simple.callback( callback_instance, object->userdata );
+        break;
+    case TP_OBJECT_TYPE_WORK:
+        TRACE( "executing work callback %p(%p, %p, %p)\n",
+               object->u.work.callback, callback_instance, object->userdata, object );
+        object->u.work.callback( callback_instance, object->userdata, (TP_WORK *)object );
+        break;
+    case TP_OBJECT_TYPE_TIMER:
+        TRACE( "executing timer callback %p(%p, %p, %p)\n",
+               object->u.timer.callback, callback_instance, object->userdata, object );
+        object->u.timer.callback( callback_instance, object->userdata, (TP_TIMER *)object );
+        break;
+    case TP_OBJECT_TYPE_WAIT:
+        TRACE( "executing wait callback %p(%p, %p, %p, %u)\n",
+               object->u.wait.callback, callback_instance, object->userdata, object,
+               object->u.wait.result );
+        object->u.wait.callback( callback_instance, object->userdata, (TP_WAIT *)object,
+                                 object->u.wait.result );
+        break;
+    }
+
+    if (instance.cleanup.critical_section)
+        RtlLeaveCriticalSection( instance.cleanup.critical_section );
+    if (instance.cleanup.mutex)
+        NtReleaseMutant( instance.cleanup.mutex, NULL );
+    if (instance.cleanup.semaphore)
+        NtReleaseSemaphore( instance.cleanup.semaphore, instance.cleanup.semaphore_count, NULL );
+    if (instance.cleanup.event)
+        NtSetEvent( instance.cleanup.event, NULL );
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (!interlocked_dec( &object->num_running_callbacks ) && !object->num_pending_callbacks)
+        RtlWakeAllConditionVariable( &object->finished_event );
+    RtlLeaveCriticalSection( &pool->cs );
+
+    tp_object_release( object );
+}
+
+/***********************************************************************
+ *           threadpool_worker_proc
+ */
+static void CALLBACK threadpool_worker_proc( void *param )
+{
+    struct threadpool_worker *worker = param;
+    struct threadpool *pool = worker->pool;
+    struct threadpool_object *object;
+    LARGE_INTEGER timeout;
+    NTSTATUS status;
+
+    ntdll_get_thread_data()->threadpool_worker = worker;
+
+    for (;;)
+    {
+        if ((object = tp_worker_next_object( worker, FALSE )))
+        {
+            tp_object_execute( object );
+            continue;
+        }
+
+        RtlEnterCriticalSection( &pool->cs );
+        pool->num_idle_workers++;
+        while (!(object = tp_worker_next_object( worker, TRUE )) && !pool->shutdown)
+        {
+            timeout.QuadPart = -(WORKER_TIMEOUT * (ULONGLONG)10000);
+            status = RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout );
+            if (status == STATUS_TIMEOUT && pool->num_workers > max( pool->min_workers, 1 ))
+            {
+                object = tp_worker_next_object( worker, TRUE );
+                break;
+            }
+        }
+        pool->num_idle_workers--;
+        if (object)
+        {
+            RtlLeaveCriticalSection( &pool->cs );
+            tp_object_execute( object );
+            continue;
+        }
+        break;  /* shutting down or too many idle workers */
+    }
+
+    /* our own queue can only be filled from this thread, so it is empty now */
+    list_remove( &worker->entry );
+    pool->num_workers--;
+    RtlLeaveCriticalSection( &pool->cs );
+
+    ntdll_get_thread_data()->threadpool_worker = NULL;
+    tp_queue_destroy( &worker->queue );
+    RtlFreeHeap( GetProcessHeap(), 0, worker );
+    tp_threadpool_release( pool );
+    RtlExitUserThread( 0 );
+}
+
+/***********************************************************************
+ *           timer heap
+ */
+static void tp_timerqueue_swap( ULONG i, ULONG j )
+{
+    struct threadpool_object *tmp = timerqueue.heap[i];
+
+    timerqueue.heap[i] = timerqueue.heap[j];
+    timerqueue.heap[j] = tmp;
+    timerqueue.heap[i]->u.timer.heap_index = i;
+    timerqueue.heap[j]->u.timer.heap_index = j;
+}
+
+static void tp_timerqueue_sift( ULONG i )
+{
+    ULONG parent, child;
+
+    while (i && timerqueue.heap[(parent = (i - 1) / 2)]->u.timer.timeout > timerqueue.heap[i]->u.timer.timeout)
+    {
+        tp_timerqueue_swap( i, parent );
+        i = parent;
+    }
+    while ((child = 2 * i + 1) < timerqueue.count)
+    {
+        if (child + 1 < timerqueue.count &&
+            timerqueue.heap[child + 1]->u.timer.timeout < timerqueue.heap[child]->u.timer.timeout)
+            child++;
+        if (timerqueue.heap[i]->u.timer.timeout <= timerqueue.heap[child]->u.timer.timeout) break;
+        tp_timerqueue_swap( i, child );
+        i = child;
+    }
+}
+
+static void tp_timerqueue_remove( struct threadpool_object *timer )
+{
+    ULONG i = timer->u.timer.heap_index;
+
+    timer->u.timer.set = FALSE;
+    if (i != --timerqueue.count)
+    {
+        timerqueue.heap[i] = timerqueue.heap[timerqueue.count];
+        timerqueue.heap[i]->u.timer.heap_index = i;
+        tp_timerqueue_sift( i );
+    }
+}
+
+static void CALLBACK timerqueue_thread_proc( void *param );
+
+static NTSTATUS tp_timerqueue_insert( struct threadpool_object *timer )
+{
+    HANDLE thread;
+    NTSTATUS status;
+
+    if (timerqueue.count == timerqueue.size)
+    {
+        ULONG new_size = max( 16, timerqueue.size * 2 );
+        struct threadpool_object **new_heap;
+
+        if (timerqueue.heap)
+            new_heap = RtlReAllocateHeap( GetProcessHeap(), 0, timerqueue.heap, new_size * sizeof(*new_heap) );
+        else
+            new_heap = RtlAllocateHeap( GetProcessHeap(), 0, new_size * sizeof(*new_heap) );
+        if (!new_heap) return STATUS_NO_MEMORY;
+        timerqueue.heap = new_heap;
+        timerqueue.size = new_size;
+    }
+
+    if (!timerqueue.thread_running)
+    {
+        status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                      timerqueue_thread_proc, NULL, &thread, NULL );
+        if (status) return status;
+        timerqueue.thread_running = TRUE;
+        NtClose( thread );
+    }
+
+    timer->u.timer.set = TRUE;
+    timer->u.timer.heap_index = timerqueue.count;
+    timerqueue.heap[timerqueue.count++] = timer;
+    tp_timerqueue_sift( timer->u.timer.heap_index );
+    if (!timer->u.timer.heap_index) RtlWakeAllConditionVariable( &timerqueue.update_event );
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           timerqueue_thread_proc
+ *
+ * Single thread serving the timers of all the pools.
+ */
+static void CALLBACK timerqueue_thread_proc( void *param )
+{
+    struct threadpool_object *timer;
+    LARGE_INTEGER timeout;
+    ULONGLONG now;
+    NTSTATUS status;
+
+    RtlEnterCriticalSection( &timerqueue.cs );
+    for (;;)
+    {
+        now = tp_current_time();
+
+        while (timerqueue.count && (timer = timerqueue.heap[0])->u.timer.timeout <= now)
+        {
+            tp_timerqueue_remove( timer );
+            if (timer->u.timer.period)
+            {
+                ULONGLONG period = (ULONGLONG)timer->u.timer.period * 10000;
+                timer->u.timer.timeout += period;
+                /* avoid a callback cascade if we have been delayed too much */
+                if (timer->u.timer.timeout <= now) timer->u.timer.timeout = now + period;
+                tp_timerqueue_insert( timer );
+            }
+            tp_object_submit( timer );
+        }
+
+        if (timerqueue.count)
+        {
+            timeout.QuadPart = timerqueue.heap[0]->u.timer.timeout;
+            RtlSleepConditionVariableCS( &timerqueue.update_event, &timerqueue.cs, &timeout );
+            continue;
+        }
+
+        /* exit the thread once no timer has been set for a while */
+        timeout.QuadPart = -(WORKER_TIMEOUT * (ULONGLONG)10000);
+        status = RtlSleepConditionVariableCS( &timerqueue.update_event, &timerqueue.cs, &timeout );
+        if (status == STATUS_TIMEOUT && !timerqueue.count) break;
+    }
+    timerqueue.thread_running = FALSE;
+    RtlLeaveCriticalSection( &timerqueue.cs );
+    RtlExitUserThread( 0 );
+}
+
+/***********************************************************************
+ *           wait queue
+ */
+static void CALLBACK waitqueue_thread_proc( void *param );
+
+/* assign a bucket to a wait object, must be called with the wait queue lock held */
+static NTSTATUS tp_waitqueue_attach( struct threadpool_object *wait )
+{
+    struct waitqueue_bucket *bucket;
+    HANDLE thread;
+    NTSTATUS status;
+
+    LIST_FOR_EACH_ENTRY( bucket, &waitqueue.buckets, struct waitqueue_bucket, bucket_entry )
+    {
+        if (bucket->num_waits < WAITQUEUE_BUCKET_SIZE) goto found;
+    }
+
+    if (!(bucket = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*bucket) )))
+        return STATUS_NO_MEMORY;
+
+    bucket->num_waits = 0;
+    list_init( &bucket->waiting );
+    if ((status = NtCreateEvent( &bucket->update_event, EVENT_ALL_ACCESS, NULL,
+                                 SynchronizationEvent, FALSE )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, bucket );
+        return status;
+    }
+    if ((status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                       waitqueue_thread_proc, bucket, &thread, NULL )))
+    {
+        NtClose( bucket->update_event );
+        RtlFreeHeap( GetProcessHeap(), 0, bucket );
+        return status;
+    }
+    NtClose( thread );
+    list_add_tail( &waitqueue.buckets, &bucket->bucket_entry );
+
+found:
+    bucket->num_waits++;
+    wait->u.wait.bucket = bucket;
+    return STATUS_SUCCESS;
+}
+
+/* must be called with the wait queue lock held */
+static void tp_waitqueue_disarm( struct threadpool_object *wait )
+{
+    if (!wait->u.wait.set) return;
+    list_remove( &wait->u.wait.wait_entry );
+    wait->u.wait.set = FALSE;
+}
+
+/* must be called with the wait queue lock held */
+static void tp_waitqueue_detach( struct threadpool_object *wait )
+{
+    struct waitqueue_bucket *bucket = wait->u.wait.bucket;
+
+    if (!bucket) return;
+    tp_waitqueue_disarm( wait );
+    wait->u.wait.bucket = NULL;
+    if (!--bucket->num_waits) NtSetEvent( bucket->update_event, NULL );
+}
+
+/* must be called with the wait queue lock held */
+static void tp_waitqueue_fire( struct threadpool_object *wait, TP_WAIT_RESULT result )
+{
+    tp_waitqueue_disarm( wait );
+    wait->u.wait.result = result;
+    tp_object_submit( wait );
+}
+
+/***********************************************************************
+ *           waitqueue_thread_proc
+ *
+ * Wait for any of the objects of a bucket, and fire the waits that are signaled or timed out.
+ */
+static void CALLBACK waitqueue_thread_proc( void *param )
+{
+    struct waitqueue_bucket *bucket = param;
+    struct threadpool_object *objects[WAITQUEUE_BUCKET_SIZE], *wait, *next;
+    HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+    LARGE_INTEGER timeout;
+    ULONGLONG now, next_timeout;
+    NTSTATUS status;
+    ULONG i, count;
+
+    RtlEnterCriticalSection( &waitqueue.cs );
+    for (;;)
+    {
+        now = tp_current_time();
+        next_timeout = TIMEOUT_INFINITE;
+        count = 0;
+
+        LIST_FOR_EACH_ENTRY_SAFE( wait, next, &bucket->waiting, struct threadpool_object, u.wait.wait_entry )
+        {
+            if (wait->u.wait.timeout <= now)
+            {
+                tp_waitqueue_fire( wait, WAIT_TIMEOUT );
+                continue;
+            }
+            objects[count] = wait;
+            handles[count++] = wait->u.wait.handle;
+            next_timeout = min( next_timeout, wait->u.wait.timeout );
+        }
+        handles[count] = bucket->update_event;
+
+        if (!count && !bucket->num_waits)
+        {
+            /* nobody is using this bucket anymore, keep it around a bit for reuse */
+            timeout.QuadPart = -(WORKER_TIMEOUT * (ULONGLONG)10000);
+            RtlLeaveCriticalSection( &waitqueue.cs );
+            status = NtWaitForSingleObject( bucket->update_event, FALSE, &timeout );
+            RtlEnterCriticalSection( &waitqueue.cs );
+            if (status == STATUS_TIMEOUT && !bucket->num_waits) break;
+            continue;
+        }
+
+        timeout.QuadPart = next_timeout;
+        RtlLeaveCriticalSection( &waitqueue.cs );
+        status = NtWaitForMultipleObjects( count + 1, handles, FALSE, FALSE,
+                                           next_timeout == TIMEOUT_INFINITE ? NULL : &timeout );
+        RtlEnterCriticalSection( &waitqueue.cs );
+
+        if (status >= STATUS_ABANDONED_WAIT_0 && status < STATUS_ABANDONED_WAIT_0 + count)
+            status -= STATUS_ABANDONED_WAIT_0 - STATUS_WAIT_0;
+
+        if (status >= STATUS_WAIT_0 && status < STATUS_WAIT_0 + count)
+        {
+            /* the object may have been changed or released while we were waiting,
+             * so only compare the pointer until it's found in the wait list */
+            i = status - STATUS_WAIT_0;
+            LIST_FOR_EACH_ENTRY( wait, &bucket->waiting, struct threadpool_object, u.wait.wait_entry )
+            {
+                if (wait != objects[i]) continue;
+                if (wait->u.wait.handle == handles[i]) tp_waitqueue_fire( wait, WAIT_OBJECT_0 );
+                break;
+            }
+        }
+        else if (status < 0)  /* error status */
+        {
+            /* one of the handles is bad, find it and drop its wait */
+            LIST_FOR_EACH_ENTRY_SAFE( wait, next, &bucket->waiting, struct threadpool_object, u.wait.wait_entry )
+            {
+                timeout.QuadPart = 0;
+                status = NtWaitForSingleObject( wait->u.wait.handle, FALSE, &timeout );
+                if (status == STATUS_WAIT_0 || status == STATUS_ABANDONED_WAIT_0)
+                    tp_waitqueue_fire( wait, WAIT_OBJECT_0 );
+                else if (status < 0)
+                {
+                    WARN( "wait %p: cannot wait on handle %p, status %x\n", wait, wait->u.wait.handle, status );
+                    tp_waitqueue_disarm( wait );
+                }
+            }
+        }
+    }
+
+    list_remove( &bucket->bucket_entry );
+    RtlLeaveCriticalSection( &waitqueue.cs );
+
+    NtClose( bucket->update_event );
+    RtlFreeHeap( GetProcessHeap(), 0, bucket );
+    RtlExitUserThread( 0 );
+}
+
+/***********************************************************************
+ *           TpAllocPool    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocPool( TP_POOL **out, PVOID reserved )
+{
+    TRACE( "%p %p\n", out, reserved );
+
+    if (reserved) FIXME( "reserved argument is nonzero (%p)\n", reserved );
+
+    return tp_threadpool_alloc( (struct threadpool **)out );
+}
+
+/***********************************************************************
+ *           TpReleasePool    (NTDLL.@)
+ */
+VOID WINAPI TpReleasePool( TP_POOL *pool )
+{
+    struct threadpool *this = impl_from_TP_POOL( pool );
+
+    TRACE( "%p\n", pool );
+
+    RtlEnterCriticalSection( &this->cs );
+    this->shutdown = TRUE;
+    RtlWakeAllConditionVariable( &this->update_event );
+    RtlLeaveCriticalSection( &this->cs );
+
+    tp_threadpool_release( this );
+}
+
+/***********************************************************************
+ *           TpSetPoolMaxThreads    (NTDLL.@)
+ */
+VOID WINAPI TpSetPoolMaxThreads( TP_POOL *pool, DWORD maximum )
+{
+    struct threadpool *this = impl_from_TP_POOL( pool );
+
+    TRACE( "%p %u\n", pool, maximum );
+
+    RtlEnterCriticalSection( &this->cs );
+    this->max_workers = max( maximum, 1 );
+    this->min_workers = min( this->min_workers, this->max_workers );
+    RtlLeaveCriticalSection( &this->cs );
+}
+
+/***********************************************************************
+ *           TpSetPoolMinThreads    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpSetPoolMinThreads( TP_POOL *pool, DWORD minimum )
+{
+    struct threadpool *this = impl_from_TP_POOL( pool );
+    NTSTATUS status = STATUS_SUCCESS;
+
+    TRACE( "%p %u\n", pool, minimum );
+
+    RtlEnterCriticalSection( &this->cs );
+    while (this->num_workers < minimum)
+    {
+        if ((status = tp_new_worker_thread( this ))) break;
+    }
+    if (!status)
+    {
+        this->min_workers = minimum;
+        this->max_workers = max( this->min_workers, this->max_workers );
+    }
+    RtlLeaveCriticalSection( &this->cs );
+    return status;
+}
+
+/***********************************************************************
+ *           TpSimpleTryPost    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpSimpleTryPost( PTP_SIMPLE_CALLBACK callback, PVOID userdata,
+                                 TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", callback, userdata, environment );
+
+    if ((status = tp_object_alloc( &object, TP_OBJECT_TYPE_SIMPLE, userdata, environment )))
+        return status;
+
+    object->u.simple.callback = callback;
+    object->shutdown = TRUE;
+    tp_object_submit( object );
+    tp_object_release( object );
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpAllocWork    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocWork( TP_WORK **out, PTP_WORK_CALLBACK callback, PVOID userdata,
+                             TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", out, callback, userdata, environment );
+
+    if ((status = tp_object_alloc( &object, TP_OBJECT_TYPE_WORK, userdata, environment )))
+        return status;
+
+    object->u.work.callback = callback;
+    *out = (TP_WORK *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpPostWork    (NTDLL.@)
+ */
+VOID WINAPI TpPostWork( TP_WORK *work )
+{
+    TRACE( "%p\n", work );
+
+    tp_object_submit( impl_from_TP_WORK( work ) );
+}
+
+/***********************************************************************
+ *           TpWaitForWork    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForWork( TP_WORK *work, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_WORK( work );
+
+    TRACE( "%p %u\n", work, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseWork    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseWork( TP_WORK *work )
+{
+    struct threadpool_object *this = impl_from_TP_WORK( work );
+
+    TRACE( "%p\n", work );
+
+    this->shutdown = TRUE;
+    tp_object_release( this );
+}
+
+/***********************************************************************
+ *           TpAllocTimer    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocTimer( TP_TIMER **out, PTP_TIMER_CALLBACK callback, PVOID userdata,
+                              TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", out, callback, userdata, environment );
+
+    if ((status = tp_object_alloc( &object, TP_OBJECT_TYPE_TIMER, userdata, environment )))
+        return status;
+
+    object->u.timer.callback = callback;
+    *out = (TP_TIMER *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpSetTimer    (NTDLL.@)
+ *
+ * A NULL due time cancels the timer, a zero due time fires it immediately.
+ */
+VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LONG window_length )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+    BOOL submit = FALSE;
+
+    TRACE( "%p %p %u %u\n", timer, timeout, period, window_length );
+
+    RtlEnterCriticalSection( &timerqueue.cs );
+
+    if (this->u.timer.set) tp_timerqueue_remove( this );
+
+    if (timeout)
+    {
+        this->u.timer.period = period;
+        this->u.timer.window = window_length;
+
+        if (!timeout->QuadPart)
+        {
+            /* fire immediately, and arm the timer for the next period if needed */
+            submit = TRUE;
+            if (period)
+            {
+                this->u.timer.timeout = tp_current_time() + (ULONGLONG)period * 10000;
+                tp_timerqueue_insert( this );
+            }
+        }
+        else
+        {
+            this->u.timer.timeout = tp_absolute_time( timeout );
+            if (tp_timerqueue_insert( this )) ERR( "failed to set timer %p\n", timer );
+        }
+    }
+
+    RtlLeaveCriticalSection( &timerqueue.cs );
+
+    if (submit) tp_object_submit( this );
+}
+
+/***********************************************************************
+ *           TpIsTimerSet    (NTDLL.@)
+ */
+BOOL WINAPI TpIsTimerSet( TP_TIMER *timer )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+
+    TRACE( "%p\n", timer );
+
+    return this->u.timer.set;
+}
+
+/***********************************************************************
+ *           TpWaitForTimer    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForTimer( TP_TIMER *timer, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+
+    TRACE( "%p %u\n", timer, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseTimer    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseTimer( TP_TIMER *timer )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+
+    TRACE( "%p\n", timer );
+
+    RtlEnterCriticalSection( &timerqueue.cs );
+    if (this->u.timer.set) tp_timerqueue_remove( this );
+    this->shutdown = TRUE;
+    RtlLeaveCriticalSection( &timerqueue.cs );
+
+    tp_object_release( this );
+}
+
+/***********************************************************************
+ *           TpAllocWait    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocWait( TP_WAIT **out, PTP_WAIT_CALLBACK callback, PVOID userdata,
+                             TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", out, callback, userdata, environment );
+
+    if ((status = tp_object_alloc( &object, TP_OBJECT_TYPE_WAIT, userdata, environment )))
+        return status;
+
+    object->u.wait.callback = callback;
+    *out = (TP_WAIT *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpSetWait    (NTDLL.@)
+ *
+ * A NULL handle cancels the wait, a NULL timeout waits forever.
+ */
+VOID WINAPI TpSetWait( TP_WAIT *wait, HANDLE handle, LARGE_INTEGER *timeout )
+{
+    struct threadpool_object *this = impl_from_TP_WAIT( wait );
+
+    TRACE( "%p %p %p\n", wait, handle, timeout );
+
+    RtlEnterCriticalSection( &waitqueue.cs );
+
+    tp_waitqueue_disarm( this );
+
+    if (!handle)
+    {
+        tp_waitqueue_detach( this );
+    }
+    else if (this->u.wait.bucket || !tp_waitqueue_attach( this ))
+    {
+        this->u.wait.handle  = handle;
+        this->u.wait.timeout = tp_absolute_time( timeout );
+        this->u.wait.set     = TRUE;
+        list_add_tail( &this->u.wait.bucket->waiting, &this->u.wait.wait_entry );
+        NtSetEvent( this->u.wait.bucket->update_event, NULL );
+    }
+    else ERR( "failed to set wait %p\n", wait );
+
+    RtlLeaveCriticalSection( &waitqueue.cs );
+}
+
+/***********************************************************************
+ *           TpWaitForWait    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForWait( TP_WAIT *wait, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_WAIT( wait );
+
+    TRACE( "%p %u\n", wait, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseWait    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseWait( TP_WAIT *wait )
+{
+    struct threadpool_object *this = impl_from_TP_WAIT( wait );
+
+    TRACE( "%p\n", wait );
+
+    RtlEnterCriticalSection( &waitqueue.cs );
+    tp_waitqueue_detach( this );
+    this->shutdown = TRUE;
+    RtlLeaveCriticalSection( &waitqueue.cs );
+
+    tp_object_release( this );
+}
+
+/***********************************************************************
+ *           TpCallbackMayRunLong    (NTDLL.@)
+ *
+ * Make sure that another worker is available while this callback runs.
+ */
+NTSTATUS WINAPI TpCallbackMayRunLong( TP_CALLBACK_INSTANCE *instance )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+    struct threadpool *pool = this->object->pool;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    TRACE( "%p\n", instance );
+
+    if (this->threadid != GetCurrentThreadId())
+    {
+        ERR( "called from wrong thread, ignoring\n" );
+        return STATUS_UNSUCCESSFUL;
+    }
+    if (this->may_run_long) return STATUS_SUCCESS;
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (!pool->num_idle_workers)
+    {
+        if (pool->num_workers < pool->max_workers) status = tp_new_worker_thread( pool );
+        else status = STATUS_TOO_MANY_THREADS;
+    }
+    RtlLeaveCriticalSection( &pool->cs );
+
+    this->may_run_long = TRUE;
+    return status;
+}
+
+/***********************************************************************
+ *           TpCallbackLeaveCriticalSectionOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackLeaveCriticalSectionOnCompletion( TP_CALLBACK_INSTANCE *instance, RTL_CRITICAL_SECTION *crit )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, crit );
+
+    if (!this->cleanup.critical_section) this->cleanup.critical_section = crit;
+}
+
+/***********************************************************************
+ *           TpCallbackReleaseMutexOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackReleaseMutexOnCompletion( TP_CALLBACK_INSTANCE *instance, HANDLE mutex )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, mutex );
+
+    if (!this->cleanup.mutex) this->cleanup.mutex = mutex;
+}
+
+/***********************************************************************
+ *           TpCallbackReleaseSemaphoreOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackReleaseSemaphoreOnCompletion( TP_CALLBACK_INSTANCE *instance, HANDLE semaphore, DWORD count )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p %u\n", instance, semaphore, count );
+
+    if (!this->cleanup.semaphore)
+    {
+        this->cleanup.semaphore = semaphore;
+        this->cleanup.semaphore_count = count;
+    }
+}
+
+/***********************************************************************
+ *           TpCallbackSetEventOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackSetEventOnCompletion( TP_CALLBACK_INSTANCE *instance, HANDLE event )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, event );
+
+    if (!this->cleanup.event) this->cleanup.event = event;
+}
@@ -52,6 +52,7 @@
 #include "wine/server.h"
 #include "wine/exception.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 #include "ntdll_misc.h"
 
@@ -66,6 +67,7 @@ WINE_DECLARE_DEBUG_CHANNEL(module);
 struct file_view
 {
     struct list   entry;       /* Entry in global view list */
+    struct wine_rb_entry tree_entry; /* Entry in global view tree */
     void         *base;        /* Base address */
     size_t        size;        /* Size in bytes */
     HANDLE        mapping;     /* Handle to the file mapping */
@@ -98,6 +100,47 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 
 static struct list views_list = LIST_INIT(views_list);
 
+static void *views_tree_alloc( size_t size );
+static void *views_tree_realloc( void *ptr, size_t size );
+static void views_tree_free( void *ptr );
+static int compare_view( const void *addr, const struct wine_rb_entry *entry );
+
+static const struct wine_rb_functions views_tree_funcs =
+{
+    views_tree_alloc,
+    views_tree_realloc,
+    views_tree_free,
+    compare_view
+};
+
+/* views indexed by address, the list is kept for ordered traversal */
+static struct wine_rb_tree views_tree;
+
+/* free address range between views */
+struct range_entry
+{
+    struct wine_rb_entry entry;  /* entry in the free ranges tree, or link in the spare list */
+    void                *base;
+    void                *end;
+};
+
+static int compare_range( const void *addr, const struct wine_rb_entry *entry );
+
+static const struct wine_rb_functions free_ranges_funcs =
+{
+    views_tree_alloc,
+    views_tree_realloc,
+    views_tree_free,
+    compare_range
+};
+
+/* free ranges indexed by address; there are at most views_count + 1 of them, so
+ * enough entries are allocated in advance for deleting a view to never fail */
+static struct wine_rb_tree free_ranges_tree;
+static struct wine_rb_entry *spare_ranges;
+static unsigned int ranges_allocated;
+static unsigned int views_count;
+
 static RTL_CRITICAL_SECTION csVirtual;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 {
@@ -242,6 +285,93 @@ static void VIRTUAL_Dump(void)
 #endif
 
 
+static void *views_tree_alloc( size_t size )
+{
+    return RtlAllocateHeap( virtual_heap, 0, size );
+}
+
+static void *views_tree_realloc( void *ptr, size_t size )
+{
+    return RtlReAllocateHeap( virtual_heap, 0, ptr, size );
+}
+
+static void views_tree_free( void *ptr )
+{
+    RtlFreeHeap( virtual_heap, 0, ptr );
+}
+
+/* views never overlap, so an address compares equal to the view containing it */
+static int compare_view( const void *addr, const struct wine_rb_entry *entry )
+{
+    const struct file_view *view = WINE_RB_ENTRY_VALUE( entry, const struct file_view, tree_entry );
+
+    if ((const char *)addr < (const char *)view->base) return -1;
+    if ((const char *)addr >= (const char *)view->base + view->size) return 1;
+    return 0;
+}
+
+
+/* ranges never overlap either */
+static int compare_range( const void *addr, const struct wine_rb_entry *entry )
+{
+    const struct range_entry *range = WINE_RB_ENTRY_VALUE( entry, const struct range_entry, entry );
+
+    if ((const char *)addr < (const char *)range->base) return -1;
+    if ((const char *)addr >= (const char *)range->end) return 1;
+    return 0;
+}
+
+
+/***********************************************************************
+ *           find_view_above
+ *
+ * Find the first view that ends above a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct file_view *find_view_above( const void *addr )
+{
+    struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *ret = NULL;
+
+    while (ptr)
+    {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, tree_entry );
+        if ((const char *)view->base + view->size > (const char *)addr)
+        {
+            ret = view;
+            ptr = ptr->left;
+        }
+        else ptr = ptr->right;
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           find_view_below
+ *
+ * Find the last view that starts below a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct file_view *find_view_below( const void *addr )
+{
+    struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *ret = NULL;
+
+    while (ptr)
+    {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, tree_entry );
+        if ((const char *)view->base < (const char *)addr)
+        {
+            ret = view;
+            ptr = ptr->right;
+        }
+        else ptr = ptr->left;
+    }
+    return ret;
+}
+
+
 /***********************************************************************
  *           VIRTUAL_FindView
  *
@@ -256,17 +386,14 @@ static void VIRTUAL_Dump(void)
  */
 static struct file_view *VIRTUAL_FindView( const void *addr, size_t size )
 {
+    struct wine_rb_entry *ptr = wine_rb_get( &views_tree, addr );
     struct file_view *view;
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
-    {
-        if (view->base > addr) break;  /* no matching view */
-        if ((const char *)view->base + view->size <= (const char *)addr) continue;
-        if ((const char *)view->base + view->size < (const char *)addr + size) break;  /* size too large */
-        if ((const char *)addr + size < (const char *)addr) break; /* overflow */
-        return view;
-    }
-    return NULL;
+    if (!ptr) return NULL;
+    view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, tree_entry );
+    if ((const char *)view->base + view->size < (const char *)addr + size) return NULL;  /* size too large */
+    if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
+    return view;
 }
 
 
@@ -289,14 +416,198 @@ static inline UINT_PTR get_mask( ULONG zero_bits )
  */
 static struct file_view *find_view_range( const void *addr, size_t size )
 {
-    struct file_view *view;
+    struct file_view *view = find_view_above( addr );
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+    if (view && (const char *)view->base < (const char *)addr + size) return view;
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           free_ranges_above
+ *
+ * Find the first free range that ends above a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct range_entry *free_ranges_above( const void *addr )
+{
+    struct wine_rb_entry *ptr = free_ranges_tree.root;
+    struct range_entry *ret = NULL;
+
+    while (ptr)
     {
-        if ((const char *)view->base >= (const char *)addr + size) break;
-        if ((const char *)view->base + view->size > (const char *)addr) return view;
+        struct range_entry *range = WINE_RB_ENTRY_VALUE( ptr, struct range_entry, entry );
+        if ((const char *)range->end > (const char *)addr)
+        {
+            ret = range;
+            ptr = ptr->left;
+        }
+        else ptr = ptr->right;
     }
-    return NULL;
+    return ret;
+}
+
+
+/***********************************************************************
+ *           free_ranges_below
+ *
+ * Find the last free range that ends at or below a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct range_entry *free_ranges_below( const void *addr )
+{
+    struct wine_rb_entry *ptr = free_ranges_tree.root;
+    struct range_entry *ret = NULL;
+
+    while (ptr)
+    {
+        struct range_entry *range = WINE_RB_ENTRY_VALUE( ptr, struct range_entry, entry );
+        if ((const char *)range->end <= (const char *)addr)
+        {
+            ret = range;
+            ptr = ptr->right;
+        }
+        else ptr = ptr->left;
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           free_ranges_last
+ *
+ * Find the free range with the highest address.
+ * The csVirtual section must be held by caller.
+ */
+static struct range_entry *free_ranges_last(void)
+{
+    struct wine_rb_entry *ptr = free_ranges_tree.root;
+
+    if (!ptr) return NULL;
+    while (ptr->right) ptr = ptr->right;
+    return WINE_RB_ENTRY_VALUE( ptr, struct range_entry, entry );
+}
+
+
+/***********************************************************************
+ *           free_ranges_reserve
+ *
+ * Make sure that there are enough range entries, and enough room in the tree
+ * stack, for a given number of views. The csVirtual section must be held by caller.
+ */
+static BOOL free_ranges_reserve( unsigned int count )
+{
+    unsigned int depth = 2;
+
+    /* the path length is at most twice the black height, which is at most log2(count + 1) + 1 */
+    while (count >> (depth - 2)) depth++;
+    while (free_ranges_tree.stack.size < 2 * (depth + 1))
+        if (wine_rb_ensure_stack_size( &free_ranges_tree, free_ranges_tree.stack.size + 1 ) == -1)
+            return FALSE;
+
+    while (ranges_allocated < count + 1)
+    {
+        struct range_entry *range = RtlAllocateHeap( virtual_heap, 0, sizeof(*range) );
+        if (!range) return FALSE;
+        range->entry.left = spare_ranges;
+        spare_ranges = &range->entry;
+        ranges_allocated++;
+    }
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           free_ranges_add
+ *
+ * Add a new free range, using one of the reserved entries.
+ * The csVirtual section must be held by caller.
+ */
+static void free_ranges_add( void *base, void *end )
+{
+    struct range_entry *range = WINE_RB_ENTRY_VALUE( spare_ranges, struct range_entry, entry );
+
+    assert( spare_ranges );
+    spare_ranges = spare_ranges->left;
+    range->base = base;
+    range->end  = end;
+    if (wine_rb_put( &free_ranges_tree, base, &range->entry ) == -1) assert( 0 );
+}
+
+
+/***********************************************************************
+ *           free_ranges_delete
+ *
+ * Remove a free range and put its entry back in the spare list.
+ * The csVirtual section must be held by caller.
+ */
+static void free_ranges_delete( struct range_entry *range )
+{
+    wine_rb_remove( &free_ranges_tree, range->base );
+    range->entry.left = spare_ranges;
+    spare_ranges = &range->entry;
+}
+
+
+/***********************************************************************
+ *           free_ranges_insert_view
+ *
+ * Remove the area of a new view from the free ranges.
+ * The csVirtual section must be held by caller.
+ */
+static void free_ranges_insert_view( struct file_view *view )
+{
+    char *base = view->base, *end = base + view->size;
+    struct range_entry *range;
+
+    while ((range = free_ranges_above( base )) && (char *)range->base < end)
+    {
+        if ((char *)range->base < base)
+        {
+            if ((char *)range->end > end)  /* split the range */
+            {
+                void *range_end = range->end;
+                range->end = base;
+                free_ranges_add( end, range_end );
+                break;
+            }
+            range->end = base;
+        }
+        else if ((char *)range->end > end)
+        {
+            /* the order of the ranges doesn't change, so the key can be updated in place */
+            range->base = end;
+            break;
+        }
+        else free_ranges_delete( range );  /* the whole range is covered by the view */
+    }
+}
+
+
+/***********************************************************************
+ *           free_ranges_remove_view
+ *
+ * Add the area of a deleted view to the free ranges, merging it with its neighbors.
+ * The csVirtual section must be held by caller.
+ */
+static void free_ranges_remove_view( struct file_view *view )
+{
+    char *base = view->base, *end = base + view->size;
+    struct range_entry *prev = free_ranges_below( base );
+    struct range_entry *next = free_ranges_above( base );
+
+    if (prev && prev->end != base) prev = NULL;
+    if (next && next->base != end) next = NULL;
+
+    if (prev && next)
+    {
+        void *next_end = next->end;
+        free_ranges_delete( next );
+        prev->end = next_end;
+    }
+    else if (prev) prev->end = end;
+    else if (next) next->base = base;
+    else free_ranges_add( base, end );
 }
 
 
@@ -308,42 +619,46 @@ static struct file_view *find_view_range( const void *addr, size_t size )
  */
 static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
 {
-    struct list *ptr;
-    void *start;
+    struct range_entry *range;
+    char *start;
 
     if (top_down)
     {
         start = ROUND_ADDR( (char *)end - size, mask );
-        if (start >= end || start < base) return NULL;
+        if (start >= (char *)end || start < (char *)base) return NULL;
 
-        for (ptr = views_list.prev; ptr != &views_list; ptr = ptr->prev)
+        /* walk down from the last range that may contain the area, the start address only goes down */
+        if (!(range = free_ranges_above( start + size - 1 ))) range = free_ranges_last();
+        for ( ; range; range = free_ranges_below( range->base ))
         {
-            struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
-
-            if ((char *)view->base + view->size <= (char *)start) break;
-            if ((char *)view->base >= (char *)start + size) continue;
-            start = ROUND_ADDR( (char *)view->base - size, mask );
+            if ((char *)range->end <= (char *)base) break;
+            if ((size_t)((char *)range->end - (char *)range->base) < size) continue;
+            if ((char *)range->end - size < start) start = ROUND_ADDR( (char *)range->end - size, mask );
             /* stop if remaining space is not large enough */
-            if (!start || start >= end || start < base) return NULL;
+            if (start < (char *)base) return NULL;
+            if (start >= (char *)range->base) return start;
         }
     }
     else
     {
         start = ROUND_ADDR( (char *)base + mask, mask );
-        if (start >= end || (char *)end - (char *)start < size) return NULL;
+        if (start >= (char *)end || (char *)end - start < size) return NULL;
 
-        for (ptr = views_list.next; ptr != &views_list; ptr = ptr->next)
+        /* walk up from the first range that may contain the area, the start address only goes up */
+        for (range = free_ranges_above( start ); range; range = free_ranges_above( range->end ))
         {
-            struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
-
-            if ((char *)view->base >= (char *)start + size) break;
-            if ((char *)view->base + view->size <= (char *)start) continue;
-            start = ROUND_ADDR( (char *)view->base + view->size + mask, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
+            if ((char *)range->base >= (char *)end) break;
+            if ((char *)range->base > start)
+            {
+                start = ROUND_ADDR( (char *)range->base + mask, mask );
+                /* stop if remaining space is not large enough */
+                if (start < (char *)range->base || start >= (char *)end || (char *)end - start < size)
+                    return NULL;
+            }
+            if (start < (char *)range->end && (size_t)((char *)range->end - start) >= size) return start;
         }
     }
-    return start;
+    return NULL;
 }
 
 
@@ -380,13 +695,16 @@ static void add_reserved_area( void *addr, size_t size )
 static void remove_reserved_area( void *addr, size_t size )
 {
     struct file_view *view;
+    struct list *ptr;
 
     TRACE( "removing %p-%p\n", addr, (char *)addr + size );
     wine_mmap_remove_reserved_area( addr, size, 0 );
 
     /* unmap areas not covered by an existing view */
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+    if (!(view = find_view_above( addr ))) return;
+    for (ptr = &view->entry; ptr != &views_list; ptr = ptr->next)
     {
+        view = LIST_ENTRY( ptr, struct file_view, entry );
         if ((char *)view->base >= (char *)addr + size)
         {
             munmap( addr, size );
@@ -437,7 +755,10 @@ static inline void unmap_area( void *addr, size_t size )
 static void delete_view( struct file_view *view ) /* [in] View */
 {
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
+    wine_rb_remove( &views_tree, view->base );
     list_remove( &view->entry );
+    free_ranges_remove_view( view );
+    views_count--;
     if (view->mapping) close_handle( view->mapping );
     RtlFreeHeap( virtual_heap, 0, view );
 }
@@ -450,7 +771,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
  */
 static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t size, unsigned int vprot )
 {
-    struct file_view *view;
+    struct file_view *view, *pos;
     struct list *ptr;
     int unix_prot = VIRTUAL_GetUnixProt( vprot );
 
@@ -474,12 +795,8 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
 
     /* Insert it in the linked list */
 
-    LIST_FOR_EACH( ptr, &views_list )
-    {
-        struct file_view *next = LIST_ENTRY( ptr, struct file_view, entry );
-        if (next->base > base) break;
-    }
-    list_add_before( ptr, &view->entry );
+    if ((pos = find_view_below( (char *)base + 1 ))) list_add_after( &pos->entry, &view->entry );
+    else list_add_head( &views_list, &view->entry );
 
     /* Check for overlapping views. This can happen if the previous view
      * was a system view that got unmapped behind our back. In that case
@@ -510,6 +827,19 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
         }
     }
 
+    /* the tree can only be updated once the overlapping views are gone; the free
+     * ranges need one entry per view so that deleting a view never fails */
+    if (!free_ranges_reserve( views_count + 1 ) ||
+        wine_rb_put( &views_tree, base, &view->tree_entry ) == -1)
+    {
+        FIXME( "out of memory in virtual heap for %p-%p\n", base, (char *)base + size );
+        list_remove( &view->entry );
+        RtlFreeHeap( virtual_heap, 0, view );
+        return STATUS_NO_MEMORY;
+    }
+    free_ranges_insert_view( view );
+    views_count++;
+
     *view_ret = view;
     VIRTUAL_DEBUG_DUMP_VIEW( view );
 
@@ -1367,6 +1697,10 @@ void virtual_init(void)
     assert( heap_base != (void *)-1 );
     virtual_heap = RtlCreateHeap( HEAP_NO_SERIALIZE, heap_base, VIRTUAL_HEAP_SIZE,
                                   VIRTUAL_HEAP_SIZE, NULL, NULL );
+    if (wine_rb_init( &views_tree, &views_tree_funcs )) assert( 0 );
+    if (wine_rb_init( &free_ranges_tree, &free_ranges_funcs )) assert( 0 );
+    if (!free_ranges_reserve( 0 )) assert( 0 );
+    free_ranges_add( (void *)0, (void *)~(UINT_PTR)0 );
     create_view( &heap_view, heap_base, VIRTUAL_HEAP_SIZE, VPROT_COMMITTED | VPROT_READ | VPROT_WRITE );
 
     /* make the DOS area accessible (except the low 64K) to hide bugs in broken apps like Excel 2003 */
@@ -2231,30 +2565,22 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
     /* Find the view containing the address */
 
     server_enter_uninterrupted_section( &csVirtual, &sigset );
-    ptr = list_head( &views_list );
-    for (;;)
+    if ((view = find_view_above( base )) && (char *)view->base <= base)
     {
-        if (!ptr)
-        {
-            size = (char *)working_set_limit - alloc_base;
-            view = NULL;
-            break;
-        }
-        view = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)view->base > base)
-        {
-            size = (char *)view->base - alloc_base;
-            view = NULL;
-            break;
-        }
-        if ((char *)view->base + view->size > base)
+        alloc_base = view->base;
+        size = view->size;
+    }
+    else
+    {
+        /* the free area starts at the end of the previous view */
+        ptr = view ? list_prev( &views_list, &view->entry ) : list_tail( &views_list );
+        if (ptr)
         {
-            alloc_base = view->base;
-            size = view->size;
-            break;
+            struct file_view *prev = LIST_ENTRY( ptr, struct file_view, entry );
+            alloc_base = (char *)prev->base + prev->size;
         }
-        alloc_base = (char *)view->base + view->size;
-        ptr = list_next( &views_list, ptr );
+        size = (view ? (char *)view->base : (char *)working_set_limit) - alloc_base;
+        view = NULL;
     }
 
     /* Fill the info structure */
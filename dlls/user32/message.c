@@ -23,7 +23,16 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #define NONAMELESSUNION
 #define NONAMELESSSTRUCT
@@ -41,6 +50,7 @@
 #include "ddk/imm.h"
 #include "wine/unicode.h"
 #include "wine/server.h"
+#include "wine/library.h"
 #include "user_private.h"
 #include "win.h"
 #include "controls.h"
@@ -2721,6 +2731,147 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/* the server publishes the queue bits and masks in a shared region, so that
+ * peek_message can find out that there is nothing to retrieve without a
+ * server call; it still calls the server every so often for the hung
+ * window detection and to refresh the active hooks */
+#define SHARED_QUEUE_MAX_SKIP_TIME 1000  /* ms */
+
+static const struct shm_queue_status *shared_queues;
+static unsigned int nb_shared_queues;
+
+static HANDLE get_server_queue_handle(void);
+
+/***********************************************************************
+ *           map_shared_queue
+ *
+ * Get the status of a queue in the region shared by the server.
+ */
+static const struct shm_queue_status *map_shared_queue( unsigned int index )
+{
+#ifdef HAVE_SYS_MMAN_H
+    static const char name[] = "/queues";
+    const char *dir;
+    struct stat st;
+    char *path;
+    void *ptr;
+    int fd;
+
+    if (!index) return NULL;
+    if (!shared_queues)
+    {
+        if (!(dir = wine_get_server_dir())) return NULL;
+        if (!(path = HeapAlloc( GetProcessHeap(), 0, strlen(dir) + sizeof(name) ))) return NULL;
+        strcpy( path, dir );
+        strcat( path, name );
+        fd = open( path, O_RDONLY );
+        HeapFree( GetProcessHeap(), 0, path );
+        if (fd == -1) return NULL;
+
+        if (fstat( fd, &st ) == -1 ||
+            (ptr = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+        {
+            close( fd );
+            return NULL;
+        }
+        close( fd );
+
+        nb_shared_queues = st.st_size / sizeof(*shared_queues);
+        if (InterlockedCompareExchangePointer( (void **)&shared_queues, ptr, NULL ))
+            munmap( ptr, st.st_size );  /* another thread mapped it first */
+    }
+    if (index >= nb_shared_queues) return NULL;
+    return &shared_queues[index];
+#else
+    return NULL;
+#endif
+}
+
+static inline void shared_queue_barrier(void)
+{
+#ifdef __GNUC__
+    __sync_synchronize();
+#endif
+}
+
+/***********************************************************************
+ *           read_shared_queue
+ *
+ * Get a consistent copy of the current thread queue status.
+ */
+static BOOL read_shared_queue( struct shm_queue_status *status )
+{
+    const volatile struct shm_queue_status *shared = get_user_thread_info()->shared_queue;
+    int i, seq;
+
+    if (!shared) return FALSE;
+
+    for (i = 0; i < 100; i++)
+    {
+        if ((seq = shared->seq) & 1) continue;  /* being updated */
+        shared_queue_barrier();
+        status->wake_bits    = shared->wake_bits;
+        status->wake_mask    = shared->wake_mask;
+        status->changed_bits = shared->changed_bits;
+        status->changed_mask = shared->changed_mask;
+        shared_queue_barrier();
+        if (shared->seq == seq) return TRUE;
+    }
+    return FALSE;
+}
+
+/***********************************************************************
+ *           get_shared_queue_bits
+ *
+ * Get the current queue bits without a server call, if possible.
+ */
+BOOL get_shared_queue_bits( UINT *wake_bits, UINT *changed_bits )
+{
+    struct shm_queue_status status;
+
+    if (!read_shared_queue( &status )) return FALSE;
+    *wake_bits = status.wake_bits;
+    *changed_bits = status.changed_bits;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           is_queue_empty
+ *
+ * Check if a get_message request with the given parameters would return STATUS_PENDING
+ * without changing the queue state, so that the server call can be skipped.
+ */
+static BOOL is_queue_empty( HWND hwnd, UINT first, UINT last, UINT flags, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct shm_queue_status status;
+    UINT filter = flags >> 16, clear_bits = 0;
+
+    if (hwnd == HWND_TOPMOST) return FALSE;  /* the server sets the idle event */
+    if (GetTickCount() - thread_info->last_getmsg_time >= SHARED_QUEUE_MAX_SKIP_TIME) return FALSE;
+    if (!read_shared_queue( &status )) return FALSE;
+
+    if (!filter) filter = QS_ALLINPUT;
+
+    /* the server would clear these changed bits */
+    if (filter & QS_POSTMESSAGE)
+    {
+        clear_bits |= QS_POSTMESSAGE | QS_HOTKEY | QS_TIMER;
+        if (!first && last == ~0U) clear_bits |= QS_ALLPOSTMESSAGE;
+    }
+    if (filter & QS_INPUT) clear_bits |= QS_INPUT;
+    if (filter & QS_PAINT) clear_bits |= QS_PAINT;
+    if (status.changed_bits & clear_bits) return FALSE;
+
+    /* and set these masks */
+    if (status.wake_mask != (changed_mask & (QS_SENDMESSAGE | QS_SMRESULT))) return FALSE;
+    if (status.changed_mask != changed_mask) return FALSE;
+
+    /* sent messages and the quit message are returned whatever the filter */
+    return !(status.wake_bits & (QS_SENDMESSAGE | QS_POSTMESSAGE | filter));
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2747,6 +2898,14 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
         size_t size = 0;
         const message_data_t *msg_data = buffer;
 
+        if (!hw_id && is_queue_empty( hwnd, first, last, flags, changed_mask ))
+        {
+            HeapFree( GetProcessHeap(), 0, buffer );
+            thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+            thread_info->changed_mask = changed_mask;
+            return FALSE;
+        }
+
         SERVER_START_REQ( get_message )
         {
             req->flags     = flags;
@@ -2775,6 +2934,8 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
         }
         SERVER_END_REQ;
 
+        thread_info->last_getmsg_time = GetTickCount();
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
@@ -2782,6 +2943,8 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
             {
                 thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
                 thread_info->changed_mask = changed_mask;
+                /* make sure the shared status is available for the next time */
+                if (!thread_info->server_queue) get_server_queue_handle();
             }
             if (res != STATUS_BUFFER_OVERFLOW) return FALSE;
             if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
@@ -2990,6 +3153,7 @@ static HANDLE get_server_queue_handle(void)
         {
             wine_server_call( req );
             ret = wine_server_ptr_handle( reply->handle );
+            thread_info->shared_queue = map_shared_queue( reply->shm_index );
         }
         SERVER_END_REQ;
         thread_info->server_queue = ret;
@@ -10481,6 +10481,65 @@ static const struct message WmStopQuitSeq[] = {
     { 0 }
 };
 
+static DWORD WINAPI post_thread_message_proc(void *arg)
+{
+    PostThreadMessageA(HandleToUlong(arg), WM_USER + 1, 0, 0);
+    return 0;
+}
+
+static void test_PeekMessage_empty_queue(void)
+{
+    DWORD i, start, elapsed, status;
+    HANDLE thread;
+    BOOL ret;
+    MSG msg;
+
+    flush_events();
+    while (PeekMessageA(&msg, 0, 0, 0, PM_REMOVE)) DispatchMessageA(&msg);
+
+    start = GetTickCount();
+    for (i = 0; i < 100000; i++)
+    {
+        ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+        if (ret) break;
+    }
+    elapsed = GetTickCount() - start;
+    ok(!ret, "got message %04x\n", msg.message);
+    if (winetest_debug > 1)
+        trace("%u empty PeekMessage calls in %u ms\n", i, elapsed);
+
+    status = GetQueueStatus(QS_POSTMESSAGE | QS_SENDMESSAGE | QS_TIMER);
+    ok(!HIWORD(status), "got queue status %08x\n", status);
+
+    /* a message posted from another thread must be seen right away */
+    thread = CreateThread(NULL, 0, post_thread_message_proc, ULongToHandle(GetCurrentThreadId()), 0, NULL);
+    ok(WaitForSingleObject(thread, 5000) == WAIT_OBJECT_0, "thread didn't exit\n");
+    CloseHandle(thread);
+
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "got queue status %08x\n", status);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == MAKELONG(0, QS_POSTMESSAGE), "got queue status %08x\n", status);
+
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(ret && msg.message == WM_USER + 1, "got ret %d message %04x\n", ret, msg.message);
+    ret = PeekMessageA(&msg, 0, WM_USER + 2, WM_USER + 2, PM_REMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "got ret %d message %04x\n", ret, msg.message);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+
+    /* and so must an expired timer */
+    SetTimer(0, 0, 10, NULL);
+    start = GetTickCount();
+    while (!(ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE)) && GetTickCount() - start < 1000)
+        ;
+    ok(ret && msg.message == WM_TIMER, "got ret %d message %04x\n", ret, msg.message);
+    if (ret && msg.message == WM_TIMER) KillTimer(0, msg.wParam);
+    while (PeekMessageA(&msg, 0, 0, 0, PM_REMOVE)) DispatchMessageA(&msg);
+}
+
 static void test_quit_message(void)
 {
     MSG msg;
@@ -14552,6 +14611,7 @@ START_TEST(msg)
     test_ShowWindow();
     test_PeekMessage();
     test_PeekMessage2();
+    test_PeekMessage_empty_queue();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -7533,10 +7533,99 @@ static void test_window_without_child_style(void)
     DestroyWindow(hwnd);
 }
 
+static void test_other_process_window_info( char **argv )
+{
+    static const WCHAR otherW[] = {'o','t','h','e','r',0};
+    HWND parent, child, dead, ret;
+    DWORD tid, pid, expect_tid, expect_pid;
+    WCHAR buffer[32];
+    RECT rect;
+
+    sscanf( argv[3], "%p", &parent );
+    sscanf( argv[4], "%p", &child );
+    sscanf( argv[5], "%p", &dead );
+    sscanf( argv[6], "%x", &expect_tid );
+    sscanf( argv[7], "%x", &expect_pid );
+
+    ok( IsWindow( parent ), "parent %p is not a window\n", parent );
+    ok( IsWindow( child ), "child %p is not a window\n", child );
+    ok( IsWindow( (HWND)(ULONG_PTR)LOWORD(child) ), "truncated child %p is not a window\n", child );
+    ok( !IsWindow( dead ), "destroyed window %p is still a window\n", dead );
+
+    tid = GetWindowThreadProcessId( child, &pid );
+    ok( tid == expect_tid, "wrong tid %04x/%04x\n", tid, expect_tid );
+    ok( pid == expect_pid, "wrong pid %04x/%04x\n", pid, expect_pid );
+
+    ok( GetWindowLongA( child, GWL_STYLE ) & WS_CHILD, "wrong style %08x\n",
+        GetWindowLongA( child, GWL_STYLE ));
+    ok( GetWindowLongPtrA( child, GWLP_ID ) == 0x1234, "wrong id %lx\n",
+        GetWindowLongPtrA( child, GWLP_ID ));
+    ret = GetParent( child );
+    ok( ret == parent, "GetParent returned %p/%p\n", ret, parent );
+    ret = GetAncestor( child, GA_PARENT );
+    ok( ret == parent, "GetAncestor(GA_PARENT) returned %p/%p\n", ret, parent );
+    ret = GetAncestor( child, GA_ROOT );
+    ok( ret == parent, "GetAncestor(GA_ROOT) returned %p/%p\n", ret, parent );
+    ok( IsChild( parent, child ), "%p is not a child of %p\n", child, parent );
+
+    GetClientRect( child, &rect );
+    ok( rect.left == 0 && rect.top == 0 && rect.right == 30 && rect.bottom == 20,
+        "wrong client rect (%d,%d)-(%d,%d)\n", rect.left, rect.top, rect.right, rect.bottom );
+    GetWindowRect( child, &rect );
+    ok( rect.left == 105 && rect.top == 105 && rect.right == 135 && rect.bottom == 125,
+        "wrong window rect (%d,%d)-(%d,%d)\n", rect.left, rect.top, rect.right, rect.bottom );
+
+    buffer[0] = 'x';
+    InternalGetWindowText( child, buffer, sizeof(buffer) / sizeof(WCHAR) );
+    ok( !buffer[0], "child has text %s\n", wine_dbgstr_w( buffer ));
+    InternalGetWindowText( parent, buffer, sizeof(buffer) / sizeof(WCHAR) );
+    ok( !lstrcmpW( buffer, otherW ), "wrong parent text %s\n", wine_dbgstr_w( buffer ));
+}
+
+static void test_other_process_windows(void)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char **argv, cmdline[MAX_PATH + 128];
+    HWND parent, child, dead;
+
+    parent = CreateWindowExA( 0, "MainWindowClass", "other", WS_POPUP,
+                              100, 100, 200, 150, 0, 0, GetModuleHandleA(NULL), NULL );
+    ok( parent != 0, "CreateWindow failed\n" );
+    child = CreateWindowExA( 0, "static", NULL, WS_CHILD | WS_VISIBLE,
+                             5, 5, 30, 20, parent, (HMENU)0x1234, GetModuleHandleA(NULL), NULL );
+    ok( child != 0, "CreateWindow failed\n" );
+    dead = CreateWindowExA( 0, "static", NULL, WS_CHILD, 0, 0, 10, 10, parent, 0, 0, NULL );
+    ok( dead != 0, "CreateWindow failed\n" );
+    DestroyWindow( dead );
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "%s win other_process %p %p %p %x %x", argv[0], parent, child, dead,
+             GetCurrentThreadId(), GetCurrentProcessId() );
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    ok( CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed\n" );
+    winetest_wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+
+    DestroyWindow( parent );
+}
+
 START_TEST(win)
 {
     HMODULE user32 = GetModuleHandleA( "user32.dll" );
     HMODULE gdi32 = GetModuleHandleA("gdi32.dll");
+    char **argv;
+    int argc = winetest_get_mainargs( &argv );
+
+    if (argc >= 8 && !strcmp( argv[2], "other_process" ))
+    {
+        test_other_process_window_info( argv );
+        return;
+    }
+
     pGetAncestor = (void *)GetProcAddress( user32, "GetAncestor" );
     pGetWindowInfo = (void *)GetProcAddress( user32, "GetWindowInfo" );
     pGetWindowModuleFileNameA = (void *)GetProcAddress( user32, "GetWindowModuleFileNameA" );
@@ -7664,6 +7753,7 @@ START_TEST(win)
     test_map_points();
     test_update_region();
     test_window_without_child_style();
+    test_other_process_windows();
 
     /* add the tests above this line */
     if (hhook) UnhookWindowsHookEx(hhook);
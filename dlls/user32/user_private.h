@@ -167,6 +167,8 @@ struct wm_char_mapping_data
     MSG  get_msg;
 };
 
+struct shm_queue_status;
+
 /* this is the structure stored in TEB->Win32ClientInfo */
 /* no attempt is made to keep the layout compatible with the Windows one */
 struct user_thread_info
@@ -189,8 +191,10 @@ struct user_thread_info
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     RAWINPUT                     *rawinput;
+    const struct shm_queue_status *shared_queue;          /* Queue status shared by the server */
+    DWORD                         last_getmsg_time;       /* Time of last get_message call */
 
-    ULONG                         pad[6];                 /* Available for more data */
+    ULONG                         pad[3];                 /* Available for more data */
 };
 
 struct hook_extra_info
@@ -231,6 +235,7 @@ extern LRESULT call_current_hook( HHOOK hhook, INT code, WPARAM wparam, LPARAM l
 extern DWORD get_input_codepage( void ) DECLSPEC_HIDDEN;
 extern BOOL map_wparam_AtoW( UINT message, WPARAM *wparam, enum wm_char_mapping mapping ) DECLSPEC_HIDDEN;
 extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_queue_bits( UINT *wake_bits, UINT *changed_bits ) DECLSPEC_HIDDEN;
 extern LRESULT MSG_SendInternalMessageTimeout( DWORD dest_pid, DWORD dest_tid,
                                                UINT msg, WPARAM wparam, LPARAM lparam,
                                                UINT flags, UINT timeout, PDWORD_PTR res_ptr ) DECLSPEC_HIDDEN;
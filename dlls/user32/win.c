@@ -22,14 +22,24 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 #include "windef.h"
 #include "winbase.h"
 #include "winver.h"
 #include "wine/server.h"
 #include "wine/unicode.h"
+#include "wine/library.h"
 #include "win.h"
 #include "user_private.h"
 #include "controls.h"
@@ -344,6 +354,104 @@ static HWND *list_window_children( HDESK desktop, HWND hwnd, LPCWSTR class, DWOR
 }
 
 
+/* the server publishes the basic state of all the windows in a shared region,
+ * which lets us query windows of other processes without a server call */
+static const struct shm_window *shared_windows;
+static unsigned int nb_shared_windows;
+static BOOL shared_windows_failed;
+
+/***********************************************************************
+ *           map_shared_windows
+ *
+ * Map the window region shared by the server.
+ */
+static const struct shm_window *map_shared_windows(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    static const char name[] = "/windows";
+    const char *dir;
+    struct stat st;
+    char *path;
+    void *ptr;
+    int fd = -1;
+
+    if (shared_windows || shared_windows_failed) return shared_windows;
+
+    if ((dir = wine_get_server_dir()) &&
+        (path = HeapAlloc( GetProcessHeap(), 0, strlen(dir) + sizeof(name) )))
+    {
+        strcpy( path, dir );
+        strcat( path, name );
+        fd = open( path, O_RDONLY );
+        HeapFree( GetProcessHeap(), 0, path );
+    }
+    if (fd == -1 || fstat( fd, &st ) == -1 ||
+        (ptr = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        if (fd != -1) close( fd );
+        shared_windows_failed = TRUE;
+        return NULL;
+    }
+    close( fd );
+
+    nb_shared_windows = st.st_size / sizeof(*shared_windows);
+    if (InterlockedCompareExchangePointer( (void **)&shared_windows, ptr, NULL ))
+        munmap( ptr, st.st_size );  /* another thread mapped it first */
+    return shared_windows;
+#else
+    return NULL;
+#endif
+}
+
+static inline void shared_window_barrier(void)
+{
+#ifdef __GNUC__
+    __sync_synchronize();
+#endif
+}
+
+/***********************************************************************
+ *           get_shared_window
+ *
+ * Get a consistent copy of the shared state of a window.
+ * Fails if the handle isn't valid, or if the state cannot be read.
+ */
+static BOOL get_shared_window( HWND hwnd, struct shm_window *info )
+{
+    const volatile struct shm_window *shared;
+    WORD index = USER_HANDLE_TO_INDEX( hwnd );
+    WORD generation = HIWORD( hwnd );
+    int i, seq;
+
+    if (!map_shared_windows() || index >= nb_shared_windows) return FALSE;
+    shared = &shared_windows[index];
+
+    for (i = 0; i < 100; i++)
+    {
+        if ((seq = shared->seq) & 1) continue;  /* being updated */
+        shared_window_barrier();
+        info->handle      = shared->handle;
+        info->parent      = shared->parent;
+        info->owner       = shared->owner;
+        info->tid         = shared->tid;
+        info->pid         = shared->pid;
+        info->style       = shared->style;
+        info->ex_style    = shared->ex_style;
+        info->id          = shared->id;
+        info->text_len    = shared->text_len;
+        info->window_rect = *(const rectangle_t *)&shared->window_rect;
+        info->client_rect = *(const rectangle_t *)&shared->client_rect;
+        shared_window_barrier();
+        if (shared->seq != seq) continue;
+
+        if (LOWORD(info->handle) != LOWORD(hwnd)) return FALSE;
+        /* a zero or 0xffff generation matches any window, like for the server handles */
+        return (!generation || generation == 0xffff || generation == HIWORD(info->handle));
+    }
+    return FALSE;
+}
+
+
 /*******************************************************************
  *           list_window_parents
  *
@@ -362,16 +470,26 @@ static HWND *list_window_parents( HWND hwnd )
     for (;;)
     {
         if (!(win = WIN_GetPtr( current ))) goto empty;
-        if (win == WND_OTHER_PROCESS) break;  /* need to do it the hard way */
+        if (win == WND_OTHER_PROCESS)
+        {
+            struct shm_window info;
+
+            if (!get_shared_window( current, &info )) break;  /* need to do it the hard way */
+            if (!info.parent) win = WND_DESKTOP;
+            else list[pos] = current = wine_server_ptr_handle( info.parent );
+        }
         if (win == WND_DESKTOP)
         {
             if (!pos) goto empty;
             list[pos] = 0;
             return list;
         }
-        list[pos] = current = win->parent;
-        WIN_ReleasePtr( win );
-        if (!current) return list;
+        if (win != WND_OTHER_PROCESS)
+        {
+            list[pos] = current = win->parent;
+            WIN_ReleasePtr( win );
+            if (!current) return list;
+        }
         if (++pos == size - 1)
         {
             /* need to grow the list */
@@ -452,8 +570,15 @@ static void update_window_state( HWND hwnd )
  */
 static void get_server_window_text( HWND hwnd, LPWSTR text, INT count )
 {
+    struct shm_window info;
     size_t len = 0;
 
+    if (get_shared_window( hwnd, &info ) && !info.text_len)
+    {
+        text[0] = 0;
+        return;
+    }
+
     SERVER_START_REQ( get_window_text )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -689,6 +814,10 @@ HWND WIN_GetFullHandle( HWND hwnd )
     }
     else  /* may belong to another process */
     {
+        struct shm_window info;
+
+        if (get_shared_window( hwnd, &info )) return wine_server_ptr_handle( info.handle );
+
         SERVER_START_REQ( get_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -791,6 +920,64 @@ ULONG WIN_SetStyle( HWND hwnd, ULONG set_bits, ULONG clear_bits )
 }
 
 
+/***********************************************************************
+ *           get_shared_rectangles
+ *
+ * Get the window and client rectangles from the shared window state.
+ */
+static BOOL get_shared_rectangles( const struct shm_window *info, enum coords_relative relative,
+                                   RECT *rectWindow, RECT *rectClient )
+{
+    struct shm_window parent;
+    user_handle_t handle;
+    RECT window_rect, client_rect, parent_rect;
+
+    SetRect( &window_rect, info->window_rect.left, info->window_rect.top,
+             info->window_rect.right, info->window_rect.bottom );
+    SetRect( &client_rect, info->client_rect.left, info->client_rect.top,
+             info->client_rect.right, info->client_rect.bottom );
+
+    switch (relative)
+    {
+    case COORDS_CLIENT:
+        OffsetRect( &window_rect, -info->client_rect.left, -info->client_rect.top );
+        OffsetRect( &client_rect, -info->client_rect.left, -info->client_rect.top );
+        if (info->ex_style & WS_EX_LAYOUTRTL) mirror_rect( &client_rect, &window_rect );
+        break;
+    case COORDS_WINDOW:
+        OffsetRect( &window_rect, -info->window_rect.left, -info->window_rect.top );
+        OffsetRect( &client_rect, -info->window_rect.left, -info->window_rect.top );
+        if (info->ex_style & WS_EX_LAYOUTRTL) mirror_rect( &window_rect, &client_rect );
+        break;
+    case COORDS_PARENT:
+        if (!info->parent) break;
+        if (!get_shared_window( wine_server_ptr_handle( info->parent ), &parent )) return FALSE;
+        if (parent.ex_style & WS_EX_LAYOUTRTL)
+        {
+            SetRect( &parent_rect, parent.client_rect.left, parent.client_rect.top,
+                     parent.client_rect.right, parent.client_rect.bottom );
+            mirror_rect( &parent_rect, &window_rect );
+            mirror_rect( &parent_rect, &client_rect );
+        }
+        break;
+    case COORDS_SCREEN:
+        for (handle = info->parent; handle; handle = parent.parent)
+        {
+            if (!get_shared_window( wine_server_ptr_handle( handle ), &parent )) return FALSE;
+            if (!parent.parent) break;  /* reached the desktop */
+            OffsetRect( &window_rect, parent.client_rect.left, parent.client_rect.top );
+            OffsetRect( &client_rect, parent.client_rect.left, parent.client_rect.top );
+        }
+        break;
+    default:
+        return FALSE;
+    }
+    if (rectWindow) *rectWindow = window_rect;
+    if (rectClient) *rectClient = client_rect;
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           WIN_GetRectangles
  *
@@ -798,6 +985,7 @@ ULONG WIN_SetStyle( HWND hwnd, ULONG set_bits, ULONG clear_bits )
  */
 BOOL WIN_GetRectangles( HWND hwnd, enum coords_relative relative, RECT *rectWindow, RECT *rectClient )
 {
+    struct shm_window info;
     WND *win = WIN_GetPtr( hwnd );
     BOOL ret = TRUE;
 
@@ -898,6 +1086,10 @@ BOOL WIN_GetRectangles( HWND hwnd, enum coords_relative relative, RECT *rectWind
     }
 
 other_process:
+    if (get_shared_window( hwnd, &info ) &&
+        get_shared_rectangles( &info, relative, rectWindow, rectClient ))
+        return TRUE;
+
     SERVER_START_REQ( get_window_rectangles )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2207,11 +2399,20 @@ static LONG_PTR WIN_GetWindowLong( HWND hwnd, INT offset, UINT size, BOOL unicod
 
     if (wndPtr == WND_OTHER_PROCESS || wndPtr == WND_DESKTOP)
     {
+        struct shm_window info;
+
         if (offset == GWLP_WNDPROC)
         {
             SetLastError( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE || offset == GWLP_ID) &&
+            get_shared_window( hwnd, &info ))
+        {
+            if (offset == GWL_STYLE) return info.style;
+            if (offset == GWL_EXSTYLE) return info.ex_style;
+            return info.id;
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -2792,6 +2993,7 @@ INT WINAPI GetWindowTextLengthW( HWND hwnd )
  */
 BOOL WINAPI IsWindow( HWND hwnd )
 {
+    struct shm_window info;
     WND *ptr;
     BOOL ret;
 
@@ -2805,6 +3007,8 @@ BOOL WINAPI IsWindow( HWND hwnd )
     }
 
     /* check other processes */
+    if (get_shared_window( hwnd, &info )) return TRUE;
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2820,6 +3024,7 @@ BOOL WINAPI IsWindow( HWND hwnd )
  */
 DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
 {
+    struct shm_window info;
     WND *ptr;
     DWORD tid = 0;
 
@@ -2839,6 +3044,12 @@ DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
     }
 
     /* check other processes */
+    if (get_shared_window( hwnd, &info ))
+    {
+        if (process) *process = info.pid;
+        return info.tid;
+    }
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2869,7 +3080,17 @@ HWND WINAPI GetParent( HWND hwnd )
     if (wndPtr == WND_DESKTOP) return 0;
     if (wndPtr == WND_OTHER_PROCESS)
     {
-        LONG style = GetWindowLongW( hwnd, GWL_STYLE );
+        struct shm_window info;
+        LONG style;
+
+        if (get_shared_window( hwnd, &info ))
+        {
+            if (info.style & WS_POPUP) retvalue = wine_server_ptr_handle( info.owner );
+            else if (info.style & WS_CHILD) retvalue = wine_server_ptr_handle( info.parent );
+            return retvalue;
+        }
+
+        style = GetWindowLongW( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
@@ -2899,6 +3120,7 @@ HWND WINAPI GetParent( HWND hwnd )
  */
 HWND WINAPI GetAncestor( HWND hwnd, UINT type )
 {
+    struct shm_window info;
     WND *win;
     HWND *list, ret = 0;
 
@@ -2916,6 +3138,10 @@ HWND WINAPI GetAncestor( HWND hwnd, UINT type )
             ret = win->parent;
             WIN_ReleasePtr( win );
         }
+        else if (get_shared_window( hwnd, &info ))
+        {
+            ret = wine_server_ptr_handle( info.parent );
+        }
         else /* need to query the server */
         {
             SERVER_START_REQ( get_window_tree )
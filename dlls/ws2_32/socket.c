@@ -63,6 +63,9 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
@@ -363,6 +366,19 @@ typedef struct ws2_accept_async
     struct ws2_async    *read;
 } ws2_accept_async;
 
+typedef struct ws2_transmit_async
+{
+    HANDLE                      hSocket;
+    LPOVERLAPPED                user_overlapped;
+    DWORD                       flags;        /* TF_* flags */
+    DWORD                       send_size;    /* maximum size of a single send */
+    char                       *buffer;       /* bounce buffer if the file can't be sent directly */
+    unsigned int                n_elements;
+    unsigned int                cur;          /* element currently being sent */
+    ULONG                       offset;       /* bytes already sent from the current element */
+    TRANSMIT_PACKETS_ELEMENT    elements[1];
+} ws2_transmit_async;
+
 /****************************************************************/
 
 /* ----------------------------------- internal data */
@@ -674,6 +690,7 @@ static NTSTATUS sock_get_ntstatus( int err )
         case EPIPE:
         case ECONNRESET:        return STATUS_CONNECTION_RESET;
         case ECONNABORTED:      return STATUS_CONNECTION_ABORTED;
+        case ENOBUFS:           return STATUS_INSUFFICIENT_RESOURCES;
 
         case 0:                 return STATUS_SUCCESS;
         default:
@@ -809,6 +826,7 @@ static inline DWORD NtStatusToWSAError( const DWORD status )
     case STATUS_IO_TIMEOUT:
     case STATUS_TIMEOUT:                    wserr = WSAETIMEDOUT;          break;
     case STATUS_NO_MEMORY:                  wserr = WSAEFAULT;             break;
+    case STATUS_INSUFFICIENT_RESOURCES:     wserr = WSAENOBUFS;            break;
     case STATUS_ACCESS_DENIED:              wserr = WSAEACCES;             break;
     case STATUS_TOO_MANY_OPENED_FILES:      wserr = WSAEMFILE;             break;
     case STATUS_CANT_WAIT:                  wserr = WSAEWOULDBLOCK;        break;
@@ -2062,6 +2080,9 @@ static NTSTATUS WS2_async_accept( void *arg, IO_STATUS_BLOCK *iosb, NTSTATUS sta
         if (status == STATUS_CANT_WAIT)
             return STATUS_PENDING;
 
+        /* the accepting socket got a new fd, forget the one we may have cached */
+        if (status == STATUS_SUCCESS) wine_server_uncache_fd( wsa->accept_socket );
+
         if (status == STATUS_INVALID_HANDLE)
         {
             FIXME("AcceptEx accepting socket closed but request was not cancelled\n");
@@ -2947,6 +2968,398 @@ connection_success:
 }
 
 
+/***********************************************************************
+ *     TransmitFile, TransmitPackets and DisconnectEx
+ */
+
+#define TRANSMIT_BUFFER_SIZE 65536
+
+/* user APC called upon async transmit completion */
+static void WINAPI ws2_async_transmit_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserved )
+{
+    struct ws2_transmit_async *wsa = arg;
+
+    HeapFree( GetProcessHeap(), 0, wsa->buffer );
+    HeapFree( GetProcessHeap(), 0, wsa );
+}
+
+/***********************************************************************
+ *              WS2_transmit_file       (INTERNAL)
+ *
+ * Send up to len bytes of a file element, without copying them through
+ * user space if the platform allows it.
+ */
+static int WS2_transmit_file( int fd, struct ws2_transmit_async *wsa,
+                              const TRANSMIT_PACKETS_ELEMENT *elem, size_t len )
+{
+    ULONGLONG pos = elem->u.s.nFileOffset.QuadPart + wsa->offset;
+    int file_fd, ret, err;
+
+    if (wine_server_handle_to_fd( elem->u.s.hFile, FILE_READ_DATA, &file_fd, NULL ))
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+#ifdef HAVE_SYS_SENDFILE_H
+    {
+        off_t off = pos;
+
+        ret = sendfile( fd, file_fd, &off, len );
+        if (ret >= 0 || (errno != EINVAL && errno != ENOSYS)) goto done;
+        /* not supported for this kind of file, fall back to copying */
+    }
+#endif
+
+    if (!wsa->buffer && !(wsa->buffer = HeapAlloc( GetProcessHeap(), 0, TRANSMIT_BUFFER_SIZE )))
+    {
+        errno = ENOBUFS;
+        ret = -1;
+        goto done;
+    }
+    /* anything read but not sent is simply read again on the next call */
+    ret = pread( file_fd, wsa->buffer, min( len, TRANSMIT_BUFFER_SIZE ), pos );
+    if (ret > 0) ret = send( fd, wsa->buffer, ret, 0 );
+
+done:
+    err = errno;
+    wine_server_release_fd( elem->u.s.hFile, file_fd );
+    errno = err;
+    return ret;
+}
+
+/***********************************************************************
+ *              WS2_transmit            (INTERNAL)
+ *
+ * Workhorse for both synchronous and asynchronous transmit operations;
+ * sends as much as possible without blocking.
+ */
+static NTSTATUS WS2_transmit( int fd, struct ws2_transmit_async *wsa, ULONG_PTR *sent )
+{
+    while (wsa->cur < wsa->n_elements)
+    {
+        const TRANSMIT_PACKETS_ELEMENT *elem = &wsa->elements[wsa->cur];
+        size_t len = min( elem->cLength - wsa->offset, wsa->send_size );
+        int ret;
+
+        if (len)
+        {
+            if (elem->dwElFlags & TP_ELEMENT_FILE)
+                ret = WS2_transmit_file( fd, wsa, elem, len );
+            else
+                ret = send( fd, (char *)elem->u.pBuffer + wsa->offset, len, 0 );
+
+            if (ret == -1)
+            {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN) return STATUS_PENDING;
+                return wsaErrStatus();
+            }
+            *sent += ret;
+            wsa->offset += ret;
+            /* a file may be shorter than requested, in which case we stop at its end */
+            if (ret && wsa->offset < elem->cLength) continue;
+        }
+        wsa->cur++;
+        wsa->offset = 0;
+    }
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *              WS2_transmit_disconnect (INTERNAL)
+ *
+ * Close the sending side of the connection once all data has been sent,
+ * as requested by TF_DISCONNECT and TF_REUSE_SOCKET.
+ */
+static NTSTATUS WS2_transmit_disconnect( int fd, struct ws2_transmit_async *wsa )
+{
+    if (!(wsa->flags & (TF_DISCONNECT | TF_REUSE_SOCKET))) return STATUS_SUCCESS;
+
+    if (shutdown( fd, SHUT_WR ) == -1 && errno != ENOTCONN) return wsaErrStatus();
+
+    /* a reusable socket looks unconnected again, so that AcceptEx can
+     * attach a new connection to it */
+    if (wsa->flags & TF_REUSE_SOCKET)
+        _enable_event( wsa->hSocket, 0, 0, FD_WINE_CONNECTED|FD_READ|FD_WRITE );
+    else
+        _enable_event( wsa->hSocket, 0, 0, FD_WRITE );
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *              WS2_async_transmit      (INTERNAL)
+ *
+ * Handler for overlapped transmit operations.
+ */
+static NTSTATUS WS2_async_transmit( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS status, void **apc )
+{
+    struct ws2_transmit_async *wsa = user;
+    int fd;
+
+    if (status == STATUS_ALERTED)
+    {
+        if (!(status = wine_server_handle_to_fd( wsa->hSocket, FILE_WRITE_DATA, &fd, NULL )))
+        {
+            status = WS2_transmit( fd, wsa, &iosb->Information );
+            if (status == STATUS_SUCCESS) status = WS2_transmit_disconnect( fd, wsa );
+            wine_server_release_fd( wsa->hSocket, fd );
+        }
+    }
+    if (status != STATUS_PENDING)
+    {
+        iosb->u.Status = status;
+        *apc = ws2_async_transmit_apc;
+    }
+    return status;
+}
+
+static struct ws2_transmit_async *alloc_transmit_async( SOCKET s, unsigned int count, DWORD send_size,
+                                                        LPOVERLAPPED ov, DWORD flags )
+{
+    struct ws2_transmit_async *wsa;
+
+    if (!(wsa = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct ws2_transmit_async, elements[count] ))))
+        return NULL;
+
+    wsa->hSocket         = SOCKET2HANDLE(s);
+    wsa->user_overlapped = ov;
+    wsa->flags           = flags;
+    wsa->send_size       = send_size ? send_size : ~0u;
+    wsa->buffer          = NULL;
+    wsa->n_elements      = count;
+    wsa->cur             = 0;
+    wsa->offset          = 0;
+    return wsa;
+}
+
+/* resolve the default offset and length of a file element */
+static NTSTATUS prepare_transmit_element( TRANSMIT_PACKETS_ELEMENT *elem )
+{
+    FILE_POSITION_INFORMATION pos;
+    FILE_STANDARD_INFORMATION std;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+
+    switch (elem->dwElFlags & (TP_ELEMENT_MEMORY | TP_ELEMENT_FILE))
+    {
+    case TP_ELEMENT_MEMORY:
+        return (elem->cLength && !elem->u.pBuffer) ? STATUS_INVALID_PARAMETER : STATUS_SUCCESS;
+    case TP_ELEMENT_FILE:
+        break;
+    default:
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (elem->u.s.nFileOffset.QuadPart == -1)
+    {
+        status = NtQueryInformationFile( elem->u.s.hFile, &io, &pos, sizeof(pos), FilePositionInformation );
+        if (status) return status;
+        elem->u.s.nFileOffset = pos.CurrentByteOffset;
+    }
+    if (!elem->cLength)
+    {
+        status = NtQueryInformationFile( elem->u.s.hFile, &io, &std, sizeof(std), FileStandardInformation );
+        if (status) return status;
+        if (std.EndOfFile.QuadPart > elem->u.s.nFileOffset.QuadPart)
+            elem->cLength = min( std.EndOfFile.QuadPart - elem->u.s.nFileOffset.QuadPart, ~0u );
+    }
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *              WS2_transmit_start      (INTERNAL)
+ *
+ * Common part of TransmitFile(), TransmitPackets() and DisconnectEx().
+ * Takes ownership of wsa.
+ */
+static BOOL WS2_transmit_start( SOCKET s, struct ws2_transmit_async *wsa )
+{
+    LPOVERLAPPED ov = wsa->user_overlapped;
+    ULONG_PTR cvalue = (ov && ((ULONG_PTR)ov->hEvent & 1) == 0) ? (ULONG_PTR)ov : 0;
+    IO_STATUS_BLOCK local_iosb, *iosb = ov ? (IO_STATUS_BLOCK *)ov : &local_iosb;
+    unsigned int options;
+    NTSTATUS status;
+    BOOL overlapped;
+    int fd;
+
+    if ((fd = get_sock_fd( s, FILE_WRITE_DATA, &options )) == -1)
+    {
+        ws2_async_transmit_apc( wsa, NULL, 0 );
+        return FALSE;
+    }
+    overlapped = ov && !(options & (FILE_SYNCHRONOUS_IO_ALERT | FILE_SYNCHRONOUS_IO_NONALERT));
+
+    iosb->Information = 0;
+    for (;;)
+    {
+        status = WS2_transmit( fd, wsa, &iosb->Information );
+        if (status == STATUS_SUCCESS) status = WS2_transmit_disconnect( fd, wsa );
+        if (status != STATUS_PENDING || overlapped) break;
+        if (do_block( fd, POLLOUT, -1 ) == -1)
+        {
+            status = wsaErrStatus();
+            break;
+        }
+    }
+    release_sock_fd( s, fd );
+
+    if (status == STATUS_PENDING)
+    {
+        iosb->u.Status = STATUS_PENDING;
+
+        SERVER_START_REQ( register_async )
+        {
+            req->type           = ASYNC_TYPE_WRITE;
+            req->async.handle   = wine_server_obj_handle( wsa->hSocket );
+            req->async.callback = wine_server_client_ptr( WS2_async_transmit );
+            req->async.iosb     = wine_server_client_ptr( iosb );
+            req->async.arg      = wine_server_client_ptr( wsa );
+            req->async.event    = wine_server_obj_handle( ov->hEvent );
+            req->async.cvalue   = cvalue;
+            status = wine_server_call( req );
+        }
+        SERVER_END_REQ;
+
+        /* Enable the event only after starting the async. The server will deliver it as soon as
+           the async is done. */
+        _enable_event( wsa->hSocket, FD_WRITE, 0, 0 );
+
+        if (status != STATUS_PENDING) ws2_async_transmit_apc( wsa, NULL, 0 );
+        SetLastError( NtStatusToWSAError( status ));
+        return FALSE;
+    }
+
+    ws2_async_transmit_apc( wsa, NULL, 0 );
+    iosb->u.Status = status;
+    if (status)
+    {
+        SetLastError( NtStatusToWSAError( status ));
+        return FALSE;
+    }
+    if (ov)
+    {
+        if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, iosb->Information );
+        if (ov->hEvent) SetEvent( ov->hEvent );
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *     TransmitPackets
+ */
+static BOOL WINAPI WS2_TransmitPackets( SOCKET s, LPTRANSMIT_PACKETS_ELEMENT array, DWORD count,
+                                        DWORD send_size, LPOVERLAPPED ov, DWORD flags )
+{
+    struct ws2_transmit_async *wsa;
+    NTSTATUS status;
+    DWORD i;
+
+    TRACE("(%lx, %p, %u, %u, %p, %x)\n", s, array, count, send_size, ov, flags);
+
+    if (count && !array)
+    {
+        SetLastError( WSAEINVAL );
+        return FALSE;
+    }
+    if (!(wsa = alloc_transmit_async( s, count, send_size, ov, flags )))
+    {
+        SetLastError( WSAENOBUFS );
+        return FALSE;
+    }
+
+    if (count) memcpy( wsa->elements, array, count * sizeof(*array) );
+    for (i = 0; i < count; i++)
+    {
+        if ((status = prepare_transmit_element( &wsa->elements[i] )))
+        {
+            ws2_async_transmit_apc( wsa, NULL, 0 );
+            SetLastError( NtStatusToWSAError( status ));
+            return FALSE;
+        }
+    }
+    return WS2_transmit_start( s, wsa );
+}
+
+/***********************************************************************
+ *     TransmitFile
+ */
+static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE file, DWORD file_bytes, DWORD bytes_per_send,
+                                     LPOVERLAPPED ov, LPTRANSMIT_FILE_BUFFERS buffers, DWORD flags )
+{
+    struct ws2_transmit_async *wsa;
+    TRANSMIT_PACKETS_ELEMENT *elem;
+    NTSTATUS status;
+
+    TRACE("(%lx, %p, %u, %u, %p, %p, %x)\n", s, file, file_bytes, bytes_per_send, ov, buffers, flags);
+
+    if (!(wsa = alloc_transmit_async( s, 3, bytes_per_send, ov, flags )))
+    {
+        SetLastError( WSAENOBUFS );
+        return FALSE;
+    }
+
+    elem = wsa->elements;
+    if (buffers && buffers->HeadLength)
+    {
+        elem->dwElFlags = TP_ELEMENT_MEMORY;
+        elem->cLength   = buffers->HeadLength;
+        elem->u.pBuffer = buffers->Head;
+        elem++;
+    }
+    if (file)
+    {
+        elem->dwElFlags = TP_ELEMENT_FILE;
+        elem->cLength   = file_bytes;
+        elem->u.s.hFile = file;
+        /* overlapped requests take the offset from the overlapped structure */
+        if (ov) elem->u.s.nFileOffset.QuadPart = ((ULONGLONG)ov->u.s.OffsetHigh << 32) | ov->u.s.Offset;
+        else elem->u.s.nFileOffset.QuadPart = -1;
+        elem++;
+    }
+    if (buffers && buffers->TailLength)
+    {
+        elem->dwElFlags = TP_ELEMENT_MEMORY;
+        elem->cLength   = buffers->TailLength;
+        elem->u.pBuffer = buffers->Tail;
+        elem++;
+    }
+    wsa->n_elements = elem - wsa->elements;
+
+    for (elem = wsa->elements; elem < wsa->elements + wsa->n_elements; elem++)
+    {
+        if ((status = prepare_transmit_element( elem )))
+        {
+            ws2_async_transmit_apc( wsa, NULL, 0 );
+            SetLastError( NtStatusToWSAError( status ));
+            return FALSE;
+        }
+    }
+    return WS2_transmit_start( s, wsa );
+}
+
+/***********************************************************************
+ *     DisconnectEx
+ */
+static BOOL WINAPI WS2_DisconnectEx( SOCKET s, LPOVERLAPPED ov, DWORD flags, DWORD reserved )
+{
+    struct ws2_transmit_async *wsa;
+
+    TRACE("(%lx, %p, %x, %x)\n", s, ov, flags, reserved);
+
+    if (flags & ~TF_REUSE_SOCKET)
+    {
+        SetLastError( WSAEINVAL );
+        return FALSE;
+    }
+    if (!(wsa = alloc_transmit_async( s, 0, 0, ov, flags | TF_DISCONNECT )))
+    {
+        SetLastError( WSAENOBUFS );
+        return FALSE;
+    }
+    return WS2_transmit_start( s, wsa );
+}
+
 /***********************************************************************
  *		getpeername		(WS2_32.5)
  */
@@ -4007,7 +4420,8 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         }
         else if ( IsEqualGUID(&disconnectex_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented DisconnectEx\n");
+            *(LPFN_DISCONNECTEX *)out_buff = WS2_DisconnectEx;
+            break;
         }
         else if ( IsEqualGUID(&acceptex_guid, in_buff) )
         {
@@ -4021,11 +4435,13 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         }
         else if ( IsEqualGUID(&transmitfile_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitFile\n");
+            *(LPFN_TRANSMITFILE *)out_buff = WS2_TransmitFile;
+            break;
         }
         else if ( IsEqualGUID(&transmitpackets_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitPackets\n");
+            *(LPFN_TRANSMITPACKETS *)out_buff = WS2_TransmitPackets;
+            break;
         }
         else if ( IsEqualGUID(&wsarecvmsg_guid, in_buff) )
         {
@@ -4361,7 +4777,7 @@ static void release_poll_fds( const WS_fd_set *readfds, const WS_fd_set *writefd
             if (fds[j].fd != -1)
             {
                 /* make sure we have a real error before releasing the fd */
-                if (!sock_error_p( fds[j].fd )) fds[j].revents = 0;
+                if (fds[j].revents && !sock_error_p( fds[j].fd )) fds[j].revents = 0;
                 release_sock_fd( exceptfds->fd_array[i], fds[j].fd );
             }
     }
@@ -4399,36 +4815,19 @@ static int get_poll_results( WS_fd_set *readfds, WS_fd_set *writefds, WS_fd_set
 }
 
 
-/***********************************************************************
- *		select			(WS2_32.18)
- */
-int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
-                     WS_fd_set *ws_writefds, WS_fd_set *ws_exceptfds,
-                     const struct WS_timeval* ws_timeout)
+/* poll the fds, restarting on signals until the timeout (in ms, -1 for infinite) expires */
+static int do_poll( struct pollfd *fds, unsigned int count, int timeout )
 {
-    struct pollfd *pollfds;
     struct timeval tv1, tv2;
-    int torig = 0;
-    int count, ret, timeout = -1;
-
-    TRACE("read %p, write %p, excp %p timeout %p\n",
-          ws_readfds, ws_writefds, ws_exceptfds, ws_timeout);
+    int ret, torig = timeout;
 
-    if (!(pollfds = fd_sets_to_poll( ws_readfds, ws_writefds, ws_exceptfds, &count )))
-        return SOCKET_ERROR;
+    if (timeout >= 0) gettimeofday( &tv1, 0 );
 
-    if (ws_timeout)
-    {
-        torig = (ws_timeout->tv_sec * 1000) + (ws_timeout->tv_usec + 999) / 1000;
-        timeout = torig;
-        gettimeofday( &tv1, 0 );
-    }
-
-    while ((ret = poll( pollfds, count, timeout )) < 0)
+    while ((ret = poll( fds, count, timeout )) < 0)
     {
         if (errno == EINTR)
         {
-            if (!ws_timeout) continue;
+            if (torig < 0) continue;
             gettimeofday( &tv2, 0 );
 
             tv2.tv_sec  -= tv1.tv_sec;
@@ -4443,6 +4842,30 @@ int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
             if (timeout <= 0) break;
         } else break;
     }
+    return ret;
+}
+
+
+/***********************************************************************
+ *		select			(WS2_32.18)
+ */
+int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
+                     WS_fd_set *ws_writefds, WS_fd_set *ws_exceptfds,
+                     const struct WS_timeval* ws_timeout)
+{
+    struct pollfd *pollfds;
+    int count, ret, timeout = -1;
+
+    TRACE("read %p, write %p, excp %p timeout %p\n",
+          ws_readfds, ws_writefds, ws_exceptfds, ws_timeout);
+
+    if (!(pollfds = fd_sets_to_poll( ws_readfds, ws_writefds, ws_exceptfds, &count )))
+        return SOCKET_ERROR;
+
+    if (ws_timeout)
+        timeout = (ws_timeout->tv_sec * 1000) + (ws_timeout->tv_usec + 999) / 1000;
+
+    ret = do_poll( pollfds, count, timeout );
     release_poll_fds( ws_readfds, ws_writefds, ws_exceptfds, pollfds );
 
     if (ret == -1) SetLastError(wsaErrno());
@@ -4451,6 +4874,88 @@ int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
     return ret;
 }
 
+
+/* map WSAPoll events to their Unix equivalents */
+static short poll_events_w2u( SHORT events )
+{
+    short ret = 0;
+
+    if (events & WS_POLLRDNORM) ret |= POLLIN;
+    if (events & WS_POLLRDBAND) ret |= POLLPRI;
+    if (events & (WS_POLLWRNORM | WS_POLLWRBAND)) ret |= POLLOUT;
+    return ret;
+}
+
+/* map Unix poll results back to the WSAPoll events that were asked for */
+static SHORT poll_events_u2w( short revents, SHORT events )
+{
+    SHORT ret = 0;
+
+    if (revents & POLLIN) ret |= WS_POLLRDNORM;
+    if (revents & POLLPRI) ret |= WS_POLLRDBAND;
+    if (revents & POLLOUT) ret |= WS_POLLWRNORM;
+    ret &= events;
+    if (revents & POLLERR) ret |= WS_POLLERR;
+    if (revents & POLLHUP) ret |= WS_POLLHUP;
+    if (revents & POLLNVAL) ret |= WS_POLLNVAL;
+    return ret;
+}
+
+/***********************************************************************
+ *		WSAPoll			(WS2_32.@)
+ */
+int WINAPI WSAPoll( WSAPOLLFD *wfds, ULONG count, int timeout )
+{
+    struct pollfd *fds;
+    int ret, invalid = 0;
+    ULONG i;
+
+    TRACE("(%p, %u, %d)\n", wfds, count, timeout);
+
+    if (!wfds || !count)
+    {
+        SetLastError( WSAEINVAL );
+        return SOCKET_ERROR;
+    }
+    if (!(fds = HeapAlloc( GetProcessHeap(), 0, count * sizeof(fds[0]) )))
+    {
+        SetLastError( WSAENOBUFS );
+        return SOCKET_ERROR;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        fds[i].events  = poll_events_w2u( wfds[i].events );
+        fds[i].revents = 0;
+        /* poll() skips negative fds, entries with a negative socket are ignored,
+         * other invalid sockets are reported as POLLNVAL below */
+        if ((INT_PTR)wfds[i].fd < 0) fds[i].fd = -1;
+        else if (wine_server_handle_to_fd( SOCKET2HANDLE(wfds[i].fd), 0, &fds[i].fd, NULL ))
+        {
+            fds[i].fd = -1;
+            invalid++;
+        }
+    }
+
+    ret = do_poll( fds, count, invalid ? 0 : timeout );
+
+    if (ret == -1) SetLastError( wsaErrno() );
+    else ret = 0;
+    for (i = 0; i < count; i++)
+    {
+        if ((INT_PTR)wfds[i].fd < 0) wfds[i].revents = 0;
+        else if (fds[i].fd == -1) wfds[i].revents = WS_POLLNVAL;
+        else
+        {
+            wfds[i].revents = poll_events_u2w( fds[i].revents, wfds[i].events );
+            release_sock_fd( wfds[i].fd, fds[i].fd );
+        }
+        if (ret != -1 && wfds[i].revents) ret++;
+    }
+    HeapFree( GetProcessHeap(), 0, fds );
+    return ret;
+}
+
 /* helper to send completion messages for client-only i/o operation case */
 static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus,
                               ULONG Information )
@@ -4461,6 +4966,7 @@ static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS C
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = 0;
         wine_server_call( req );
     }
     SERVER_END_REQ;
@@ -67,6 +67,7 @@ static int   (WINAPI *pgetaddrinfo)(LPCSTR,LPCSTR,const struct addrinfo *,struct
 static void  (WINAPI *pFreeAddrInfoW)(PADDRINFOW);
 static int   (WINAPI *pGetAddrInfoW)(LPCWSTR,LPCWSTR,const ADDRINFOW *,PADDRINFOW *);
 static PCSTR (WINAPI *pInetNtop)(INT,LPVOID,LPSTR,ULONG);
+static int   (WINAPI *pWSAPoll)(WSAPOLLFD *,ULONG,INT);
 static int   (WINAPI *pWSALookupServiceBeginW)(LPWSAQUERYSETW,DWORD,LPHANDLE);
 static int   (WINAPI *pWSALookupServiceEnd)(HANDLE);
 static int   (WINAPI *pWSALookupServiceNextW)(HANDLE,DWORD,LPDWORD,LPWSAQUERYSETW);
@@ -1139,6 +1140,7 @@ static void Init (void)
     pFreeAddrInfoW = (void *)GetProcAddress(hws2_32, "FreeAddrInfoW");
     pGetAddrInfoW = (void *)GetProcAddress(hws2_32, "GetAddrInfoW");
     pInetNtop = (void *)GetProcAddress(hws2_32, "inet_ntop");
+    pWSAPoll = (void *)GetProcAddress(hws2_32, "WSAPoll");
     pWSALookupServiceBeginW = (void *)GetProcAddress(hws2_32, "WSALookupServiceBeginW");
     pWSALookupServiceEnd = (void *)GetProcAddress(hws2_32, "WSALookupServiceEnd");
     pWSALookupServiceNextW = (void *)GetProcAddress(hws2_32, "WSALookupServiceNextW");
@@ -5423,6 +5425,42 @@ static void test_WSARecv(void)
     closesocket(dest);
     dest = INVALID_SOCKET;
 
+    tcp_socketpair(&src, &dest);
+    if (src == INVALID_SOCKET || dest == INVALID_SOCKET)
+    {
+        skip("failed to create sockets\n");
+        goto end;
+    }
+
+    iret = WSARecv(dest, &bufs, 1, &bytesReturned, &flags, &ov, NULL);
+    ok(iret == SOCKET_ERROR && GetLastError() == ERROR_IO_PENDING, "WSARecv failed - %d error %d\n", iret, GetLastError());
+
+    iret = send(src, "test message", sizeof("test message"), 0);
+    ok(iret == sizeof("test message"), "send returned %d\n", iret);
+
+    dwret = WaitForSingleObject(ov.hEvent, 1000);
+    ok(dwret == WAIT_OBJECT_0, "Waiting for recv event failed with %d + errno %d\n", dwret, GetLastError());
+
+    bret = GetOverlappedResult((HANDLE)dest, &ov, &bytesReturned, FALSE);
+    ok(bret, "GetOverlappedResult failed, error %d\n", GetLastError());
+    ok(bytesReturned == sizeof("test message"), "Bytes received is %d\n", bytesReturned);
+    ok(!memcmp(buf, "test message", sizeof("test message")), "got %s\n", buf);
+
+    iret = WSARecv(dest, &bufs, 1, &bytesReturned, &flags, &ov, NULL);
+    ok(iret == SOCKET_ERROR && GetLastError() == ERROR_IO_PENDING, "WSARecv failed - %d error %d\n", iret, GetLastError());
+
+    closesocket(dest);
+    dest = INVALID_SOCKET;
+
+    dwret = WaitForSingleObject(ov.hEvent, 1000);
+    ok(dwret == WAIT_OBJECT_0, "Waiting for recv event failed with %d + errno %d\n", dwret, GetLastError());
+
+    bret = GetOverlappedResult((HANDLE)dest, &ov, &bytesReturned, FALSE);
+    ok(!bret && GetLastError() == ERROR_OPERATION_ABORTED, "GetOverlappedResult returned %d, error %d\n", bret, GetLastError());
+    ok(bytesReturned == 0, "Bytes received is %d\n", bytesReturned);
+    closesocket(src);
+    src = INVALID_SOCKET;
+
     src = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, 0);
     ok(src != INVALID_SOCKET, "failed to create socket %d\n", WSAGetLastError());
     if (src == INVALID_SOCKET) goto end;
@@ -5467,6 +5505,131 @@ end:
         WSACloseEvent(ov.hEvent);
 }
 
+/* pending receives have to behave the same whoever polls the socket */
+static void test_pending_recv(void)
+{
+    BOOL (WINAPI *pCancelIoEx)(HANDLE, OVERLAPPED *);
+    struct timeval timeout = { 1, 0 };
+    WSANETWORKEVENTS events;
+    SOCKET src, dst, tmp;
+    WSAOVERLAPPED ov;
+    fd_set readfds;
+    WSADATA data;
+    WSABUF buf;
+    DWORD bytes, flags;
+    HANDLE event;
+    char buffer[32];
+    BOOL bret;
+    int ret;
+
+    pCancelIoEx = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "CancelIoEx");
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(FALSE, "failed to create socket pair\n");
+        return;
+    }
+    buf.buf = buffer;
+    buf.len = sizeof(buffer);
+
+    /* without an event, waiting on the socket handle */
+    memset(&ov, 0, sizeof(ov));
+    flags = 0;
+    ret = WSARecv(dst, &buf, 1, &bytes, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d error %d\n",
+       ret, WSAGetLastError());
+    ret = send(src, "test", 4, 0);
+    ok(ret == 4, "send returned %d\n", ret);
+    bytes = 0;
+    bret = WSAGetOverlappedResult(dst, &ov, &bytes, TRUE, &flags);
+    ok(bret, "WSAGetOverlappedResult failed, error %d\n", WSAGetLastError());
+    ok(bytes == 4, "got %u bytes\n", bytes);
+    ok(!memcmp(buffer, "test", 4), "wrong data\n");
+
+    /* cancelled by CancelIo */
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = WSACreateEvent();
+    ret = WSARecv(dst, &buf, 1, &bytes, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d error %d\n",
+       ret, WSAGetLastError());
+    bret = CancelIo((HANDLE)dst);
+    ok(bret, "CancelIo failed, error %u\n", GetLastError());
+    ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "receive not cancelled\n");
+    bret = WSAGetOverlappedResult(dst, &ov, &bytes, FALSE, &flags);
+    ok(!bret && WSAGetLastError() == ERROR_OPERATION_ABORTED, "got %d error %d\n", bret, WSAGetLastError());
+
+    /* cancelled by CancelIoEx */
+    if (pCancelIoEx)
+    {
+        ret = WSARecv(dst, &buf, 1, &bytes, &flags, &ov, NULL);
+        ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d error %d\n",
+           ret, WSAGetLastError());
+        bret = pCancelIoEx((HANDLE)dst, &ov);
+        ok(bret, "CancelIoEx failed, error %u\n", GetLastError());
+        ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "receive not cancelled\n");
+        bret = WSAGetOverlappedResult(dst, &ov, &bytes, FALSE, &flags);
+        ok(!bret && WSAGetLastError() == ERROR_OPERATION_ABORTED, "got %d error %d\n", bret, WSAGetLastError());
+    }
+    else win_skip("CancelIoEx not available\n");
+
+    /* FD_READ is enabled again once the receive completed */
+    event = WSACreateEvent();
+    ret = WSAEventSelect(dst, event, FD_READ);
+    ok(!ret, "WSAEventSelect failed, error %d\n", WSAGetLastError());
+    ret = WSARecv(dst, &buf, 1, &bytes, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d error %d\n",
+       ret, WSAGetLastError());
+    ret = send(src, "test", 4, 0);
+    ok(ret == 4, "send returned %d\n", ret);
+    ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "receive not completed\n");
+    bret = WSAGetOverlappedResult(dst, &ov, &bytes, FALSE, &flags);
+    ok(bret && bytes == 4, "got %d bytes %u error %d\n", bret, bytes, WSAGetLastError());
+    WSAEnumNetworkEvents(dst, event, &events);
+    ret = send(src, "more", 4, 0);
+    ok(ret == 4, "send returned %d\n", ret);
+    ok(WaitForSingleObject(event, 1000) == WAIT_OBJECT_0, "FD_READ not signaled\n");
+    ret = WSAEnumNetworkEvents(dst, event, &events);
+    ok(!ret, "WSAEnumNetworkEvents failed, error %d\n", WSAGetLastError());
+    ok(events.lNetworkEvents & FD_READ, "got events %x\n", events.lNetworkEvents);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == 4, "recv returned %d\n", ret);
+    WSAEventSelect(dst, NULL, 0);
+    WSACloseEvent(event);
+
+    /* outstanding operations survive an unbalanced cleanup */
+    ret = WSAStartup(MAKEWORD(2,2), &data);
+    ok(!ret, "WSAStartup failed, error %d\n", ret);
+    ret = WSARecv(dst, &buf, 1, &bytes, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d error %d\n",
+       ret, WSAGetLastError());
+    ret = WSACleanup();
+    ok(!ret, "WSACleanup failed, error %d\n", WSAGetLastError());
+    ret = send(src, "test", 4, 0);
+    ok(ret == 4, "send returned %d\n", ret);
+    ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "receive not completed\n");
+    bret = WSAGetOverlappedResult(dst, &ov, &bytes, FALSE, &flags);
+    ok(bret && bytes == 4, "got %d bytes %u error %d\n", bret, bytes, WSAGetLastError());
+
+    /* closing the socket with a pending receive closes the connection */
+    ret = WSARecv(dst, &buf, 1, &bytes, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d error %d\n",
+       ret, WSAGetLastError());
+    tmp = dst;
+    closesocket(dst);
+    ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "receive not aborted\n");
+    bret = WSAGetOverlappedResult(tmp, &ov, &bytes, FALSE, &flags);
+    ok(!bret, "WSAGetOverlappedResult succeeded\n");
+    FD_ZERO(&readfds);
+    FD_SET(src, &readfds);
+    ret = select(0, &readfds, NULL, NULL, &timeout);
+    ok(ret == 1, "select returned %d\n", ret);
+    ret = recv(src, buffer, sizeof(buffer), 0);
+    ok(ret == 0 || (ret == SOCKET_ERROR && WSAGetLastError() == WSAECONNRESET),
+       "recv returned %d error %d\n", ret, WSAGetLastError());
+    WSACloseEvent(ov.hEvent);
+    closesocket(src);
+}
+
 static void test_GetAddrInfoW(void)
 {
     static const WCHAR port[] = {'8','0',0};
@@ -6816,6 +6979,441 @@ end:
     return ret;
 }
 
+static int recv_all(SOCKET s, char *buf, int len)
+{
+    int ret, total = 0;
+
+    while (total < len)
+    {
+        ret = recv(s, buf + total, len - total, 0);
+        if (ret <= 0) break;
+        total += ret;
+    }
+    return total;
+}
+
+static void test_TransmitFile(void)
+{
+    static char head[] = "head", tail[] = "tail";
+    GUID transmitFileGuid = WSAID_TRANSMITFILE;
+    LPFN_TRANSMITFILE pTransmitFile = NULL;
+    char temp_path[MAX_PATH], filename[MAX_PATH];
+    char data[16384], buf[sizeof(data) + 8];
+    TRANSMIT_FILE_BUFFERS buffers;
+    SOCKET src, dst;
+    OVERLAPPED ov;
+    HANDLE file;
+    DWORD size, i;
+    BOOL bret;
+    int ret;
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(FALSE, "failed to create socket pair\n");
+        return;
+    }
+
+    ret = WSAIoctl(src, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitFileGuid, sizeof(transmitFileGuid),
+                   &pTransmitFile, sizeof(pTransmitFile), &size, NULL, NULL);
+    if (ret || !pTransmitFile)
+    {
+        win_skip("TransmitFile not available\n");
+        closesocket(src);
+        closesocket(dst);
+        return;
+    }
+
+    for (i = 0; i < sizeof(data); i++) data[i] = i * 7;
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "tf", 0, filename);
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    WriteFile(file, data, sizeof(data), &size, NULL);
+    ok(size == sizeof(data), "wrong size %u\n", size);
+    SetFilePointer(file, 0, NULL, FILE_BEGIN);
+
+    buffers.Head = head;
+    buffers.HeadLength = 4;
+    buffers.Tail = tail;
+    buffers.TailLength = 4;
+
+    /* whole file from the current position, with head and tail */
+    bret = pTransmitFile(src, file, 0, 0, NULL, &buffers, 0);
+    ok(bret, "TransmitFile failed, error %d\n", WSAGetLastError());
+    ret = recv_all(dst, buf, sizeof(buf));
+    ok(ret == sizeof(buf), "received %d bytes\n", ret);
+    ok(!memcmp(buf, head, 4), "wrong head\n");
+    ok(!memcmp(buf + 4, data, sizeof(data)), "wrong file data\n");
+    ok(!memcmp(buf + 4 + sizeof(data), tail, 4), "wrong tail\n");
+
+    /* overlapped, with an explicit offset and size */
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    ov.Offset = 1000;
+    bret = pTransmitFile(src, file, 2000, 0, &ov, NULL, 0);
+    ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitFile failed, error %d\n", WSAGetLastError());
+    ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "wait failed\n");
+    bret = GetOverlappedResult((HANDLE)src, &ov, &size, FALSE);
+    ok(bret, "GetOverlappedResult failed, error %u\n", GetLastError());
+    ok(size == 2000, "wrong size %u\n", size);
+    ret = recv_all(dst, buf, 2000);
+    ok(ret == 2000, "received %d bytes\n", ret);
+    ok(!memcmp(buf, data + 1000, 2000), "wrong file data\n");
+    CloseHandle(ov.hEvent);
+
+    /* buffers only, then disconnect */
+    bret = pTransmitFile(src, NULL, 0, 0, NULL, &buffers, TF_DISCONNECT);
+    ok(bret, "TransmitFile failed, error %d\n", WSAGetLastError());
+    ret = recv_all(dst, buf, sizeof(buf));
+    ok(ret == 8, "received %d bytes\n", ret);
+    ok(!memcmp(buf, "headtail", 8), "wrong data\n");
+
+    CloseHandle(file);
+    closesocket(src);
+    closesocket(dst);
+}
+
+static void test_WSAPoll(void)
+{
+    WSAPOLLFD fds[3];
+    SOCKET src, dst, tmp;
+    DWORD start, ticks;
+    char buf = 'x';
+    int ret;
+
+    if (!pWSAPoll)
+    {
+        win_skip("WSAPoll not available\n");
+        return;
+    }
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(FALSE, "failed to create socket pair\n");
+        return;
+    }
+
+    fds[0].fd = src;
+    fds[0].events = POLLRDNORM | POLLWRNORM;
+    fds[0].revents = 0xdead;
+    fds[1].fd = dst;
+    fds[1].events = POLLRDNORM;
+    fds[1].revents = 0xdead;
+    ret = pWSAPoll(fds, 2, 0);
+    ok(ret == 1, "got %d\n", ret);
+    ok(fds[0].revents == POLLWRNORM, "got %x\n", fds[0].revents);
+    ok(fds[1].revents == 0, "got %x\n", fds[1].revents);
+
+    ret = send(src, &buf, 1, 0);
+    ok(ret == 1, "send returned %d\n", ret);
+    ret = pWSAPoll(fds, 2, 1000);
+    ok(ret == 2, "got %d\n", ret);
+    ok(fds[1].revents == POLLRDNORM, "got %x\n", fds[1].revents);
+
+    /* negative sockets are ignored */
+    fds[2].fd = INVALID_SOCKET;
+    fds[2].events = POLLRDNORM;
+    fds[2].revents = 0xdead;
+    ret = pWSAPoll(fds + 1, 2, 1000);
+    ok(ret == 1, "got %d\n", ret);
+    ok(fds[1].revents == POLLRDNORM, "got %x\n", fds[1].revents);
+    ok(fds[2].revents == 0, "got %x\n", fds[2].revents);
+
+    /* and don't make the call return early */
+    fds[1].fd = src;
+    fds[1].events = POLLRDNORM;
+    start = GetTickCount();
+    ret = pWSAPoll(fds + 1, 2, 200);
+    ticks = GetTickCount() - start;
+    ok(ret == 0, "got %d\n", ret);
+    ok(ticks >= 100, "returned after %u ms\n", ticks);
+
+    /* closed sockets are invalid */
+    tmp = socket(AF_INET, SOCK_STREAM, 0);
+    ok(tmp != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+    closesocket(tmp);
+    fds[2].fd = tmp;
+    ret = pWSAPoll(fds + 2, 1, 1000);
+    ok(ret == 1, "got %d\n", ret);
+    ok(fds[2].revents == POLLNVAL, "got %x\n", fds[2].revents);
+
+    SetLastError(0xdeadbeef);
+    ret = pWSAPoll(fds, 0, 0);
+    ok(ret == SOCKET_ERROR, "got %d\n", ret);
+    ok(WSAGetLastError() == WSAEINVAL, "got error %d\n", WSAGetLastError());
+
+    closesocket(src);
+    closesocket(dst);
+}
+
+/* fd_set large enough for the scalability test */
+struct big_fd_set
+{
+    u_int  fd_count;
+    SOCKET fd_array[8192];
+};
+
+static void test_select_scalability(void)
+{
+    static const unsigned int sizes[] = { 64, 1024, 8192 };
+    static struct big_fd_set set;
+    static WSAPOLLFD fds[8192];
+    static SOCKET socks[8192];
+    struct timeval timeout = { 0, 0 };
+    unsigned int i, j, n, count = 0, iterations;
+    DWORD start;
+    int ret;
+
+    if (!winetest_interactive)
+    {
+        skip("select scalability test (set WINETEST_INTERACTIVE=1)\n");
+        return;
+    }
+
+    for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++)
+    {
+        while (count < sizes[n])
+        {
+            if ((socks[count] = socket(AF_INET, SOCK_DGRAM, 0)) == INVALID_SOCKET) break;
+            count++;
+        }
+        if (count < sizes[n])
+        {
+            skip("could only create %u sockets\n", count);
+            break;
+        }
+
+        /* nothing is readable, so select has to look at every socket and return none */
+        iterations = 65536 / count;
+        start = GetTickCount();
+        for (i = 0; i < iterations; i++)
+        {
+            set.fd_count = count;
+            memcpy(set.fd_array, socks, count * sizeof(SOCKET));
+            ret = select(0, (fd_set *)&set, NULL, NULL, &timeout);
+            if (ret) break;
+        }
+        ok(!ret, "select returned %d\n", ret);
+        trace("select: %u sockets, %u iterations in %u ms\n", count, iterations, GetTickCount() - start);
+
+        if (!pWSAPoll) continue;
+        for (j = 0; j < count; j++)
+        {
+            fds[j].fd = socks[j];
+            fds[j].events = POLLRDNORM;
+        }
+        start = GetTickCount();
+        for (i = 0; i < iterations; i++)
+        {
+            ret = pWSAPoll(fds, count, 0);
+            if (ret) break;
+        }
+        ok(!ret, "WSAPoll returned %d\n", ret);
+        trace("WSAPoll: %u sockets, %u iterations in %u ms\n", count, iterations, GetTickCount() - start);
+    }
+
+    for (i = 0; i < count; i++) closesocket(socks[i]);
+}
+
+static void test_TransmitPackets(void)
+{
+    static char head[] = "head", tail[] = "tail";
+    GUID transmitPacketsGuid = WSAID_TRANSMITPACKETS;
+    LPFN_TRANSMITPACKETS pTransmitPackets = NULL;
+    char temp_path[MAX_PATH], filename[MAX_PATH];
+    char data[4096], buf[sizeof(data) + 8];
+    TRANSMIT_PACKETS_ELEMENT elems[3];
+    OVERLAPPED ov, *povl;
+    SOCKET src, dst;
+    HANDLE file, port;
+    ULONG_PTR key;
+    DWORD size, i;
+    BOOL bret;
+    int ret;
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(FALSE, "failed to create socket pair\n");
+        return;
+    }
+
+    ret = WSAIoctl(src, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitPacketsGuid, sizeof(transmitPacketsGuid),
+                   &pTransmitPackets, sizeof(pTransmitPackets), &size, NULL, NULL);
+    if (ret || !pTransmitPackets)
+    {
+        win_skip("TransmitPackets not available\n");
+        closesocket(src);
+        closesocket(dst);
+        return;
+    }
+
+    for (i = 0; i < sizeof(data); i++) data[i] = i * 3;
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "tp", 0, filename);
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    WriteFile(file, data, sizeof(data), &size, NULL);
+    ok(size == sizeof(data), "wrong size %u\n", size);
+
+    memset(elems, 0, sizeof(elems));
+    elems[0].dwElFlags = TP_ELEMENT_MEMORY;
+    elems[0].cLength = 4;
+    elems[0].pBuffer = head;
+    elems[1].dwElFlags = TP_ELEMENT_FILE;
+    elems[1].cLength = 0;  /* up to the end of the file */
+    elems[1].hFile = file;
+    elems[1].nFileOffset.QuadPart = 0;
+    elems[2].dwElFlags = TP_ELEMENT_MEMORY;
+    elems[2].cLength = 4;
+    elems[2].pBuffer = tail;
+
+    bret = pTransmitPackets(src, elems, 3, 0, NULL, 0);
+    ok(bret, "TransmitPackets failed, error %d\n", WSAGetLastError());
+    ret = recv_all(dst, buf, sizeof(buf));
+    ok(ret == sizeof(buf), "received %d bytes\n", ret);
+    ok(!memcmp(buf, head, 4), "wrong head\n");
+    ok(!memcmp(buf + 4, data, sizeof(data)), "wrong file data\n");
+    ok(!memcmp(buf + 4 + sizeof(data), tail, 4), "wrong tail\n");
+
+    /* small send size */
+    elems[1].cLength = 1000;
+    elems[1].nFileOffset.QuadPart = 100;
+    bret = pTransmitPackets(src, elems + 1, 1, 64, NULL, 0);
+    ok(bret, "TransmitPackets failed, error %d\n", WSAGetLastError());
+    ret = recv_all(dst, buf, 1000);
+    ok(ret == 1000, "received %d bytes\n", ret);
+    ok(!memcmp(buf, data + 100, 1000), "wrong file data\n");
+
+    /* invalid element */
+    elems[0].dwElFlags = 0;
+    SetLastError(0xdeadbeef);
+    bret = pTransmitPackets(src, elems, 1, 0, NULL, 0);
+    ok(!bret, "TransmitPackets succeeded\n");
+    ok(WSAGetLastError() == WSAEINVAL, "wrong error %d\n", WSAGetLastError());
+    elems[0].dwElFlags = TP_ELEMENT_MEMORY;
+
+    /* completion port notification */
+    port = CreateIoCompletionPort((HANDLE)src, NULL, 0xbeef, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed, error %u\n", GetLastError());
+    memset(&ov, 0, sizeof(ov));
+    bret = pTransmitPackets(src, elems, 3, 0, &ov, 0);
+    ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitPackets failed, error %d\n", WSAGetLastError());
+    ret = recv_all(dst, buf, 1008);
+    ok(ret == 1008, "received %d bytes\n", ret);
+    ok(!memcmp(buf + 4, data + 100, 1000), "wrong file data\n");
+    key = 0;
+    povl = NULL;
+    bret = GetQueuedCompletionStatus(port, &size, &key, &povl, 1000);
+    ok(bret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+    ok(key == 0xbeef, "wrong key %lx\n", key);
+    ok(povl == &ov, "wrong overlapped %p\n", povl);
+    ok(size == 1008, "wrong size %u\n", size);
+
+    CloseHandle(file);
+    closesocket(src);
+    closesocket(dst);
+    CloseHandle(port);
+}
+
+static void test_DisconnectEx(void)
+{
+    GUID disconnectExGuid = WSAID_DISCONNECTEX, acceptExGuid = WSAID_ACCEPTEX;
+    LPFN_DISCONNECTEX pDisconnectEx = NULL;
+    LPFN_ACCEPTEX pAcceptEx = NULL;
+    SOCKET listener, acceptor, connector, src, dst;
+    struct sockaddr_in addr;
+    char buffer[2 * (sizeof(struct sockaddr_in) + 16)];
+    OVERLAPPED ov;
+    DWORD size;
+    BOOL bret;
+    int ret, len, i;
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(FALSE, "failed to create socket pair\n");
+        return;
+    }
+
+    ret = WSAIoctl(src, SIO_GET_EXTENSION_FUNCTION_POINTER, &disconnectExGuid, sizeof(disconnectExGuid),
+                   &pDisconnectEx, sizeof(pDisconnectEx), &size, NULL, NULL);
+    if (ret || !pDisconnectEx)
+    {
+        win_skip("DisconnectEx not available\n");
+        closesocket(src);
+        closesocket(dst);
+        return;
+    }
+
+    SetLastError(0xdeadbeef);
+    bret = pDisconnectEx(src, NULL, 0x80, 0);
+    ok(!bret, "DisconnectEx succeeded\n");
+    ok(WSAGetLastError() == WSAEINVAL, "wrong error %d\n", WSAGetLastError());
+
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    bret = pDisconnectEx(src, &ov, 0, 0);
+    ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "DisconnectEx failed, error %d\n", WSAGetLastError());
+    ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "wait failed\n");
+    bret = GetOverlappedResult((HANDLE)src, &ov, &size, FALSE);
+    ok(bret, "GetOverlappedResult failed, error %u\n", GetLastError());
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == 0, "recv returned %d\n", ret);
+    closesocket(src);
+    closesocket(dst);
+
+    /* a socket disconnected with TF_REUSE_SOCKET can accept another connection */
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    ok(listener != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+    acceptor = socket(AF_INET, SOCK_STREAM, 0);
+    ok(acceptor != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ret = bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "bind failed, error %d\n", WSAGetLastError());
+    len = sizeof(addr);
+    ret = getsockname(listener, (struct sockaddr *)&addr, &len);
+    ok(!ret, "getsockname failed, error %d\n", WSAGetLastError());
+    ret = listen(listener, 5);
+    ok(!ret, "listen failed, error %d\n", WSAGetLastError());
+    ret = WSAIoctl(listener, SIO_GET_EXTENSION_FUNCTION_POINTER, &acceptExGuid, sizeof(acceptExGuid),
+                   &pAcceptEx, sizeof(pAcceptEx), &size, NULL, NULL);
+    ok(!ret, "failed to get AcceptEx, error %d\n", WSAGetLastError());
+
+    for (i = 0; i < 2; i++)
+    {
+        ResetEvent(ov.hEvent);
+        bret = pAcceptEx(listener, acceptor, buffer, 0, sizeof(struct sockaddr_in) + 16,
+                         sizeof(struct sockaddr_in) + 16, &size, &ov);
+        ok(!bret && WSAGetLastError() == ERROR_IO_PENDING, "%d: AcceptEx returned %d error %d\n",
+           i, bret, WSAGetLastError());
+
+        connector = socket(AF_INET, SOCK_STREAM, 0);
+        ok(connector != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+        ret = connect(connector, (struct sockaddr *)&addr, sizeof(addr));
+        ok(!ret, "%d: connect failed, error %d\n", i, WSAGetLastError());
+        ok(WaitForSingleObject(ov.hEvent, 1000) == WAIT_OBJECT_0, "%d: AcceptEx not completed\n", i);
+        bret = GetOverlappedResult((HANDLE)listener, &ov, &size, FALSE);
+        ok(bret, "%d: GetOverlappedResult failed, error %u\n", i, GetLastError());
+
+        ret = send(acceptor, "test", 4, 0);
+        ok(ret == 4, "%d: send returned %d, error %d\n", i, ret, WSAGetLastError());
+        ret = recv_all(connector, buffer, 4);
+        ok(ret == 4 && !memcmp(buffer, "test", 4), "%d: received %d bytes\n", i, ret);
+
+        bret = pDisconnectEx(acceptor, NULL, TF_REUSE_SOCKET, 0);
+        ok(bret, "%d: DisconnectEx failed, error %d\n", i, WSAGetLastError());
+        ret = recv(connector, buffer, sizeof(buffer), 0);
+        ok(ret == 0, "%d: recv returned %d\n", i, ret);
+        closesocket(connector);
+    }
+
+    CloseHandle(ov.hEvent);
+    closesocket(acceptor);
+    closesocket(listener);
+}
+
 static void test_completion_port(void)
 {
     HANDLE previous_port, io_port;
@@ -7707,6 +8305,7 @@ START_TEST( sock )
     test_errors();
     test_listen();
     test_select();
+    test_WSAPoll();
     test_accept();
     test_getpeername();
     test_getsockname();
@@ -7719,6 +8318,7 @@ START_TEST( sock )
     test_WSASendMsg();
     test_WSASendTo();
     test_WSARecv();
+    test_pending_recv();
 
     test_events(0);
     test_events(1);
@@ -7728,6 +8328,9 @@ START_TEST( sock )
     test_getaddrinfo();
     test_AcceptEx();
     test_ConnectEx();
+    test_TransmitFile();
+    test_TransmitPackets();
+    test_DisconnectEx();
 
     test_sioRoutingInterfaceQuery();
 
@@ -7741,6 +8344,7 @@ START_TEST( sock )
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
     test_send();
     test_synchronous_WSAIoctl();
+    test_select_scalability();
 
     Exit();
 }
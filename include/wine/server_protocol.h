@@ -373,6 +373,16 @@ typedef struct
     int          high_part;
 } luid_t;
 
+
+typedef struct
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+} completion_msg_t;
+
 #define MAX_ACL_LEN 65535
 
 struct security_descriptor
@@ -653,6 +663,61 @@ struct rawinput_device
 };
 
 
+struct shm_sync_object
+{
+    int            state;
+    unsigned int   count;
+    int            abandoned;
+    int            client_waiters;
+    int            seq;
+    unsigned int   owned_prev;
+    unsigned int   owned_next;
+    int            reserved[9];
+};
+
+
+struct shm_sync_info
+{
+    unsigned int   type;
+    unsigned int   max;
+    int            manual_reset;
+    int            server_waiters;
+    unsigned int   generation;
+    unsigned int   pulse;
+    int            reserved[2];
+};
+enum shm_sync_type { SHM_SYNC_NONE, SHM_SYNC_EVENT, SHM_SYNC_MUTEX, SHM_SYNC_SEMAPHORE, SHM_SYNC_THREAD };
+
+
+struct shm_queue_status
+{
+    int            seq;
+    unsigned int   wake_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_bits;
+    unsigned int   changed_mask;
+    int            reserved[3];
+};
+
+
+struct shm_window
+{
+    int            seq;
+    user_handle_t  handle;
+    user_handle_t  parent;
+    user_handle_t  owner;
+    thread_id_t    tid;
+    process_id_t   pid;
+    unsigned int   style;
+    unsigned int   ex_style;
+    unsigned int   id;
+    data_size_t    text_len;
+    rectangle_t    window_rect;
+    rectangle_t    client_rect;
+    int            reserved[6];
+};
+
+
 
 
 
@@ -1293,6 +1358,34 @@ struct query_semaphore_reply
 };
 
 
+
+struct get_shm_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_shm_sync_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    unsigned int access;
+    unsigned int generation;
+    unsigned int owner;
+};
+
+
+
+struct wake_shm_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct wake_shm_sync_reply
+{
+    struct reply_header __header;
+};
+
+
 struct open_semaphore_request
 {
     struct request_header __header;
@@ -1394,6 +1487,8 @@ struct get_handle_fd_reply
     int          cacheable;
     unsigned int access;
     unsigned int options;
+    unsigned int comp_flags;
+    char __pad_28[4];
 };
 enum server_fd_type
 {
@@ -2810,7 +2905,7 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    unsigned int shm_index;
 };
 
 
@@ -4907,6 +5002,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completion_msgs); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -4943,7 +5051,7 @@ struct add_fd_completion_request
     apc_param_t    cvalue;
     apc_param_t    information;
     unsigned int   status;
-    char __pad_36[4];
+    int            async;
 };
 struct add_fd_completion_reply
 {
@@ -4952,6 +5060,34 @@ struct add_fd_completion_reply
 
 
 
+struct set_fd_completion_mode_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+    unsigned int   flags;
+    char __pad_20[4];
+};
+struct set_fd_completion_mode_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct set_fd_pending_io_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+    int            pending;
+    char __pad_20[4];
+};
+struct set_fd_pending_io_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct get_window_layered_info_request
 {
     struct request_header __header;
@@ -5081,6 +5217,22 @@ struct set_suspend_context_reply
 };
 
 
+
+struct batch_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct batch_reply
+{
+    struct reply_header __header;
+    unsigned int   count;
+    /* VARARG(replies,bytes); */
+    char __pad_12[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5120,6 +5272,8 @@ enum request
     REQ_create_semaphore,
     REQ_release_semaphore,
     REQ_query_semaphore,
+    REQ_get_shm_sync,
+    REQ_wake_shm_sync,
     REQ_open_semaphore,
     REQ_create_file,
     REQ_open_file_object,
@@ -5327,9 +5481,12 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
+    REQ_set_fd_completion_mode,
+    REQ_set_fd_pending_io,
     REQ_get_window_layered_info,
     REQ_set_window_layered_info,
     REQ_alloc_user_handle,
@@ -5338,6 +5495,7 @@ enum request
     REQ_update_rawinput_devices,
     REQ_get_suspend_context,
     REQ_set_suspend_context,
+    REQ_batch,
     REQ_NB_REQUESTS
 };
 
@@ -5382,6 +5540,8 @@ union generic_request
     struct create_semaphore_request create_semaphore_request;
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
+    struct get_shm_sync_request get_shm_sync_request;
+    struct wake_shm_sync_request wake_shm_sync_request;
     struct open_semaphore_request open_semaphore_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
@@ -5589,9 +5749,12 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
+    struct set_fd_completion_mode_request set_fd_completion_mode_request;
+    struct set_fd_pending_io_request set_fd_pending_io_request;
     struct get_window_layered_info_request get_window_layered_info_request;
     struct set_window_layered_info_request set_window_layered_info_request;
     struct alloc_user_handle_request alloc_user_handle_request;
@@ -5600,6 +5763,7 @@ union generic_request
     struct update_rawinput_devices_request update_rawinput_devices_request;
     struct get_suspend_context_request get_suspend_context_request;
     struct set_suspend_context_request set_suspend_context_request;
+    struct batch_request batch_request;
 };
 union generic_reply
 {
@@ -5642,6 +5806,8 @@ union generic_reply
     struct create_semaphore_reply create_semaphore_reply;
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
+    struct get_shm_sync_reply get_shm_sync_reply;
+    struct wake_shm_sync_reply wake_shm_sync_reply;
     struct open_semaphore_reply open_semaphore_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
@@ -5849,9 +6015,12 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
+    struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
+    struct set_fd_pending_io_reply set_fd_pending_io_reply;
     struct get_window_layered_info_reply get_window_layered_info_reply;
     struct set_window_layered_info_reply set_window_layered_info_reply;
     struct alloc_user_handle_reply alloc_user_handle_reply;
@@ -5860,8 +6029,9 @@ union generic_reply
     struct update_rawinput_devices_reply update_rawinput_devices_reply;
     struct get_suspend_context_reply get_suspend_context_reply;
     struct set_suspend_context_reply set_suspend_context_reply;
+    struct batch_reply batch_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 454
+#define SERVER_PROTOCOL_VERSION 463
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
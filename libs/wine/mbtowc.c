@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "wine/unicode.h"
+#include "unicode_private.h"
 
 /* get the decomposition of a Unicode char */
 static int get_decomposition( WCHAR src, WCHAR *dst, unsigned int dstlen )
@@ -46,6 +47,18 @@ static inline int is_private_use_area_char(WCHAR code)
     return (code >= 0xe000 && code <= 0xf8ff);
 }
 
+/* check whether the 7-bit ASCII chars are mapped to themselves */
+static int is_ascii_cp2uni( const WCHAR *cp2uni )
+{
+    static const WCHAR *ascii_cp2uni;  /* last table found to be compatible */
+    unsigned int i;
+
+    if (cp2uni == ascii_cp2uni) return 1;
+    for (i = 0; i < 0x80; i++) if (cp2uni[i] != i) return 0;
+    ascii_cp2uni = cp2uni;
+    return 1;
+}
+
 /* check src string for invalid chars; return non-zero if invalid char found */
 static inline int check_invalid_chars_sbcs( const struct sbcs_table *table, int flags,
                                             const unsigned char *src, unsigned int srclen )
@@ -54,8 +67,21 @@ static inline int check_invalid_chars_sbcs( const struct sbcs_table *table, int
     const WCHAR def_unicode_char = table->info.def_unicode_char;
     const unsigned char def_char = table->uni2cp_low[table->uni2cp_high[def_unicode_char >> 8]
                                                      + (def_unicode_char & 0xff)];
+    /* 7-bit ASCII chars are valid unless one of them is the default char */
+    const int ascii = srclen >= 16 && (def_unicode_char >= 0x80 || def_char == def_unicode_char) &&
+                      is_ascii_cp2uni( cp2uni );
+    const unsigned char *next_block = src;
+
     while (srclen)
     {
+        if (ascii && src >= next_block)  /* skip whole blocks of 7-bit ASCII */
+        {
+            unsigned int count = ascii_mbstowcs( (const char *)src, srclen, NULL );
+            src += count;
+            srclen -= count;
+            next_block = src + 16;
+            if (!srclen) break;
+        }
         if ((cp2uni[*src] == def_unicode_char && *src != def_char) ||
             is_private_use_area_char(cp2uni[*src])) break;
         src++;
@@ -71,7 +97,7 @@ static inline int mbstowcs_sbcs( const struct sbcs_table *table, int flags,
                                  WCHAR *dst, unsigned int dstlen )
 {
     const WCHAR * const cp2uni = (flags & MB_USEGLYPHCHARS) ? table->cp2uni_glyphs : table->cp2uni;
-    int ret = srclen;
+    int ret = srclen, ascii;
 
     if (dstlen < srclen)
     {
@@ -80,8 +106,17 @@ static inline int mbstowcs_sbcs( const struct sbcs_table *table, int flags,
         ret = -1;
     }
 
+    ascii = srclen >= 16 && is_ascii_cp2uni( cp2uni );
+
     for (;;)
     {
+        if (ascii)  /* convert whole blocks of 7-bit ASCII at once */
+        {
+            unsigned int count = ascii_mbstowcs( (const char *)src, srclen, dst );
+            src += count;
+            dst += count;
+            srclen -= count;
+        }
         switch(srclen)
         {
         default:
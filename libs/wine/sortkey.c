@@ -155,89 +155,122 @@ int wine_get_sortkey(int flags, const WCHAR *src, int srclen, char *dst, int dst
     return key_ptr[3] - dst;
 }
 
-static inline int compare_unicode_weights(int flags, const WCHAR *str1, int len1,
-                                          const WCHAR *str2, int len2)
+/* 32-bit collation element table format:
+ * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
+ * case weight - high 4 bit of low 8 bit.
+ */
+static inline unsigned int get_collation_element(WCHAR ch)
 {
-    unsigned int ce1, ce2;
-    int ret;
+    return collation_table[collation_table[ch >> 8] + (ch & 0xff)];
+}
 
-    /* 32-bit collation element table format:
-     * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
-     * case weight - high 4 bit of low 8 bit.
-     */
-    while (len1 > 0 && len2 > 0)
+/* comparison state of the diacritic and case weights */
+struct secondary_weights
+{
+    int diacritic;  /* first diacritic weight difference */
+    int case_diff;  /* first case weight difference */
+};
+
+static inline void update_secondary_weights(struct secondary_weights *weights,
+                                            WCHAR ch1, unsigned int ce1, WCHAR ch2, unsigned int ce2)
+{
+    int diacritic, case_diff;
+
+    if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
     {
-        if (flags & NORM_IGNORESYMBOLS)
-        {
-            int skip = 0;
-            /* FIXME: not tested */
-            if (get_char_typeW(*str1) & (C1_PUNCT | C1_SPACE))
-            {
-                str1++;
-                len1--;
-                skip = 1;
-            }
-            if (get_char_typeW(*str2) & (C1_PUNCT | C1_SPACE))
-            {
-                str2++;
-                len2--;
-                skip = 1;
-            }
-            if (skip) continue;
-        }
+        diacritic = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
+        case_diff = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
+    }
+    else diacritic = case_diff = ch1 - ch2;
 
-       /* hyphen and apostrophe are treated differently depending on
-        * whether SORT_STRINGSORT specified or not
-        */
-        if (!(flags & SORT_STRINGSORT))
+    if (!weights->diacritic) weights->diacritic = diacritic;
+    if (!weights->case_diff) weights->case_diff = case_diff;
+}
+
+static inline int get_secondary_result(int flags, const struct secondary_weights *weights, int len_diff)
+{
+    if (!(flags & NORM_IGNORENONSPACE))
+    {
+        if (weights->diacritic) return weights->diacritic;
+        if (len_diff) return len_diff;
+    }
+    if (!(flags & NORM_IGNORECASE))
+    {
+        if (weights->case_diff) return weights->case_diff;
+        return len_diff;
+    }
+    return 0;
+}
+
+/* compare the diacritic and case weights in a single pass */
+static int compare_secondary_weights(int flags, const WCHAR *str1, int len1,
+                                     const WCHAR *str2, int len2)
+{
+    struct secondary_weights weights = { 0, 0 };
+
+    while (len1 > 0 && len2 > 0)
+    {
+        if (*str1 != *str2)  /* identical chars have identical weights */
         {
-            if (*str1 == '-' || *str1 == '\'')
+            if (flags & NORM_IGNORESYMBOLS)
             {
-                if (*str2 != '-' && *str2 != '\'')
+                int skip = 0;
+                /* FIXME: not tested */
+                if (get_char_typeW(*str1) & (C1_PUNCT | C1_SPACE))
                 {
                     str1++;
                     len1--;
-                    continue;
+                    skip = 1;
                 }
+                if (get_char_typeW(*str2) & (C1_PUNCT | C1_SPACE))
+                {
+                    str2++;
+                    len2--;
+                    skip = 1;
+                }
+                if (skip) continue;
             }
-            else if (*str2 == '-' || *str2 == '\'')
+
+            update_secondary_weights(&weights, *str1, get_collation_element(*str1),
+                                     *str2, get_collation_element(*str2));
+            /* the first difference found in the weights that are compared takes precedence */
+            if (!(flags & NORM_IGNORENONSPACE))
             {
-                str2++;
-                len2--;
-                continue;
+                if (weights.diacritic) return weights.diacritic;
             }
+            else if (weights.case_diff && !(flags & NORM_IGNORECASE)) return weights.case_diff;
         }
-
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
-
-        if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
-            ret = (ce1 >> 16) - (ce2 >> 16);
-        else
-            ret = *str1 - *str2;
-
-        if (ret) return ret;
-
         str1++;
         str2++;
         len1--;
         len2--;
     }
-    return len1 - len2;
+    return get_secondary_result(flags, &weights, len1 - len2);
 }
 
-static inline int compare_diacritic_weights(int flags, const WCHAR *str1, int len1,
-                                            const WCHAR *str2, int len2)
+/* compare the unicode weights, and the diacritic and case weights as long as
+ * both strings are traversed the same way for all of them */
+static int compare_weights(int flags, const WCHAR *str1, int len1,
+                           const WCHAR *str2, int len2)
 {
-    unsigned int ce1, ce2;
-    int ret;
+    const WCHAR *start1 = str1, *start2 = str2;
+    const int start_len1 = len1, start_len2 = len2;
+    struct secondary_weights weights = { 0, 0 };
+    int aligned = 1, ret;
 
-    /* 32-bit collation element table format:
-     * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
-     * case weight - high 4 bit of low 8 bit.
-     */
     while (len1 > 0 && len2 > 0)
     {
+        unsigned int ce1, ce2;
+
+        if (*str1 == *str2)  /* identical chars have identical weights */
+        {
+            str1++;
+            str2++;
+            len1--;
+            len2--;
+            continue;
+        }
+
         if (flags & NORM_IGNORESYMBOLS)
         {
             int skip = 0;
@@ -257,71 +290,54 @@ static inline int compare_diacritic_weights(int flags, const WCHAR *str1, int le
             if (skip) continue;
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
-
-        if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
-            ret = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
-        else
-            ret = *str1 - *str2;
-
-        if (ret) return ret;
-
-        str1++;
-        str2++;
-        len1--;
-        len2--;
-    }
-    return len1 - len2;
-}
-
-static inline int compare_case_weights(int flags, const WCHAR *str1, int len1,
-                                       const WCHAR *str2, int len2)
-{
-    unsigned int ce1, ce2;
-    int ret;
-
-    /* 32-bit collation element table format:
-     * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
-     * case weight - high 4 bit of low 8 bit.
-     */
-    while (len1 > 0 && len2 > 0)
-    {
-        if (flags & NORM_IGNORESYMBOLS)
+       /* hyphen and apostrophe are treated differently depending on
+        * whether SORT_STRINGSORT specified or not; this is the only case
+        * where the secondary weights need a separate pass
+        */
+        if (!(flags & SORT_STRINGSORT))
         {
-            int skip = 0;
-            /* FIXME: not tested */
-            if (get_char_typeW(*str1) & (C1_PUNCT | C1_SPACE))
+            if (*str1 == '-' || *str1 == '\'')
             {
-                str1++;
-                len1--;
-                skip = 1;
+                if (*str2 != '-' && *str2 != '\'')
+                {
+                    str1++;
+                    len1--;
+                    aligned = 0;
+                    continue;
+                }
             }
-            if (get_char_typeW(*str2) & (C1_PUNCT | C1_SPACE))
+            else if (*str2 == '-' || *str2 == '\'')
             {
                 str2++;
                 len2--;
-                skip = 1;
+                aligned = 0;
+                continue;
             }
-            if (skip) continue;
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
+        ce1 = get_collation_element(*str1);
+        ce2 = get_collation_element(*str2);
 
         if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
-            ret = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
+            ret = (ce1 >> 16) - (ce2 >> 16);
         else
             ret = *str1 - *str2;
 
         if (ret) return ret;
 
+        if (aligned) update_secondary_weights(&weights, *str1, ce1, *str2, ce2);
+
         str1++;
         str2++;
         len1--;
         len2--;
     }
-    return len1 - len2;
+    if ((ret = len1 - len2)) return ret;
+
+    /* both strings are exhausted, so the secondary length difference is 0 too */
+    if (aligned) return get_secondary_result(flags, &weights, 0);
+    if ((flags & NORM_IGNORENONSPACE) && (flags & NORM_IGNORECASE)) return 0;
+    return compare_secondary_weights(flags, start1, start_len1, start2, start_len2);
 }
 
 static inline int real_length(const WCHAR *str, int len)
@@ -333,18 +349,8 @@ static inline int real_length(const WCHAR *str, int len)
 int wine_compare_string(int flags, const WCHAR *str1, int len1,
                         const WCHAR *str2, int len2)
 {
-    int ret;
-
     len1 = real_length(str1, len1);
     len2 = real_length(str2, len2);
 
-    ret = compare_unicode_weights(flags, str1, len1, str2, len2);
-    if (!ret)
-    {
-        if (!(flags & NORM_IGNORENONSPACE))
-            ret = compare_diacritic_weights(flags, str1, len1, str2, len2);
-        if (!ret && !(flags & NORM_IGNORECASE))
-            ret = compare_case_weights(flags, str1, len1, str2, len2);
-    }
-    return ret;
+    return compare_weights(flags, str1, len1, str2, len2);
 }
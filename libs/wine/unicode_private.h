@@ -0,0 +1,71 @@
+/*
+ * Internal definitions for the Unicode routines
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_UNICODE_PRIVATE_H
+#define __WINE_UNICODE_PRIVATE_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "wine/unicode.h"
+
+/* convert the leading 7-bit ASCII chars of src, a block of 16 at a time */
+/* return the number of chars converted; if dst is NULL only count them */
+static inline unsigned int ascii_mbstowcs( const char *src, unsigned int srclen, WCHAR *dst )
+{
+    unsigned int len = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for ( ; srclen - len >= 16; len += 16)
+    {
+        __m128i chars = _mm_loadu_si128( (const __m128i *)(src + len) );
+
+        if (_mm_movemask_epi8( chars )) break;  /* some char is >= 0x80 */
+        if (!dst) continue;
+        _mm_storeu_si128( (__m128i *)(dst + len), _mm_unpacklo_epi8( chars, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + len + 8), _mm_unpackhi_epi8( chars, zero ));
+    }
+#endif
+    return len;
+}
+
+/* convert the leading 7-bit ASCII chars of src, a block of 16 at a time */
+/* return the number of chars converted; if dst is NULL only count them */
+static inline unsigned int ascii_wcstombs( const WCHAR *src, unsigned int srclen, char *dst )
+{
+    unsigned int len = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i high_bits = _mm_set1_epi16( (short)0xff80 );
+
+    for ( ; srclen - len >= 16; len += 16)
+    {
+        __m128i lo = _mm_loadu_si128( (const __m128i *)(src + len) );
+        __m128i hi = _mm_loadu_si128( (const __m128i *)(src + len + 8) );
+        __m128i high = _mm_and_si128( _mm_or_si128( lo, hi ), high_bits );
+
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( high, zero )) != 0xffff) break;
+        if (dst) _mm_storeu_si128( (__m128i *)(dst + len), _mm_packus_epi16( lo, hi ));
+    }
+#endif
+    return len;
+}
+
+#endif  /* __WINE_UNICODE_PRIVATE_H */
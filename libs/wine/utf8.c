@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "wine/unicode.h"
+#include "unicode_private.h"
 
 extern WCHAR compose( const WCHAR *str );
 
@@ -62,10 +63,20 @@ static inline unsigned int get_surrogate_value( const WCHAR *src, unsigned int s
 static inline int get_length_wcs_utf8( int flags, const WCHAR *src, unsigned int srclen )
 {
     int len;
-    unsigned int val;
+    unsigned int val, count;
+    const WCHAR *next_block = src;
 
     for (len = 0; srclen; srclen--, src++)
     {
+        if (src >= next_block)  /* skip whole blocks of 7-bit ASCII */
+        {
+            count = ascii_wcstombs( src, srclen, NULL );
+            len += count;
+            src += count;
+            srclen -= count;
+            next_block = src + 16;
+            if (!srclen) break;
+        }
         if (*src < 0x80)  /* 0x00-0x7f: 1 byte */
         {
             len++;
@@ -98,14 +109,28 @@ static inline int get_length_wcs_utf8( int flags, const WCHAR *src, unsigned int
 int wine_utf8_wcstombs( int flags, const WCHAR *src, int srclen, char *dst, int dstlen )
 {
     int len;
+    const WCHAR *next_block = src;
 
     if (!dstlen) return get_length_wcs_utf8( flags, src, srclen );
 
     for (len = dstlen; srclen; srclen--, src++)
     {
-        WCHAR ch = *src;
+        WCHAR ch;
         unsigned int val;
 
+        if (src >= next_block)  /* convert whole blocks of 7-bit ASCII at once */
+        {
+            unsigned int count = ascii_wcstombs( src, srclen < len ? srclen : len, dst );
+            src += count;
+            dst += count;
+            srclen -= count;
+            len -= count;
+            next_block = src + 16;
+            if (!srclen) break;
+        }
+
+        ch = *src;
+
         if (ch < 0x80)  /* 0x00-0x7f: 1 byte */
         {
             if (!len--) return -1;  /* overflow */
@@ -279,10 +304,21 @@ static inline int get_length_mbs_utf8( int flags, const char *src, int srclen )
     int ret = 0;
     unsigned int res;
     const char *srcend = src + srclen;
+    const char *next_block = src;
 
     while (src < srcend)
     {
-        unsigned char ch = *src++;
+        unsigned char ch;
+
+        if (src >= next_block)  /* skip whole blocks of 7-bit ASCII */
+        {
+            unsigned int count = ascii_mbstowcs( src, srcend - src, NULL );
+            ret += count;
+            src += count;
+            next_block = src + 16;
+            if (src == srcend) break;
+        }
+        ch = *src++;
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             ret++;
@@ -305,6 +341,7 @@ int wine_utf8_mbstowcs( int flags, const char *src, int srclen, WCHAR *dst, int
 {
     unsigned int res;
     const char *srcend = src + srclen;
+    const char *next_block = src;
     WCHAR *dstend = dst + dstlen;
 
     if (flags & MB_COMPOSITE) return utf8_mbstowcs_compose( flags, src, srclen, dst, dstlen );
@@ -313,7 +350,18 @@ int wine_utf8_mbstowcs( int flags, const char *src, int srclen, WCHAR *dst, int
 
     while ((dst < dstend) && (src < srcend))
     {
-        unsigned char ch = *src++;
+        unsigned char ch;
+
+        if (src >= next_block)  /* convert whole blocks of 7-bit ASCII at once */
+        {
+            unsigned int count = ascii_mbstowcs( src, srcend - src < dstend - dst ?
+                                                 srcend - src : dstend - dst, dst );
+            src += count;
+            dst += count;
+            next_block = src + 16;
+            if (count) continue;
+        }
+        ch = *src++;
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
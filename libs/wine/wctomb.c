@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "wine/unicode.h"
+#include "unicode_private.h"
 
 /* search for a character in the unicode_compose_table; helper for compose() */
 static inline int binary_search( WCHAR ch, int low, int high )
@@ -74,6 +75,19 @@ static inline int is_valid_sbcs_mapping( const struct sbcs_table *table, int fla
     return 1;
 }
 
+/* check whether the 7-bit ASCII chars are mapped to themselves in both directions */
+static int is_ascii_sbcs( const struct sbcs_table *table )
+{
+    static const struct sbcs_table *ascii_table;  /* last table found to be compatible */
+    const unsigned char *uni2cp = table->uni2cp_low + table->uni2cp_high[0];
+    unsigned int i;
+
+    if (table == ascii_table) return 1;
+    for (i = 0; i < 0x80; i++) if (uni2cp[i] != i || table->cp2uni[i] != i) return 0;
+    ascii_table = table;
+    return 1;
+}
+
 /* query necessary dst length for src string */
 static int get_length_sbcs( const struct sbcs_table *table, int flags,
                             const WCHAR *src, unsigned int srclen, int *used )
@@ -82,15 +96,29 @@ static int get_length_sbcs( const struct sbcs_table *table, int flags,
     const unsigned short * const uni2cp_high = table->uni2cp_high;
     int ret, tmp;
     WCHAR composed;
+    /* 7-bit ASCII chars always have a valid mapping and never compose */
+    const int ascii = !(flags & WC_COMPOSITECHECK) && srclen >= 16 && is_ascii_sbcs( table );
+    const WCHAR *next_block = src;
 
     if (!used) used = &tmp;  /* avoid checking on every char */
     *used = 0;
 
     for (ret = 0; srclen; ret++, src++, srclen--)
     {
-        WCHAR wch = *src;
+        WCHAR wch;
         unsigned char ch;
 
+        if (ascii && src >= next_block)  /* skip whole blocks of 7-bit ASCII */
+        {
+            unsigned int count = ascii_wcstombs( src, srclen, NULL );
+            ret += count;
+            src += count;
+            srclen -= count;
+            next_block = src + 16;
+            if (!srclen) break;
+        }
+        wch = *src;
+
         if ((flags & WC_COMPOSITECHECK) && (srclen > 1) && (composed = compose(src)))
         {
             /* now check if we can use the composed char */
@@ -133,7 +161,7 @@ static inline int wcstombs_sbcs( const struct sbcs_table *table,
 {
     const unsigned char  * const uni2cp_low = table->uni2cp_low;
     const unsigned short * const uni2cp_high = table->uni2cp_high;
-    int ret = srclen;
+    int ret = srclen, ascii;
 
     if (dstlen < srclen)
     {
@@ -142,8 +170,18 @@ static inline int wcstombs_sbcs( const struct sbcs_table *table,
         ret = -1;
     }
 
+    ascii = srclen >= 16 && is_ascii_sbcs( table );
+
     while (srclen >= 16)
     {
+        if (ascii)  /* convert whole blocks of 7-bit ASCII at once */
+        {
+            unsigned int count = ascii_wcstombs( src, srclen, dst );
+            src += count;
+            dst += count;
+            srclen -= count;
+            if (srclen < 16) break;
+        }
         dst[0]  = uni2cp_low[uni2cp_high[src[0]  >> 8] + (src[0]  & 0xff)];
         dst[1]  = uni2cp_low[uni2cp_high[src[1]  >> 8] + (src[1]  & 0xff)];
         dst[2]  = uni2cp_low[uni2cp_high[src[2]  >> 8] + (src[2]  & 0xff)];
@@ -202,6 +240,9 @@ static int wcstombs_sbcs_slow( const struct sbcs_table *table, int flags,
     unsigned int len;
     int tmp;
     WCHAR composed;
+    /* 7-bit ASCII chars always have a valid mapping and never compose */
+    const int ascii = !(flags & WC_COMPOSITECHECK) && srclen >= 16 && is_ascii_sbcs( table );
+    const WCHAR *next_block = src;
 
     if (!defchar)
         def = table->info.def_char & 0xff;
@@ -213,7 +254,19 @@ static int wcstombs_sbcs_slow( const struct sbcs_table *table, int flags,
 
     for (len = dstlen; srclen && len; dst++, len--, src++, srclen--)
     {
-        WCHAR wch = *src;
+        WCHAR wch;
+
+        if (ascii && src >= next_block)  /* convert whole blocks of 7-bit ASCII at once */
+        {
+            unsigned int count = ascii_wcstombs( src, srclen < len ? srclen : len, dst );
+            src += count;
+            dst += count;
+            srclen -= count;
+            len -= count;
+            next_block = src + 16;
+            if (!srclen || !len) break;
+        }
+        wch = *src;
 
         if ((flags & WC_COMPOSITECHECK) && (srclen > 1) && (composed = compose(src)))
         {
@@ -115,6 +115,11 @@ struct event *create_event( struct directory *root, const struct unicode_str *na
             /* initialize it if it didn't already exist */
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+            if ((event->obj.sync = alloc_shm_sync( &event->obj, SHM_SYNC_EVENT )))
+            {
+                get_shm_sync_info( event->obj.sync )->manual_reset = manual_reset;
+                event->obj.sync->state = initial_state;
+            }
             if (sd) default_set_sd( &event->obj, sd, OWNER_SECURITY_INFORMATION|
                                                      GROUP_SECURITY_INFORMATION|
                                                      DACL_SECURITY_INFORMATION|
@@ -129,32 +134,40 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
     return (struct event *)get_handle_obj( process, handle, access, &event_ops );
 }
 
+static void set_event_state( struct event *event, int state )
+{
+    if (!event->obj.sync) event->signaled = state;
+    else if (!interlocked_xchg( &event->obj.sync->state, state ) && state) shm_sync_wake( event->obj.sync );
+}
+
 void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    /* the futex waiters may not run before the reset, let them check the pulse count */
+    if (event->obj.sync) shm_sync_pulse( event->obj.sync );
+    else set_event_state( event, 0 );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    set_event_state( event, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    fprintf( stderr, "Event manual=%d signaled=%d ",
-             event->manual_reset, event->signaled );
+    fprintf( stderr, "Event manual=%d signaled=%d ", event->manual_reset,
+             event->obj.sync ? event->obj.sync->state : event->signaled );
     dump_object_name( &event->obj );
     fputc( '\n', stderr );
 }
@@ -170,6 +183,7 @@ static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
+    if (obj->sync) return shm_sync_signaled( obj->sync, entry );
     return event->signaled;
 }
 
@@ -177,6 +191,7 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
+    if (obj->sync) return;  /* already acquired in check_wait */
     /* Reset if it's an auto-reset event */
     if (!event->manual_reset) event->signaled = 0;
 }
@@ -365,7 +380,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = event->obj.sync ? event->obj.sync->state : event->signaled;
 
     release_object( event );
 }
@@ -167,6 +167,14 @@ struct closed_fd
     char        unlink[1];   /* name to unlink on close (if any) */
 };
 
+/* a handle for which a client cached the fd */
+struct fd_cache_user
+{
+    struct list          entry;       /* entry in the fd list of cache users */
+    process_id_t         pid;         /* process that cached the fd */
+    obj_handle_t         handle;      /* handle it was cached for */
+};
+
 struct fd
 {
     struct object        obj;         /* object header */
@@ -185,12 +193,16 @@ struct fd
     unsigned int         cacheable :1;/* can the fd be cached on the client side? */
     unsigned int         signaled :1; /* is the fd signaled? */
     unsigned int         fs_locks :1; /* can we use filesystem locks for this fd? */
+    unsigned int         track_cache :1; /* keep track of the handles the fd is cached for? */
+    struct list          cache_users; /* handles the fd was cached for, if tracked */
     int                  poll_index;  /* index of fd in poll array */
     struct async_queue  *read_q;      /* async readers of this fd */
     struct async_queue  *write_q;     /* async writers of this fd */
     struct async_queue  *wait_q;      /* other async waiters of this fd */
     struct completion   *completion;  /* completion object attached to this fd */
     apc_param_t          comp_key;    /* completion key to set in completion events */
+    unsigned int         comp_flags;  /* completion notification modes (FILE_SKIP_* flags) */
+    unsigned int         pending_io;  /* number of requests in progress on the client side */
 };
 
 static void fd_dump( struct object *obj, int verbose );
@@ -1457,12 +1469,18 @@ static void fd_dump( struct object *obj, int verbose )
 static void fd_destroy( struct object *obj )
 {
     struct fd *fd = (struct fd *)obj;
+    struct fd_cache_user *user, *next;
 
     free_async_queue( fd->read_q );
     free_async_queue( fd->write_q );
     free_async_queue( fd->wait_q );
 
     if (fd->completion) release_object( fd->completion );
+    LIST_FOR_EACH_ENTRY_SAFE( user, next, &fd->cache_users, struct fd_cache_user, entry )
+    {
+        list_remove( &user->entry );
+        free( user );
+    }
     remove_fd_locks( fd );
     free( fd->unix_name );
     list_remove( &fd->inode_entry );
@@ -1587,13 +1605,17 @@ static struct fd *alloc_fd_object(void)
     fd->cacheable  = 0;
     fd->signaled   = 1;
     fd->fs_locks   = 1;
+    fd->track_cache = 0;
     fd->poll_index = -1;
     fd->read_q     = NULL;
     fd->write_q    = NULL;
     fd->wait_q     = NULL;
     fd->completion = NULL;
+    fd->comp_flags = 0;
+    fd->pending_io = 0;
     list_init( &fd->inode_entry );
     list_init( &fd->locks );
+    list_init( &fd->cache_users );
 
     if ((fd->poll_index = add_poll_user( fd )) == -1)
     {
@@ -1622,14 +1644,18 @@ struct fd *alloc_pseudo_fd( const struct fd_ops *fd_user_ops, struct object *use
     fd->cacheable  = 0;
     fd->signaled   = 0;
     fd->fs_locks   = 0;
+    fd->track_cache = 0;
     fd->poll_index = -1;
     fd->read_q     = NULL;
     fd->write_q    = NULL;
     fd->wait_q     = NULL;
     fd->completion = NULL;
+    fd->comp_flags = 0;
+    fd->pending_io = 0;
     fd->no_fd_status = STATUS_BAD_DEVICE_TYPE;
     list_init( &fd->inode_entry );
     list_init( &fd->locks );
+    list_init( &fd->cache_users );
     return fd;
 }
 
@@ -1935,6 +1961,52 @@ void allow_fd_caching( struct fd *fd )
     fd->cacheable = 1;
 }
 
+/* allow the fd to be cached, and remember which handles it gets cached for */
+void allow_tracked_fd_caching( struct fd *fd )
+{
+    fd->cacheable = 1;
+    fd->track_cache = 1;
+}
+
+/* remember that a client caches the fd for a handle; return 0 if it can't */
+static int add_fd_cache_user( struct fd *fd, struct process *process, obj_handle_t handle )
+{
+    struct fd_cache_user *user;
+
+    LIST_FOR_EACH_ENTRY( user, &fd->cache_users, struct fd_cache_user, entry )
+        if (user->pid == process->id && user->handle == handle) return 1;
+
+    if (!(user = malloc( sizeof(*user) ))) return 0;
+    user->pid    = process->id;
+    user->handle = handle;
+    list_add_tail( &fd->cache_users, &user->entry );
+    return 1;
+}
+
+/* forget a handle the fd was cached for, once the handle is closed */
+void remove_fd_cache_user( struct fd *fd, struct process *process, obj_handle_t handle )
+{
+    struct fd_cache_user *user;
+
+    LIST_FOR_EACH_ENTRY( user, &fd->cache_users, struct fd_cache_user, entry )
+    {
+        if (user->pid != process->id || user->handle != handle) continue;
+        list_remove( &user->entry );
+        free( user );
+        return;
+    }
+}
+
+/* check if a client may have cached the fd for another handle than the given one */
+int is_fd_cached_elsewhere( struct fd *fd, struct process *process, obj_handle_t handle )
+{
+    struct fd_cache_user *user;
+
+    LIST_FOR_EACH_ENTRY( user, &fd->cache_users, struct fd_cache_user, entry )
+        if (user->pid != process->id || user->handle != handle) return 1;
+    return 0;
+}
+
 /* check if fd is on a removable device */
 int is_fd_removable( struct fd *fd )
 {
@@ -2212,6 +2284,11 @@ void fd_copy_completion( struct fd *src, struct fd *dst )
     dst->completion = fd_get_completion( src, &dst->comp_key );
 }
 
+unsigned int fd_get_comp_flags( struct fd *fd )
+{
+    return fd->comp_flags;
+}
+
 /* flush a file buffers */
 DECL_HANDLER(flush_file)
 {
@@ -2283,8 +2360,11 @@ DECL_HANDLER(get_handle_fd)
         if (unix_fd != -1)
         {
             reply->type = fd->fd_ops->get_fd_type( fd );
-            reply->cacheable = fd->cacheable;
+            /* remember who caches it, in case the fd gets replaced */
+            reply->cacheable = fd->cacheable &&
+                               (!fd->track_cache || add_fd_cache_user( fd, current->process, req->handle ));
             reply->options = fd->options;
+            reply->comp_flags = fd->comp_flags;
             reply->access = get_handle_access( current->process, req->handle );
             send_client_fd( current->process, unix_fd, req->handle );
         }
@@ -2369,8 +2449,37 @@ DECL_HANDLER(add_fd_completion)
     struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
     if (fd)
     {
-        if (fd->completion)
+        /* operations that succeeded right away may not need a completion */
+        if (fd->completion && (req->async || req->status != STATUS_SUCCESS ||
+                               !(fd->comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)))
             add_completion( fd->completion, fd->comp_key, req->cvalue, req->status, req->information );
         release_object( fd );
     }
 }
+
+/* set the completion notification modes of a fd */
+DECL_HANDLER(set_fd_completion_mode)
+{
+    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
+    if (fd)
+    {
+        /* modes can't be cleared once set */
+        fd->comp_flags |= req->flags;
+        release_object( fd );
+    }
+}
+
+/* the fd stays unsignaled while client side requests are in progress */
+DECL_HANDLER(set_fd_pending_io)
+{
+    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
+    if (fd)
+    {
+        if (req->pending)
+        {
+            if (!fd->pending_io++) set_fd_signaled( fd, 0 );
+        }
+        else if (fd->pending_io && !--fd->pending_io) set_fd_signaled( fd, 1 );
+        release_object( fd );
+    }
+}
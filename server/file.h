@@ -74,6 +74,9 @@ extern void set_fd_events( struct fd *fd, int events );
 extern obj_handle_t lock_fd( struct fd *fd, file_pos_t offset, file_pos_t count, int shared, int wait );
 extern void unlock_fd( struct fd *fd, file_pos_t offset, file_pos_t count );
 extern void allow_fd_caching( struct fd *fd );
+extern void allow_tracked_fd_caching( struct fd *fd );
+extern void remove_fd_cache_user( struct fd *fd, struct process *process, obj_handle_t handle );
+extern int is_fd_cached_elsewhere( struct fd *fd, struct process *process, obj_handle_t handle );
 extern void set_fd_signaled( struct fd *fd, int signaled );
 extern int is_fd_signaled( struct fd *fd );
 
@@ -166,6 +169,7 @@ extern int async_wake_up_by( struct async_queue *queue, struct process *process,
 extern void async_wake_up( struct async_queue *queue, unsigned int status );
 extern struct completion *fd_get_completion( struct fd *fd, apc_param_t *p_key );
 extern void fd_copy_completion( struct fd *src, struct fd *dst );
+extern unsigned int fd_get_comp_flags( struct fd *fd );
 
 /* access rights that require Unix read permission */
 #define FILE_UNIX_READ_ACCESS (FILE_READ_DATA|FILE_READ_ATTRIBUTES|FILE_READ_EA)
@@ -379,6 +379,8 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     table = handle_is_global(handle) ? global_table : process->handles;
     if (entry < table->entries + table->free) table->free = entry - table->entries;
     if (entry == table->entries + table->last) shrink_handle_table( table );
+    /* the process can't remove the handle from its shared object cache */
+    if (obj->sync && (!current || process != current->process)) shm_sync_invalidate_handles();
     release_object( obj );
     return STATUS_SUCCESS;
 }
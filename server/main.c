@@ -36,11 +36,14 @@
 #include "file.h"
 #include "thread.h"
 #include "request.h"
+#include "user.h"
 #include "wine/library.h"
 
 /* command-line options */
 int debug_level = 0;
 int foreground = 0;
+int registry_journal = 0;
+static const char *profile_file;
 timeout_t master_socket_timeout = 3 * -TICKS_PER_SEC;  /* master socket timeout, default is 3 seconds */
 const char *server_argv0;
 
@@ -53,8 +56,10 @@ static void usage( FILE *fh )
     fprintf(fh, "   -d[n], --debug[=n]       set debug level to n or +1 if n not specified\n");
     fprintf(fh, "   -f,    --foreground      remain in the foreground for debugging\n");
     fprintf(fh, "   -h,    --help            display this help message\n");
+    fprintf(fh, "   -j,    --journal         keep binary registry snapshots and a change journal\n");
     fprintf(fh, "   -k[n], --kill[=n]        kill the current wineserver, optionally with signal n\n");
     fprintf(fh, "   -p[n], --persistent[=n]  make server persistent, optionally for n seconds\n");
+    fprintf(fh, "   -P[f], --profile[=f]     profile requests, write statistics to file f\n");
     fprintf(fh, "   -v,    --version         display version information and exit\n");
     fprintf(fh, "   -w,    --wait            wait until the current wineserver terminates\n");
     fprintf(fh, "\n");
@@ -69,8 +74,10 @@ static void parse_args( int argc, char *argv[] )
         {"debug",       2, NULL, 'd'},
         {"foreground",  0, NULL, 'f'},
         {"help",        0, NULL, 'h'},
+        {"journal",     0, NULL, 'j'},
         {"kill",        2, NULL, 'k'},
         {"persistent",  2, NULL, 'p'},
+        {"profile",     2, NULL, 'P'},
         {"version",     0, NULL, 'v'},
         {"wait",        0, NULL, 'w'},
         { NULL,         0, NULL, 0}
@@ -78,7 +85,7 @@ static void parse_args( int argc, char *argv[] )
 
     server_argv0 = argv[0];
 
-    while ((optc = getopt_long( argc, argv, "d::fhk::p::vw", long_options, NULL )) != -1)
+    while ((optc = getopt_long( argc, argv, "d::fhjk::p::P::vw", long_options, NULL )) != -1)
     {
         switch(optc)
         {
@@ -95,6 +102,9 @@ static void parse_args( int argc, char *argv[] )
                 usage(stdout);
                 exit(0);
                 break;
+            case 'j':
+                registry_journal = 1;
+                break;
             case 'k':
                 if (optarg && isdigit(*optarg))
                     ret = kill_lock_owner( atoi( optarg ) );
@@ -107,6 +117,9 @@ static void parse_args( int argc, char *argv[] )
                 else
                     master_socket_timeout = TIMEOUT_INFINITE;
                 break;
+            case 'P':
+                profile_file = optarg ? optarg : "";
+                break;
             case 'v':
                 fprintf( stderr, "%s\n", wine_get_build_id());
                 exit(0);
@@ -143,6 +156,10 @@ int main( int argc, char *argv[] )
 
     if (debug_level) fprintf( stderr, "wineserver: starting (pid=%ld)\n", (long) getpid() );
     init_signals();
+    init_shm_sync();
+    init_shm_queues();
+    init_shm_windows();
+    init_request_profile( profile_file );
     init_directories();
     init_registry();
     main_loop();
@@ -110,7 +110,16 @@ static struct mutex *create_mutex( struct directory *root, const struct unicode_
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
-            if (owned) do_grab( mutex, current );
+            if ((mutex->obj.sync = alloc_shm_sync( &mutex->obj, SHM_SYNC_MUTEX )))
+            {
+                if (owned)
+                {
+                    mutex->obj.sync->state = current->id;
+                    mutex->obj.sync->count = 1;
+                    shm_sync_set_owner( mutex->obj.sync, current );
+                }
+            }
+            else if (owned) do_grab( mutex, current );
             if (sd) default_set_sd( &mutex->obj, sd, OWNER_SECURITY_INFORMATION|
                                                      GROUP_SECURITY_INFORMATION|
                                                      DACL_SECURITY_INFORMATION|
@@ -120,6 +129,27 @@ static struct mutex *create_mutex( struct directory *root, const struct unicode_
     return mutex;
 }
 
+/* release a shared mutex, the client may not have told us that it owns it */
+static int release_shm_mutex( struct mutex *mutex, thread_id_t owner, unsigned int *prev_count )
+{
+    struct shm_sync_object *sync = mutex->obj.sync;
+
+    if (!sync->count || (thread_id_t)sync->state != owner)
+    {
+        set_error( STATUS_MUTANT_NOT_OWNED );
+        return 0;
+    }
+    if (prev_count) *prev_count = sync->count;
+    if (!--sync->count)
+    {
+        shm_sync_clear_owner( sync );
+        interlocked_xchg( &sync->state, 0 );
+        shm_sync_wake( sync );
+        wake_up( &mutex->obj, 0 );
+    }
+    return 1;
+}
+
 void abandon_mutexes( struct thread *thread )
 {
     struct list *ptr;
@@ -132,13 +162,17 @@ void abandon_mutexes( struct thread *thread )
         mutex->abandoned = 1;
         do_release( mutex );
     }
+    abandon_shm_mutexes( thread );
 }
 
 static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p ", mutex->count, mutex->owner );
+    if (obj->sync)
+        fprintf( stderr, "Mutex count=%u owner=%04x ", obj->sync->count, obj->sync->state );
+    else
+        fprintf( stderr, "Mutex count=%u owner=%p ", mutex->count, mutex->owner );
     dump_object_name( &mutex->obj );
     fputc( '\n', stderr );
 }
@@ -154,6 +188,7 @@ static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
+    if (obj->sync) return shm_sync_signaled( obj->sync, entry );
     return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
 }
 
@@ -161,6 +196,7 @@ static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
+    if (obj->sync) return;  /* already acquired in check_wait */
 
     do_grab( mutex, get_wait_queue_thread( entry ));
     if (mutex->abandoned) make_wait_abandoned( entry );
@@ -186,6 +222,7 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
+    if (obj->sync) return release_shm_mutex( mutex, current->id, NULL );
     if (!mutex->count || (mutex->owner != current))
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
@@ -200,7 +237,7 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
-    if (!mutex->count) return;
+    if (obj->sync || !mutex->count) return;
     mutex->count = 0;
     do_release( mutex );
 }
@@ -265,7 +302,8 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
+        if (mutex->obj.sync) release_shm_mutex( mutex, current->id, &reply->prev_count );
+        else if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
         else
         {
             reply->prev_count = mutex->count;
@@ -210,6 +210,7 @@ void *alloc_object( const struct object_ops *ops )
         obj->ops      = ops;
         obj->name     = NULL;
         obj->sd       = NULL;
+        obj->sync     = NULL;
         list_init( &obj->wait_queue );
 #ifdef DEBUG_OBJECTS
         list_add_head( &object_list, &obj->obj_list );
@@ -311,6 +312,7 @@ void release_object( void *ptr )
         obj->ops->destroy( obj );
         if (obj->name) free_name( obj );
         free( obj->sd );
+        if (obj->sync) free_shm_sync( obj->sync );
 #ifdef DEBUG_OBJECTS
         list_remove( &obj->obj_list );
         memset( obj, 0xaa, obj->ops->size );
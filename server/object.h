@@ -99,6 +99,7 @@ struct object
     struct list               wait_queue;
     struct object_name       *name;
     struct security_descriptor *sd;
+    struct shm_sync_object   *sync;        /* state shared with the clients, if any */
 #ifdef DEBUG_OBJECTS
     struct list               obj_list;
 #endif
@@ -169,6 +170,22 @@ extern void reset_event( struct event *event );
 
 extern void abandon_mutexes( struct thread *thread );
 
+/* shared synchronization functions */
+
+extern void init_shm_sync(void);
+extern struct shm_sync_object *alloc_shm_sync( struct object *obj, unsigned int type );
+extern void free_shm_sync( struct shm_sync_object *sync );
+extern struct shm_sync_info *get_shm_sync_info( const struct shm_sync_object *sync );
+extern void shm_sync_invalidate_handles(void);
+extern void shm_sync_wake( struct shm_sync_object *sync );
+extern void shm_sync_pulse( struct shm_sync_object *sync );
+extern int shm_sync_signaled( struct shm_sync_object *sync, struct wait_queue_entry *entry );
+extern int shm_sync_acquire( struct shm_sync_object *sync, struct wait_queue_entry *entry );
+extern void shm_sync_undo_acquire( struct shm_sync_object *sync, int acquired );
+extern void shm_sync_set_owner( struct shm_sync_object *sync, struct thread *thread );
+extern void shm_sync_clear_owner( struct shm_sync_object *sync );
+extern void abandon_shm_mutexes( struct thread *thread );
+
 /* serial functions */
 
 int get_serial_async_timeout(struct object *obj, int type, int count);
@@ -230,6 +247,7 @@ extern void create_mailslot_device( struct directory *root, const struct unicode
   /* command-line options */
 extern int debug_level;
 extern int foreground;
+extern int registry_journal;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
 
@@ -0,0 +1,239 @@
+/*
+ * Server request profiling
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When enabled with --profile or the WINESERVERPROFILE environment variable,
+ * the server records for each process and request type the number of calls,
+ * the time spent in the handler and the size of the reply data. The handler
+ * times are also kept in a logarithmic histogram to estimate percentiles.
+ *
+ * The statistics are written on SIGUSR1 and when the server exits, as tab
+ * separated lines with one header line starting with '#'. The statistics
+ * of terminated processes are written in the next dump and then freed.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "object.h"
+#include "process.h"
+#include "thread.h"
+#include "request.h"
+
+/* four buckets per power of two nanoseconds, up to about 30 seconds */
+#define PROFILE_SUBBUCKETS 4
+#define PROFILE_BUCKETS    (34 * PROFILE_SUBBUCKETS)
+
+struct request_stats
+{
+    unsigned int     count;                       /* number of calls */
+    unsigned __int64 total_time;                  /* total handler time in ns */
+    unsigned __int64 max_time;                    /* longest handler time in ns */
+    unsigned __int64 reply_bytes;                 /* total size of the reply data */
+    unsigned int     histogram[PROFILE_BUCKETS];  /* handler time histogram */
+};
+
+struct process_profile
+{
+    struct list           entry;                  /* entry in the profile list */
+    process_id_t          id;                     /* id of the process */
+    int                   unix_pid;               /* Unix pid of the process */
+    int                   exited;                 /* has the process terminated? */
+    struct request_stats *stats[REQ_NB_REQUESTS]; /* stats for each request type, allocated on use */
+};
+
+static struct list profile_list = LIST_INIT(profile_list);
+static const char *profile_file;  /* output file name, NULL if profiling is disabled */
+static FILE *profile_output;
+
+static unsigned __int64 get_time_ns(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return ts.tv_sec * (unsigned __int64)1000000000 + ts.tv_nsec;
+#endif
+    {
+        struct timeval tv;
+        gettimeofday( &tv, NULL );
+        return tv.tv_sec * (unsigned __int64)1000000000 + tv.tv_usec * 1000;
+    }
+}
+
+/* map a time to a histogram bucket */
+static unsigned int time_to_bucket( unsigned __int64 ns )
+{
+    unsigned int bucket, bits = 0;
+
+    if (ns < PROFILE_SUBBUCKETS) return ns;
+    while (ns >> bits >= 2 * PROFILE_SUBBUCKETS) bits++;
+    bucket = (bits + 1) * PROFILE_SUBBUCKETS + (ns >> bits) - PROFILE_SUBBUCKETS;
+    return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+/* return the upper bound of the times stored in a histogram bucket */
+static unsigned __int64 bucket_to_time( unsigned int bucket )
+{
+    unsigned int bits;
+
+    if (bucket < PROFILE_SUBBUCKETS) return bucket;
+    bits = bucket / PROFILE_SUBBUCKETS - 1;
+    return ((unsigned __int64)(bucket % PROFILE_SUBBUCKETS + PROFILE_SUBBUCKETS + 1) << bits) - 1;
+}
+
+/* estimate a percentile of the handler times */
+static unsigned __int64 get_percentile( const struct request_stats *stats, unsigned int percent )
+{
+    unsigned int i, sum = 0, limit = (stats->count * (unsigned __int64)percent + 99) / 100;
+
+    for (i = 0; i < PROFILE_BUCKETS; i++)
+    {
+        sum += stats->histogram[i];
+        if (sum >= limit) break;
+    }
+    if (i == PROFILE_BUCKETS) return stats->max_time;
+    return min( bucket_to_time( i ), stats->max_time );
+}
+
+/* enable profiling, output goes to the given file, or stderr if empty */
+void init_request_profile( const char *file )
+{
+    if (!file && !(file = getenv( "WINESERVERPROFILE" ))) return;
+    profile_file = file;
+    atexit( dump_request_profile );
+}
+
+/* start timing a request; returns 0 if profiling is disabled */
+unsigned __int64 profile_request_start(void)
+{
+    if (!profile_file) return 0;
+    return get_time_ns();
+}
+
+/* record the execution of a request by the current thread */
+void profile_request_end( enum request req, unsigned __int64 start )
+{
+    struct process *process = current->process;
+    struct process_profile *profile;
+    struct request_stats *stats;
+    unsigned __int64 time;
+
+    if (!start || req >= REQ_NB_REQUESTS) return;
+    time = get_time_ns() - start;
+
+    if (!(profile = process->profile))
+    {
+        if (!(profile = mem_alloc( sizeof(*profile) ))) return;
+        memset( profile, 0, sizeof(*profile) );
+        profile->id       = process->id;
+        profile->unix_pid = process->unix_pid;
+        list_add_tail( &profile_list, &profile->entry );
+        process->profile = profile;
+    }
+    if (!(stats = profile->stats[req]))
+    {
+        if (!(stats = mem_alloc( sizeof(*stats) ))) return;
+        memset( stats, 0, sizeof(*stats) );
+        profile->stats[req] = stats;
+    }
+    if (profile->unix_pid == -1) profile->unix_pid = process->unix_pid;
+
+    stats->count++;
+    stats->total_time += time;
+    stats->reply_bytes += current->reply_size;
+    if (time > stats->max_time) stats->max_time = time;
+    stats->histogram[time_to_bucket( time )]++;
+}
+
+static void free_profile( struct process_profile *profile )
+{
+    unsigned int i;
+
+    list_remove( &profile->entry );
+    for (i = 0; i < REQ_NB_REQUESTS; i++) free( profile->stats[i] );
+    free( profile );
+}
+
+/* keep the statistics of a terminated process until the next dump */
+void profile_process_exit( struct process *process )
+{
+    struct process_profile *profile = process->profile;
+
+    if (!profile) return;
+    process->profile = NULL;
+    if (!profile_file) free_profile( profile );  /* the output file couldn't be opened */
+    else profile->exited = 1;
+}
+
+/* write the statistics of all the processes */
+void dump_request_profile(void)
+{
+    struct process_profile *profile, *next;
+    struct request_stats *stats;
+    unsigned int i;
+
+    if (!profile_file) return;
+
+    if (!profile_output)
+    {
+        if (!profile_file[0]) profile_output = stderr;
+        else if (!(profile_output = fopen( profile_file, "a" )))
+        {
+            fprintf( stderr, "wineserver: cannot open profile file %s: %s\n",
+                     profile_file, strerror( errno ));
+            profile_file = NULL;
+            LIST_FOR_EACH_ENTRY_SAFE( profile, next, &profile_list, struct process_profile, entry )
+                if (profile->exited) free_profile( profile );
+            return;
+        }
+    }
+
+    fprintf( profile_output, "#pid\tunix_pid\tstate\trequest\tcount\ttotal_ns\tavg_ns\tp99_ns\tmax_ns\treply_bytes\n" );
+    LIST_FOR_EACH_ENTRY_SAFE( profile, next, &profile_list, struct process_profile, entry )
+    {
+        for (i = 0; i < REQ_NB_REQUESTS; i++)
+        {
+            if (!(stats = profile->stats[i])) continue;
+            fprintf( profile_output, "%04x\t%d\t%s\t%s\t%u\t%llu\t%llu\t%llu\t%llu\t%llu\n",
+                     profile->id, profile->unix_pid, profile->exited ? "exited" : "running",
+                     get_req_name( i ), stats->count,
+                     (unsigned long long)stats->total_time,
+                     (unsigned long long)(stats->total_time / stats->count),
+                     (unsigned long long)get_percentile( stats, 99 ),
+                     (unsigned long long)stats->max_time,
+                     (unsigned long long)stats->reply_bytes );
+        }
+        /* the statistics of a terminated process are only written once */
+        if (profile->exited) free_profile( profile );
+    }
+    fflush( profile_output );
+}
@@ -22,9 +22,16 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -135,6 +142,7 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    struct shm_queue_status *shared;        /* status shared with the owner thread, NULL if none */
 };
 
 struct hotkey
@@ -259,6 +267,85 @@ static struct thread_input *create_thread_input( struct thread *thread )
     return input;
 }
 
+/* The wake and changed bits and masks of each queue are published in a file
+ * mapping, so that the owner thread can find out that there is nothing to
+ * retrieve without a server round trip. */
+
+#define SHM_MAX_QUEUES 16384
+
+static struct shm_queue_status *shm_queues;      /* shared region, NULL if not available */
+static unsigned int *free_queue_slots;           /* indices of the free entries */
+static unsigned int nb_free_queue_slots;         /* number of free entries in the list */
+static unsigned int next_queue_slot = 1;         /* first never used entry, 0 is reserved */
+
+/* create the shared queue region in the server directory */
+void init_shm_queues(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    size_t size = SHM_MAX_QUEUES * sizeof(struct shm_queue_status);
+    void *ptr;
+    int fd;
+
+    /* the clients open the same file from the server directory */
+    if ((fd = open( "queues", O_CREAT | O_TRUNC | O_RDWR, 0600 )) == -1)
+    {
+        fprintf( stderr, "wineserver: cannot create queue region: %s\n", strerror( errno ));
+        return;
+    }
+    if (ftruncate( fd, size ) == -1 ||
+        (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        fprintf( stderr, "wineserver: cannot map queue region: %s\n", strerror( errno ));
+        close( fd );
+        return;
+    }
+    close( fd );
+
+    if (!(free_queue_slots = malloc( SHM_MAX_QUEUES * sizeof(*free_queue_slots) )))
+    {
+        munmap( ptr, size );
+        return;
+    }
+    shm_queues = ptr;
+#endif
+}
+
+/* allocate the shared status of a new queue */
+static struct shm_queue_status *alloc_shm_queue(void)
+{
+    struct shm_queue_status *shared;
+    unsigned int index;
+
+    if (!shm_queues) return NULL;
+
+    if (nb_free_queue_slots) index = free_queue_slots[--nb_free_queue_slots];
+    else if (next_queue_slot < SHM_MAX_QUEUES) index = next_queue_slot++;
+    else return NULL;
+
+    shared = &shm_queues[index];
+    interlocked_xchg_add( &shared->seq, 1 );
+    shared->wake_bits    = 0;
+    shared->wake_mask    = 0;
+    shared->changed_bits = 0;
+    shared->changed_mask = 0;
+    interlocked_xchg_add( &shared->seq, 1 );
+    return shared;
+}
+
+/* publish the current queue status to the owner thread */
+static void update_shm_queue( struct msg_queue *queue )
+{
+    struct shm_queue_status *shared = queue->shared;
+
+    if (!shared) return;
+    interlocked_xchg_add( &shared->seq, 1 );
+    shared->wake_bits    = queue->wake_bits;
+    shared->wake_mask    = queue->wake_mask;
+    shared->changed_bits = queue->changed_bits;
+    shared->changed_mask = queue->changed_mask;
+    interlocked_xchg_add( &shared->seq, 1 );
+}
+
 /* create a message queue object */
 static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_input *input )
 {
@@ -289,6 +376,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->shared          = alloc_shm_queue();
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -421,6 +509,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_shm_queue( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -429,6 +518,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_shm_queue( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -929,6 +1019,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_shm_queue( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -967,6 +1058,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shared) free_queue_slots[nb_free_queue_slots++] = queue->shared - shm_queues;
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -2154,7 +2246,12 @@ DECL_HANDLER(get_msg_queue)
     struct msg_queue *queue = get_current_queue();
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    reply->shm_index = 0;
+    if (queue)
+    {
+        reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+        if (queue->shared) reply->shm_index = queue->shared - shm_queues;
+    }
 }
 
 
@@ -2200,6 +2297,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_shm_queue( queue );
     }
 }
 
@@ -2212,7 +2310,11 @@ DECL_HANDLER(get_queue_status)
     {
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
-        if (req->clear) queue->changed_bits = 0;
+        if (req->clear)
+        {
+            queue->changed_bits = 0;
+            update_shm_queue( queue );
+        }
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2387,6 +2489,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_shm_queue( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2442,6 +2545,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_shm_queue( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
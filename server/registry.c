@@ -35,6 +35,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -69,12 +73,19 @@ struct key
     unsigned short    namelen;     /* length of key name */
     unsigned short    classlen;    /* length of class name */
     struct key       *parent;      /* parent key */
+    unsigned int      index_slot;  /* slot in the subkey index of the parent */
     int               last_subkey; /* last in use subkey */
     int               nb_subkeys;  /* count of allocated subkeys */
+    int               sorted_subkeys; /* count of subkeys in sorted order at the start of the array */
+    int               deleted_subkeys; /* count of deleted subkeys left in the array */
     struct key      **subkeys;     /* subkeys array */
+    struct name_index *subkey_index; /* hash index of the subkey names */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
+    int               sorted_values; /* count of values in sorted order at the start of the array */
+    int               deleted_values; /* count of deleted values left in the array */
     struct key_value *values;      /* values array */
+    struct name_index *value_index; /* hash index of the value names */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
@@ -96,10 +107,38 @@ struct key_value
     unsigned short    type;    /* value type */
     data_size_t       len;     /* value data length in bytes */
     void             *data;    /* pointer to value data */
+    unsigned int      index_slot; /* slot in the value index of the key */
 };
 
+#define DELETED_VALUE_NAMELEN 0xffff  /* name length of the deleted values left in the array */
+
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEXED  32  /* min. number of subkeys or values to use a hash index */
+
+/* Subkeys and values are appended to their array, and the array is only
+ * sorted when an entry is requested by index, or when the key is saved.
+ * Keys with many entries use a case-insensitive hash index of the array
+ * positions for lookups, so that creating many entries is not quadratic.
+ * Each entry stores its slot in the index, so that the positions can be
+ * updated when entries move. Deleting an entry of an indexed array leaves
+ * a hole, and the holes are only removed when there are too many of them,
+ * or before the array is sorted, so that deleting many entries is not
+ * quadratic either. The last entry of an array is never a hole. */
+struct name_index
+{
+    unsigned int      size;        /* size of the table, a power of 2 */
+    unsigned int      count;       /* number of used entries */
+    int               pos[1];      /* position in the array, -1 if free */
+};
+
+/* accessors for the entries of the subkey and value arrays */
+struct entry_funcs
+{
+    const WCHAR  *(*get_name)( const struct key *key, int pos, data_size_t *len );
+    unsigned int *(*get_slot)( const struct key *key, int pos );
+    int           (*is_deleted)( const struct key *key, int pos );
+};
 
 #define MAX_NAME_LEN  255    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -118,13 +157,23 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( const struct key *key, const struct unicode_str *name );
+static void sort_subkeys( struct key *key );
+static void sort_values( struct key *key );
+static void journal_delete_key( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    char        *snapshot_path;  /* binary snapshot file (journal mode only) */
+    char        *journal_path;   /* change journal file (journal mode only) */
+    FILE        *journal;        /* change journal opened for appending */
+    timeout_t    generation;     /* generation number of the current snapshot */
+    file_pos_t   snapshot_size;  /* size of the current snapshot */
+    int          text_dirty;     /* text file is out of date with respect to the journal */
+    int          need_snapshot;  /* snapshot must be rewritten at the next save */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -253,11 +302,13 @@ static void dump_value( const struct key_value *value, FILE *f )
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -407,12 +458,15 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free( key->value_index );
     for (i = 0; i <= key->last_subkey; i++)
     {
+        if (!key->subkeys[i]) continue;
         key->subkeys[i]->parent = NULL;
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free( key->subkey_index );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -475,10 +529,16 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->flags       = 0;
         key->last_subkey = -1;
         key->nb_subkeys  = 0;
+        key->sorted_subkeys = 0;
+        key->deleted_subkeys = 0;
         key->subkeys     = NULL;
+        key->subkey_index = NULL;
         key->nb_values   = 0;
         key->last_value  = -1;
+        key->sorted_values = 0;
+        key->deleted_values = 0;
         key->values      = NULL;
+        key->value_index = NULL;
         key->modif       = modif;
         key->parent      = NULL;
         list_init( &key->notify_list );
@@ -510,7 +570,7 @@ static void make_clean( struct key *key )
     if (key->flags & KEY_VOLATILE) return;
     if (!(key->flags & KEY_DIRTY)) return;
     key->flags &= ~KEY_DIRTY;
-    for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
+    for (i = 0; i <= key->last_subkey; i++) if (key->subkeys[i]) make_clean( key->subkeys[i] );
 }
 
 /* go through all the notifications and send them if necessary */
@@ -540,6 +600,301 @@ static void touch_key( struct key *key, unsigned int change )
         check_notify( k, change & ~REG_NOTIFY_CHANGE_LAST_SET, 0 );
 }
 
+/* compare two key or value names the same way as the sorted arrays */
+static inline int compare_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmpW( name1, name2, min( len1, len2 ) / sizeof(WCHAR) );
+    if (!res) res = (int)len1 - (int)len2;
+    return res;
+}
+
+/* compute the case-insensitive hash of a key or value name */
+static unsigned int hash_name( const WCHAR *name, data_size_t len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len / sizeof(WCHAR); i++) hash = hash * 31 + tolowerW( name[i] );
+    return hash;
+}
+
+static const WCHAR *get_subkey_name( const struct key *key, int pos, data_size_t *len )
+{
+    *len = key->subkeys[pos]->namelen;
+    return key->subkeys[pos]->name;
+}
+
+static unsigned int *get_subkey_slot( const struct key *key, int pos )
+{
+    return &key->subkeys[pos]->index_slot;
+}
+
+static int is_deleted_subkey( const struct key *key, int pos )
+{
+    return !key->subkeys[pos];
+}
+
+static const WCHAR *get_value_name( const struct key *key, int pos, data_size_t *len )
+{
+    *len = key->values[pos].namelen;
+    return key->values[pos].name;
+}
+
+static unsigned int *get_value_slot( const struct key *key, int pos )
+{
+    return &key->values[pos].index_slot;
+}
+
+static inline int is_value_deleted( const struct key_value *value )
+{
+    return value->namelen == DELETED_VALUE_NAMELEN;
+}
+
+static int is_deleted_value( const struct key *key, int pos )
+{
+    return is_value_deleted( &key->values[pos] );
+}
+
+static const struct entry_funcs subkey_funcs = { get_subkey_name, get_subkey_slot, is_deleted_subkey };
+static const struct entry_funcs value_funcs = { get_value_name, get_value_slot, is_deleted_value };
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(const struct key * const *)p1;
+    const struct key *key2 = *(const struct key * const *)p2;
+    return compare_names( key1->name, key1->namelen, key2->name, key2->namelen );
+}
+
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1;
+    const struct key_value *value2 = p2;
+    return compare_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* add an array position to a name index */
+static void name_index_add( const struct key *key, struct name_index *index, unsigned int hash, int pos,
+                            const struct entry_funcs *funcs )
+{
+    unsigned int i = hash & (index->size - 1);
+
+    while (index->pos[i] != -1) i = (i + 1) & (index->size - 1);
+    index->pos[i] = pos;
+    *funcs->get_slot( key, pos ) = i;
+    index->count++;
+}
+
+/* build the name index of an array of subkeys or values; return NULL if not needed */
+static struct name_index *build_name_index( const struct key *key, int count, int deleted,
+                                            const struct entry_funcs *funcs )
+{
+    struct name_index *index;
+    const WCHAR *name;
+    data_size_t len;
+    unsigned int size = 2 * MIN_INDEXED;
+    int i;
+
+    /* arrays with holes must keep an index */
+    if (!deleted && count < MIN_INDEXED) return NULL;
+    while (size < 2 * count) size *= 2;
+    if (!(index = malloc( sizeof(*index) + (size - 1) * sizeof(index->pos[0]) ))) return NULL;
+    index->size  = size;
+    index->count = 0;
+    memset( index->pos, 0xff, size * sizeof(index->pos[0]) );
+    for (i = 0; i < count; i++)
+    {
+        if (funcs->is_deleted( key, i )) continue;
+        name = funcs->get_name( key, i, &len );
+        name_index_add( key, index, hash_name( name, len ), i, funcs );
+    }
+    return index;
+}
+
+/* find the array position of a named subkey or value, or -1 if not found */
+static int find_entry( const struct key *key, const struct name_index *index, int count, int sorted,
+                       const struct entry_funcs *funcs, const struct unicode_str *name )
+{
+    const WCHAR *entry;
+    data_size_t len;
+    int i, min, max, res;
+
+    if (index)
+    {
+        for (i = hash_name( name->str, name->len ) & (index->size - 1); index->pos[i] != -1;
+             i = (i + 1) & (index->size - 1))
+        {
+            entry = funcs->get_name( key, index->pos[i], &len );
+            if (!compare_names( entry, len, name->str, name->len )) return index->pos[i];
+        }
+        return -1;
+    }
+
+    /* arrays without an index have no holes */
+    min = 0;
+    max = sorted - 1;
+    while (min <= max)
+    {
+        i = (min + max) / 2;
+        entry = funcs->get_name( key, i, &len );
+        res = compare_names( entry, len, name->str, name->len );
+        if (!res) return i;
+        if (res > 0) max = i - 1;
+        else min = i + 1;
+    }
+    for (i = sorted; i < count; i++)
+    {
+        entry = funcs->get_name( key, i, &len );
+        if (!compare_names( entry, len, name->str, name->len )) return i;
+    }
+    return -1;
+}
+
+/* add the entry that has been appended to an array to its index */
+static void add_entry( const struct key *key, struct name_index **index, int count, int deleted,
+                       const struct entry_funcs *funcs )
+{
+    const WCHAR *name;
+    data_size_t len;
+
+    if (!*index || count * 4 > (*index)->size * 3)
+    {
+        free( *index );
+        *index = build_name_index( key, count, deleted, funcs );
+        return;
+    }
+    name = funcs->get_name( key, count - 1, &len );
+    name_index_add( key, *index, hash_name( name, len ), count - 1, funcs );
+}
+
+/* remove an entry from the index of an array, the other entries keep their position */
+static void remove_entry( const struct key *key, struct name_index *index, int pos,
+                          const struct entry_funcs *funcs )
+{
+    const WCHAR *name;
+    data_size_t len;
+    unsigned int i, j, k, mask = index->size - 1;
+
+    i = *funcs->get_slot( key, pos );
+    assert( index->pos[i] == pos );
+
+    /* move back the following entries of the cluster that can fill the hole */
+    for (j = (i + 1) & mask; index->pos[j] != -1; j = (j + 1) & mask)
+    {
+        name = funcs->get_name( key, index->pos[j], &len );
+        k = hash_name( name, len ) & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+        index->pos[i] = index->pos[j];
+        *funcs->get_slot( key, index->pos[i] ) = i;
+        i = j;
+    }
+    index->pos[i] = -1;
+    index->count--;
+}
+
+/* update the index after the entries of an array have moved */
+static void update_entry_positions( const struct key *key, struct name_index *index, int start, int count,
+                                    const struct entry_funcs *funcs )
+{
+    int i;
+
+    if (index) for (i = start; i < count; i++) index->pos[*funcs->get_slot( key, i )] = i;
+}
+
+/* remove the holes of an array of subkeys or values; return the new count */
+static int compact_entries( const struct key *key, void *array, int count, int *sorted, size_t size,
+                            struct name_index *index, const struct entry_funcs *funcs )
+{
+    char *ptr = array;
+    int i, pos, first, new_sorted;
+
+    for (first = 0; first < count && !funcs->is_deleted( key, first ); first++) ;
+    new_sorted = min( first, *sorted );
+    for (i = pos = first; i < count; i++)
+    {
+        if (funcs->is_deleted( key, i )) continue;
+        if (i < *sorted) new_sorted++;
+        memcpy( ptr + pos * size, ptr + i * size, size );
+        pos++;
+    }
+    *sorted = new_sorted;
+    update_entry_positions( key, index, first, pos, funcs );
+    return pos;
+}
+
+/* sort an array of subkeys or values by merging the unsorted entries into the sorted ones */
+static void *sort_entries( void *array, int sorted, int count, int capacity, size_t size,
+                           int (*compare)( const void *, const void * ) )
+{
+    char *src = array, *dst, *new_array;
+    int i, j;
+
+    qsort( src + sorted * size, count - sorted, size, compare );
+    if (!sorted) return array;
+    if (!(new_array = malloc( capacity * size )))
+    {
+        qsort( src, count, size, compare );
+        return array;
+    }
+    for (i = 0, j = sorted, dst = new_array; i < sorted || j < count; dst += size)
+    {
+        if (j == count || (i < sorted && compare( src + i * size, src + j * size ) <= 0))
+            memcpy( dst, src + i++ * size, size );
+        else
+            memcpy( dst, src + j++ * size, size );
+    }
+    free( array );
+    return new_array;
+}
+
+/* remove the holes of the subkeys array, if forced or if there are too many of them */
+static void compact_subkeys( struct key *key, int force )
+{
+    int count = key->last_subkey + 1;
+
+    if (!key->deleted_subkeys || (!force && key->deleted_subkeys * 2 <= count)) return;
+    key->last_subkey = compact_entries( key, key->subkeys, count, &key->sorted_subkeys,
+                                        sizeof(*key->subkeys), key->subkey_index, &subkey_funcs ) - 1;
+    key->deleted_subkeys = 0;
+}
+
+/* remove the holes of the values array, if forced or if there are too many of them */
+static void compact_values( struct key *key, int force )
+{
+    int count = key->last_value + 1;
+
+    if (!key->deleted_values || (!force && key->deleted_values * 2 <= count)) return;
+    key->last_value = compact_entries( key, key->values, count, &key->sorted_values,
+                                       sizeof(*key->values), key->value_index, &value_funcs ) - 1;
+    key->deleted_values = 0;
+}
+
+/* sort the subkeys array before accessing it by index */
+static void sort_subkeys( struct key *key )
+{
+    int count;
+
+    compact_subkeys( key, 1 );
+    count = key->last_subkey + 1;
+    if (key->sorted_subkeys == count) return;
+    key->subkeys = sort_entries( key->subkeys, key->sorted_subkeys, count, key->nb_subkeys,
+                                 sizeof(*key->subkeys), compare_subkeys );
+    key->sorted_subkeys = count;
+    update_entry_positions( key, key->subkey_index, 0, count, &subkey_funcs );
+}
+
+/* sort the values array before accessing it by index */
+static void sort_values( struct key *key )
+{
+    int count;
+
+    compact_values( key, 1 );
+    count = key->last_value + 1;
+    if (key->sorted_values == count) return;
+    key->values = sort_entries( key->values, key->sorted_values, count, key->nb_values,
+                                sizeof(*key->values), compare_values );
+    key->sorted_values = count;
+    update_entry_positions( key, key->value_index, 0, count, &value_funcs );
+}
+
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
 static int grow_subkeys( struct key *key )
 {
@@ -565,12 +920,11 @@ static int grow_subkeys( struct key *key )
     return 1;
 }
 
-/* allocate a subkey for a given key, and return its index */
-static struct key *alloc_subkey( struct key *parent, const struct unicode_str *name,
-                                 int index, timeout_t modif )
+/* allocate a subkey for a given key */
+static struct key *alloc_subkey( struct key *parent, const struct unicode_str *name, timeout_t modif )
 {
     struct key *key;
-    int i;
+    int last;
 
     if (name->len > MAX_NAME_LEN * sizeof(WCHAR))
     {
@@ -585,9 +939,12 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
     if ((key = alloc_key( name, modif )) != NULL)
     {
         key->parent = parent;
-        for (i = ++parent->last_subkey; i > index; i--)
-            parent->subkeys[i] = parent->subkeys[i-1];
-        parent->subkeys[index] = key;
+        last = ++parent->last_subkey;
+        parent->subkeys[last] = key;
+        if (parent->sorted_subkeys == last &&
+            (!last || compare_subkeys( &parent->subkeys[last - 1], &parent->subkeys[last] ) < 0))
+            parent->sorted_subkeys++;
+        add_entry( parent, &parent->subkey_index, last + 1, parent->deleted_subkeys, &subkey_funcs );
         if (is_wow6432node( key->name, key->namelen ) && !is_wow6432node( parent->name, parent->namelen ))
             parent->flags |= KEY_WOW64;
     }
@@ -604,8 +961,31 @@ static void free_subkey( struct key *parent, int index )
     assert( index <= parent->last_subkey );
 
     key = parent->subkeys[index];
-    for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
-    parent->last_subkey--;
+    if (parent->subkey_index)
+    {
+        remove_entry( parent, parent->subkey_index, index, &subkey_funcs );
+        parent->subkeys[index] = NULL;
+        parent->deleted_subkeys++;
+        while (parent->last_subkey >= 0 && !parent->subkeys[parent->last_subkey])
+        {
+            parent->last_subkey--;
+            parent->deleted_subkeys--;
+        }
+        if (parent->sorted_subkeys > parent->last_subkey + 1) parent->sorted_subkeys = parent->last_subkey + 1;
+        if (parent->last_subkey + 1 - parent->deleted_subkeys < MIN_INDEXED / 2)
+        {
+            compact_subkeys( parent, 1 );
+            free( parent->subkey_index );
+            parent->subkey_index = NULL;
+        }
+        else compact_subkeys( parent, 0 );
+    }
+    else
+    {
+        for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+        parent->last_subkey--;
+        if (index < parent->sorted_subkeys) parent->sorted_subkeys--;
+    }
     key->flags |= KEY_DELETED;
     key->parent = NULL;
     if (is_wow6432node( key->name, key->namelen )) parent->flags &= ~KEY_WOW64;
@@ -624,42 +1004,29 @@ static void free_subkey( struct key *parent, int index )
     }
 }
 
-/* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+/* find the named child of a given key and return its index, or -1 if not found */
+static int find_subkey_index( const struct key *key, const struct unicode_str *name )
 {
-    int i, min, max, res;
-    data_size_t len;
+    return find_entry( key, key->subkey_index, key->last_subkey + 1, key->sorted_subkeys,
+                       &subkey_funcs, name );
+}
 
-    min = 0;
-    max = key->last_subkey;
-    while (min <= max)
-    {
-        i = (min + max) / 2;
-        len = min( key->subkeys[i]->namelen, name->len );
-        res = memicmpW( key->subkeys[i]->name, name->str, len / sizeof(WCHAR) );
-        if (!res) res = key->subkeys[i]->namelen - name->len;
-        if (!res)
-        {
-            *index = i;
-            return key->subkeys[i];
-        }
-        if (res > 0) max = i - 1;
-        else min = i + 1;
-    }
-    *index = min;  /* this is where we should insert it */
-    return NULL;
+/* find the named child of a given key */
+static struct key *find_subkey( const struct key *key, const struct unicode_str *name )
+{
+    int index = find_subkey_index( key, name );
+    return index != -1 ? key->subkeys[index] : NULL;
 }
 
 /* return the wow64 variant of the key, or the key itself if none */
 static struct key *find_wow64_subkey( struct key *key, const struct unicode_str *name )
 {
     static const struct unicode_str wow6432node_str = { wow6432node, sizeof(wow6432node) };
-    int index;
 
     if (!(key->flags & KEY_WOW64)) return key;
     if (!is_wow6432node( name->str, name->len ))
     {
-        key = find_subkey( key, &wow6432node_str, &index );
+        key = find_subkey( key, &wow6432node_str );
         assert( key );  /* if KEY_WOW64 is set we must find it */
     }
     return key;
@@ -671,11 +1038,10 @@ static struct key *follow_symlink( struct key *key, int iteration )
 {
     struct unicode_str path, token;
     struct key_value *value;
-    int index;
 
     if (iteration > 16) return NULL;
     if (!(key->flags & KEY_SYMLINK)) return key;
-    if (!(value = find_value( key, &symlink_str, &index ))) return NULL;
+    if (!(value = find_value( key, &symlink_str ))) return NULL;
 
     path.str = value->data;
     path.len = (value->len / sizeof(WCHAR)) * sizeof(WCHAR);
@@ -689,7 +1055,7 @@ static struct key *follow_symlink( struct key *key, int iteration )
     if (!get_path_token( &path, &token )) return NULL;
     while (token.len)
     {
-        if (!(key = find_subkey( key, &token, &index ))) break;
+        if (!(key = find_subkey( key, &token ))) break;
         if (!(key = follow_symlink( key, iteration + 1 ))) break;
         get_path_token( &path, &token );
     }
@@ -699,7 +1065,7 @@ static struct key *follow_symlink( struct key *key, int iteration )
 /* open a key until we find an element that doesn't exist */
 /* helper for open_key and create_key */
 static struct key *open_key_prefix( struct key *key, const struct unicode_str *name,
-                                    unsigned int access, struct unicode_str *token, int *index )
+                                    unsigned int access, struct unicode_str *token )
 {
     token->str = NULL;
     if (!get_path_token( name, token )) return NULL;
@@ -707,13 +1073,13 @@ static struct key *open_key_prefix( struct key *key, const struct unicode_str *n
     while (token->len)
     {
         struct key *subkey;
-        if (!(subkey = find_subkey( key, token, index )))
+        if (!(subkey = find_subkey( key, token )))
         {
             if ((key->flags & KEY_WOWSHARE) && !(access & KEY_WOW64_64KEY))
             {
                 /* try in the 64-bit parent */
                 key = key->parent;
-                subkey = find_subkey( key, token, index );
+                subkey = find_subkey( key, token );
             }
         }
         if (!subkey) break;
@@ -734,10 +1100,9 @@ static struct key *open_key_prefix( struct key *key, const struct unicode_str *n
 static struct key *open_key( struct key *key, const struct unicode_str *name, unsigned int access,
                              unsigned int attributes )
 {
-    int index;
     struct unicode_str token;
 
-    if (!(key = open_key_prefix( key, name, access, &token, &index ))) return NULL;
+    if (!(key = open_key_prefix( key, name, access, &token ))) return NULL;
 
     if (token.len)
     {
@@ -760,11 +1125,10 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
                                const struct unicode_str *class, unsigned int options,
                                unsigned int access, unsigned int attributes, int *created )
 {
-    int index;
     struct unicode_str token, next;
 
     *created = 0;
-    if (!(key = open_key_prefix( key, name, access, &token, &index ))) return NULL;
+    if (!(key = open_key_prefix( key, name, access, &token ))) return NULL;
 
     if (!token.len)  /* the key already exists */
     {
@@ -800,7 +1164,7 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
     }
     *created = 1;
     make_dirty( key );
-    if (!(key = alloc_subkey( key, &token, index, current_time ))) return NULL;
+    if (!(key = alloc_subkey( key, &token, current_time ))) return NULL;
 
     if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
     if (options & REG_OPTION_VOLATILE) key->flags |= KEY_VOLATILE;
@@ -820,8 +1184,7 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
 /* recursively create a subkey (for internal use only) */
 static struct key *create_key_recursive( struct key *key, const struct unicode_str *name, timeout_t modif )
 {
-    struct key *base;
-    int index;
+    struct key *parent;
     struct unicode_str token;
 
     token.str = NULL;
@@ -829,7 +1192,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
     while (token.len)
     {
         struct key *subkey;
-        if (!(subkey = find_subkey( key, &token, &index ))) break;
+        if (!(subkey = find_subkey( key, &token ))) break;
         key = subkey;
         if (!(key = follow_symlink( key, 0 )))
         {
@@ -841,16 +1204,16 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 
     if (token.len)
     {
-        if (!(key = alloc_subkey( key, &token, index, modif ))) return NULL;
-        base = key;
+        parent = key;
+        if (!(key = alloc_subkey( key, &token, modif ))) return NULL;
         for (;;)
         {
             get_path_token( name, &token );
             if (!token.len) break;
-            /* we know the index is always 0 in a new key */
-            if (!(key = alloc_subkey( key, &token, 0, modif )))
+            if (!(key = alloc_subkey( key, &token, modif )))
             {
-                free_subkey( base, index );
+                /* the new key is still the last one of its parent */
+                free_subkey( parent, parent->last_subkey );
                 return NULL;
             }
         }
@@ -861,7 +1224,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 }
 
 /* query information about a key or a subkey */
-static void enum_key( const struct key *key, int index, int info_class,
+static void enum_key( struct key *key, int index, int info_class,
                       struct enum_key_reply *reply )
 {
     int i;
@@ -872,6 +1235,7 @@ static void enum_key( const struct key *key, int index, int info_class,
 
     if (index != -1)  /* -1 means use the specified key directly */
     {
+        sort_subkeys( key );
         if ((index < 0) || (index > key->last_subkey))
         {
             set_error( STATUS_NO_MORE_ENTRIES );
@@ -899,6 +1263,7 @@ static void enum_key( const struct key *key, int index, int info_class,
         for (i = 0; i <= key->last_subkey; i++)
         {
             struct key *subkey = key->subkeys[i];
+            if (!subkey) continue;
             len = subkey->namelen / sizeof(WCHAR);
             if (len > max_subkey) max_subkey = len;
             len = subkey->classlen / sizeof(WCHAR);
@@ -906,6 +1271,7 @@ static void enum_key( const struct key *key, int index, int info_class,
         }
         for (i = 0; i <= key->last_value; i++)
         {
+            if (is_value_deleted( &key->values[i] )) continue;
             len = key->values[i].namelen / sizeof(WCHAR);
             if (len > max_value) max_value = len;
             len = key->values[i].len;
@@ -921,8 +1287,8 @@ static void enum_key( const struct key *key, int index, int info_class,
         set_error( STATUS_INVALID_PARAMETER );
         return;
     }
-    reply->subkeys = key->last_subkey + 1;
-    reply->values  = key->last_value + 1;
+    reply->subkeys = key->last_subkey + 1 - key->deleted_subkeys;
+    reply->values  = key->last_value + 1 - key->deleted_values;
     reply->modif   = key->modif;
     reply->total   = namelen + classlen;
 
@@ -949,6 +1315,7 @@ static int delete_key( struct key *key, int recurse )
 {
     int index;
     struct key *parent = key->parent;
+    struct unicode_str name;
 
     /* must find parent and index */
     if (key == root_key)
@@ -962,9 +1329,10 @@ static int delete_key( struct key *key, int recurse )
         if (0 > delete_key(key->subkeys[key->last_subkey], 1))
             return -1;
 
-    for (index = 0; index <= parent->last_subkey; index++)
-        if (parent->subkeys[index] == key) break;
-    assert( index <= parent->last_subkey );
+    name.str = key->name;
+    name.len = key->namelen;
+    index = find_subkey_index( parent, &name );
+    assert( index != -1 && parent->subkeys[index] == key );
 
     /* we can only delete a key that has no subkeys */
     if (key->last_subkey >= 0)
@@ -974,6 +1342,7 @@ static int delete_key( struct key *key, int recurse )
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
+    if (registry_journal) journal_delete_key( key );
     free_subkey( parent, index );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 0;
@@ -1004,38 +1373,26 @@ static int grow_values( struct key *key )
     return 1;
 }
 
-/* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+/* find the named value of a given key and return its index in the array, or -1 if not found */
+static int find_value_index( const struct key *key, const struct unicode_str *name )
 {
-    int i, min, max, res;
-    data_size_t len;
+    return find_entry( key, key->value_index, key->last_value + 1, key->sorted_values,
+                       &value_funcs, name );
+}
 
-    min = 0;
-    max = key->last_value;
-    while (min <= max)
-    {
-        i = (min + max) / 2;
-        len = min( key->values[i].namelen, name->len );
-        res = memicmpW( key->values[i].name, name->str, len / sizeof(WCHAR) );
-        if (!res) res = key->values[i].namelen - name->len;
-        if (!res)
-        {
-            *index = i;
-            return &key->values[i];
-        }
-        if (res > 0) max = i - 1;
-        else min = i + 1;
-    }
-    *index = min;  /* this is where we should insert it */
-    return NULL;
+/* find the named value of a given key */
+static struct key_value *find_value( const struct key *key, const struct unicode_str *name )
+{
+    int index = find_value_index( key, name );
+    return index != -1 ? &key->values[index] : NULL;
 }
 
-/* insert a new value; the index must have been returned by find_value */
-static struct key_value *insert_value( struct key *key, const struct unicode_str *name, int index )
+/* append a new value to a key */
+static struct key_value *insert_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
     WCHAR *new_name = NULL;
-    int i;
+    int last;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
@@ -1047,12 +1404,15 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
-    for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
-    value = &key->values[index];
+    last = ++key->last_value;
+    value = &key->values[last];
     value->name    = new_name;
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    if (key->sorted_values == last && (!last || compare_values( value - 1, value ) < 0))
+        key->sorted_values++;
+    add_entry( key, &key->value_index, last + 1, key->deleted_values, &value_funcs );
     return value;
 }
 
@@ -1062,9 +1422,8 @@ static void set_value( struct key *key, const struct unicode_str *name,
 {
     struct key_value *value;
     void *ptr = NULL;
-    int index;
 
-    if ((value = find_value( key, name, &index )))
+    if ((value = find_value( key, name )))
     {
         /* check if the new value is identical to the existing one */
         if (value->type == type && value->len == len &&
@@ -1089,7 +1448,7 @@ static void set_value( struct key *key, const struct unicode_str *name,
 
     if (!value)
     {
-        if (!(value = insert_value( key, name, index )))
+        if (!(value = insert_value( key, name )))
         {
             free( ptr );
             return;
@@ -1108,9 +1467,8 @@ static void set_value( struct key *key, const struct unicode_str *name,
 static void get_value( struct key *key, const struct unicode_str *name, int *type, data_size_t *len )
 {
     struct key_value *value;
-    int index;
 
-    if ((value = find_value( key, name, &index )))
+    if ((value = find_value( key, name )))
     {
         *type = value->type;
         *len  = value->len;
@@ -1129,6 +1487,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 {
     struct key_value *value;
 
+    sort_values( key );
     if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
     else
     {
@@ -1181,16 +1540,42 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     struct key_value *value;
     int i, index, nb_values;
 
-    if (!(value = find_value( key, name, &index )))
+    if ((index = find_value_index( key, name )) == -1)
     {
         set_error( STATUS_OBJECT_NAME_NOT_FOUND );
         return;
     }
+    value = &key->values[index];
     if (debug_level > 1) dump_operation( key, value, "Delete" );
     free( value->name );
     free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
-    key->last_value--;
+    if (key->value_index)
+    {
+        remove_entry( key, key->value_index, index, &value_funcs );
+        value->name = NULL;
+        value->data = NULL;
+        value->namelen = DELETED_VALUE_NAMELEN;
+        key->deleted_values++;
+        while (key->last_value >= 0 && is_value_deleted( &key->values[key->last_value] ))
+        {
+            key->last_value--;
+            key->deleted_values--;
+        }
+        if (key->sorted_values > key->last_value + 1) key->sorted_values = key->last_value + 1;
+        if (key->last_value + 1 - key->deleted_values < MIN_INDEXED / 2)
+        {
+            compact_values( key, 1 );
+            free( key->value_index );
+            key->value_index = NULL;
+        }
+        else compact_values( key, 0 );
+    }
+    else
+    {
+        for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
+        key->last_value--;
+        if (index < key->sorted_values) key->sorted_values--;
+    }
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1436,7 +1821,6 @@ static struct key_value *parse_value_name( struct key *key, const char *buffer,
 {
     struct key_value *value;
     struct unicode_str name;
-    int index;
 
     if (!get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) return NULL;
     name.str = info->tmp;
@@ -1457,7 +1841,7 @@ static struct key_value *parse_value_name( struct key *key, const char *buffer,
     if (buffer[*len] != '=') goto error;
     (*len)++;
     while (isspace(buffer[*len])) (*len)++;
-    if (!(value = find_value( key, &name, &index ))) value = insert_value( key, &name, index );
+    if (!(value = find_value( key, &name ))) value = insert_value( key, &name );
     return value;
 
  error:
@@ -1623,9 +2007,660 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     free( info.tmp );
 }
 
+/*
+ * Binary snapshots and change journal
+ *
+ * When the server runs with --journal, each saved branch is also stored as a
+ * binary snapshot (<file>.snapshot) that is mapped and loaded without any
+ * parsing, plus an append-only journal (<file>.journal) of the keys modified
+ * or deleted since the snapshot was written. The periodic save only appends
+ * the dirty keys to the journal, and the snapshot is rewritten once the
+ * journal has grown too large. The text files remain the interchange format:
+ * they are loaded whenever the snapshot doesn't match them, and are written
+ * back when the server exits.
+ *
+ * All the variable-length data is padded to a multiple of 4 bytes.
+ */
+
+#define SNAPSHOT_VERSION     2
+#define JOURNAL_VERSION      1
+#define JOURNAL_MIN_COMPACT  (1024 * 1024)  /* min. journal size before rewriting the snapshot */
+
+static const char snapshot_magic[8] = { 'W','I','N','E','R','E','G','S' };
+static const char journal_magic[8]  = { 'W','I','N','E','R','E','G','J' };
+static const char snapshot_padding[3];
+
+struct snapshot_header
+{
+    char          magic[8];     /* snapshot_magic */
+    unsigned int  version;      /* SNAPSHOT_VERSION */
+    unsigned int  arch;         /* prefix type */
+    timeout_t     generation;   /* generation number, must match the journal */
+    timeout_t     text_mtime;   /* modification time of the text file when the snapshot was written */
+    file_pos_t    text_size;    /* size of the text file when the snapshot was written */
+};
+
+/* a key, followed by its name, class, values and subkeys */
+struct snapshot_key
+{
+    timeout_t     modif;        /* last modification time */
+    unsigned int  flags;        /* key flags (only KEY_SYMLINK is stored) */
+    unsigned int  namelen;      /* length of key name */
+    unsigned int  classlen;     /* length of class name */
+    unsigned int  nb_values;    /* number of values */
+    unsigned int  nb_subkeys;   /* number of subkeys */
+    unsigned int  reserved;
+};
+
+/* a value, followed by its name and data */
+struct snapshot_value
+{
+    unsigned int  namelen;      /* length of value name */
+    unsigned int  type;         /* value type */
+    data_size_t   len;          /* value data length in bytes */
+};
+
+struct journal_header
+{
+    char          magic[8];     /* journal_magic */
+    unsigned int  version;      /* JOURNAL_VERSION */
+    unsigned int  reserved;
+    timeout_t     generation;   /* generation number of the snapshot */
+};
+
+/* a journal record, followed by the key path relative to the branch and the record data */
+struct journal_record
+{
+    unsigned int  op;           /* operation (JOURNAL_*) */
+    unsigned int  pathlen;      /* length of key path */
+    unsigned int  size;         /* size of the record data */
+};
+
+#define JOURNAL_SET_KEY     0   /* key attributes and values, as a snapshot_key without name or subkeys */
+#define JOURNAL_DELETE_KEY  1   /* key has been deleted, no data */
+
+struct snapshot_reader
+{
+    const char   *ptr;          /* current position */
+    const char   *end;          /* end of data */
+};
+
+static inline size_t snapshot_align( size_t size )
+{
+    return (size + 3) & ~3;
+}
+
+/* read a chunk of data from a snapshot, return NULL if truncated */
+static const void *snapshot_read( struct snapshot_reader *reader, size_t size )
+{
+    const char *ret = reader->ptr;
+
+    size = snapshot_align( size );
+    if (size > (size_t)(reader->end - reader->ptr)) return NULL;
+    reader->ptr += size;
+    return ret;
+}
+
+/* write a chunk of data to a snapshot */
+static void snapshot_write( const void *data, size_t size, FILE *f )
+{
+    if (!size) return;
+    fwrite( data, 1, size, f );
+    if (size & 3) fwrite( snapshot_padding, 1, 4 - (size & 3), f );
+}
+
+/* find the save branch containing a given key */
+static struct save_branch_info *find_save_branch( const struct key *key )
+{
+    int i;
+
+    for ( ; key; key = key->parent)
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key == key) return &save_branch_info[i];
+    return NULL;
+}
+
+/* free all the values of a key */
+static void free_values( struct key *key )
+{
+    int i;
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    key->last_value = -1;
+    key->sorted_values = 0;
+    key->deleted_values = 0;
+    free( key->value_index );
+    key->value_index = NULL;
+}
+
+/* remove all the contents of a branch */
+static void clear_branch( struct key *key )
+{
+    while (key->last_subkey >= 0) free_subkey( key, key->last_subkey );
+    free_values( key );
+    free( key->class );
+    key->class = NULL;
+    key->classlen = 0;
+}
+
+/* load the attributes and values of a key from a snapshot */
+static int load_snapshot_key_data( struct key *key, const struct snapshot_key *sk,
+                                   struct snapshot_reader *reader )
+{
+    struct snapshot_value sv;
+    struct key_value *value;
+    struct unicode_str name;
+    const void *ptr, *data;
+    unsigned int i;
+
+    if (sk->classlen % sizeof(WCHAR)) return 0;
+    if (!(ptr = snapshot_read( reader, sk->classlen ))) return 0;
+    free( key->class );
+    key->class = NULL;
+    key->classlen = 0;
+    if (sk->classlen && (key->class = memdup( ptr, sk->classlen ))) key->classlen = sk->classlen;
+    key->modif = sk->modif;
+    key->flags = (key->flags & ~KEY_SYMLINK) | (sk->flags & KEY_SYMLINK);
+
+    free_values( key );
+    for (i = 0; i < sk->nb_values; i++)
+    {
+        if (!(ptr = snapshot_read( reader, sizeof(sv) ))) return 0;
+        memcpy( &sv, ptr, sizeof(sv) );
+        if (sv.namelen % sizeof(WCHAR)) return 0;
+        if (!(name.str = snapshot_read( reader, sv.namelen ))) return 0;
+        name.len = sv.namelen;
+        if (!(data = snapshot_read( reader, sv.len ))) return 0;
+
+        if (find_value( key, &name )) return 0;  /* duplicate value */
+        if (!(value = insert_value( key, &name ))) return 0;
+        value->type = sv.type;
+        if (sv.len && !(value->data = memdup( data, sv.len ))) return 0;
+        value->len = sv.len;
+    }
+    return 1;
+}
+
+/* load the subkeys of a key from a snapshot */
+static int load_snapshot_subkeys( struct key *key, unsigned int count, struct snapshot_reader *reader )
+{
+    struct snapshot_key sk;
+    struct unicode_str name;
+    struct key *subkey;
+    const void *ptr;
+
+    while (count--)
+    {
+        if (!(ptr = snapshot_read( reader, sizeof(sk) ))) return 0;
+        memcpy( &sk, ptr, sizeof(sk) );
+        if (!sk.namelen || sk.namelen % sizeof(WCHAR)) return 0;
+        if (!(name.str = snapshot_read( reader, sk.namelen ))) return 0;
+        name.len = sk.namelen;
+
+        if (!(subkey = find_subkey( key, &name )) && !(subkey = alloc_subkey( key, &name, sk.modif )))
+            return 0;
+
+        if (!load_snapshot_key_data( subkey, &sk, reader )) return 0;
+        if (!load_snapshot_subkeys( subkey, sk.nb_subkeys, reader )) return 0;
+    }
+    return 1;
+}
+
+/* count the subkeys of a key that are saved to disk */
+static unsigned int count_saved_subkeys( const struct key *key )
+{
+    unsigned int count = 0;
+    int i;
+
+    for (i = 0; i <= key->last_subkey; i++)
+        if (key->subkeys[i] && !(key->subkeys[i]->flags & KEY_VOLATILE)) count++;
+    return count;
+}
+
+/* get the size of a snapshot key record */
+static size_t get_snapshot_key_size( const struct key *key, unsigned int namelen )
+{
+    size_t size = sizeof(struct snapshot_key) + snapshot_align( namelen ) + snapshot_align( key->classlen );
+    int i;
+
+    for (i = 0; i <= key->last_value; i++)
+        if (!is_value_deleted( &key->values[i] ))
+            size += sizeof(struct snapshot_value) + snapshot_align( key->values[i].namelen ) +
+                    snapshot_align( key->values[i].len );
+    return size;
+}
+
+/* write the attributes and values of a key to a snapshot */
+static void write_snapshot_key( const struct key *key, unsigned int namelen, unsigned int nb_subkeys, FILE *f )
+{
+    struct snapshot_key sk;
+    struct snapshot_value sv;
+    int i;
+
+    sk.modif      = key->modif;
+    sk.flags      = key->flags & KEY_SYMLINK;
+    sk.namelen    = namelen;
+    sk.classlen   = key->classlen;
+    sk.nb_values  = key->last_value + 1 - key->deleted_values;
+    sk.nb_subkeys = nb_subkeys;
+    sk.reserved   = 0;
+    snapshot_write( &sk, sizeof(sk), f );
+    snapshot_write( key->name, namelen, f );
+    snapshot_write( key->class, key->classlen, f );
+    for (i = 0; i <= key->last_value; i++)
+    {
+        if (is_value_deleted( &key->values[i] )) continue;
+        sv.namelen = key->values[i].namelen;
+        sv.type    = key->values[i].type;
+        sv.len     = key->values[i].len;
+        snapshot_write( &sv, sizeof(sv), f );
+        snapshot_write( key->values[i].name, sv.namelen, f );
+        snapshot_write( key->values[i].data, sv.len, f );
+    }
+}
+
+/* write all the subkeys of a key to a snapshot */
+static void write_snapshot_subkeys( const struct key *key, FILE *f )
+{
+    int i;
+
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        const struct key *subkey = key->subkeys[i];
+        if (!subkey || (subkey->flags & KEY_VOLATILE)) continue;
+        write_snapshot_key( subkey, subkey->namelen, count_saved_subkeys( subkey ), f );
+        write_snapshot_subkeys( subkey, f );
+    }
+}
+
+/* get the modification time of a text file, with sub-second precision when available */
+static timeout_t get_text_mtime( const struct stat *st )
+{
+    timeout_t mtime = (timeout_t)st->st_mtime * TICKS_PER_SEC;
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime += st->st_mtim.tv_nsec / 100;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime += st->st_mtimespec.tv_nsec / 100;
+#endif
+    return mtime;
+}
+
+/* check if the snapshot has been written from the current text file */
+static int snapshot_matches_text( const struct save_branch_info *info, const struct snapshot_header *header )
+{
+    struct stat st;
+
+    if (stat( info->path, &st ) == -1) return !header->text_mtime && !header->text_size;
+    return header->text_mtime == get_text_mtime( &st ) && header->text_size == st.st_size;
+}
+
+/* load a branch from its snapshot, return 0 if it is missing or out of date */
+static int load_snapshot( struct save_branch_info *info )
+{
+    struct snapshot_header header;
+    struct snapshot_reader reader;
+    struct snapshot_key sk;
+    struct stat st;
+    const void *ptr;
+    void *base;
+    int fd, ret = 0;
+
+    if ((fd = open( info->snapshot_path, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(header))
+    {
+        close( fd );
+        return 0;
+    }
+    base = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (base == MAP_FAILED) return 0;
+
+    reader.ptr = base;
+    reader.end = (const char *)base + st.st_size;
+    ptr = snapshot_read( &reader, sizeof(header) );
+    memcpy( &header, ptr, sizeof(header) );
+    if (memcmp( header.magic, snapshot_magic, sizeof(header.magic) )) goto done;
+    if (header.version != SNAPSHOT_VERSION) goto done;
+    if (!snapshot_matches_text( info, &header )) goto done;
+    if (header.arch != PREFIX_UNKNOWN && prefix_type != PREFIX_UNKNOWN && header.arch != prefix_type)
+        goto done;
+
+    /* the branch key itself comes first, its name is ignored */
+    if (!(ptr = snapshot_read( &reader, sizeof(sk) ))) goto done;
+    memcpy( &sk, ptr, sizeof(sk) );
+    if (!snapshot_read( &reader, sk.namelen ) ||
+        !load_snapshot_key_data( info->key, &sk, &reader ) ||
+        !load_snapshot_subkeys( info->key, sk.nb_subkeys, &reader ))
+    {
+        fprintf( stderr, "%s: corrupted registry snapshot, using %s instead\n",
+                 info->snapshot_path, info->path );
+        clear_branch( info->key );
+        goto done;
+    }
+
+    if (header.arch != PREFIX_UNKNOWN) prefix_type = header.arch;
+    info->generation = header.generation;
+    info->snapshot_size = st.st_size;
+    ret = 1;
+
+ done:
+    munmap( base, st.st_size );
+    return ret;
+}
+
+/* look up a key by its path relative to a branch, optionally creating it */
+static struct key *get_journal_key( struct key *key, const struct unicode_str *path,
+                                    int create, timeout_t modif )
+{
+    struct unicode_str token;
+    struct key *subkey;
+
+    token.str = NULL;
+    if (!get_path_token( path, &token )) return NULL;
+    while (token.len)
+    {
+        if (!(subkey = find_subkey( key, &token )))
+        {
+            if (!create) return NULL;
+            if (!(subkey = alloc_subkey( key, &token, modif ))) return NULL;
+        }
+        key = subkey;
+        get_path_token( path, &token );
+    }
+    return key;
+}
+
+/* apply a journal record to a branch */
+static int replay_journal_record( struct key *base, const struct journal_record *rec,
+                                  const struct unicode_str *path, struct snapshot_reader *reader )
+{
+    struct snapshot_key sk;
+    struct key *key;
+    const void *ptr;
+
+    switch (rec->op)
+    {
+    case JOURNAL_SET_KEY:
+        if (!(ptr = snapshot_read( reader, sizeof(sk) ))) return 0;
+        memcpy( &sk, ptr, sizeof(sk) );
+        if (sk.namelen || sk.nb_subkeys) return 0;
+        if (!(key = get_journal_key( base, path, 1, sk.modif ))) return 0;
+        return load_snapshot_key_data( key, &sk, reader );
+    case JOURNAL_DELETE_KEY:
+        if (!path->len) return 0;  /* the branch itself can't be deleted */
+        if ((key = get_journal_key( base, path, 0, 0 ))) delete_key( key, 1 );
+        return 1;
+    }
+    return 0;
+}
+
+/* replay the journal of a branch on top of the snapshot */
+/* return the offset of the end of the last valid record, or 0 if the journal can't be used */
+static off_t replay_journal( struct save_branch_info *info )
+{
+    struct journal_header header;
+    struct journal_record rec;
+    struct snapshot_reader reader, data;
+    struct unicode_str path;
+    struct stat st;
+    const void *ptr;
+    const char *end;
+    void *base;
+    int fd;
+
+    if ((fd = open( info->journal_path, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(header))
+    {
+        close( fd );
+        return 0;
+    }
+    base = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (base == MAP_FAILED) return 0;
+
+    reader.ptr = base;
+    reader.end = (const char *)base + st.st_size;
+    ptr = snapshot_read( &reader, sizeof(header) );
+    memcpy( &header, ptr, sizeof(header) );
+    if (memcmp( header.magic, journal_magic, sizeof(header.magic) ) ||
+        header.version != JOURNAL_VERSION || header.generation != info->generation)
+    {
+        munmap( base, st.st_size );
+        return 0;
+    }
+
+    /* stop at the first incomplete or invalid record, it has been interrupted while writing */
+    end = reader.ptr;
+    while ((ptr = snapshot_read( &reader, sizeof(rec) )))
+    {
+        memcpy( &rec, ptr, sizeof(rec) );
+        if (rec.pathlen % sizeof(WCHAR) || rec.size % 4) break;
+        if (!(path.str = snapshot_read( &reader, rec.pathlen ))) break;
+        path.len = rec.pathlen;
+        if (!(data.ptr = snapshot_read( &reader, rec.size ))) break;
+        data.end = data.ptr + rec.size;
+        if (!replay_journal_record( info->key, &rec, &path, &data )) break;
+        end = reader.ptr;
+    }
+
+    munmap( base, st.st_size );
+    return end - (const char *)base;
+}
+
+/* open the journal of a branch for appending, discarding everything after offset */
+/* a new journal is started if offset is 0 */
+static FILE *open_journal( struct save_branch_info *info, off_t offset )
+{
+    struct journal_header header;
+    FILE *f;
+    int fd;
+
+    if ((fd = open( info->journal_path, O_CREAT | O_WRONLY, 0666 )) == -1) return NULL;
+    if (!offset)
+    {
+        memcpy( header.magic, journal_magic, sizeof(header.magic) );
+        header.version    = JOURNAL_VERSION;
+        header.reserved   = 0;
+        header.generation = info->generation;
+        if (ftruncate( fd, 0 ) == -1 || write( fd, &header, sizeof(header) ) != sizeof(header))
+        {
+            close( fd );
+            return NULL;
+        }
+        offset = sizeof(header);
+    }
+    if (ftruncate( fd, offset ) == -1 || lseek( fd, offset, SEEK_SET ) == -1 || !(f = fdopen( fd, "w" )))
+    {
+        close( fd );
+        return NULL;
+    }
+    return f;
+}
+
+/* write the full path of a key relative to a base key */
+static void write_journal_path( const struct key *key, const struct key *base, FILE *f )
+{
+    static const WCHAR backslash = '\\';
+
+    if (key == base) return;
+    if (key->parent != base)
+    {
+        write_journal_path( key->parent, base, f );
+        fwrite( &backslash, sizeof(backslash), 1, f );
+    }
+    fwrite( key->name, 1, key->namelen, f );
+}
+
+/* append a record for a key to the journal */
+static void write_journal_record( struct save_branch_info *info, const struct key *key, unsigned int op )
+{
+    struct journal_record rec;
+    const struct key *k;
+
+    rec.op      = op;
+    rec.pathlen = 0;
+    rec.size    = (op == JOURNAL_SET_KEY) ? get_snapshot_key_size( key, 0 ) : 0;
+    for (k = key; k != info->key; k = k->parent) rec.pathlen += k->namelen + sizeof(WCHAR);
+    if (rec.pathlen) rec.pathlen -= sizeof(WCHAR);
+
+    fwrite( &rec, sizeof(rec), 1, info->journal );
+    write_journal_path( key, info->key, info->journal );
+    if (rec.pathlen & 3) fwrite( snapshot_padding, 1, 4 - (rec.pathlen & 3), info->journal );
+    if (op == JOURNAL_SET_KEY) write_snapshot_key( key, 0, 0, info->journal );
+}
+
+/* append all the modified keys of a branch to the journal */
+static void journal_dirty_keys( struct save_branch_info *info, const struct key *key )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(key->flags & KEY_DIRTY)) return;
+    write_journal_record( info, key, JOURNAL_SET_KEY );
+    for (i = 0; i <= key->last_subkey; i++) if (key->subkeys[i]) journal_dirty_keys( info, key->subkeys[i] );
+}
+
+/* record the deletion of a key in the journal */
+static void journal_delete_key( struct key *key )
+{
+    struct save_branch_info *info;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(info = find_save_branch( key )) || !info->journal || key == info->key) return;
+    write_journal_record( info, key, JOURNAL_DELETE_KEY );
+}
+
+/* write a new snapshot of a branch and start a new journal */
+static int save_snapshot( struct save_branch_info *info )
+{
+    struct snapshot_header header;
+    struct timeval now;
+    struct stat st;
+    char *tmp;
+    FILE *f;
+    int fd, ret;
+
+    memcpy( header.magic, snapshot_magic, sizeof(header.magic) );
+    header.version    = SNAPSHOT_VERSION;
+    header.arch       = prefix_type;
+    /* current_time isn't set yet while loading the initial files */
+    gettimeofday( &now, NULL );
+    header.generation = max( (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10, info->generation + 1 );
+    header.text_mtime = 0;
+    header.text_size  = 0;
+    if (!stat( info->path, &st ))
+    {
+        header.text_mtime = get_text_mtime( &st );
+        header.text_size  = st.st_size;
+    }
+
+    if (!(tmp = malloc( strlen(info->snapshot_path) + 5 ))) return 0;
+    sprintf( tmp, "%s.tmp", info->snapshot_path );
+    if ((fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1)
+    {
+        free( tmp );
+        return 0;
+    }
+    if (!(f = fdopen( fd, "w" )))
+    {
+        close( fd );
+        unlink( tmp );
+        free( tmp );
+        return 0;
+    }
+
+    if (debug_level > 1)
+    {
+        fprintf( stderr, "%s: ", info->snapshot_path );
+        dump_operation( info->key, NULL, "saving" );
+    }
+
+    fwrite( &header, sizeof(header), 1, f );
+    write_snapshot_key( info->key, 0, count_saved_subkeys( info->key ), f );
+    write_snapshot_subkeys( info->key, f );
+    info->snapshot_size = ftell( f );
+    ret = !fclose( f );
+    if (ret) ret = !rename( tmp, info->snapshot_path );
+    if (!ret) unlink( tmp );
+    free( tmp );
+    if (!ret) return 0;
+
+    /* the old journal doesn't apply to the new snapshot anymore */
+    if (info->journal) fclose( info->journal );
+    info->generation = header.generation;
+    info->journal = open_journal( info, 0 );
+    info->need_snapshot = !info->journal;
+    return 1;
+}
+
+/* build the name of a file associated to a branch */
+static char *get_branch_file_name( const char *path, const char *ext )
+{
+    char *ret = malloc( strlen(path) + strlen(ext) + 1 );
+
+    if (!ret) fatal_error( "out of memory\n" );
+    strcpy( ret, path );
+    strcat( ret, ext );
+    return ret;
+}
+
+/* load a branch from its snapshot and journal, return 0 if they can't be used */
+static int load_branch_snapshot( struct save_branch_info *info )
+{
+    off_t end;
+
+    info->snapshot_path = get_branch_file_name( info->path, ".snapshot" );
+    info->journal_path  = get_branch_file_name( info->path, ".journal" );
+    if (!load_snapshot( info )) return 0;
+
+    end = replay_journal( info );
+    /* a non-empty journal means that the text file hasn't been saved */
+    if (end > sizeof(struct journal_header)) info->text_dirty = 1;
+    make_clean( info->key );
+    if (!(info->journal = open_journal( info, end ))) info->need_snapshot = 1;
+    return 1;
+}
+
+/* save the modified keys of a branch to its journal, and rewrite the snapshot if needed */
+static int save_branch_journal( struct save_branch_info *info )
+{
+    long size;
+
+    if (info->key->flags & KEY_DIRTY)
+    {
+        info->text_dirty = 1;
+        if (!info->journal) info->need_snapshot = 1;
+        if (!info->need_snapshot)
+        {
+            if (debug_level > 1)
+            {
+                fprintf( stderr, "%s: ", info->journal_path );
+                dump_operation( info->key, NULL, "journaling" );
+            }
+            journal_dirty_keys( info, info->key );
+            if (fflush( info->journal )) info->need_snapshot = 1;
+        }
+        make_clean( info->key );
+    }
+
+    if (!info->need_snapshot)
+    {
+        if (!info->journal) return 1;
+        size = ftell( info->journal );
+        if (size < JOURNAL_MIN_COMPACT || size < info->snapshot_size / 2) return 1;
+    }
+    return save_snapshot( info );
+}
+
 /* load a part of the registry from a file */
 static void load_registry( struct key *key, obj_handle_t handle )
 {
+    struct save_branch_info *info;
     struct file *file;
     int fd;
 
@@ -1639,6 +2674,9 @@ static void load_registry( struct key *key, obj_handle_t handle )
         {
             load_keys( key, NULL, f, -1 );
             fclose( f );
+            /* the loaded keys are not marked dirty, so they can only be saved in a snapshot */
+            if (registry_journal && (info = find_save_branch( key )))
+                info->need_snapshot = info->text_dirty = 1;
         }
         else file_set_error();
     }
@@ -1647,7 +2685,23 @@ static void load_registry( struct key *key, obj_handle_t handle )
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    struct save_branch_info *info;
+    FILE *f = NULL;
+
+    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
+
+    info = &save_branch_info[save_branch_count];
+    memset( info, 0, sizeof(*info) );
+    info->path = filename;
+    info->key  = key;
+
+    if (registry_journal && load_branch_snapshot( info ))
+    {
+        save_branch_count++;
+        grab_object( key );
+        make_object_static( &key->obj );
+        return 1;
+    }
 
     if ((f = fopen( filename, "r" )))
     {
@@ -1660,11 +2714,12 @@ static int load_init_registry_from_file( const char *filename, struct key *key )
         }
     }
 
-    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
-
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    save_branch_count++;
+    grab_object( key );
     make_object_static( &key->obj );
+
+    /* start a snapshot right away so that the next startup doesn't need to parse the file */
+    if (registry_journal && f) save_snapshot( info );
     return (f != NULL);
 }
 
@@ -1922,7 +2977,10 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+    {
+        if (registry_journal) save_branch_journal( &save_branch_info[i] );
+        else save_branch( save_branch_info[i].key, save_branch_info[i].path );
+    }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -1942,11 +3000,21 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        struct save_branch_info *info = &save_branch_info[i];
+        int text_dirty = info->text_dirty || (info->key->flags & KEY_DIRTY);
+
+        /* changes that went to the journal need a full save of the text file */
+        if (info->text_dirty) make_dirty( info->key );
+        if (!save_branch( info->key, info->path ))
         {
-            fprintf( stderr, "wineserver: could not save registry branch to %s",
-                     save_branch_info[i].path );
+            fprintf( stderr, "wineserver: could not save registry branch to %s", info->path );
             perror( " " );
+            continue;
+        }
+        if (registry_journal && (text_dirty || info->need_snapshot))
+        {
+            info->text_dirty = 0;
+            save_snapshot( info );
         }
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
@@ -2039,7 +3107,14 @@ DECL_HANDLER(flush_key)
     struct key *key = get_hkey_obj( req->hkey, 0 );
     if (key)
     {
-        /* we don't need to do anything here with the current implementation */
+        struct save_branch_info *info;
+
+        /* in journal mode, write the pending changes of the branch right away */
+        if (registry_journal && (info = find_save_branch( key )) && fchdir( config_dir_fd ) != -1)
+        {
+            save_branch_journal( info );
+            if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+        }
         release_object( key );
     }
 }
@@ -235,6 +235,7 @@ static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    unsigned __int64 start = profile_request_start();
 
     current = thread;
     current->reply_size = 0;
@@ -250,6 +251,7 @@ static void call_req_handler( struct thread *thread )
 
     if (current)
     {
+        profile_request_end( req, start );
         if (current->reply_fd)
         {
             reply.reply_header.error = current->error;
@@ -266,6 +268,113 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* check if a request can be executed as part of a batch */
+static int is_batchable( enum request req )
+{
+    switch (req)
+    {
+    /* requests that block or that change the reply channel */
+    case REQ_batch:
+    case REQ_select:
+    case REQ_new_thread:
+    case REQ_init_thread:
+    case REQ_terminate_thread:
+    case REQ_terminate_process:
+    /* requests that send or receive file descriptors along with the reply */
+    case REQ_new_process:
+    case REQ_get_handle_fd:
+    case REQ_alloc_file_handle:
+    case REQ_alloc_console:
+    case REQ_create_console_output:
+        return 0;
+    default:
+        return req < REQ_NB_REQUESTS;
+    }
+}
+
+/* execute the requests contained in a batch */
+DECL_HANDLER(batch)
+{
+    const char *data = get_req_data();
+    data_size_t size = get_req_data_size();
+    data_size_t max_size = get_reply_max_size();
+    union generic_request batch_req = current->req;
+    void *batch_data = current->req_data;
+    data_size_t pos = 0, reply_pos = 0;
+    unsigned int count = 0;
+    char *replies = NULL;
+
+    if (max_size && !(replies = mem_alloc( max_size ))) return;
+
+    while (size - pos >= sizeof(union generic_request))
+    {
+        union generic_reply sub_reply;
+        enum request req;
+        data_size_t req_size, reply_max;
+        unsigned __int64 start;
+
+        memcpy( &current->req, data + pos, sizeof(current->req) );
+        pos += sizeof(current->req);
+        req       = current->req.request_header.req;
+        req_size  = current->req.request_header.request_size;
+        reply_max = (current->req.request_header.reply_size + 7) & ~7;
+        if (req_size > size - pos || reply_max > max_size - reply_pos ||
+            sizeof(sub_reply) > max_size - reply_pos - reply_max)
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            break;
+        }
+        /* the request data is freed with the thread if the request kills it */
+        current->req_data = NULL;
+        if (req_size && !(current->req_data = memdup( data + pos, req_size ))) break;
+        pos += min( (req_size + 7) & ~7, size - pos );
+
+        start = profile_request_start();
+        current->reply_size = 0;
+        clear_error();
+        memset( &sub_reply, 0, sizeof(sub_reply) );
+
+        if (debug_level) trace_request();
+
+        if (is_batchable( req ))
+            req_handlers[req]( &current->req, &sub_reply );
+        else
+            set_error( STATUS_NOT_SUPPORTED );
+
+        if (!current)  /* thread has been killed, there's nobody to reply to */
+        {
+            free( batch_data );
+            free( replies );
+            return;
+        }
+        free( current->req_data );
+        current->req_data = NULL;
+
+        profile_request_end( req, start );
+        sub_reply.reply_header.error = current->error;
+        sub_reply.reply_header.reply_size = current->reply_size;
+        if (debug_level) trace_reply( req, &sub_reply );
+
+        memcpy( replies + reply_pos, &sub_reply, sizeof(sub_reply) );
+        reply_pos += sizeof(sub_reply);
+        if (current->reply_size) memcpy( replies + reply_pos, current->reply_data, current->reply_size );
+        memset( replies + reply_pos + current->reply_size, 0, -current->reply_size & 7 );
+        reply_pos += (current->reply_size + 7) & ~7;
+        free( current->reply_data );
+        current->reply_data = NULL;
+        clear_error();
+        count++;
+    }
+    if (pos < size && !current->error) set_error( STATUS_INVALID_PARAMETER );
+
+    current->req = batch_req;
+    current->req_data = batch_data;
+    current->reply_size = 0;
+    reply->count = count;
+    if (reply_pos) set_reply_data_ptr( replies, reply_pos );
+    else free( replies );
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
@@ -89,6 +89,11 @@ static struct semaphore *create_semaphore( struct directory *root, const struct
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+            if ((sem->obj.sync = alloc_shm_sync( &sem->obj, SHM_SYNC_SEMAPHORE )))
+            {
+                sem->obj.sync->state = initial;
+                get_shm_sync_info( sem->obj.sync )->max = max;
+            }
             if (sd) default_set_sd( &sem->obj, sd, OWNER_SECURITY_INFORMATION|
                                                    GROUP_SECURITY_INFORMATION|
                                                    DACL_SECURITY_INFORMATION|
@@ -98,9 +103,36 @@ static struct semaphore *create_semaphore( struct directory *root, const struct
     return sem;
 }
 
+static int release_shm_semaphore( struct semaphore *sem, unsigned int count,
+                                  unsigned int *prev )
+{
+    struct shm_sync_object *sync = sem->obj.sync;
+    unsigned int current;
+
+    do
+    {
+        current = sync->state;
+        if (prev) *prev = current;
+        if (current + count < current || current + count > get_shm_sync_info( sync )->max)
+        {
+            set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
+            return 0;
+        }
+    } while (interlocked_cmpxchg( &sync->state, current + count, current ) != current);
+
+    if (!current)
+    {
+        shm_sync_wake( sync );
+        wake_up( &sem->obj, count );
+    }
+    return 1;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
+    if (sem->obj.sync) return release_shm_semaphore( sem, count, prev );
+
     if (prev) *prev = sem->count;
     if (sem->count + count < sem->count || sem->count + count > sem->max)
     {
@@ -124,7 +156,8 @@ static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d ", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d ",
+             sem->obj.sync ? sem->obj.sync->state : sem->count, sem->max );
     dump_object_name( &sem->obj );
     fputc( '\n', stderr );
 }
@@ -140,6 +173,7 @@ static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entr
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
+    if (obj->sync) return shm_sync_signaled( obj->sync, entry );
     return (sem->count > 0);
 }
 
@@ -147,6 +181,7 @@ static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *en
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
+    if (obj->sync) return;  /* already acquired in check_wait */
     assert( sem->count );
     sem->count--;
 }
@@ -246,7 +281,7 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
+        reply->current = sem->obj.sync ? sem->obj.sync->state : sem->count;
         reply->max = sem->max;
         release_object( sem );
     }
@@ -0,0 +1,437 @@
+/*
+ * Synchronization objects shared with the clients
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When enabled with the WINESHMSYNC environment variable, the state of
+ * events, mutexes and semaphores is stored in a file mapping shared with
+ * all the clients, so that uncontended operations can be done without a
+ * server round trip, and single object waits can block on a futex.
+ *
+ * The region is made of two arrays: the object state, that the clients
+ * modify with atomic operations, and the object information that only the
+ * server modifies, which the clients map read-only. Threads waiting in the
+ * server are counted in the information, and the clients send a
+ * wake_shm_sync request when they change the state of an object that has
+ * server-side waiters. Client threads sleep on the seq futex word, which is
+ * bumped on every change that can wake them.
+ *
+ * The clients cache the slot of each handle. The slot generation is bumped
+ * when an object is destroyed, and the generation of the reserved slot 0
+ * when a handle is closed from another process, so that stale entries are
+ * looked up again. A slot isn't reused until its futex waiters are gone.
+ *
+ * Each thread that owns shared mutexes gets a slot holding the head of the
+ * list of its owned mutexes, maintained by the owner thread, or by the server
+ * while the thread waits in it, so that they can be abandoned when it dies.
+ * The links are written by the clients, so the server checks them.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "handle.h"
+#include "thread.h"
+#include "request.h"
+
+#define SHM_SYNC_MAX_OBJECTS 16384
+
+static struct shm_sync_object *shm_sync_region;  /* shared region, NULL if disabled */
+static struct shm_sync_info *shm_sync_infos;     /* information part of the region */
+static struct object **slot_objects;             /* object of each used slot, for abandoning mutexes */
+static unsigned int *free_slots;                 /* indices of the free objects */
+static unsigned int nb_free_slots;               /* number of free objects in the list */
+static unsigned int *dead_slots;                 /* indices of destroyed objects that are still referenced */
+static unsigned int nb_dead_slots;               /* number of destroyed objects in the list */
+static unsigned int next_slot = 1;               /* first never used object, 0 is reserved */
+
+#ifdef __linux__
+static inline int futex_wake( int *addr, int val )
+{
+    return syscall( __NR_futex, addr, 1 /* FUTEX_WAKE */, val, NULL, 0, 0 );
+}
+#endif
+
+/* create the shared region in the server directory */
+void init_shm_sync(void)
+{
+#ifdef __linux__
+    const char *env = getenv( "WINESHMSYNC" );
+    size_t size = SHM_SYNC_MAX_OBJECTS * (sizeof(struct shm_sync_object) + sizeof(struct shm_sync_info));
+    void *ptr;
+    int fd;
+
+    if (!env || !atoi( env )) return;
+
+    /* the clients open the same file from the server directory */
+    if ((fd = open( "sync", O_CREAT | O_TRUNC | O_RDWR, 0600 )) == -1)
+    {
+        fprintf( stderr, "wineserver: cannot create sync region: %s\n", strerror( errno ));
+        return;
+    }
+    if (ftruncate( fd, size ) == -1 ||
+        (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        fprintf( stderr, "wineserver: cannot map sync region: %s\n", strerror( errno ));
+        close( fd );
+        return;
+    }
+    close( fd );
+
+    if (!(free_slots = malloc( SHM_SYNC_MAX_OBJECTS * sizeof(*free_slots) )) ||
+        !(dead_slots = malloc( SHM_SYNC_MAX_OBJECTS * sizeof(*dead_slots) )) ||
+        !(slot_objects = calloc( SHM_SYNC_MAX_OBJECTS, sizeof(*slot_objects) )))
+    {
+        free( free_slots );
+        free( dead_slots );
+        munmap( ptr, size );
+        return;
+    }
+    shm_sync_region = ptr;
+    shm_sync_infos = (struct shm_sync_info *)(shm_sync_region + SHM_SYNC_MAX_OBJECTS);
+    if (debug_level) fprintf( stderr, "wineserver: shared memory synchronization enabled\n" );
+#endif
+}
+
+static inline unsigned int get_slot_index( const struct shm_sync_object *sync )
+{
+    return sync - shm_sync_region;
+}
+
+/* get the server-owned information of an object */
+struct shm_sync_info *get_shm_sync_info( const struct shm_sync_object *sync )
+{
+    return &shm_sync_infos[get_slot_index( sync )];
+}
+
+/* move the destroyed objects whose futex waiters and owner are gone to the free list */
+static void reclaim_dead_slots(void)
+{
+    unsigned int i = 0;
+
+    while (i < nb_dead_slots)
+    {
+        struct shm_sync_object *sync = &shm_sync_region[dead_slots[i]];
+        if (sync->client_waiters || sync->owned_next) i++;
+        else free_slots[nb_free_slots++] = dead_slots[i] = dead_slots[--nb_dead_slots];
+    }
+}
+
+static unsigned int alloc_slot( struct object *obj, unsigned int type )
+{
+    struct shm_sync_info *info;
+    unsigned int index, generation;
+
+    if (!nb_free_slots && nb_dead_slots) reclaim_dead_slots();
+    if (nb_free_slots) index = free_slots[--nb_free_slots];
+    else if (next_slot < SHM_SYNC_MAX_OBJECTS) index = next_slot++;
+    else return 0;
+
+    info = &shm_sync_infos[index];
+    generation = info->generation;
+    memset( info, 0, sizeof(*info) );
+    memset( &shm_sync_region[index], 0, sizeof(shm_sync_region[index]) );
+    info->generation = generation;
+    info->type = type;
+    slot_objects[index] = obj;
+    return index;
+}
+
+/* allocate the shared state for a new object; return NULL if it must be kept in the server */
+struct shm_sync_object *alloc_shm_sync( struct object *obj, unsigned int type )
+{
+    unsigned int index;
+
+    if (!shm_sync_region || !(index = alloc_slot( obj, type ))) return NULL;
+    return &shm_sync_region[index];
+}
+
+/* free the shared state of a destroyed object */
+void free_shm_sync( struct shm_sync_object *sync )
+{
+    unsigned int index = get_slot_index( sync );
+    struct shm_sync_info *info = &shm_sync_infos[index];
+
+    info->type = SHM_SYNC_NONE;
+    interlocked_xchg_add( (int *)&info->generation, 1 );
+    slot_objects[index] = NULL;
+    /* a client can still be blocked on the futex through a stale handle, */
+    /* wake it up so that it notices, and reuse the slot once it's gone */
+    /* a mutex also stays linked in the list of its owner until it dies */
+    if (sync->client_waiters || sync->owned_next)
+    {
+        shm_sync_wake( sync );
+        dead_slots[nb_dead_slots++] = index;
+    }
+    else free_slots[nb_free_slots++] = index;
+}
+
+/* invalidate the handle caches of the clients after a handle is closed by another process */
+void shm_sync_invalidate_handles(void)
+{
+    if (shm_sync_region) interlocked_xchg_add( (int *)&shm_sync_infos[0].generation, 1 );
+}
+
+/* get the slot of the owned mutex list of a thread, allocating it if needed */
+static unsigned int get_thread_slot( struct thread *thread )
+{
+    if (!thread->shm_sync_slot && (thread->shm_sync_slot = alloc_slot( NULL, SHM_SYNC_THREAD )))
+    {
+        struct shm_sync_object *head = &shm_sync_region[thread->shm_sync_slot];
+        head->owned_prev = head->owned_next = thread->shm_sync_slot;
+    }
+    return thread->shm_sync_slot;
+}
+
+/* check a link written by a client */
+static inline int is_valid_link( unsigned int index )
+{
+    return index && index < next_slot;
+}
+
+/* add a mutex acquired by the server on behalf of a thread to its owned list */
+void shm_sync_set_owner( struct shm_sync_object *sync, struct thread *thread )
+{
+    unsigned int index = get_slot_index( sync ), head = get_thread_slot( thread ), next;
+
+    if (!head || !is_valid_link( next = shm_sync_region[head].owned_next ))
+    {
+        /* it will have to be found the slow way when the thread dies */
+        thread->shm_sync_untracked = 1;
+        return;
+    }
+    sync->owned_prev = head;
+    sync->owned_next = next;
+    shm_sync_region[next].owned_prev = index;
+    shm_sync_region[head].owned_next = index;
+}
+
+/* remove a mutex released by the server from the owned list of its owner */
+void shm_sync_clear_owner( struct shm_sync_object *sync )
+{
+    unsigned int prev = sync->owned_prev, next = sync->owned_next;
+
+    if (is_valid_link( prev ) && is_valid_link( next ))
+    {
+        shm_sync_region[prev].owned_next = next;
+        shm_sync_region[next].owned_prev = prev;
+    }
+    sync->owned_prev = sync->owned_next = 0;
+}
+
+/* abandon a mutex owned by a dead thread */
+static void abandon_shm_mutex( unsigned int index )
+{
+    struct shm_sync_object *sync = &shm_sync_region[index];
+    struct object *obj = slot_objects[index];
+
+    shm_sync_clear_owner( sync );
+    sync->count = 0;
+    if (!obj)  /* destroyed while owned, the slot can now be reclaimed */
+    {
+        sync->state = 0;
+        return;
+    }
+    sync->abandoned = 1;
+    interlocked_xchg( &sync->state, 0 );
+    shm_sync_wake( sync );
+    grab_object( obj );
+    wake_up( obj, 0 );
+    release_object( obj );
+}
+
+/* abandon the shared mutexes owned by a dead thread and free its slot */
+void abandon_shm_mutexes( struct thread *thread )
+{
+    unsigned int index, head = thread->shm_sync_slot, count = 0;
+
+    if (head)
+    {
+        /* the list can be corrupted by the client, don't loop forever */
+        while (count++ < next_slot && is_valid_link( index = shm_sync_region[head].owned_next ) &&
+               index != head)
+        {
+            if ((thread_id_t)shm_sync_region[index].state != thread->id)
+                shm_sync_clear_owner( &shm_sync_region[index] );
+            else
+                abandon_shm_mutex( index );
+        }
+        shm_sync_region[head].owned_prev = shm_sync_region[head].owned_next = 0;
+        shm_sync_infos[head].type = SHM_SYNC_NONE;
+        interlocked_xchg_add( (int *)&shm_sync_infos[head].generation, 1 );
+        free_slots[nb_free_slots++] = head;
+        thread->shm_sync_slot = 0;
+    }
+    if (thread->shm_sync_untracked)
+    {
+        for (index = 1; index < next_slot; index++)
+            if (shm_sync_infos[index].type == SHM_SYNC_MUTEX &&
+                (thread_id_t)shm_sync_region[index].state == thread->id)
+                abandon_shm_mutex( index );
+        thread->shm_sync_untracked = 0;
+    }
+}
+
+/* wake up the client threads blocked on the object futex */
+void shm_sync_wake( struct shm_sync_object *sync )
+{
+#ifdef __linux__
+    interlocked_xchg_add( &sync->seq, 1 );
+    if (sync->client_waiters) futex_wake( &sync->seq, INT_MAX );
+#endif
+}
+
+/* pulse a shared event: release the futex waiters that were blocked before the pulse, */
+/* a single one for an auto-reset event if no thread was waiting for it in the server */
+void shm_sync_pulse( struct shm_sync_object *sync )
+{
+    struct shm_sync_info *info = get_shm_sync_info( sync );
+
+    if (!info->manual_reset && !interlocked_cmpxchg( &sync->state, 0, 1 )) return;
+    interlocked_xchg( &sync->state, 0 );
+    interlocked_xchg_add( (int *)&info->pulse, 1 );
+    shm_sync_wake( sync );
+}
+
+/* check if the object can be acquired by the thread of a wait queue entry */
+int shm_sync_signaled( struct shm_sync_object *sync, struct wait_queue_entry *entry )
+{
+    switch (get_shm_sync_info( sync )->type)
+    {
+    case SHM_SYNC_EVENT:
+    case SHM_SYNC_SEMAPHORE:
+        return sync->state != 0;
+    case SHM_SYNC_MUTEX:
+        /* FIXME: the owner of a mutex at the recursion limit waits forever instead of failing */
+        if (sync->state == get_wait_queue_thread( entry )->id) return sync->count < MAXLONG;
+        return !sync->state;
+    }
+    return 0;
+}
+
+/* atomically acquire the object for a waiting thread; it may have been grabbed */
+/* by a client since it was found signaled, in which case 0 is returned */
+/* returns 2 if an abandoned mutex was acquired, 1 otherwise */
+int shm_sync_acquire( struct shm_sync_object *sync, struct wait_queue_entry *entry )
+{
+    struct shm_sync_info *info = get_shm_sync_info( sync );
+    struct thread *thread = get_wait_queue_thread( entry );
+    int val;
+
+    switch (info->type)
+    {
+    case SHM_SYNC_EVENT:
+        if (info->manual_reset) return sync->state != 0;
+        return interlocked_cmpxchg( &sync->state, 0, 1 ) == 1;
+    case SHM_SYNC_SEMAPHORE:
+        while ((val = sync->state))
+            if (interlocked_cmpxchg( &sync->state, val - 1, val ) == val) return 1;
+        return 0;
+    case SHM_SYNC_MUTEX:
+        if (sync->state == thread->id)
+        {
+            if (sync->count >= MAXLONG) return 0;
+            sync->count++;
+            return 1;
+        }
+        if (interlocked_cmpxchg( &sync->state, thread->id, 0 )) return 0;
+        sync->count = 1;
+        shm_sync_set_owner( sync, thread );
+        return interlocked_xchg( &sync->abandoned, 0 ) ? 2 : 1;
+    }
+    return 0;
+}
+
+/* undo a successful shm_sync_acquire when the rest of a wait-all could not be satisfied */
+void shm_sync_undo_acquire( struct shm_sync_object *sync, int acquired )
+{
+    struct shm_sync_info *info = get_shm_sync_info( sync );
+
+    switch (info->type)
+    {
+    case SHM_SYNC_EVENT:
+        if (!info->manual_reset) interlocked_xchg( &sync->state, 1 );
+        break;
+    case SHM_SYNC_SEMAPHORE:
+        interlocked_xchg_add( &sync->state, 1 );
+        break;
+    case SHM_SYNC_MUTEX:
+        if (--sync->count) return;
+        if (acquired == 2) sync->abandoned = 1;
+        shm_sync_clear_owner( sync );
+        interlocked_xchg( &sync->state, 0 );
+        break;
+    }
+    shm_sync_wake( sync );
+}
+
+/* get the shared state index of an object */
+DECL_HANDLER(get_shm_sync)
+{
+    struct object *obj;
+
+    if (!shm_sync_region)
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if (obj->sync)
+    {
+        reply->index      = get_slot_index( obj->sync );
+        reply->access     = get_handle_access( current->process, req->handle );
+        reply->generation = get_shm_sync_info( obj->sync )->generation;
+        if (get_shm_sync_info( obj->sync )->type == SHM_SYNC_MUTEX)
+            reply->owner = get_thread_slot( current );
+    }
+    else set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
+
+/* wake up the server-side waiters of an object */
+DECL_HANDLER(wake_shm_sync)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    if (obj->sync) wake_up( obj, 0 );
+    release_object( obj );
+}
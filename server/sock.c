@@ -112,6 +112,7 @@ struct sock
 static void sock_dump( struct object *obj, int verbose );
 static int sock_signaled( struct object *obj, struct wait_queue_entry *entry );
 static struct fd *sock_get_fd( struct object *obj );
+static int sock_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 static void sock_destroy( struct object *obj );
 
 static int sock_get_poll_events( struct fd *fd );
@@ -141,7 +142,7 @@ static const struct object_ops sock_ops =
     default_set_sd,               /* set_sd */
     no_lookup_name,               /* lookup_name */
     no_open_file,                 /* open_file */
-    fd_close_handle,              /* close_handle */
+    sock_close_handle,            /* close_handle */
     sock_destroy                  /* destroy */
 };
 
@@ -247,7 +248,6 @@ static int sock_reselect( struct sock *sock )
         if (!(sock->state & ~FD_WINE_NONBLOCKING)) return 0;
         /* ok, it is, attach it to the wineserver's main poll loop */
         sock->polling = 1;
-        allow_fd_caching( sock->fd );
     }
     /* update condition mask */
     set_fd_events( sock->fd, ev );
@@ -398,6 +398,7 @@ static void sock_poll_event( struct fd *fd, int event )
             /* we got connected */
             sock->state |= FD_WINE_CONNECTED|FD_READ|FD_WRITE;
             sock->state &= ~FD_CONNECT;
+            allow_tracked_fd_caching( sock->fd );
         }
     }
     else if (sock->state & FD_WINE_LISTENING)
@@ -580,6 +581,17 @@ static struct fd *sock_get_fd( struct object *obj )
     return (struct fd *)grab_object( sock->fd );
 }
 
+static int sock_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
+{
+    struct sock *sock = (struct sock *)obj;
+    int ret = fd_close_handle( obj, process, handle );
+
+    /* the client drops its cached fd with the handle; handles are also closed
+     * when the handle table of the process is destroyed, whatever we return */
+    if (sock->fd && (ret || !process->handles)) remove_fd_cache_user( sock->fd, process, handle );
+    return ret;
+}
+
 static void sock_destroy( struct object *obj )
 {
     struct sock *sock = (struct sock *)obj;
@@ -654,6 +666,8 @@ static struct object *create_socket( int family, int type, int protocol, unsigne
         release_object( sock );
         return NULL;
     }
+    /* unconnected stream sockets may still be accepted into, which replaces their fd */
+    if (type != SOCK_STREAM) allow_tracked_fd_caching( sock->fd );
     sock_reselect( sock );
     clear_error();
     return &sock->obj;
@@ -731,6 +745,7 @@ static struct sock *accept_socket( obj_handle_t handle )
             release_object( sock );
             return NULL;
         }
+        allow_tracked_fd_caching( acceptsock->fd );
     }
     clear_error();
     sock->pmask &= ~FD_ACCEPT;
@@ -776,6 +791,8 @@ static int accept_into_socket( struct sock *sock, struct sock *acceptsock )
     acceptsock->deferred = NULL;
     release_object( acceptsock->fd );
     acceptsock->fd = newfd;
+    /* the client has to drop any fd it cached for the accepting socket */
+    allow_tracked_fd_caching( acceptsock->fd );
 
     clear_error();
     sock->pmask &= ~FD_ACCEPT;
@@ -951,7 +968,11 @@ DECL_HANDLER(accept_into_socket)
         return;
     }
 
-    if (accept_into_socket( sock, acceptsock ))
+    /* other open handles would keep using the fd that was cached for them, only
+     * the client of this handle drops it (this happens with TF_REUSE_SOCKET) */
+    if (is_fd_cached_elsewhere( acceptsock->fd, current->process, req->ahandle ))
+        set_error( STATUS_INVALID_PARAMETER );
+    else if (accept_into_socket( sock, acceptsock ))
     {
         acceptsock->wparam = req->ahandle;  /* wparam for message is the socket handle */
         sock_reselect( acceptsock );
@@ -1050,6 +1071,7 @@ DECL_HANDLER(enable_socket_event)
     sock->state |= req->sstate;
     sock->state &= ~req->cstate;
     if ( sock->type != SOCK_STREAM ) sock->state &= ~STREAM_FLAG_MASK;
+    if (sock->state & (FD_WINE_CONNECTED|FD_WINE_LISTENING)) allow_tracked_fd_caching( sock->fd );
 
     sock_reselect( sock );
 
@@ -194,6 +194,8 @@ static inline void init_thread_structure( struct thread *thread )
     thread->suspend         = 0;
     thread->desktop_users   = 0;
     thread->token           = NULL;
+    thread->shm_sync_slot   = 0;
+    thread->shm_sync_untracked = 0;
 
     thread->creation_time = current_time;
     thread->exit_time     = 0;
@@ -536,12 +538,15 @@ int add_queue( struct object *obj, struct wait_queue_entry *entry )
     grab_object( obj );
     entry->obj = obj;
     list_add_tail( &obj->wait_queue, &entry->entry );
+    /* tell the clients that they need to wake us up */
+    if (obj->sync) interlocked_xchg_add( &get_shm_sync_info( obj->sync )->server_waiters, 1 );
     return 1;
 }
 
 /* remove a thread from an object wait queue */
 void remove_queue( struct object *obj, struct wait_queue_entry *entry )
 {
+    if (obj->sync) interlocked_xchg_add( &get_shm_sync_info( obj->sync )->server_waiters, -1 );
     list_remove( &entry->entry );
     release_object( obj );
 }
@@ -633,6 +638,31 @@ static int wait_on_handles( const select_op_t *select_op, unsigned int count, co
     return ret;
 }
 
+/* acquire the shared objects of a wait-all; they can be grabbed by the clients at any time */
+static int acquire_shm_sync_objects( struct thread_wait *wait )
+{
+    struct wait_queue_entry *entry;
+    int i, acquired[MAXIMUM_WAIT_OBJECTS];
+
+    for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+    {
+        if (!entry->obj->sync) continue;
+        if (!(acquired[i] = shm_sync_acquire( entry->obj->sync, entry ))) break;
+    }
+    if (i == wait->count)
+    {
+        for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+            if (entry->obj->sync && acquired[i] == 2) make_wait_abandoned( entry );
+        return 1;
+    }
+    while (i-- > 0)
+    {
+        entry = wait->queues + i;
+        if (entry->obj->sync) shm_sync_undo_acquire( entry->obj->sync, acquired[i] );
+    }
+    return 0;
+}
+
 /* check if the thread waiting condition is satisfied */
 static int check_wait( struct thread *thread )
 {
@@ -656,6 +686,7 @@ static int check_wait( struct thread *thread )
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             not_ok |= !entry->obj->ops->signaled( entry->obj, entry );
         if (not_ok) goto other_checks;
+        if (!acquire_shm_sync_objects( wait )) goto other_checks;
         /* Wait satisfied: tell it to all objects */
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             entry->obj->ops->satisfied( entry->obj, entry );
@@ -666,6 +697,12 @@ static int check_wait( struct thread *thread )
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
         {
             if (!entry->obj->ops->signaled( entry->obj, entry )) continue;
+            if (entry->obj->sync)
+            {
+                int acquired = shm_sync_acquire( entry->obj->sync, entry );
+                if (!acquired) continue;
+                if (acquired == 2) make_wait_abandoned( entry );
+            }
             /* Wait satisfied: tell it to the object */
             entry->obj->ops->satisfied( entry->obj, entry );
             if (wait->abandoned) i += STATUS_ABANDONED_WAIT_0;
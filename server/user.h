@@ -100,6 +100,7 @@ extern struct thread *get_first_global_hook( int id );
 
 /* queue functions */
 
+extern void init_shm_queues(void);
 extern void free_msg_queue( struct thread *thread );
 extern struct hook_table *get_queue_hooks( struct thread *thread );
 extern void set_queue_hooks( struct thread *thread, struct hook_table *hooks );
@@ -145,6 +146,7 @@ extern int rect_in_region( struct region *region, const rectangle_t *rect );
 
 /* window functions */
 
+extern void init_shm_windows(void);
 extern struct process *get_top_window_owner( struct desktop *desktop );
 extern void get_top_window_rectangle( struct desktop *desktop, rectangle_t *rect );
 extern void post_desktop_message( struct desktop *desktop, unsigned int message,
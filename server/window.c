@@ -22,7 +22,16 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -174,6 +183,79 @@ static inline void update_pixel_format_flags( struct window *win )
         win->paint_flags |= PAINT_PIXEL_FORMAT_CHILD;
 }
 
+/* The basic state of every window is published in a file mapping indexed by
+ * the user handle, so that the clients can query windows of other processes
+ * without a server round trip. */
+
+#define SHM_MAX_WINDOWS ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
+
+static struct shm_window *shm_windows;  /* shared region, NULL if not available */
+
+/* create the shared window region in the server directory */
+void init_shm_windows(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    size_t size = SHM_MAX_WINDOWS * sizeof(struct shm_window);
+    void *ptr;
+    int fd;
+
+    /* the clients open the same file from the server directory */
+    if ((fd = open( "windows", O_CREAT | O_TRUNC | O_RDWR, 0600 )) == -1)
+    {
+        fprintf( stderr, "wineserver: cannot create window region: %s\n", strerror( errno ));
+        return;
+    }
+    if (ftruncate( fd, size ) == -1 ||
+        (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        fprintf( stderr, "wineserver: cannot map window region: %s\n", strerror( errno ));
+        close( fd );
+        return;
+    }
+    close( fd );
+    shm_windows = ptr;
+#endif
+}
+
+/* get the shared entry of a window */
+static inline struct shm_window *get_shm_window( struct window *win )
+{
+    if (!shm_windows) return NULL;
+    return &shm_windows[((win->handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+}
+
+/* publish the current window state to the clients */
+static void update_shm_window( struct window *win )
+{
+    struct shm_window *shared = get_shm_window( win );
+
+    if (!shared) return;
+    interlocked_xchg_add( &shared->seq, 1 );
+    shared->handle      = win->handle;
+    shared->parent      = win->parent ? win->parent->handle : 0;
+    shared->owner       = win->owner;
+    shared->tid         = win->thread ? get_thread_id( win->thread ) : 0;
+    shared->pid         = win->thread ? get_process_id( win->thread->process ) : 0;
+    shared->style       = win->style;
+    shared->ex_style    = win->ex_style;
+    shared->id          = win->id;
+    shared->text_len    = win->text ? strlenW( win->text ) : 0;
+    shared->window_rect = win->window_rect;
+    shared->client_rect = win->client_rect;
+    interlocked_xchg_add( &shared->seq, 1 );
+}
+
+/* mark the shared entry of a destroyed window as unused */
+static void clear_shm_window( struct window *win )
+{
+    struct shm_window *shared = get_shm_window( win );
+
+    if (!shared) return;
+    interlocked_xchg_add( &shared->seq, 1 );
+    shared->handle = 0;
+    interlocked_xchg_add( &shared->seq, 1 );
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -227,6 +309,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_shm_window( win );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -527,6 +610,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     }
 
     current->desktop_users++;
+    update_shm_window( win );
     return win;
 
 failed:
@@ -549,7 +633,11 @@ void destroy_thread_windows( struct thread *thread )
     while ((win = next_user_handle( &handle, USER_WINDOW )))
     {
         if (win->thread != thread) continue;
-        if (is_desktop_window( win )) detach_window_thread( win );
+        if (is_desktop_window( win ))
+        {
+            detach_window_thread( win );
+            update_shm_window( win );
+        }
         else destroy_window( win );
     }
 }
@@ -1633,6 +1721,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_shm_window( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1646,6 +1735,7 @@ static void set_window_pos( struct window *win, struct window *previous,
             offset_rect( &child->window_rect, new_size - old_size, 0 );
             offset_rect( &child->visible_rect, new_size - old_size, 0 );
             offset_rect( &child->client_rect, new_size - old_size, 0 );
+            update_shm_window( child );
         }
     }
 
@@ -1831,6 +1921,7 @@ void destroy_window( struct window *win )
     if (win == progman_window) progman_window = NULL;
     if (win == taskman_window) taskman_window = NULL;
     free_hotkeys( win->desktop, win->handle );
+    clear_shm_window( win );
     free_user_handle( win->handle );
     destroy_properties( win );
     list_remove( &win->entry );
@@ -1914,7 +2005,11 @@ DECL_HANDLER(destroy_window)
     if (win)
     {
         if (!is_desktop_window(win)) destroy_window( win );
-        else if (win->thread == current) detach_window_thread( win );
+        else if (win->thread == current)
+        {
+            detach_window_thread( win );
+            update_shm_window( win );
+        }
         else set_error( STATUS_ACCESS_DENIED );
     }
 }
@@ -1933,6 +2028,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shm_window( desktop->top_window );
         }
     }
 
@@ -1945,6 +2041,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shm_window( desktop->msg_window );
         }
     }
 
@@ -1980,6 +2077,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_shm_window( win );
 }
 
 
@@ -2055,6 +2153,7 @@ DECL_HANDLER(set_window_info)
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
+    update_shm_window( win );
 }
 
 
@@ -2356,6 +2455,7 @@ DECL_HANDLER(set_window_text)
         }
         free( win->text );
         win->text = text;
+        update_shm_window( win );
     }
 }
 